@@ -123,6 +123,7 @@ function withCommonRunOptions (cmd) {
 
 withCommonRunOptions(program.command("watch"))
     .description("Rebuild and refresh when source code changes")
+    .option("--native", "Run the cart in the native desktop runtime, which reloads it in place", false)
     .action(opts => {
         const watch = require("./lib/watch");
         watch.start(opts);
@@ -142,6 +143,8 @@ withCommonRunOptions(program.command("run <cart>"))
 
 program.command("run-native <cart>")
     .description("Open a cartridge in the native desktop runtime")
+    .option("--watch", "Reload the cart whenever it changes, keeping the window open", false)
+    .option("--hot", "Enable hot swapping. When the cart is reloaded, the console memory will be preserved, allowing code changes to the cart without resetting.", false)
     .action((cart, opts) => {
         const runNative = require("./lib/run-native");
         runNative.run(cart, opts);
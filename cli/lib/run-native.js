@@ -28,6 +28,12 @@ function run (cart, opts) {
         executable = tmp;
     }
 
-    spawn(executable, [cart], {stdio: "inherit"});
+    const args = [cart];
+    if (opts.hot) {
+        args.push("--hot");
+    } else if (opts.watch) {
+        args.push("--watch");
+    }
+    spawn(executable, args, {stdio: "inherit"});
 }
 exports.run = run;
@@ -3,6 +3,7 @@ const path = require("path");
 const { spawn } = require("child_process");
 const watch = require("node-watch");
 
+const runNative = require("./run-native");
 const server = require("./server");
 
 function start (opts) {
@@ -60,7 +61,12 @@ function start (opts) {
             }
             if (serveAfterBuild) {
                 serveAfterBuild = false;
-                server.start(buildOutput, opts);
+                if (opts.native) {
+                    // Started once, the runtime reloads the cart itself after each build
+                    runNative.run(buildOutput, {watch: true, hot: opts.hot});
+                } else {
+                    server.start(buildOutput, opts);
+                }
             }
         });
     }
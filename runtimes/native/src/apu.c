@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include "util.h"
+
 #define SAMPLE_RATE 44100
 #define MAX_VOLUME 0x1333 // ~15% of INT16_MAX
 // The triangle channel sounds a bit quieter than the others, so give it higher amplitude
@@ -63,11 +65,18 @@ typedef struct {
     };
 } Channel;
 
-static Channel channels[4] = { 0 };
+typedef struct {
+    Channel channels[4];
+
+    /** The current time in samples and ticks respectively. */
+    unsigned long long time;
+    unsigned long long ticks;
+} ApuState;
 
-/** The current time in samples and ticks respectively. */
-static unsigned long long time = 0;
-static unsigned long long ticks = 0;
+static ApuState defaultState = { 0 };
+
+/** The state of the console instance bound to this thread. */
+static W4_THREAD_LOCAL ApuState* apu = &defaultState;
 
 static int w4_min (int a, int b) {
     return a < b ? a : b;
@@ -81,13 +90,13 @@ static float lerpf (float value1, float value2, float t) {
 }
 
 static int ramp (int value1, int value2, unsigned long long time1, unsigned long long time2) {
-    if (time >= time2) return value2;
-    float t = (float)(time - time1) / (time2 - time1);
+    if (apu->time >= time2) return value2;
+    float t = (float)(apu->time - time1) / (time2 - time1);
     return lerp(value1, value2, t);
 }
 static float rampf (float value1, float value2, unsigned long long time1, unsigned long long time2) {
-    if (time >= time2) return value2;
-    float t = (float)(time - time1) / (time2 - time1);
+    if (apu->time >= time2) return value2;
+    float t = (float)(apu->time - time1) / (time2 - time1);
     return lerpf(value1, value2, t);
 }
 
@@ -100,13 +109,13 @@ static float getCurrentFrequency (const Channel* channel) {
 }
 
 static int16_t getCurrentVolume (const Channel* channel) {
-    if (time >= channel->sustainTime && (channel->releaseTime - channel->sustainTime) > RELEASE_TIME_TRIANGLE) {
+    if (apu->time >= channel->sustainTime && (channel->releaseTime - channel->sustainTime) > RELEASE_TIME_TRIANGLE) {
         // Release
         return ramp(channel->sustainVolume, 0, channel->sustainTime, channel->releaseTime);
-    } else if (time >= channel->decayTime) {
+    } else if (apu->time >= channel->decayTime) {
         // Sustain
         return channel->sustainVolume;
-    } else if (time >= channel->attackTime) {
+    } else if (apu->time >= channel->attackTime) {
         // Decay
         return ramp(channel->peakVolume, channel->sustainVolume, channel->attackTime, channel->decayTime);
     } else {
@@ -131,12 +140,24 @@ static float midiFreq (uint8_t note, uint8_t bend) {
     return powf(2.0f, ((float)note - 69.0f + (float)bend / 256.0f) / 12.0f) * 440.0f;
 }
 
+int w4_apuStateSize () {
+    return sizeof(ApuState);
+}
+
+void* w4_apuGetState () {
+    return apu;
+}
+
+void w4_apuBindState (void* state) {
+    apu = (state != NULL) ? state : &defaultState;
+}
+
 void w4_apuInit () {
-    channels[3].noise.seed = 0x0001;
+    apu->channels[3].noise.seed = 0x0001;
 }
 
 void w4_apuTick () {
-    ticks++;
+    apu->ticks++;
 }
 
 void w4_apuTone (int frequency, int duration, int volume, int flags) {
@@ -157,10 +178,10 @@ void w4_apuTone (int frequency, int duration, int volume, int flags) {
     int noteMode = flags & 0x40;
 
     // TODO(2022-01-08): Thread safety
-    Channel* channel = &channels[channelIdx];
+    Channel* channel = &apu->channels[channelIdx];
 
     // Restart the phase if this channel wasn't already playing
-    if (time > channel->releaseTime && ticks != channel->endTick) {
+    if (apu->time > channel->releaseTime && apu->ticks != channel->endTick) {
         channel->phase = (channelIdx == 2) ? 0.25 : 0;
     }
     if (noteMode) {
@@ -170,12 +191,12 @@ void w4_apuTone (int frequency, int duration, int volume, int flags) {
         channel->freq1 = freq1;
         channel->freq2 = freq2;
     }
-    channel->startTime = time;
+    channel->startTime = apu->time;
     channel->attackTime = channel->startTime + SAMPLE_RATE*attack/60;
     channel->decayTime = channel->attackTime + SAMPLE_RATE*decay/60;
     channel->sustainTime = channel->decayTime + SAMPLE_RATE*sustain/60;
     channel->releaseTime = channel->sustainTime + SAMPLE_RATE*release/60;
-    channel->endTick = ticks + attack + decay + sustain + release;
+    channel->endTick = apu->ticks + attack + decay + sustain + release;
     int16_t maxVolume = (channelIdx == 2) ? MAX_VOLUME_TRIANGLE : MAX_VOLUME;
     channel->sustainVolume = maxVolume * sustainVolume/100;
     channel->peakVolume = peakVolume ? maxVolume * peakVolume/100 : maxVolume;
@@ -202,13 +223,13 @@ void w4_apuTone (int frequency, int duration, int volume, int flags) {
 }
 
 void w4_apuWriteSamples (int16_t* output, unsigned long frames) {
-    for (int ii = 0; ii < frames; ++ii, ++time) {
+    for (int ii = 0; ii < frames; ++ii, ++apu->time) {
         int16_t mix_left = 0, mix_right = 0;
 
         for (int channelIdx = 0; channelIdx < 4; ++channelIdx) {
-            Channel* channel = &channels[channelIdx];
+            Channel* channel = &apu->channels[channelIdx];
 
-            if (time < channel->releaseTime || ticks == channel->endTick) {
+            if (apu->time < channel->releaseTime || apu->ticks == channel->endTick) {
                 float freq = getCurrentFrequency(channel);
                 int16_t volume = getCurrentVolume(channel);
                 int16_t sample;
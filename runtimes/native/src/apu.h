@@ -5,6 +5,13 @@
 
 void w4_apuInit ();
 
+// The APU state is bound per thread. Instances other than the default one are allocated by the
+// caller, w4_apuStateSize() zeroed bytes, and bound before w4_apuInit(). Binding NULL restores the
+// default instance.
+int w4_apuStateSize ();
+void* w4_apuGetState ();
+void w4_apuBindState (void* state);
+
 void w4_apuTick ();
 
 void w4_apuTone (int frequency, int duration, int volume, int flags);
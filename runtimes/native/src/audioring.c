@@ -0,0 +1,153 @@
+#include "audioring.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+// How far the playback rate may stray from the production rate. 0.5% is below what can be heard
+// as a pitch change.
+#define MAX_RATE_ADJUST 0.005
+
+// Weight of each new fill measurement, smoothing out the bursts of whole updates being pushed
+#define FILL_SMOOTHING 0.05
+
+#if !defined(_MSC_VER)
+#define LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#define LOAD_RELAXED(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define ADD_RELAXED(ptr, value) __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED)
+#else
+#define LOAD_ACQUIRE(ptr) (*(ptr))
+#define STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#define LOAD_RELAXED(ptr) (*(ptr))
+#define ADD_RELAXED(ptr, value) (*(ptr) += (value))
+#endif
+
+struct w4_AudioRing {
+    int16_t* samples;
+    uint32_t capacity;
+    uint32_t target;
+
+    /** Free running frame positions. */
+    uint32_t writePos;
+    uint32_t readPos;
+
+    /** Consumer state: the position between the next two frames, and whether the ring has
+     * filled up to the target since it last ran dry. */
+    double phase;
+    double smoothedFill;
+    double ratio;
+    bool primed;
+
+    /** Counters read by other threads. */
+    uint64_t underruns;
+    uint64_t droppedFrames;
+    uint32_t lastFill;
+};
+
+w4_AudioRing* w4_audioRingNew (uint32_t capacity, uint32_t target) {
+    w4_AudioRing* ring = xmalloc(sizeof(w4_AudioRing));
+    memset(ring, 0, sizeof(w4_AudioRing));
+
+    ring->capacity = 1;
+    while (ring->capacity < capacity) {
+        ring->capacity <<= 1;
+    }
+    ring->target = (target < ring->capacity / 2) ? target : ring->capacity / 2;
+    ring->samples = xmalloc(2 * ring->capacity * sizeof(int16_t));
+    ring->smoothedFill = ring->target;
+    ring->ratio = 1;
+    return ring;
+}
+
+void w4_audioRingDelete (w4_AudioRing* ring) {
+    free(ring->samples);
+    free(ring);
+}
+
+uint32_t w4_audioRingPush (w4_AudioRing* ring, const int16_t* samples, uint32_t frames) {
+    uint32_t writePos = ring->writePos;
+    uint32_t space = ring->capacity - (writePos - LOAD_ACQUIRE(&ring->readPos));
+    uint32_t dropped = 0;
+    if (frames > space) {
+        dropped = frames - space;
+        frames = space;
+        ADD_RELAXED(&ring->droppedFrames, dropped);
+    }
+
+    for (uint32_t n = 0; n < frames; ++n) {
+        uint32_t idx = (writePos + n) & (ring->capacity - 1);
+        ring->samples[2*idx] = samples[2*n];
+        ring->samples[2*idx + 1] = samples[2*n + 1];
+    }
+    STORE_RELEASE(&ring->writePos, writePos + frames);
+    return dropped;
+}
+
+void w4_audioRingPull (w4_AudioRing* ring, int16_t* output, uint32_t frames) {
+    uint32_t readPos = ring->readPos;
+    uint32_t available = LOAD_ACQUIRE(&ring->writePos) - readPos;
+    ring->lastFill = available;
+
+    if (!ring->primed) {
+        if (available < ring->target) {
+            memset(output, 0, 2 * frames * sizeof(int16_t));
+            return;
+        }
+        ring->primed = true;
+        ring->phase = 0;
+        ring->smoothedFill = available;
+    }
+
+    // Play slightly faster when the ring is fuller than the target, and slower when emptier
+    ring->smoothedFill += FILL_SMOOTHING * ((double)available - ring->smoothedFill);
+    double error = (ring->smoothedFill - ring->target) / ring->target;
+    if (error > 1) {
+        error = 1;
+    } else if (error < -1) {
+        error = -1;
+    }
+    ring->ratio = 1 + MAX_RATE_ADJUST * error;
+
+    // Linear interpolation between the two frames around the phase
+    uint32_t consumed = 0;
+    double phase = ring->phase;
+    uint32_t n = 0;
+    for (; n < frames; ++n) {
+        if (consumed + 1 >= available) {
+            break;
+        }
+        uint32_t idx0 = (readPos + consumed) & (ring->capacity - 1);
+        uint32_t idx1 = (readPos + consumed + 1) & (ring->capacity - 1);
+        for (int channel = 0; channel < 2; ++channel) {
+            double a = ring->samples[2*idx0 + channel];
+            double b = ring->samples[2*idx1 + channel];
+            output[2*n + channel] = (int16_t)(a + (b - a) * phase);
+        }
+
+        phase += ring->ratio;
+        while (phase >= 1) {
+            phase -= 1;
+            ++consumed;
+        }
+    }
+
+    if (n < frames) {
+        // Ran dry, wait for the ring to fill back up to the target
+        memset(output + 2*n, 0, 2 * (frames - n) * sizeof(int16_t));
+        ADD_RELAXED(&ring->underruns, 1);
+        ring->primed = false;
+    }
+
+    ring->phase = phase;
+    STORE_RELEASE(&ring->readPos, readPos + consumed);
+}
+
+void w4_audioRingGetStats (w4_AudioRing* ring, w4_AudioRingStats* stats) {
+    stats->fill = LOAD_RELAXED(&ring->lastFill);
+    stats->ratio = ring->ratio;
+    stats->underruns = LOAD_RELAXED(&ring->underruns);
+    stats->droppedFrames = LOAD_RELAXED(&ring->droppedFrames);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Single producer, single consumer ring of interleaved stereo samples. The game thread pushes
+// exactly one update's worth of samples per update, and the audio thread pulls them at the
+// device's pace, resampling very slightly to keep the ring near a target fill. Samples are
+// dropped only when the ring is full, and silence is played while it refills after running dry.
+
+typedef struct w4_AudioRing w4_AudioRing;
+
+// Sizes are in stereo frames, the capacity is rounded up to a power of two
+w4_AudioRing* w4_audioRingNew (uint32_t capacity, uint32_t target);
+void w4_audioRingDelete (w4_AudioRing* ring);
+
+// Producer side. Returns the number of frames dropped because the ring was full.
+uint32_t w4_audioRingPush (w4_AudioRing* ring, const int16_t* samples, uint32_t frames);
+
+// Consumer side, always writes the requested number of frames
+void w4_audioRingPull (w4_AudioRing* ring, int16_t* output, uint32_t frames);
+
+typedef struct {
+    uint32_t fill;
+    double ratio;
+    uint64_t underruns;
+    uint64_t droppedFrames;
+} w4_AudioRingStats;
+
+void w4_audioRingGetStats (w4_AudioRing* ring, w4_AudioRingStats* stats);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Telemetry for the audio device callback, to tell whether crackling comes from synthesis being
+// too slow or from the callback being scheduled late. Recording is lock-free, the callback
+// functions are only called from the audio thread and the rest from any thread.
+
+void w4_audioStatsBeginCallback (long frames);
+void w4_audioStatsEndCallback ();
+
+// Stream state changes reported by the audio device
+void w4_audioStatsStreamError ();
+void w4_audioStatsStreamStopped ();
+
+// The device's output latency, added to the tick to sample lag
+void w4_audioStatsSetLatency (uint32_t frames);
+
+// Called after every game update, which is when the APU picks up new sounds
+void w4_audioStatsGameTick ();
+
+// Prints everything recorded so far
+void w4_audioStatsPrint ();
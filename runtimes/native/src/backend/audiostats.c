@@ -0,0 +1,179 @@
+#include "../audiostats.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+#define SAMPLE_RATE 44100
+
+// Histogram buckets are powers of two: bucket n counts values in [2^(n-1), 2^n)
+#define BUCKETS 24
+
+#if !defined(_MSC_VER)
+#define ATOMIC_ADD(ptr, value) __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define ATOMIC_STORE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELAXED)
+#else
+#define ATOMIC_ADD(ptr, value) (*(ptr) += (value))
+#define ATOMIC_LOAD(ptr) (*(ptr))
+#define ATOMIC_STORE(ptr, value) (*(ptr) = (value))
+#endif
+
+typedef struct {
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+static struct {
+    uint64_t callbacks;
+    uint64_t frames;
+
+    /** Callbacks that took longer than the audio they produced lasts. */
+    uint64_t overDeadline;
+
+    /** Callbacks that started so late after the previous one that the device likely ran dry. */
+    uint64_t lateCallbacks;
+
+    uint64_t streamErrors;
+    uint64_t streamStops;
+    uint32_t latencyFrames;
+
+    /** When the last game update ran, 0 until the first one. */
+    uint64_t lastTickNs;
+
+    Histogram framesPerCallback;
+    Histogram durationUs;
+    Histogram deadlinePercent;
+    Histogram callbackGapUs;
+    Histogram tickLagUs;
+} stats;
+
+// Only touched by the audio thread
+static uint64_t callbackStartNs = 0;
+static uint64_t previousStartNs = 0;
+static long previousFrames = 0;
+static long callbackFrames = 0;
+static uint64_t tickSeenNs = 0;
+
+static uint64_t nowNs () {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (uint64_t)spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+static void record (Histogram* histogram, uint64_t value) {
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && (value >> bucket) != 0) {
+        ++bucket;
+    }
+    ATOMIC_ADD(&histogram->counts[bucket], 1);
+    ATOMIC_ADD(&histogram->total, value);
+
+    // Only the audio thread records, so the max can't race with another writer
+    if (value > ATOMIC_LOAD(&histogram->max)) {
+        ATOMIC_STORE(&histogram->max, value);
+    }
+}
+
+static void printHistogram (const char* label, const char* unit, const Histogram* histogram) {
+    uint64_t count = 0;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        count += ATOMIC_LOAD(&histogram->counts[bucket]);
+    }
+    if (count == 0) {
+        printf("%-18s -\n", label);
+        return;
+    }
+
+    printf("%-18s mean %.1f %s, max %llu %s\n", label, (double)ATOMIC_LOAD(&histogram->total) / count,
+        unit, (unsigned long long)ATOMIC_LOAD(&histogram->max), unit);
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        uint64_t bucketCount = ATOMIC_LOAD(&histogram->counts[bucket]);
+        if (bucketCount > 0) {
+            unsigned long long low = bucket ? 1ull << (bucket - 1) : 0;
+            printf("    %8llu .. %-8llu %10llu (%.1f%%)\n", low, (1ull << bucket) - 1,
+                (unsigned long long)bucketCount, 100.0 * bucketCount / count);
+        }
+    }
+}
+
+void w4_audioStatsBeginCallback (long frames) {
+    uint64_t now = nowNs();
+    callbackStartNs = now;
+    callbackFrames = frames;
+
+    if (previousStartNs != 0 && previousFrames > 0) {
+        uint64_t gapNs = now - previousStartNs;
+        uint64_t previousBufferNs = (uint64_t)previousFrames * 1000000000 / SAMPLE_RATE;
+        record(&stats.callbackGapUs, gapNs / 1000);
+
+        // The device had two buffers' worth of time to call back, and didn't
+        if (gapNs > 2 * previousBufferNs) {
+            ATOMIC_ADD(&stats.lateCallbacks, 1);
+        }
+    }
+    previousStartNs = now;
+    previousFrames = frames;
+
+    // How long a sound started by the game waits to be heard, from the first callback after it
+    uint64_t lastTick = ATOMIC_LOAD(&stats.lastTickNs);
+    if (lastTick != tickSeenNs && now > lastTick) {
+        tickSeenNs = lastTick;
+        uint64_t latencyNs = (uint64_t)ATOMIC_LOAD(&stats.latencyFrames) * 1000000000 / SAMPLE_RATE;
+        record(&stats.tickLagUs, (now - lastTick + latencyNs) / 1000);
+    }
+}
+
+void w4_audioStatsEndCallback () {
+    uint64_t durationNs = nowNs() - callbackStartNs;
+    uint64_t deadlineNs = (uint64_t)callbackFrames * 1000000000 / SAMPLE_RATE;
+
+    ATOMIC_ADD(&stats.callbacks, 1);
+    ATOMIC_ADD(&stats.frames, callbackFrames);
+    record(&stats.framesPerCallback, callbackFrames);
+    record(&stats.durationUs, durationNs / 1000);
+    if (deadlineNs > 0) {
+        record(&stats.deadlinePercent, durationNs * 100 / deadlineNs);
+    }
+    if (durationNs > deadlineNs) {
+        ATOMIC_ADD(&stats.overDeadline, 1);
+    }
+}
+
+void w4_audioStatsStreamError () {
+    ATOMIC_ADD(&stats.streamErrors, 1);
+}
+
+void w4_audioStatsStreamStopped () {
+    ATOMIC_ADD(&stats.streamStops, 1);
+}
+
+void w4_audioStatsSetLatency (uint32_t frames) {
+    ATOMIC_STORE(&stats.latencyFrames, frames);
+}
+
+void w4_audioStatsGameTick () {
+    ATOMIC_STORE(&stats.lastTickNs, nowNs());
+}
+
+void w4_audioStatsPrint () {
+    uint32_t latencyFrames = ATOMIC_LOAD(&stats.latencyFrames);
+
+    printf("--- Audio ---\n");
+    printf("Callbacks:         %llu (%llu frames)\n", (unsigned long long)ATOMIC_LOAD(&stats.callbacks),
+        (unsigned long long)ATOMIC_LOAD(&stats.frames));
+    printf("Over deadline:     %llu (synthesis slower than playback)\n",
+        (unsigned long long)ATOMIC_LOAD(&stats.overDeadline));
+    printf("Late callbacks:    %llu (scheduled too late, likely underruns)\n",
+        (unsigned long long)ATOMIC_LOAD(&stats.lateCallbacks));
+    printf("Stream errors:     %llu, stops: %llu\n", (unsigned long long)ATOMIC_LOAD(&stats.streamErrors),
+        (unsigned long long)ATOMIC_LOAD(&stats.streamStops));
+    printf("Device latency:    %u frames (%.1f ms)\n", latencyFrames, latencyFrames * 1000.0 / SAMPLE_RATE);
+    printHistogram("Frames/callback:", "frames", &stats.framesPerCallback);
+    printHistogram("Duration:", "us", &stats.durationUs);
+    printHistogram("Deadline used:", "%", &stats.deadlinePercent);
+    printHistogram("Callback gap:", "us", &stats.callbackGapUs);
+    printHistogram("Tick to sound:", "us", &stats.tickLagUs);
+    printf("-------------\n");
+}
@@ -0,0 +1,593 @@
+#include "../batchio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef W4_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+#include "../util.h"
+
+// The first read of every file, replay logs rarely need a second
+#define INITIAL_READ_SIZE (16 * 1024)
+
+// Threads reading when io_uring isn't available
+#define MAX_PREAD_THREADS 4
+
+// Address space mapped for an append file, and how much the file is grown by at a time
+#define APPEND_RESERVE ((size_t)1 << (sizeof(size_t) >= 8 ? 36 : 28))
+#define APPEND_GROW_SIZE (16 * 1024 * 1024)
+
+typedef struct {
+    int index;
+    uint8_t* bytes;
+    size_t length;
+} ReadFile;
+
+#ifdef W4_IO_URING
+typedef enum {
+    JOB_FREE,
+    JOB_OPENING,
+    JOB_READING,
+    JOB_CLOSING,
+} JobState;
+
+// One file going through open, read and close on the ring
+typedef struct {
+    JobState state;
+    int index;
+    int fd;
+    uint8_t* bytes;
+    size_t length;
+    size_t capacity;
+} Job;
+
+typedef struct {
+    int fd;
+    unsigned entries;
+
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    unsigned pending;
+
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+} Uring;
+#endif
+
+struct w4_FileReader {
+    const char* const* paths;
+    int count;
+    int maxInFlight;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t readyChanged;
+    pthread_cond_t spaceChanged;
+
+    /** Files read and not yet taken, as a queue of maxInFlight entries. */
+    ReadFile* ready;
+    int readyStart;
+    int readyCount;
+
+    /** Files started, files being read, and files handed out by w4_fileReaderNext(). */
+    int started;
+    int reading;
+    int taken;
+    bool stopping;
+
+    pthread_t threads[MAX_PREAD_THREADS];
+    int threadCount;
+
+#ifdef W4_IO_URING
+    bool uring;
+    Uring ring;
+    Job* jobs;
+    int jobCount;
+#endif
+};
+
+// Claims the next file to read, waiting while maxInFlight are already read or being read. Returns
+// -1 when there is nothing left to start. Called with the lock held.
+static int startFile (w4_FileReader* reader, bool wait) {
+    for (;;) {
+        if (reader->stopping || reader->started == reader->count) {
+            return -1;
+        }
+        if (reader->reading + reader->readyCount < reader->maxInFlight) {
+            ++reader->reading;
+            return reader->started++;
+        }
+        if (!wait) {
+            return -1;
+        }
+        pthread_cond_wait(&reader->spaceChanged, &reader->mutex);
+    }
+}
+
+// Called with the lock held
+static void finishFile (w4_FileReader* reader, int index, uint8_t* bytes, size_t length) {
+    ReadFile* file = &reader->ready[(reader->readyStart + reader->readyCount) % reader->maxInFlight];
+    file->index = index;
+    file->bytes = bytes;
+    file->length = length;
+    ++reader->readyCount;
+    --reader->reading;
+    pthread_cond_signal(&reader->readyChanged);
+}
+
+static uint8_t* preadFile (const char* path, size_t* length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    size_t capacity = INITIAL_READ_SIZE;
+    uint8_t* bytes = xmalloc(capacity);
+    size_t used = 0;
+    for (;;) {
+        if (used == capacity) {
+            capacity *= 2;
+            bytes = xrealloc(bytes, capacity);
+        }
+        ssize_t result = pread(fd, bytes + used, capacity - used, used);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            free(bytes);
+            bytes = NULL;
+            break;
+        }
+        if (result == 0) {
+            break;
+        }
+        used += result;
+    }
+    close(fd);
+    *length = used;
+    return bytes;
+}
+
+static void* preadMain (void* userData) {
+    w4_FileReader* reader = userData;
+    pthread_mutex_lock(&reader->mutex);
+    for (;;) {
+        int index = startFile(reader, true);
+        if (index < 0) {
+            break;
+        }
+        pthread_mutex_unlock(&reader->mutex);
+
+        size_t length = 0;
+        uint8_t* bytes = preadFile(reader->paths[index], &length);
+
+        pthread_mutex_lock(&reader->mutex);
+        finishFile(reader, index, bytes, length);
+    }
+    pthread_mutex_unlock(&reader->mutex);
+    return NULL;
+}
+
+#ifdef W4_IO_URING
+static bool uringInit (Uring* ring, unsigned entries) {
+    memset(ring, 0, sizeof(Uring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    // Opening, reading and closing files on the ring needs Linux 5.6, which is also the first to
+    // report these features
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)
+            || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return false;
+    }
+
+    ring->entries = params.sq_entries;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cqRingSize > ring->sqRingSize) {
+        ring->sqRingSize = ring->cqRingSize;
+    }
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+    ring->cqRing = ring->sqRing;
+
+    size_t sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(ring->fd);
+        return false;
+    }
+
+    uint8_t* sq = ring->sqRing;
+    ring->sqHead = (unsigned*)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+
+    uint8_t* cq = ring->cqRing;
+    ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return true;
+}
+
+static void uringDestroy (Uring* ring) {
+    munmap(ring->sqes, ring->entries * sizeof(struct io_uring_sqe));
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
+
+// Queues an operation for the next uringSubmit(). The ring has an entry for every job, and jobs
+// have one operation in flight at a time, so there is always room.
+static struct io_uring_sqe* uringQueue (Uring* ring, Job* job, int opcode) {
+    unsigned tail = *ring->sqTail;
+    unsigned idx = tail & *ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = (uint64_t)(uintptr_t)job;
+    ring->sqArray[idx] = idx;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ++ring->pending;
+    return sqe;
+}
+
+// Submits the queued operations, and waits for at least one completion if wait is set
+static bool uringSubmit (Uring* ring, bool wait) {
+    for (;;) {
+        int result = syscall(__NR_io_uring_enter, ring->fd, ring->pending, wait ? 1 : 0,
+            wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (result >= 0) {
+            ring->pending -= result;
+            return true;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return false;
+        }
+    }
+}
+
+static void queueRead (w4_FileReader* reader, Job* job) {
+    if (job->length == job->capacity) {
+        job->capacity *= 2;
+        job->bytes = xrealloc(job->bytes, job->capacity);
+    }
+    struct io_uring_sqe* sqe = uringQueue(&reader->ring, job, IORING_OP_READ);
+    sqe->fd = job->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(job->bytes + job->length);
+    sqe->len = job->capacity - job->length;
+    sqe->off = job->length;
+    job->state = JOB_READING;
+}
+
+static void queueClose (w4_FileReader* reader, Job* job) {
+    struct io_uring_sqe* sqe = uringQueue(&reader->ring, job, IORING_OP_CLOSE);
+    sqe->fd = job->fd;
+    job->state = JOB_CLOSING;
+}
+
+// Moves a job to its next operation, after the previous one completed with result. Called with
+// the lock held.
+static void advanceJob (w4_FileReader* reader, Job* job, int result) {
+    switch (job->state) {
+    case JOB_OPENING:
+        if (result < 0) {
+            finishFile(reader, job->index, NULL, 0);
+            job->state = JOB_FREE;
+            break;
+        }
+        job->fd = result;
+        job->capacity = INITIAL_READ_SIZE;
+        job->bytes = xmalloc(job->capacity);
+        job->length = 0;
+        queueRead(reader, job);
+        break;
+
+    case JOB_READING:
+        if (result == -EINTR || result == -EAGAIN) {
+            queueRead(reader, job);
+        } else if (result > 0) {
+            job->length += result;
+            queueRead(reader, job);
+        } else {
+            // The file is handed out as soon as it's read, the close completes in the background
+            if (result < 0) {
+                free(job->bytes);
+                job->bytes = NULL;
+            }
+            finishFile(reader, job->index, job->bytes, job->length);
+            job->bytes = NULL;
+            queueClose(reader, job);
+        }
+        break;
+
+    case JOB_CLOSING:
+        job->state = JOB_FREE;
+        break;
+
+    case JOB_FREE:
+        break;
+    }
+}
+
+static void* uringMain (void* userData) {
+    w4_FileReader* reader = userData;
+    Uring* ring = &reader->ring;
+    int active = 0;
+
+    pthread_mutex_lock(&reader->mutex);
+    for (;;) {
+        // Open as many files as there is room for
+        for (int ii = 0; ii < reader->jobCount; ++ii) {
+            Job* job = &reader->jobs[ii];
+            if (job->state != JOB_FREE) {
+                continue;
+            }
+            int index = startFile(reader, false);
+            if (index < 0) {
+                break;
+            }
+            job->index = index;
+            job->state = JOB_OPENING;
+            struct io_uring_sqe* sqe = uringQueue(ring, job, IORING_OP_OPENAT);
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uint64_t)(uintptr_t)reader->paths[index];
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            ++active;
+        }
+
+        if (active == 0) {
+            if (reader->stopping || reader->started == reader->count) {
+                break;
+            }
+            // Everything read is waiting to be taken
+            pthread_cond_wait(&reader->spaceChanged, &reader->mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&reader->mutex);
+        bool ok = uringSubmit(ring, true);
+        pthread_mutex_lock(&reader->mutex);
+        if (!ok) {
+            // Not expected once the ring is set up. Jobs are left to the kernel to cancel, and
+            // the files not yet started are read synchronously instead.
+            for (int ii = 0; ii < reader->jobCount; ++ii) {
+                Job* job = &reader->jobs[ii];
+                if (job->state == JOB_OPENING || job->state == JOB_READING) {
+                    size_t length = 0;
+                    uint8_t* bytes = preadFile(reader->paths[job->index], &length);
+                    finishFile(reader, job->index, bytes, length);
+                }
+            }
+            pthread_mutex_unlock(&reader->mutex);
+            preadMain(reader);
+            return NULL;
+        }
+
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+            Job* job = (Job*)(uintptr_t)cqe->user_data;
+            advanceJob(reader, job, cqe->res);
+            if (job->state == JOB_FREE) {
+                --active;
+            }
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&reader->mutex);
+    return NULL;
+}
+#endif
+
+w4_FileReader* w4_fileReaderNew (const char* const* paths, int count, int maxInFlight) {
+    w4_FileReader* reader = xmalloc(sizeof(w4_FileReader));
+    memset(reader, 0, sizeof(w4_FileReader));
+    reader->paths = paths;
+    reader->count = count;
+    reader->maxInFlight = (maxInFlight > 0) ? maxInFlight : 1;
+    reader->ready = xmalloc(reader->maxInFlight * sizeof(ReadFile));
+
+    pthread_mutex_init(&reader->mutex, NULL);
+    pthread_cond_init(&reader->readyChanged, NULL);
+    pthread_cond_init(&reader->spaceChanged, NULL);
+
+#ifdef W4_IO_URING
+    // A job for every file in flight, and as many again for files that were handed out but are
+    // still closing. Each job has one operation in flight at a time.
+    reader->jobCount = 2 * reader->maxInFlight;
+    if (uringInit(&reader->ring, reader->jobCount)) {
+        reader->uring = true;
+        reader->jobs = xmalloc(reader->jobCount * sizeof(Job));
+        memset(reader->jobs, 0, reader->jobCount * sizeof(Job));
+        reader->threadCount = 1;
+        pthread_create(&reader->threads[0], NULL, uringMain, reader);
+        return reader;
+    }
+#endif
+
+    reader->threadCount = (reader->maxInFlight < MAX_PREAD_THREADS)
+        ? reader->maxInFlight : MAX_PREAD_THREADS;
+    for (int ii = 0; ii < reader->threadCount; ++ii) {
+        pthread_create(&reader->threads[ii], NULL, preadMain, reader);
+    }
+    return reader;
+}
+
+void w4_fileReaderDelete (w4_FileReader* reader) {
+    pthread_mutex_lock(&reader->mutex);
+    reader->stopping = true;
+    pthread_cond_broadcast(&reader->spaceChanged);
+    pthread_mutex_unlock(&reader->mutex);
+
+    // Reads in flight are finished first, so no buffer is freed under the kernel
+    for (int ii = 0; ii < reader->threadCount; ++ii) {
+        pthread_join(reader->threads[ii], NULL);
+    }
+
+#ifdef W4_IO_URING
+    if (reader->uring) {
+        uringDestroy(&reader->ring);
+        free(reader->jobs);
+    }
+#endif
+
+    for (int ii = 0; ii < reader->readyCount; ++ii) {
+        free(reader->ready[(reader->readyStart + ii) % reader->maxInFlight].bytes);
+    }
+    pthread_cond_destroy(&reader->spaceChanged);
+    pthread_cond_destroy(&reader->readyChanged);
+    pthread_mutex_destroy(&reader->mutex);
+    free(reader->ready);
+    free(reader);
+}
+
+int w4_fileReaderNext (w4_FileReader* reader, uint8_t** bytes, size_t* length) {
+    pthread_mutex_lock(&reader->mutex);
+    while (reader->readyCount == 0 && reader->taken < reader->count) {
+        pthread_cond_wait(&reader->readyChanged, &reader->mutex);
+    }
+    if (reader->readyCount == 0) {
+        pthread_mutex_unlock(&reader->mutex);
+        return -1;
+    }
+
+    ReadFile* file = &reader->ready[reader->readyStart];
+    reader->readyStart = (reader->readyStart + 1) % reader->maxInFlight;
+    --reader->readyCount;
+    ++reader->taken;
+    int index = file->index;
+    *bytes = file->bytes;
+    *length = file->length;
+
+    // Wake the readers, and any other caller waiting for a file that will never come
+    pthread_cond_broadcast(&reader->spaceChanged);
+    if (reader->taken == reader->count) {
+        pthread_cond_broadcast(&reader->readyChanged);
+    }
+    pthread_mutex_unlock(&reader->mutex);
+    return index;
+}
+
+const char* w4_fileReaderMethod (const w4_FileReader* reader) {
+#ifdef W4_IO_URING
+    if (reader->uring) {
+        return "io_uring";
+    }
+#endif
+    return "pread";
+}
+
+struct w4_AppendFile {
+    int fd;
+    uint8_t* map;
+    size_t mapLength;
+
+    /** Bytes reserved by appends so far, and the current size of the file. */
+    uint64_t tail;
+    uint64_t fileSize;
+    bool failed;
+
+    /** Held while growing the file. */
+    pthread_mutex_t mutex;
+};
+
+w4_AppendFile* w4_appendFileOpen (const char* path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    // The mapping covers more than the file will ever hold, so it never moves. Only the part
+    // within the file is touched.
+    size_t mapLength = APPEND_RESERVE;
+    void* map = MAP_FAILED;
+    for (; mapLength >= APPEND_GROW_SIZE; mapLength >>= 1) {
+        map = mmap(NULL, mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            break;
+        }
+    }
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    w4_AppendFile* file = xmalloc(sizeof(w4_AppendFile));
+    memset(file, 0, sizeof(w4_AppendFile));
+    file->fd = fd;
+    file->map = map;
+    file->mapLength = mapLength;
+    pthread_mutex_init(&file->mutex, NULL);
+    return file;
+}
+
+int64_t w4_appendFileWrite (w4_AppendFile* file, const void* data, size_t length) {
+    uint64_t offset = __atomic_fetch_add(&file->tail, length, __ATOMIC_RELAXED);
+    uint64_t end = offset + length;
+    if (end > file->mapLength) {
+        __atomic_store_n(&file->failed, true, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    if (end > __atomic_load_n(&file->fileSize, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&file->mutex);
+        uint64_t size = file->fileSize;
+        if (end > size) {
+            size = (end + APPEND_GROW_SIZE - 1) / APPEND_GROW_SIZE * APPEND_GROW_SIZE;
+            if (size > file->mapLength) {
+                size = file->mapLength;
+            }
+            if (ftruncate(file->fd, size) != 0) {
+                pthread_mutex_unlock(&file->mutex);
+                __atomic_store_n(&file->failed, true, __ATOMIC_RELAXED);
+                return -1;
+            }
+            __atomic_store_n(&file->fileSize, size, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&file->mutex);
+    }
+
+    memcpy(file->map + offset, data, length);
+    return offset;
+}
+
+int w4_appendFileClose (w4_AppendFile* file) {
+    bool ok = !file->failed;
+    ok = (munmap(file->map, file->mapLength) == 0) && ok;
+    ok = (ftruncate(file->fd, file->tail) == 0) && ok;
+    ok = (close(file->fd) == 0) && ok;
+    pthread_mutex_destroy(&file->mutex);
+    free(file);
+    return ok ? 0 : -1;
+}
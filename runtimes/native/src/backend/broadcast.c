@@ -0,0 +1,521 @@
+#include "../broadcast.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../runtime.h"
+#include "../util.h"
+#include "../window.h"
+
+#if !defined(_WIN32)
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Every datagram starts with the magic "W4BC", the session and the packet type
+#define MAGIC 0x43423457
+#define HEADER_SIZE 12
+
+#define PACKET_INPUT 1
+#define PACKET_KEYFRAME 2
+
+// An input datagram repeats the frames before it, so losing a few in a row loses nothing
+#define INPUT_REDUNDANCY 16
+#define INPUT_SIZE 9
+
+// Save states are split into fragments that fit in a typical MTU
+#define FRAGMENT_SIZE 1200
+#define KEYFRAME_HEADER_SIZE 16
+#define MAX_FRAGMENTS 1024
+
+// Frames of input a spectator holds on to while it catches up
+#define INPUT_RING 256
+
+// Most updates a spectator runs in one go on top of the window's own, so that catching up after a
+// long stall doesn't freeze the window
+#define MAX_CATCH_UP 120
+
+typedef struct {
+    uint8_t gamepads[4];
+    int16_t mouseX;
+    int16_t mouseY;
+    uint8_t mouseButtons;
+} Input;
+
+struct w4_Broadcast {
+    int socket;
+    struct sockaddr_in address;
+    bool spectator;
+    uint32_t session;
+
+    /** The serialized runtime state, and the same compressed. */
+    uint8_t* state;
+    uint8_t* packed;
+    size_t stateSize;
+
+    // Host
+    int keyframeInterval;
+    uint32_t frame;
+    Input history[INPUT_REDUNDANCY];
+
+    // Spectator
+    bool hasSession;
+    bool synced;
+
+    /** Set when an update run to catch up ends the game, until the next save state. */
+    bool ended;
+    uint32_t nextFrame;
+    uint32_t latestFrame;
+    Input inputs[INPUT_RING];
+
+    /** Frame number + 1 of each input in the ring, or 0 if the slot is empty. */
+    uint32_t inputTags[INPUT_RING];
+
+    // The save state being reassembled
+    bool assembling;
+    uint32_t keyframe;
+    uint32_t packedLength;
+    uint16_t fragmentCount;
+    uint16_t fragmentsReceived;
+    uint8_t fragmentReceived[MAX_FRAGMENTS];
+};
+
+// A byte oriented run-length coding. A control byte below 128 is followed by that many plus one
+// literal bytes, from 128 on it is followed by a byte to repeat that many minus 126 times. Most of
+// a save state is zeroed memory, which this shrinks several fold.
+static size_t packedCapacity (size_t length) {
+    return length + length/128 + 1;
+}
+
+static size_t pack (uint8_t* dest, const uint8_t* src, size_t length) {
+    size_t out = 0;
+    size_t ii = 0;
+    while (ii < length) {
+        size_t run = 1;
+        while (ii + run < length && run < 129 && src[ii + run] == src[ii]) {
+            ++run;
+        }
+        if (run > 1) {
+            dest[out++] = 126 + run;
+            dest[out++] = src[ii];
+            ii += run;
+        } else {
+            // Runs of two go in with the literals, as a run they would cost as much and split the
+            // literals with another control byte
+            size_t start = ii;
+            while (ii < length && ii - start < 128
+                    && !(ii + 2 < length && src[ii + 1] == src[ii] && src[ii + 2] == src[ii])) {
+                ++ii;
+            }
+            dest[out++] = ii - start - 1;
+            memcpy(dest + out, src + start, ii - start);
+            out += ii - start;
+        }
+    }
+    return out;
+}
+
+static bool unpack (uint8_t* dest, size_t length, const uint8_t* src, size_t packedLength) {
+    size_t out = 0;
+    size_t ii = 0;
+    while (ii < packedLength) {
+        uint8_t control = src[ii++];
+        if (control < 128) {
+            size_t count = control + 1;
+            if (ii + count > packedLength || out + count > length) {
+                return false;
+            }
+            memcpy(dest + out, src + ii, count);
+            ii += count;
+            out += count;
+        } else {
+            size_t count = control - 126;
+            if (ii >= packedLength || out + count > length) {
+                return false;
+            }
+            memset(dest + out, src[ii++], count);
+            out += count;
+        }
+    }
+    return out == length;
+}
+
+static bool resolve (const char* address, struct sockaddr_in* result) {
+    const char* colon = strrchr(address, ':');
+    if (colon == NULL || colon == address || colon - address >= 256) {
+        return false;
+    }
+    char host[256];
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* info;
+    if (getaddrinfo(host, colon + 1, &hints, &info)) {
+        return false;
+    }
+    memcpy(result, info->ai_addr, sizeof(*result));
+    freeaddrinfo(info);
+    return true;
+}
+
+static bool isMulticast (const struct sockaddr_in* address) {
+    return IN_MULTICAST(ntohl(address->sin_addr.s_addr));
+}
+
+static w4_Broadcast* broadcastNew (const char* address, bool spectator) {
+    w4_Broadcast* broadcast = xmalloc(sizeof(w4_Broadcast));
+    memset(broadcast, 0, sizeof(w4_Broadcast));
+    broadcast->spectator = spectator;
+
+    if (!resolve(address, &broadcast->address)) {
+        fprintf(stderr, "Could not resolve %s\n", address);
+        free(broadcast);
+        return NULL;
+    }
+    broadcast->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (broadcast->socket < 0) {
+        perror("socket");
+        free(broadcast);
+        return NULL;
+    }
+
+    broadcast->stateSize = w4_runtimeSerializeSize();
+    broadcast->state = xmalloc(broadcast->stateSize);
+    broadcast->packed = xmalloc(packedCapacity(broadcast->stateSize));
+    return broadcast;
+}
+
+w4_Broadcast* w4_broadcastHostNew (const char* address, int keyframeInterval) {
+    w4_Broadcast* broadcast = broadcastNew(address, false);
+    if (broadcast == NULL) {
+        return NULL;
+    }
+    broadcast->keyframeInterval = keyframeInterval > 0 ? keyframeInterval : W4_BROADCAST_KEYFRAME_INTERVAL;
+
+    // Spectators that hear another session start over from its next save state
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    broadcast->session = ((uint32_t)now.tv_sec * 2654435761u) ^ (uint32_t)now.tv_nsec ^ (uint32_t)getpid();
+
+    int on = 1;
+    setsockopt(broadcast->socket, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    int bufferSize = 1 << 18;
+    setsockopt(broadcast->socket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    if (isMulticast(&broadcast->address)) {
+        // Stay on the LAN, and reach spectators on this machine too
+        unsigned char ttl = 1, loop = 1;
+        setsockopt(broadcast->socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        setsockopt(broadcast->socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+    return broadcast;
+}
+
+w4_Broadcast* w4_broadcastSpectatorNew (const char* address) {
+    w4_Broadcast* broadcast = broadcastNew(address, true);
+    if (broadcast == NULL) {
+        return NULL;
+    }
+
+    // Several spectators may listen on the same machine
+    int on = 1;
+    setsockopt(broadcast->socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#if defined(SO_REUSEPORT)
+    setsockopt(broadcast->socket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+    // Room for a whole save state arriving in one burst
+    int bufferSize = 1 << 20;
+    setsockopt(broadcast->socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = broadcast->address.sin_port;
+    if (bind(broadcast->socket, (struct sockaddr*)&local, sizeof(local))) {
+        perror("bind");
+        w4_broadcastDelete(broadcast);
+        return NULL;
+    }
+    if (isMulticast(&broadcast->address)) {
+        struct ip_mreq request = {0};
+        request.imr_multiaddr = broadcast->address.sin_addr;
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(broadcast->socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request))) {
+            perror("IP_ADD_MEMBERSHIP");
+            w4_broadcastDelete(broadcast);
+            return NULL;
+        }
+    }
+    fcntl(broadcast->socket, F_SETFL, fcntl(broadcast->socket, F_GETFL) | O_NONBLOCK);
+    return broadcast;
+}
+
+void w4_broadcastDelete (w4_Broadcast* broadcast) {
+    if (broadcast == NULL) {
+        return;
+    }
+    close(broadcast->socket);
+    free(broadcast->state);
+    free(broadcast->packed);
+    free(broadcast);
+}
+
+bool w4_broadcastIsSpectator (const w4_Broadcast* broadcast) {
+    return broadcast->spectator;
+}
+
+static void writeHeader (uint8_t* packet, uint32_t session, uint8_t type, uint8_t count) {
+    w4_write32LE(packet, MAGIC);
+    w4_write32LE(packet + 4, session);
+    packet[8] = type;
+    packet[9] = count;
+    w4_write16LE(packet + 10, 0);
+}
+
+static void sendPacket (w4_Broadcast* broadcast, const uint8_t* packet, size_t length) {
+    // A spectator that misses a datagram recovers from the redundancy or the next save state
+    sendto(broadcast->socket, packet, length, 0,
+        (const struct sockaddr*)&broadcast->address, sizeof(broadcast->address));
+}
+
+static void sendKeyframe (w4_Broadcast* broadcast) {
+    w4_runtimeSerialize(broadcast->state);
+    size_t packedLength = pack(broadcast->packed, broadcast->state, broadcast->stateSize);
+    uint16_t fragmentCount = (packedLength + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
+
+    uint8_t packet[HEADER_SIZE + KEYFRAME_HEADER_SIZE + FRAGMENT_SIZE];
+    for (uint16_t fragment = 0; fragment < fragmentCount; ++fragment) {
+        size_t offset = (size_t)fragment * FRAGMENT_SIZE;
+        size_t length = packedLength - offset < FRAGMENT_SIZE ? packedLength - offset : FRAGMENT_SIZE;
+
+        writeHeader(packet, broadcast->session, PACKET_KEYFRAME, 0);
+        uint8_t* body = packet + HEADER_SIZE;
+        w4_write32LE(body, broadcast->frame);
+        w4_write32LE(body + 4, broadcast->stateSize);
+        w4_write32LE(body + 8, packedLength);
+        w4_write16LE(body + 12, fragment);
+        w4_write16LE(body + 14, fragmentCount);
+        memcpy(body + KEYFRAME_HEADER_SIZE, broadcast->packed + offset, length);
+        sendPacket(broadcast, packet, HEADER_SIZE + KEYFRAME_HEADER_SIZE + length);
+    }
+}
+
+static bool hostUpdate (w4_Broadcast* broadcast) {
+    // The save state is taken before the frame's update, so it pairs with the frame's input
+    if (broadcast->frame % broadcast->keyframeInterval == 0) {
+        sendKeyframe(broadcast);
+    }
+
+    memmove(broadcast->history + 1, broadcast->history, (INPUT_REDUNDANCY - 1) * sizeof(Input));
+    Input* input = &broadcast->history[0];
+    memcpy(input->gamepads, w4_memory->gamepads, 4);
+    input->mouseX = w4_read16LE(&w4_memory->mouseX);
+    input->mouseY = w4_read16LE(&w4_memory->mouseY);
+    input->mouseButtons = w4_memory->mouseButtons;
+
+    uint8_t packet[HEADER_SIZE + 4 + INPUT_REDUNDANCY*INPUT_SIZE];
+    uint8_t count = broadcast->frame < INPUT_REDUNDANCY ? broadcast->frame + 1 : INPUT_REDUNDANCY;
+    writeHeader(packet, broadcast->session, PACKET_INPUT, count);
+    w4_write32LE(packet + HEADER_SIZE, broadcast->frame);
+
+    // Newest first
+    uint8_t* entry = packet + HEADER_SIZE + 4;
+    for (int ii = 0; ii < count; ++ii, entry += INPUT_SIZE) {
+        const Input* past = &broadcast->history[ii];
+        memcpy(entry, past->gamepads, 4);
+        w4_write16LE(entry + 4, past->mouseX);
+        w4_write16LE(entry + 6, past->mouseY);
+        entry[8] = past->mouseButtons;
+    }
+    sendPacket(broadcast, packet, entry - packet);
+
+    ++broadcast->frame;
+    return true;
+}
+
+static void receiveInput (w4_Broadcast* broadcast, const uint8_t* packet, size_t length, uint8_t count) {
+    if (length < HEADER_SIZE + 4 + (size_t)count*INPUT_SIZE) {
+        return;
+    }
+    uint32_t latest = w4_read32LE(packet + HEADER_SIZE);
+    if (count == 0 || (uint32_t)count - 1 > latest) {
+        return;
+    }
+    const uint8_t* entry = packet + HEADER_SIZE + 4;
+    for (int ii = 0; ii < count; ++ii, entry += INPUT_SIZE) {
+        uint32_t frame = latest - ii;
+        Input* input = &broadcast->inputs[frame % INPUT_RING];
+        memcpy(input->gamepads, entry, 4);
+        input->mouseX = w4_read16LE(entry + 4);
+        input->mouseY = w4_read16LE(entry + 6);
+        input->mouseButtons = entry[8];
+        broadcast->inputTags[frame % INPUT_RING] = frame + 1;
+    }
+    if (latest > broadcast->latestFrame) {
+        broadcast->latestFrame = latest;
+    }
+}
+
+static void receiveKeyframe (w4_Broadcast* broadcast, const uint8_t* packet, size_t length) {
+    if (broadcast->synced || length < HEADER_SIZE + KEYFRAME_HEADER_SIZE) {
+        return;
+    }
+    const uint8_t* body = packet + HEADER_SIZE;
+    uint32_t frame = w4_read32LE(body);
+    uint32_t stateSize = w4_read32LE(body + 4);
+    uint32_t packedLength = w4_read32LE(body + 8);
+    uint16_t fragment = w4_read16LE(body + 12);
+    uint16_t fragmentCount = w4_read16LE(body + 14);
+
+    if (stateSize != broadcast->stateSize) {
+        fprintf(stderr, "Ignoring a save state of %u bytes, expected %zu. Is this the same cart?\n",
+            stateSize, broadcast->stateSize);
+        return;
+    }
+    if (packedLength > packedCapacity(stateSize)
+            || fragmentCount != (packedLength + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE
+            || fragmentCount > MAX_FRAGMENTS || fragment >= fragmentCount) {
+        return;
+    }
+    size_t offset = (size_t)fragment * FRAGMENT_SIZE;
+    size_t fragmentLength = length - HEADER_SIZE - KEYFRAME_HEADER_SIZE;
+    if (fragmentLength != (packedLength - offset < FRAGMENT_SIZE ? packedLength - offset : FRAGMENT_SIZE)) {
+        return;
+    }
+
+    if (!broadcast->assembling || frame != broadcast->keyframe) {
+        if (broadcast->assembling && frame < broadcast->keyframe) {
+            return;
+        }
+        // A newer save state, whatever is left of the last one is never coming
+        broadcast->assembling = true;
+        broadcast->keyframe = frame;
+        broadcast->packedLength = packedLength;
+        broadcast->fragmentCount = fragmentCount;
+        broadcast->fragmentsReceived = 0;
+        memset(broadcast->fragmentReceived, 0, sizeof(broadcast->fragmentReceived));
+    }
+    if (packedLength != broadcast->packedLength || broadcast->fragmentReceived[fragment]) {
+        return;
+    }
+    memcpy(broadcast->packed + offset, body + KEYFRAME_HEADER_SIZE, fragmentLength);
+    broadcast->fragmentReceived[fragment] = 1;
+    if (++broadcast->fragmentsReceived < fragmentCount) {
+        return;
+    }
+
+    broadcast->assembling = false;
+    if (!unpack(broadcast->state, broadcast->stateSize, broadcast->packed, packedLength)) {
+        return;
+    }
+    w4_runtimeUnserialize(broadcast->state);
+    broadcast->synced = true;
+    broadcast->ended = false;
+    broadcast->nextFrame = frame;
+    printf("Joined the broadcast at frame %u\n", frame);
+}
+
+static void receive (w4_Broadcast* broadcast) {
+    uint8_t packet[2048];
+    ssize_t length;
+    while ((length = recv(broadcast->socket, packet, sizeof(packet), 0)) >= 0) {
+        if (length < HEADER_SIZE || w4_read32LE(packet) != MAGIC) {
+            continue;
+        }
+        uint32_t session = w4_read32LE(packet + 4);
+        uint8_t type = packet[8];
+        if (!broadcast->hasSession || session != broadcast->session) {
+            // Only follow a new session from one of its save states, inputs alone are of no use
+            if (type != PACKET_KEYFRAME) {
+                continue;
+            }
+            broadcast->hasSession = true;
+            broadcast->session = session;
+            broadcast->synced = false;
+            broadcast->assembling = false;
+            broadcast->latestFrame = 0;
+            memset(broadcast->inputTags, 0, sizeof(broadcast->inputTags));
+        }
+
+        if (type == PACKET_INPUT) {
+            receiveInput(broadcast, packet, length, packet[9]);
+        } else if (type == PACKET_KEYFRAME) {
+            receiveKeyframe(broadcast, packet, length);
+        }
+    }
+}
+
+static bool spectatorUpdate (w4_Broadcast* broadcast) {
+    receive(broadcast);
+    if (!broadcast->synced || broadcast->ended) {
+        return false;
+    }
+
+    for (int updates = 0;; ++updates) {
+        uint32_t frame = broadcast->nextFrame;
+        if (broadcast->inputTags[frame % INPUT_RING] != frame + 1) {
+            if (broadcast->latestFrame >= frame + INPUT_REDUNDANCY) {
+                // Every datagram that carried this frame was lost
+                printf("Lost the input of frame %u, waiting for the next save state\n", frame);
+                broadcast->synced = false;
+            }
+            return false;
+        }
+
+        const Input* input = &broadcast->inputs[frame % INPUT_RING];
+        for (int ii = 0; ii < 4; ++ii) {
+            w4_runtimeSetGamepad(ii, input->gamepads[ii]);
+        }
+        w4_runtimeSetMouse(input->mouseX, input->mouseY, input->mouseButtons);
+        ++broadcast->nextFrame;
+
+        // The window runs the last update, the ones before go through the same tick as it would
+        if (frame >= broadcast->latestFrame || updates >= MAX_CATCH_UP) {
+            return true;
+        }
+        bool running = w4_runtimeUpdate();
+        w4_windowGameTick();
+        if (!running) {
+            broadcast->ended = true;
+            return false;
+        }
+    }
+}
+
+bool w4_broadcastUpdate (w4_Broadcast* broadcast) {
+    return broadcast->spectator ? spectatorUpdate(broadcast) : hostUpdate(broadcast);
+}
+
+#else
+
+w4_Broadcast* w4_broadcastHostNew (const char* address, int keyframeInterval) {
+    fprintf(stderr, "Broadcasting isn't supported on this platform\n");
+    return NULL;
+}
+
+w4_Broadcast* w4_broadcastSpectatorNew (const char* address) {
+    fprintf(stderr, "Broadcasting isn't supported on this platform\n");
+    return NULL;
+}
+
+void w4_broadcastDelete (w4_Broadcast* broadcast) {
+}
+
+bool w4_broadcastUpdate (w4_Broadcast* broadcast) {
+    return true;
+}
+
+bool w4_broadcastIsSpectator (const w4_Broadcast* broadcast) {
+    return false;
+}
+
+#endif
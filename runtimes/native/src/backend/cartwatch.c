@@ -0,0 +1,125 @@
+#include "../cartwatch.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define W4_INOTIFY
+#endif
+
+#include "../util.h"
+
+// How long the file must go unchanged before it's reported. Compilers and linkers often write the
+// output in several steps.
+#define SETTLE_MS 100
+
+struct w4_CartWatch {
+    char* path;
+
+    /** Whether there are changes not reported yet, and when the last one was noticed. */
+    bool changed;
+    uint64_t changedAt;
+
+#ifdef W4_INOTIFY
+    int fd;
+    const char* name;
+#else
+    time_t mtime;
+    off_t size;
+#endif
+};
+
+static uint64_t nowMs () {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+w4_CartWatch* w4_cartWatchNew (const char* path) {
+    w4_CartWatch* watch = xmalloc(sizeof(w4_CartWatch));
+    memset(watch, 0, sizeof(w4_CartWatch));
+    watch->path = xmalloc(strlen(path) + 1);
+    strcpy(watch->path, path);
+
+#ifdef W4_INOTIFY
+    char* dir = xmalloc(strlen(path) + 2);
+    const char* slash = strrchr(path, '/');
+    if (slash != NULL) {
+        memcpy(dir, path, slash - path + 1);
+        dir[slash - path + 1] = '\0';
+        watch->name = watch->path + (slash - path + 1);
+    } else {
+        strcpy(dir, ".");
+        watch->name = watch->path;
+    }
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    bool watching = watch->fd >= 0 && inotify_add_watch(watch->fd, dir,
+        IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) >= 0;
+    free(dir);
+    if (!watching) {
+        w4_cartWatchDelete(watch);
+        return NULL;
+    }
+#else
+    struct stat info;
+    if (stat(path, &info)) {
+        w4_cartWatchDelete(watch);
+        return NULL;
+    }
+    watch->mtime = info.st_mtime;
+    watch->size = info.st_size;
+#endif
+    return watch;
+}
+
+void w4_cartWatchDelete (w4_CartWatch* watch) {
+#ifdef W4_INOTIFY
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+#endif
+    free(watch->path);
+    free(watch);
+}
+
+bool w4_cartWatchChanged (w4_CartWatch* watch) {
+    bool event = false;
+
+#ifdef W4_INOTIFY
+    uint8_t buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(watch->fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < length; ) {
+            const struct inotify_event* inotifyEvent = (const struct inotify_event*)(buffer + offset);
+            if (inotifyEvent->len > 0 && !strcmp(inotifyEvent->name, watch->name)) {
+                event = true;
+            }
+            offset += sizeof(struct inotify_event) + inotifyEvent->len;
+        }
+    }
+#else
+    struct stat info;
+    if (!stat(watch->path, &info) && (info.st_mtime != watch->mtime || info.st_size != watch->size)) {
+        watch->mtime = info.st_mtime;
+        watch->size = info.st_size;
+        event = true;
+    }
+#endif
+
+    uint64_t now = nowMs();
+    if (event) {
+        watch->changed = true;
+        watch->changedAt = now;
+    }
+    if (watch->changed && now - watch->changedAt >= SETTLE_MS) {
+        watch->changed = false;
+        return true;
+    }
+    return false;
+}
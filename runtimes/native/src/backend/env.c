@@ -0,0 +1,301 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#define W4_ENV_THREADS
+#endif
+
+#include "../apu.h"
+#include "../env.h"
+#include "../pool.h"
+#include "../runtime.h"
+#include "../trace.h"
+#include "../util.h"
+#include "../wasm.h"
+
+typedef struct {
+    w4_RuntimeContext context;
+    w4_Disk disk;
+    void* apuState;
+    w4_Trace* trace;
+
+    /** Number of episodes started. */
+    uint32_t episodes;
+} Instance;
+
+typedef struct {
+    w4_Env* env;
+    int index;
+#ifdef W4_ENV_THREADS
+    pthread_t thread;
+#endif
+} Worker;
+
+struct w4_Env {
+    w4_EnvConfig config;
+    Instance* instances;
+
+    /** Serialized state of a freshly loaded instance, that every episode starts from. */
+    uint8_t* initialState;
+    size_t initialStateSize;
+
+    uint8_t* observations;
+    uint32_t* persistentValues;
+    w4_EnvPersistentData persistentData;
+    uint8_t* done;
+
+    /** The gamepads of the step in progress. */
+    const uint8_t* pads;
+
+    Worker* workers;
+    int workerCount;
+
+#ifdef W4_ENV_THREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t stepStarted;
+    pthread_cond_t stepFinished;
+    unsigned long long stepCount;
+    int workersBusy;
+    bool stopping;
+#endif
+};
+
+static void resetInstance (w4_Env* env, int idx) {
+    Instance* instance = &env->instances[idx];
+    uint32_t seed = env->config.seed + instance->episodes * env->config.count + idx;
+    ++instance->episodes;
+
+    // Same as a fresh boot, the persistent inputs are set before the first update
+    w4_runtimeUnserialize(env->initialState);
+    w4_write32LE(&w4_memory->persistent.game_mode, env->config.gameMode);
+    w4_write32LE(&w4_memory->persistent.max_frames, env->config.maxFrames);
+    w4_write32LE(&w4_memory->persistent.game_seed, seed);
+}
+
+static void stepInstance (w4_Env* env, int idx) {
+    Instance* instance = &env->instances[idx];
+    w4_runtimeLoadContext(&instance->context);
+
+    if (env->done[idx]) {
+        resetInstance(env, idx);
+        env->done[idx] = 0;
+    }
+
+    w4_runtimeSetGamepad(0, env->pads[idx]);
+    env->done[idx] = !w4_runtimeUpdate();
+    w4_runtimeSaveContext(&instance->context);
+
+    memcpy(env->observations + idx*W4_ENV_OBSERVATION_SIZE, w4_memory->framebuffer, W4_ENV_OBSERVATION_SIZE);
+
+    const w4_EnvPersistentData* persistent = &env->persistentData;
+    persistent->game_mode[idx] = w4_read32LE(&w4_memory->persistent.game_mode);
+    persistent->max_frames[idx] = w4_read32LE(&w4_memory->persistent.max_frames);
+    persistent->game_seed[idx] = w4_read32LE(&w4_memory->persistent.game_seed);
+    persistent->frames[idx] = w4_read32LE(&w4_memory->persistent.frames);
+    persistent->score[idx] = w4_read32LE(&w4_memory->persistent.score);
+    persistent->health[idx] = w4_read32LE(&w4_memory->persistent.health);
+}
+
+// Each worker steps a contiguous slice of the instances
+static void stepWorkerSlice (w4_Env* env, int worker) {
+    int count = env->config.count;
+    int start = (long long)count * worker / env->workerCount;
+    int end = (long long)count * (worker + 1) / env->workerCount;
+    for (int idx = start; idx < end; ++idx) {
+        stepInstance(env, idx);
+    }
+}
+
+#ifdef W4_ENV_THREADS
+static void* workerMain (void* userData) {
+    Worker* worker = userData;
+    w4_Env* env = worker->env;
+    unsigned long long stepsSeen = 0;
+
+    pthread_mutex_lock(&env->mutex);
+    for (;;) {
+        while (env->stepCount == stepsSeen && !env->stopping) {
+            pthread_cond_wait(&env->stepStarted, &env->mutex);
+        }
+        if (env->stopping) {
+            break;
+        }
+        stepsSeen = env->stepCount;
+        pthread_mutex_unlock(&env->mutex);
+
+        stepWorkerSlice(env, worker->index);
+
+        pthread_mutex_lock(&env->mutex);
+        if (--env->workersBusy == 0) {
+            pthread_cond_signal(&env->stepFinished);
+        }
+    }
+    pthread_mutex_unlock(&env->mutex);
+    return NULL;
+}
+#endif
+
+w4_Env* w4_envNew (const uint8_t* cart, int cartLength, const w4_EnvConfig* config) {
+    if (config->count <= 0) {
+        return NULL;
+    }
+
+    w4_Env* env = xmalloc(sizeof(w4_Env));
+    memset(env, 0, sizeof(w4_Env));
+    env->config = *config;
+
+    int count = config->count;
+    env->instances = xmalloc(count * sizeof(Instance));
+    memset(env->instances, 0, count * sizeof(Instance));
+    env->observations = xmalloc(count * W4_ENV_OBSERVATION_SIZE);
+    memset(env->observations, 0, count * W4_ENV_OBSERVATION_SIZE);
+    env->done = xmalloc(count);
+
+    env->persistentValues = xmalloc(6 * count * sizeof(uint32_t));
+    memset(env->persistentValues, 0, 6 * count * sizeof(uint32_t));
+    env->persistentData.game_mode = env->persistentValues;
+    env->persistentData.max_frames = env->persistentValues + count;
+    env->persistentData.game_seed = env->persistentValues + 2*count;
+    env->persistentData.frames = env->persistentValues + 3*count;
+    env->persistentData.score = env->persistentValues + 4*count;
+    env->persistentData.health = env->persistentValues + 5*count;
+
+    if (config->pool) {
+        w4_poolReserve((size_t)count * W4_POOL_INSTANCE_BYTES, config->hugePages);
+    }
+
+    bool shareCode = w4_wasmSetShareCode(config->shareCode != 0);
+    for (int idx = 0; idx < count; ++idx) {
+        Instance* instance = &env->instances[idx];
+        instance->apuState = w4_poolAlloc(w4_apuStateSize());
+        memset(instance->apuState, 0, w4_apuStateSize());
+        w4_apuBindState(instance->apuState);
+        instance->trace = w4_traceNew(idx, config->trace);
+        w4_traceBind(instance->trace);
+
+        uint8_t* memoryBytes = w4_wasmInit();
+        w4_runtimeInit(memoryBytes, &instance->disk);
+        w4_wasmLoadModule(cart, cartLength);
+
+        // Every instance loads to the same state, so the first one's is used to start all episodes
+        if (idx == 0) {
+            env->initialStateSize = w4_runtimeSerializeSize();
+            env->initialState = w4_poolAlloc(env->initialStateSize);
+            w4_runtimeSerialize(env->initialState);
+        }
+
+        resetInstance(env, idx);
+        w4_runtimeSaveContext(&instance->context);
+        env->done[idx] = 0;
+    }
+    w4_wasmSetShareCode(shareCode);
+    w4_apuBindState(NULL);
+    w4_traceBind(NULL);
+
+    env->workerCount = config->threads;
+    if (env->workerCount > count) {
+        env->workerCount = count;
+    }
+#ifdef W4_ENV_THREADS
+    if (env->workerCount < 1) {
+        env->workerCount = 1;
+    }
+#else
+    env->workerCount = 1;
+#endif
+
+    env->workers = xmalloc(env->workerCount * sizeof(Worker));
+    for (int ii = 0; ii < env->workerCount; ++ii) {
+        env->workers[ii].env = env;
+        env->workers[ii].index = ii;
+    }
+
+#ifdef W4_ENV_THREADS
+    pthread_mutex_init(&env->mutex, NULL);
+    pthread_cond_init(&env->stepStarted, NULL);
+    pthread_cond_init(&env->stepFinished, NULL);
+
+    // Worker 0 is the thread calling w4_envStep()
+    for (int ii = 1; ii < env->workerCount; ++ii) {
+        pthread_create(&env->workers[ii].thread, NULL, workerMain, &env->workers[ii]);
+    }
+#endif
+
+    return env;
+}
+
+void w4_envDelete (w4_Env* env) {
+#ifdef W4_ENV_THREADS
+    pthread_mutex_lock(&env->mutex);
+    env->stopping = true;
+    pthread_cond_broadcast(&env->stepStarted);
+    pthread_mutex_unlock(&env->mutex);
+
+    for (int ii = 1; ii < env->workerCount; ++ii) {
+        pthread_join(env->workers[ii].thread, NULL);
+    }
+
+    pthread_cond_destroy(&env->stepFinished);
+    pthread_cond_destroy(&env->stepStarted);
+    pthread_mutex_destroy(&env->mutex);
+#endif
+
+    for (int idx = 0; idx < env->config.count; ++idx) {
+        Instance* instance = &env->instances[idx];
+        w4_runtimeLoadContext(&instance->context);
+        w4_wasmDestroy();
+        w4_runtimeUnloadContext();
+        w4_traceDelete(instance->trace);
+        w4_poolFree(instance->apuState, w4_apuStateSize());
+    }
+
+    free(env->workers);
+    w4_poolFree(env->initialState, env->initialStateSize);
+    free(env->persistentValues);
+    free(env->done);
+    free(env->observations);
+    free(env->instances);
+    free(env);
+}
+
+void w4_envStep (w4_Env* env, const uint8_t* pads) {
+    env->pads = pads;
+
+#ifdef W4_ENV_THREADS
+    if (env->workerCount > 1) {
+        pthread_mutex_lock(&env->mutex);
+        env->workersBusy = env->workerCount - 1;
+        ++env->stepCount;
+        pthread_cond_broadcast(&env->stepStarted);
+        pthread_mutex_unlock(&env->mutex);
+
+        stepWorkerSlice(env, 0);
+
+        pthread_mutex_lock(&env->mutex);
+        while (env->workersBusy > 0) {
+            pthread_cond_wait(&env->stepFinished, &env->mutex);
+        }
+        pthread_mutex_unlock(&env->mutex);
+    } else {
+        stepWorkerSlice(env, 0);
+    }
+#else
+    stepWorkerSlice(env, 0);
+#endif
+
+    env->pads = NULL;
+}
+
+const uint8_t* w4_envObservations (const w4_Env* env) {
+    return env->observations;
+}
+
+const w4_EnvPersistentData* w4_envPersistentData (const w4_Env* env) {
+    return &env->persistentData;
+}
+
+const uint8_t* w4_envDone (const w4_Env* env) {
+    return env->done;
+}
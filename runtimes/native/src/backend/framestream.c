@@ -0,0 +1,398 @@
+#include "../framestream.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+
+#if !defined(_WIN32)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAGIC 0x53463457 // "W4FS"
+#define VERSION 1
+
+#define FRAMEBUFFER_SIZE (160*160 >> 2)
+
+#define FLAG_PALETTE 1
+#define FLAG_KEYFRAME 2
+
+// A message is at most its header, the palette, and a delta that in the worst case (single
+// literals between short repeats) grows the frame by a fifth
+#define MAX_MESSAGE_SIZE (4 + 1 + 16 + 2 + 2*FRAMEBUFFER_SIZE)
+
+// Unsent bytes a client may have queued before frames are skipped for it. Once it has caught up it
+// starts over from a keyframe.
+#define MAX_BACKLOG (256 * 1024)
+
+// Runs of a byte shorter than this are cheaper to send as literals
+#define MIN_REPEAT 4
+
+typedef struct {
+    int fd;
+    bool needsKeyframe;
+
+    uint8_t* queue;
+    size_t queued;
+    size_t sent;
+    size_t capacity;
+} Client;
+
+struct w4_FrameStream {
+    int listener;
+    char* unixPath;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t pushed;
+    bool closing;
+
+    uint32_t pushedFrames;
+
+    /** The frame last pushed, waiting for the encoder. */
+    bool pending;
+    uint32_t pendingFrame;
+    uint8_t pendingFramebuffer[FRAMEBUFFER_SIZE];
+    uint32_t pendingPalette[4];
+
+    // Only touched by the encoder
+    Client* clients;
+    int clientCount;
+    int clientCapacity;
+    uint8_t framebuffer[FRAMEBUFFER_SIZE];
+    uint32_t palette[4];
+    uint8_t previous[FRAMEBUFFER_SIZE];
+    uint32_t previousPalette[4];
+    uint8_t delta[FRAMEBUFFER_SIZE];
+    uint8_t message[MAX_MESSAGE_SIZE];
+    uint8_t keyframe[MAX_MESSAGE_SIZE];
+};
+
+static uint8_t* writeVarint (uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+    return out;
+}
+
+// Codes the XOR of two frames as runs of zeros, each followed by literals or a repeated byte.
+// Trailing zeros are left out, so an unchanged frame codes to nothing.
+static size_t encodeDelta (uint8_t* dest, const uint8_t* delta, size_t length) {
+    uint8_t* out = dest;
+    size_t ii = 0;
+    for (;;) {
+        size_t start = ii;
+        while (ii < length && delta[ii] == 0) {
+            ++ii;
+        }
+        if (ii == length) {
+            break;
+        }
+        out = writeVarint(out, ii - start);
+
+        size_t run = 1;
+        while (ii + run < length && delta[ii + run] == delta[ii]) {
+            ++run;
+        }
+        if (run >= MIN_REPEAT) {
+            out = writeVarint(out, run << 1 | 1);
+            *out++ = delta[ii];
+            ii += run;
+            continue;
+        }
+
+        // Literals up to the next run of zeros or repeat worth breaking off for. Lone zeros are
+        // cheaper to carry along than to skip.
+        start = ii;
+        while (ii < length) {
+            if (delta[ii] == 0 && (ii + 1 == length || delta[ii + 1] == 0)) {
+                break;
+            }
+            size_t repeat = 1;
+            while (repeat < MIN_REPEAT && ii + repeat < length && delta[ii + repeat] == delta[ii]) {
+                ++repeat;
+            }
+            if (repeat == MIN_REPEAT) {
+                break;
+            }
+            ++ii;
+        }
+        out = writeVarint(out, (ii - start) << 1);
+        memcpy(out, delta + start, ii - start);
+        out += ii - start;
+    }
+    return out - dest;
+}
+
+static size_t encodeMessage (uint8_t* dest, uint32_t frame, uint8_t flags, const uint32_t* palette,
+    const uint8_t* delta)
+{
+    uint8_t* out = dest;
+    w4_write32LE(out, frame);
+    out[4] = flags;
+    out += 5;
+    if (flags & FLAG_PALETTE) {
+        for (int ii = 0; ii < 4; ++ii, out += 4) {
+            w4_write32LE(out, palette[ii]);
+        }
+    }
+    size_t length = encodeDelta(out + 2, delta, FRAMEBUFFER_SIZE);
+    w4_write16LE(out, length);
+    return out + 2 + length - dest;
+}
+
+static void enqueue (Client* client, const uint8_t* bytes, size_t length) {
+    if (client->queued + length > client->capacity) {
+        client->capacity = client->queued + length + MAX_MESSAGE_SIZE;
+        client->queue = xrealloc(client->queue, client->capacity);
+    }
+    memcpy(client->queue + client->queued, bytes, length);
+    client->queued += length;
+}
+
+// Sends what the socket takes without blocking. Returns false once the client is gone.
+static bool flush (Client* client) {
+    while (client->sent < client->queued) {
+        ssize_t sent = send(client->fd, client->queue + client->sent, client->queued - client->sent,
+            MSG_NOSIGNAL);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client->sent += sent;
+    }
+    client->queued = 0;
+    client->sent = 0;
+    return true;
+}
+
+static void removeClient (w4_FrameStream* stream, int idx) {
+    close(stream->clients[idx].fd);
+    free(stream->clients[idx].queue);
+    stream->clients[idx] = stream->clients[--stream->clientCount];
+}
+
+static void acceptClients (w4_FrameStream* stream) {
+    int fd;
+    while ((fd = accept(stream->listener, NULL, NULL)) >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        if (stream->clientCount == stream->clientCapacity) {
+            stream->clientCapacity = stream->clientCapacity ? 2*stream->clientCapacity : 8;
+            stream->clients = xrealloc(stream->clients, stream->clientCapacity * sizeof(Client));
+        }
+        Client* client = &stream->clients[stream->clientCount++];
+        memset(client, 0, sizeof(Client));
+        client->fd = fd;
+        client->needsKeyframe = true;
+
+        uint8_t header[8];
+        w4_write32LE(header, MAGIC);
+        w4_write32LE(header + 4, VERSION);
+        enqueue(client, header, sizeof(header));
+        if (!flush(client)) {
+            removeClient(stream, stream->clientCount - 1);
+        }
+    }
+}
+
+static void encodeFrame (w4_FrameStream* stream, uint32_t frame) {
+    for (int ii = 0; ii < FRAMEBUFFER_SIZE; ++ii) {
+        stream->delta[ii] = stream->framebuffer[ii] ^ stream->previous[ii];
+    }
+    bool paletteChanged = memcmp(stream->palette, stream->previousPalette, sizeof(stream->palette));
+    size_t messageLength = encodeMessage(stream->message, frame, paletteChanged ? FLAG_PALETTE : 0,
+        stream->palette, stream->delta);
+
+    // Only coded when a client is waiting for one
+    size_t keyframeLength = 0;
+
+    for (int idx = 0; idx < stream->clientCount; ++idx) {
+        Client* client = &stream->clients[idx];
+        if (!client->needsKeyframe && client->queued - client->sent > MAX_BACKLOG) {
+            client->needsKeyframe = true;
+        }
+        if (!client->needsKeyframe) {
+            enqueue(client, stream->message, messageLength);
+        } else if (client->queued == client->sent) {
+            if (keyframeLength == 0) {
+                keyframeLength = encodeMessage(stream->keyframe, frame, FLAG_PALETTE | FLAG_KEYFRAME,
+                    stream->palette, stream->framebuffer);
+            }
+            enqueue(client, stream->keyframe, keyframeLength);
+            client->needsKeyframe = false;
+        }
+
+        if (!flush(client)) {
+            removeClient(stream, idx--);
+        }
+    }
+
+    memcpy(stream->previous, stream->framebuffer, sizeof(stream->previous));
+    memcpy(stream->previousPalette, stream->palette, sizeof(stream->palette));
+}
+
+static void* encoderMain (void* arg) {
+    w4_FrameStream* stream = arg;
+    pthread_mutex_lock(&stream->mutex);
+    for (;;) {
+        while (!stream->pending && !stream->closing) {
+            pthread_cond_wait(&stream->pushed, &stream->mutex);
+        }
+        if (stream->closing) {
+            break;
+        }
+        memcpy(stream->framebuffer, stream->pendingFramebuffer, sizeof(stream->framebuffer));
+        memcpy(stream->palette, stream->pendingPalette, sizeof(stream->palette));
+        uint32_t frame = stream->pendingFrame;
+        stream->pending = false;
+        pthread_mutex_unlock(&stream->mutex);
+
+        acceptClients(stream);
+        encodeFrame(stream, frame);
+
+        pthread_mutex_lock(&stream->mutex);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    return NULL;
+}
+
+static int listenTcp (const char* address) {
+    const char* colon = strrchr(address, ':');
+    const char* port = colon != NULL ? colon + 1 : address;
+    char host[256] = "";
+    if (colon != NULL) {
+        if (colon - address >= (long)sizeof(host)) {
+            return -1;
+        }
+        memcpy(host, address, colon - address);
+        host[colon - address] = '\0';
+    }
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    struct addrinfo* info;
+    if (getaddrinfo(host[0] ? host : NULL, port, &hints, &info)) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, info->ai_addr, info->ai_addrlen)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(info);
+    return fd;
+}
+
+static int listenUnix (const char* path) {
+    struct sockaddr_un local = {0};
+    local.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(local.sun_path)) {
+        return -1;
+    }
+    strcpy(local.sun_path, path);
+
+    // Left behind by a run that didn't exit cleanly
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && bind(fd, (struct sockaddr*)&local, sizeof(local))) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+w4_FrameStream* w4_frameStreamOpen (const char* address) {
+    bool isUnix = !strncmp(address, "unix:", 5);
+    int listener = isUnix ? listenUnix(address + 5) : listenTcp(address);
+    if (listener < 0 || listen(listener, 16)) {
+        if (listener >= 0) {
+            close(listener);
+        }
+        return NULL;
+    }
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+    w4_FrameStream* stream = xmalloc(sizeof(w4_FrameStream));
+    memset(stream, 0, sizeof(w4_FrameStream));
+    stream->listener = listener;
+    if (isUnix) {
+        stream->unixPath = xmalloc(strlen(address + 5) + 1);
+        strcpy(stream->unixPath, address + 5);
+    }
+
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->pushed, NULL);
+    pthread_create(&stream->thread, NULL, encoderMain, stream);
+    return stream;
+}
+
+void w4_frameStreamClose (w4_FrameStream* stream) {
+    if (stream == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&stream->mutex);
+    stream->closing = true;
+    pthread_cond_signal(&stream->pushed);
+    pthread_mutex_unlock(&stream->mutex);
+    pthread_join(stream->thread, NULL);
+
+    while (stream->clientCount > 0) {
+        removeClient(stream, stream->clientCount - 1);
+    }
+    free(stream->clients);
+    close(stream->listener);
+    if (stream->unixPath != NULL) {
+        unlink(stream->unixPath);
+        free(stream->unixPath);
+    }
+    pthread_mutex_destroy(&stream->mutex);
+    pthread_cond_destroy(&stream->pushed);
+    free(stream);
+}
+
+void w4_frameStreamPush (w4_FrameStream* stream, const uint8_t* framebuffer, const uint32_t* palette) {
+    pthread_mutex_lock(&stream->mutex);
+    // An older frame the encoder didn't get to is dropped, the next delta covers it
+    stream->pendingFrame = stream->pushedFrames++;
+    memcpy(stream->pendingFramebuffer, framebuffer, sizeof(stream->pendingFramebuffer));
+    memcpy(stream->pendingPalette, palette, sizeof(stream->pendingPalette));
+    stream->pending = true;
+    pthread_cond_signal(&stream->pushed);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+#else
+
+w4_FrameStream* w4_frameStreamOpen (const char* address) {
+    fprintf(stderr, "Frame streaming isn't supported on this platform\n");
+    return NULL;
+}
+
+void w4_frameStreamClose (w4_FrameStream* stream) {
+}
+
+void w4_frameStreamPush (w4_FrameStream* stream, const uint8_t* framebuffer, const uint32_t* palette) {
+}
+
+#endif
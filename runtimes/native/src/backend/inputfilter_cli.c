@@ -0,0 +1,174 @@
+// Screens gamepad event logs (the serialized recorder format) against a baseline of honest ones.
+//
+//   wasm4_inputfilter baseline [--update-rate <hz>] <baseline-out> <log>...
+//   wasm4_inputfilter score [--update-rate <hz>] [--threshold <z>] <baseline> <log>...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../inputfilter.h"
+#include "../util.h"
+
+#define DEFAULT_THRESHOLD 4.0
+
+// The web and minifb runtimes, which record the logs, update at 10 Hz
+#define DEFAULT_UPDATE_RATE 10
+
+static uint32_t updateRate = DEFAULT_UPDATE_RATE;
+
+static uint8_t* buffer = NULL;
+static size_t bufferCapacity = 0;
+
+// Decodes the events straight into the analyzer. Returns 0 on success.
+static int analyzeFile (const char* path, w4_InputFeatures* features) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length < 0) {
+        fclose(file);
+        return -1;
+    }
+    if ((size_t)length > bufferCapacity) {
+        bufferCapacity = length;
+        buffer = xrealloc(buffer, bufferCapacity);
+    }
+    size_t read = fread(buffer, 1, length, file);
+    fclose(file);
+
+    if (read < 4 || (read - 4) % 8 != 0 || w4_read32LE(buffer) != (read - 4) / 8) {
+        return -1;
+    }
+
+    w4_InputAnalyzer analyzer;
+    w4_inputAnalyzerInit(&analyzer, updateRate);
+    for (const uint8_t* ptr = buffer + 4; ptr < buffer + read; ptr += 8) {
+        w4_GamepadEvent event;
+        event.frame = w4_read32LE(ptr);
+        event.playerIdx = ptr[4];
+        event.button = ptr[5];
+        event.eventType = ptr[6];
+        event.padding = 0;
+        w4_inputAnalyzerAdd(&analyzer, &event);
+    }
+    w4_inputAnalyzerFinish(&analyzer, features);
+    return 0;
+}
+
+static double now () {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec + spec.tv_nsec * 1e-9;
+}
+
+static int usage () {
+    fprintf(stderr, "Usage: wasm4_inputfilter baseline [--update-rate <hz>] <baseline-out> <log>...\n");
+    fprintf(stderr, "       wasm4_inputfilter score [--update-rate <hz>] [--threshold <z>] <baseline> <log>...\n");
+    return 1;
+}
+
+static int buildBaseline (const char* baselinePath, int logCount, const char* logs[]) {
+    w4_InputBaseline baseline;
+    w4_inputBaselineInit(&baseline);
+
+    int skipped = 0;
+    for (int ii = 0; ii < logCount; ++ii) {
+        w4_InputFeatures features;
+        // Logs whose events don't add up weren't recorded honestly, so they stay out of the baseline
+        if (analyzeFile(logs[ii], &features) || features.inconsistentEvents) {
+            fprintf(stderr, "Skipping %s\n", logs[ii]);
+            ++skipped;
+            continue;
+        }
+        w4_inputBaselineAdd(&baseline, &features);
+    }
+
+    if (w4_inputBaselineSave(&baseline, baselinePath)) {
+        fprintf(stderr, "Error writing %s\n", baselinePath);
+        return 1;
+    }
+    printf("Baseline of %u logs (%d skipped) written to %s\n", baseline.count, skipped, baselinePath);
+    return 0;
+}
+
+// Prints one line per log: path, score, the feature it scored worst on, and the verdict
+static int scoreLogs (const char* baselinePath, double threshold, int logCount, const char* logs[]) {
+    w4_InputBaseline baseline;
+    if (w4_inputBaselineLoad(&baseline, baselinePath)) {
+        fprintf(stderr, "Error reading baseline %s\n", baselinePath);
+        return 1;
+    }
+
+    int flagged = 0;
+    double start = now();
+    for (int ii = 0; ii < logCount; ++ii) {
+        w4_InputFeatures features;
+        if (analyzeFile(logs[ii], &features)) {
+            printf("%s\t-\t-\tmalformed\n", logs[ii]);
+            ++flagged;
+            continue;
+        }
+
+        w4_InputFeature worst;
+        double score = w4_inputBaselineScore(&baseline, &features, &worst);
+        const char* verdict = "ok";
+        if (features.inconsistentEvents > 0) {
+            verdict = "inconsistent";
+        } else if (score > threshold) {
+            verdict = "flagged";
+        }
+        if (strcmp(verdict, "ok")) {
+            ++flagged;
+        }
+        printf("%s\t%.2f\t%s\t%s\n", logs[ii], score, w4_inputFeatureNames[worst], verdict);
+    }
+    double elapsed = now() - start;
+
+    fprintf(stderr, "%d of %d logs flagged, %.0f logs/s\n", flagged, logCount,
+        (elapsed > 0) ? logCount / elapsed : 0);
+    return 0;
+}
+
+int main (int argc, const char* argv[]) {
+    if (argc < 3) {
+        return usage();
+    }
+
+    bool score = !strcmp(argv[1], "score");
+    if (!score && strcmp(argv[1], "baseline")) {
+        return usage();
+    }
+
+    int arg = 2;
+    double threshold = DEFAULT_THRESHOLD;
+    for (;;) {
+        if (!strcmp(argv[arg], "--update-rate") && arg + 2 < argc) {
+            int rate = atoi(argv[arg + 1]);
+            if (rate < 1 || rate > W4_INPUT_MAX_UPDATE_RATE) {
+                fprintf(stderr, "The update rate must be between 1 and %d Hz\n", W4_INPUT_MAX_UPDATE_RATE);
+                return 1;
+            }
+            updateRate = rate;
+            arg += 2;
+        } else if (score && !strcmp(argv[arg], "--threshold") && arg + 2 < argc) {
+            threshold = atof(argv[arg + 1]);
+            arg += 2;
+        } else {
+            break;
+        }
+    }
+    if (arg >= argc) {
+        return usage();
+    }
+
+    if (score) {
+        return scoreLogs(argv[arg], threshold, argc - arg - 1, argv + arg + 1);
+    }
+    return buildBaseline(argv[arg], argc - arg - 1, argv + arg + 1);
+
+}
@@ -7,7 +7,15 @@
 
 
 #include "../apu.h"
+#include "../audioring.h"
+#include "../audiostats.h"
+#include "../broadcast.h"
+#include "../capture.h"
+#include "../cartwatch.h"
+#include "../framestream.h"
+#include "../memprofile.h"
 #include "../runtime.h"
+#include "../timeline.h"
 #include "../wasm.h"
 #include "../window.h"
 #include "../util.h"
@@ -18,6 +26,13 @@
 
 #define DISK_FILE_EXT ".disk"
 
+#define SAMPLE_RATE 44100
+
+// Extra ring fill on top of one update's worth of audio, enough to ride out a late update or two
+// at 60 Hz
+#define AUDIO_RING_SLACK (2 * SAMPLE_RATE / 60)
+#define AUDIO_RING_MIN_CAPACITY 8192
+
 typedef struct {
     // Should be the 4 byte ASCII string "CART" (1414676803)
     uint32_t magic;
@@ -29,14 +44,58 @@ typedef struct {
     uint32_t cartLength;
 } FileFooter;
 
+// Only set with --frame-locked-audio, otherwise the callback synthesizes directly
+static w4_AudioRing* audioRing = NULL;
+
+// One update's worth of audio, produced after each update when frame-locked
+static uint32_t tickFrames = 0;
+static int16_t* tickSamples = NULL;
+
+// Only set with --broadcast or --spectate
+static w4_Broadcast* broadcast = NULL;
+
+// Only set with --stream-frames
+static w4_FrameStream* frameStream = NULL;
+
+// Only set with --watch or --hot
+static w4_CartWatch* cartWatch = NULL;
+static const char* cartPath = NULL;
+static bool hotSwap = false;
+static bool keepPersistent = false;
+
+// The persistent area as the game was first started with, which a reload starts over from
+static w4_PersistentData startPersistent;
+
+// How many times the cart was reloaded. Each build gets its own gamepad event log.
+static int cartBuild = 0;
+
 static long audioDataCallback (cubeb_stream* stream, void* userData,
     const void* inputBuffer, void* outputBuffer, long frames)
 {
-    w4_apuWriteSamples((int16_t*)outputBuffer, frames);
+    // cubeb has no hook for when its thread starts, so the first callback on it names it
+    static W4_THREAD_LOCAL bool threadNamed = false;
+    if (!threadNamed) {
+        w4_timelineNameThread("audio");
+        threadNamed = true;
+    }
+    w4_timelineBegin(W4_TIMELINE_AUDIO);
+    w4_audioStatsBeginCallback(frames);
+    if (audioRing != NULL) {
+        w4_audioRingPull(audioRing, (int16_t*)outputBuffer, frames);
+    } else {
+        w4_apuWriteSamples((int16_t*)outputBuffer, frames);
+    }
+    w4_audioStatsEndCallback();
+    w4_timelineEnd(W4_TIMELINE_AUDIO);
     return frames;
 }
 
 static void audioStateCallback (cubeb_stream* stream, void* userData, cubeb_state state) {
+    if (state == CUBEB_STATE_ERROR) {
+        w4_audioStatsStreamError();
+    } else if (state == CUBEB_STATE_STOPPED || state == CUBEB_STATE_DRAINED) {
+        w4_audioStatsStreamStopped();
+    }
 }
 
 static void audioInit () {
@@ -54,7 +113,7 @@ static void audioInit () {
 
     cubeb_stream_params params;
     params.format = CUBEB_SAMPLE_S16NE;
-    params.rate = 44100;
+    params.rate = SAMPLE_RATE;
     params.channels = 2;
     params.layout = CUBEB_LAYOUT_UNDEFINED;
     params.prefs = CUBEB_STREAM_PREF_NONE;
@@ -76,6 +135,112 @@ static void audioInit () {
         fprintf(stderr, "Could not start the stream\n");
         return;
     }
+
+    uint32_t streamLatency;
+    if (cubeb_stream_get_latency(stream, &streamLatency) == CUBEB_OK) {
+        w4_audioStatsSetLatency(streamLatency);
+    }
+}
+
+static void saveRecording (uint32_t seed) {
+    char filename[64];
+    if (cartBuild == 0) {
+        snprintf(filename, sizeof(filename), "gamepad-events-%u.bin", seed);
+    } else {
+        snprintf(filename, sizeof(filename), "gamepad-events-%u-%d.bin", seed, cartBuild);
+    }
+    w4_gamepadRecorderExportToFile(&gamepadRecorder, filename);
+    printf("Saved %u gamepad events to %s\n", gamepadRecorder.eventCount, filename);
+}
+
+// Swaps in a rebuilt cart, keeping the window, audio stream and disk. With --keep-persistent the
+// persistent area survives the reload. With --hot the whole memory and the wasm globals do too, so
+// the game carries on instead of starting over.
+static void reloadCart () {
+    uint8_t* cart = NULL;
+    size_t cartLength = 0;
+    FILE* file = fopen(cartPath, "rb");
+    if (file != NULL) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        cart = xmalloc(size > 0 ? size : 1);
+        cartLength = fread(cart, 1, size > 0 ? size : 0, file);
+        fclose(file);
+    }
+    if (cartLength < 8 || memcmp(cart, "\0asm", 4)) {
+        fprintf(stderr, "Not reloading %s, it isn't a wasm module\n", cartPath);
+        free(cart);
+        return;
+    }
+
+    // The log so far replays against the old build only
+    bool spectating = broadcast != NULL && w4_broadcastIsSpectator(broadcast);
+    if (gamepadRecorder.isRecording && gamepadRecorder.eventCount > 0 && !spectating) {
+        saveRecording(w4_memory->persistent.game_seed);
+    }
+
+    Memory* saved = xmalloc(sizeof(Memory));
+    memcpy(saved, w4_memory, sizeof(Memory));
+    int globalsSize = w4_wasmGlobalsSize();
+    void* globals = xmalloc(globalsSize + 1);
+    w4_wasmSaveGlobals(globals);
+
+    w4_wasmDestroy();
+    w4_runtimeInit(w4_wasmInit(), w4_disk);
+    memcpy(&w4_memory->persistent, keepPersistent ? &saved->persistent : &startPersistent,
+        sizeof(w4_PersistentData));
+    w4_wasmLoadModule(cart, cartLength);
+
+    // The stack pointer and allocator state live in globals, the memory is only resumed with them
+    bool resumed = false;
+    if (hotSwap) {
+        if (w4_wasmGlobalsSize() == globalsSize) {
+            memcpy(w4_memory, saved, sizeof(Memory));
+            w4_wasmLoadGlobals(globals);
+            w4_runtimeSkipStart();
+            resumed = true;
+        } else {
+            fprintf(stderr, "The rebuilt cart's globals changed, restarting instead of hot swapping\n");
+        }
+    }
+
+    printf("%s %s\n", resumed ? "Hot swapped" : "Reloaded", cartPath);
+    ++cartBuild;
+    if (gamepadRecorder.isRecording) {
+        w4_gamepadRecorderStartRecording(&gamepadRecorder);
+    }
+    free(globals);
+    free(saved);
+    free(cart);
+}
+
+// Reloads happen between frames, so no update sees input that was set for the old build
+void w4_windowGameFrame () {
+    if (cartWatch != NULL && w4_cartWatchChanged(cartWatch)) {
+        reloadCart();
+    }
+}
+
+bool w4_windowGameInput () {
+    return broadcast == NULL || w4_broadcastUpdate(broadcast);
+}
+
+void w4_windowGameTick () {
+    if (audioRing != NULL) {
+        // The samples now only depend on the updates that came before, not on when the device
+        // happened to call back
+        w4_apuWriteSamples(tickSamples, tickFrames);
+        w4_audioRingPush(audioRing, tickSamples, tickFrames);
+    }
+    if (frameStream != NULL) {
+        uint32_t palette[4];
+        for (int ii = 0; ii < 4; ++ii) {
+            palette[ii] = w4_read32LE(&w4_memory->palette[ii]);
+        }
+        w4_frameStreamPush(frameStream, w4_memory->framebuffer, palette);
+    }
+    w4_audioStatsGameTick();
 }
 
 static void audioUninit () {
@@ -134,7 +299,7 @@ int main (int argc, const char* argv[]) {
         FileFooter footer;
         if (fread(&footer, 1, sizeof(FileFooter), file) < sizeof(FileFooter) || footer.magic != 1414676803) {
             // No bundled cart found
-            fprintf(stderr, "Usage: wasm4 <cart>\n");
+            fprintf(stderr, "Usage: wasm4 <cart> [--capture-draws <file>] [--profile-memory <file>] [--frame-locked-audio] [--broadcast|--spectate <host:port>] [--keyframe-interval <frames>] [--stream-frames <[host:]port|unix:path>] [--watch|--hot] [--keep-persistent] [--timeline <file>]\n");
             return 1;
         }
 
@@ -195,6 +360,8 @@ int main (int argc, const char* argv[]) {
         cartLength = fread(cartBytes, 1, cartLength, file);
         fclose(file);
 
+        cartPath = argv[1];
+
         // Look for disk file
         diskPath = xmalloc(strlen(argv[1]) + sizeof(DISK_FILE_EXT));
         strcpy(diskPath, argv[1]);
@@ -203,45 +370,137 @@ int main (int argc, const char* argv[]) {
         loadDiskFile(&disk, diskPath);
     }
 
-    audioInit();
+    w4_runtimeInit(w4_wasmInit(), &disk);
+
+    const char* broadcastAddress = NULL;
+    const char* spectateAddress = NULL;
+    int keyframeInterval = W4_BROADCAST_KEYFRAME_INTERVAL;
+    for (int ii = 2; ii < argc; ++ii) {
+        if (!strcmp(argv[ii], "--capture-draws") && ii + 1 < argc) {
+            // Framebuffer calls for raster_bench
+            const char* capturePath = argv[++ii];
+            if (!w4_captureStart(capturePath)) {
+                fprintf(stderr, "Error opening %s\n", capturePath);
+                return 1;
+            }
+        } else if (!strcmp(argv[ii], "--profile-memory") && ii + 1 < argc) {
+            // Heatmap of the pages the cart uses, written at exit
+            w4_memProfileStart(argv[++ii]);
+        } else if (!strcmp(argv[ii], "--timeline") && ii + 1 < argc) {
+            // Chrome trace events of every frame's phases, written at exit
+            const char* timelinePath = argv[++ii];
+            if (!w4_timelineStart(timelinePath)) {
+                fprintf(stderr, "Error opening %s\n", timelinePath);
+                return 1;
+            }
+            w4_timelineNameThread("frame");
+        } else if (!strcmp(argv[ii], "--frame-locked-audio")) {
+            // Sized from the window's update rate, so that the pushes keep up with the device
+            tickFrames = SAMPLE_RATE / w4_windowUpdateRate();
+            tickSamples = xmalloc(2 * tickFrames * sizeof(int16_t));
+            uint32_t target = tickFrames + AUDIO_RING_SLACK;
+            uint32_t capacity = 2 * (target + tickFrames);
+            audioRing = w4_audioRingNew(
+                (capacity > AUDIO_RING_MIN_CAPACITY) ? capacity : AUDIO_RING_MIN_CAPACITY, target);
+        } else if (!strcmp(argv[ii], "--broadcast") && ii + 1 < argc) {
+            // Stream the input to spectators
+            broadcastAddress = argv[++ii];
+        } else if (!strcmp(argv[ii], "--spectate") && ii + 1 < argc) {
+            // Follow a broadcast instead of the local input
+            spectateAddress = argv[++ii];
+        } else if (!strcmp(argv[ii], "--keyframe-interval") && ii + 1 < argc) {
+            keyframeInterval = atoi(argv[++ii]);
+        } else if (!strcmp(argv[ii], "--watch") || !strcmp(argv[ii], "--hot")) {
+            // Reload the cart whenever it's rebuilt, restarting it or with --hot resuming it
+            if (cartPath == NULL) {
+                fprintf(stderr, "Only a cart file can be watched\n");
+                return 1;
+            }
+            hotSwap = hotSwap || !strcmp(argv[ii], "--hot");
+            if (cartWatch == NULL && (cartWatch = w4_cartWatchNew(cartPath)) == NULL) {
+                fprintf(stderr, "Error watching %s\n", cartPath);
+                return 1;
+            }
+        } else if (!strcmp(argv[ii], "--keep-persistent")) {
+            // Reloads carry on from the persistent area the last build left behind
+            keepPersistent = true;
+        } else if (!strcmp(argv[ii], "--stream-frames") && ii + 1 < argc) {
+            // Framebuffer deltas for displays that don't run the cart
+            const char* streamAddress = argv[++ii];
+            frameStream = w4_frameStreamOpen(streamAddress);
+            if (frameStream == NULL) {
+                fprintf(stderr, "Error listening on %s\n", streamAddress);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[ii]);
+            return 1;
+        }
+    }
 
-    uint8_t* memory = w4_wasmInit();
-    w4_runtimeInit(memory, &disk);
+    audioInit();
 
     w4_gamepadRecorderInit(&gamepadRecorder);
     w4_gamepadRecorderStartRecording(&gamepadRecorder);
 
-    ((Memory*)memory)->persistent.game_mode = 1;
-    ((Memory*)memory)->persistent.max_frames = 600;
+    w4_memory->persistent.game_mode = 1;
+    w4_memory->persistent.max_frames = 600;
     
     struct timespec spec;
     clock_gettime(CLOCK_REALTIME, &spec);
     uint64_t ms = (uint64_t)spec.tv_sec * 1000 + (uint64_t)spec.tv_nsec / 1000000;
-    ((Memory*)memory)->persistent.game_seed = (uint32_t)ms;
+    w4_memory->persistent.game_seed = (uint32_t)ms;
 
-    printf("Starting in recording mode with seed: %u\n", ((Memory*)memory)->persistent.game_seed);
+    printf("Starting in recording mode with seed: %u\n", w4_memory->persistent.game_seed);
+    startPersistent = w4_memory->persistent;
 
     w4_wasmLoadModule(cartBytes, cartLength);
 
+    if (broadcastAddress != NULL) {
+        broadcast = w4_broadcastHostNew(broadcastAddress, keyframeInterval);
+    } else if (spectateAddress != NULL) {
+        broadcast = w4_broadcastSpectatorNew(spectateAddress);
+    }
+    if ((broadcastAddress != NULL || spectateAddress != NULL) && broadcast == NULL) {
+        return 1;
+    }
+    // The disk and input belong to the host, not to this machine
+    bool spectating = broadcast != NULL && w4_broadcastIsSpectator(broadcast);
+
     w4_windowBoot(title);
 
-    if (gamepadRecorder.eventCount > 0) {
-        char filename[64];
-        snprintf(filename, sizeof(filename), "gamepad-events-%u.bin", ((Memory*)memory)->persistent.game_seed);
-        w4_gamepadRecorderExportToFile(&gamepadRecorder, filename);
-        printf("Saved %u gamepad events to %s\n", gamepadRecorder.eventCount, filename);
+    if (gamepadRecorder.eventCount > 0 && !spectating) {
+        saveRecording(w4_memory->persistent.game_seed);
     }
 
     printf("--- Persistent Data ---\n");
-    printf("Game Mode:  %u\n", ((Memory*)memory)->persistent.game_mode);
-    printf("Max Frames: %u\n", ((Memory*)memory)->persistent.max_frames);
-    printf("Game Seed:  %u\n", ((Memory*)memory)->persistent.game_seed);
-    printf("Frames:     %u\n", ((Memory*)memory)->persistent.frames);
-    printf("Score:      %u\n", ((Memory*)memory)->persistent.score);
-    printf("Health:     %u\n", ((Memory*)memory)->persistent.health);
+    printf("Game Mode:  %u\n", w4_memory->persistent.game_mode);
+    printf("Max Frames: %u\n", w4_memory->persistent.max_frames);
+    printf("Game Seed:  %u\n", w4_memory->persistent.game_seed);
+    printf("Frames:     %u\n", w4_memory->persistent.frames);
+    printf("Score:      %u\n", w4_memory->persistent.score);
+    printf("Health:     %u\n", w4_memory->persistent.health);
     printf("-----------------------\n");
 
+    w4_captureStop();
+    w4_memProfileStop();
+    w4_timelineStop();
+    w4_audioStatsPrint();
+    if (audioRing != NULL) {
+        w4_AudioRingStats ringStats;
+        w4_audioRingGetStats(audioRing, &ringStats);
+        printf("Frame-locked audio: %llu underruns, %llu frames dropped, fill %u frames, rate %.4f\n",
+            (unsigned long long)ringStats.underruns, (unsigned long long)ringStats.droppedFrames,
+            ringStats.fill, ringStats.ratio);
+    }
     audioUninit();
+    w4_broadcastDelete(broadcast);
+    w4_frameStreamClose(frameStream);
+    if (cartWatch != NULL) {
+        w4_cartWatchDelete(cartWatch);
+    }
 
-    saveDiskFile(&disk, diskPath);
+    if (!spectating) {
+        saveDiskFile(&disk, diskPath);
+    }
 }
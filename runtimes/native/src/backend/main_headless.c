@@ -0,0 +1,121 @@
+// Replays a recorded gamepad event log without a window or audio device, and prints the
+// persistent data it ends with. Built against whichever wasm backend the target links.
+//
+//   wasm4_<backend>_headless [options] <cart> <events.bin>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../w4core.h"
+#include "../util.h"
+
+static uint8_t* readFile (const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* bytes = xmalloc(size > 0 ? size : 1);
+    *length = fread(bytes, 1, size > 0 ? size : 0, file);
+    fclose(file);
+    return bytes;
+}
+
+static double now () {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec + spec.tv_nsec * 1e-9;
+}
+
+static int usage (const char* name) {
+    fprintf(stderr, "Usage: %s [options] <cart> <events.bin>\n"
+        "  --game-mode <n>   (1)\n"
+        "  --max-frames <n>  (600)\n"
+        "  --seed <n>        For logs not named gamepad-events-<seed>.bin (0)\n"
+        "  --limit <n>       Stop after n updates (36000)\n", name);
+    return 1;
+}
+
+int main (int argc, const char* argv[]) {
+    w4_CorePersistentData data = {
+        .game_mode = 1,
+        .max_frames = 600,
+    };
+    uint32_t limit = 36000;
+    uint32_t seed = 0;
+
+    int arg = 1;
+    for (; arg < argc && !strncmp(argv[arg], "--", 2); arg += 2) {
+        if (arg + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        const char* option = argv[arg];
+        uint32_t value = strtoul(argv[arg + 1], NULL, 10);
+        if (!strcmp(option, "--game-mode")) {
+            data.game_mode = value;
+        } else if (!strcmp(option, "--max-frames")) {
+            data.max_frames = value;
+        } else if (!strcmp(option, "--seed")) {
+            seed = value;
+        } else if (!strcmp(option, "--limit")) {
+            limit = value;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (argc - arg != 2) {
+        return usage(argv[0]);
+    }
+
+    size_t cartLength, eventsLength;
+    uint8_t* cart = readFile(argv[arg], &cartLength);
+    if (cart == NULL) {
+        fprintf(stderr, "Error opening %s\n", argv[arg]);
+        return 1;
+    }
+    uint8_t* events = readFile(argv[arg + 1], &eventsLength);
+    if (events == NULL) {
+        fprintf(stderr, "Error opening %s\n", argv[arg + 1]);
+        return 1;
+    }
+
+    // Logs saved by wasm4 are named after the seed they were played with
+    const char* name = strrchr(argv[arg + 1], '/');
+    sscanf(name != NULL ? name + 1 : argv[arg + 1], "gamepad-events-%u", &seed);
+    data.game_seed = seed;
+
+    double start = now();
+    w4_Core* core = w4_coreNew(cart, cartLength, NULL, 0);
+    w4_coreSetTrace(core, W4_CORE_TRACE_DISABLED, 0);
+    w4_coreSetPersistentData(core, &data);
+    double loaded = now();
+
+    int updates = w4_coreReplay(core, events, eventsLength, limit);
+    double done = now();
+    if (updates < 0) {
+        fprintf(stderr, "Malformed event log: %s\n", argv[arg + 1]);
+        return 1;
+    }
+    w4_coreGetPersistentData(core, &data);
+
+    printf("Updates:    %d\n", updates);
+    printf("Load:       %.1f ms\n", (loaded - start) * 1000);
+    printf("Replay:     %.1f ms\n", (done - loaded) * 1000);
+    printf("--- Persistent Data ---\n");
+    printf("Game Mode:  %u\n", data.game_mode);
+    printf("Max Frames: %u\n", data.max_frames);
+    printf("Game Seed:  %u\n", data.game_seed);
+    printf("Frames:     %u\n", data.frames);
+    printf("Score:      %u\n", data.score);
+    printf("Health:     %u\n", data.health);
+    printf("-----------------------\n");
+
+    w4_coreDelete(core);
+    free(events);
+    free(cart);
+    return 0;
+}
@@ -13,6 +13,9 @@
 #define AUDIO_BUFFER_FRAMES_CALLBACK 256
 #define AUDIO_BUFFER_FRAMES_PER_VIDEO_FRAME 735
 
+// Most frames skipped in a row, so the picture still moves when the audio never catches up
+#define FRAMESKIP_MAX 4
+
 static retro_environment_t environ_cb;
 static retro_video_refresh_t video_cb;
 static retro_input_poll_t input_poll_cb;
@@ -30,8 +33,23 @@ static int16_t audio_output[2*AUDIO_BUFFER_FRAMES_PER_VIDEO_FRAME];
 
 static w4_Disk disk = { 0 };
 
+// The runtime state is bound per thread, and libretro only promises that the entry points are
+// called from one thread at a time, not from the one that loaded the game. Each of them binds the
+// state first and saves it after.
+static w4_RuntimeContext context;
+static bool loaded = false;
+
 static int hold_in_start_value = 10;
 
+// Audio buffer occupancy (%) below which frames are skipped, 0 when disabled
+static unsigned frameskip_threshold = 0;
+static bool audio_buffer_active = false;
+static unsigned audio_buffer_occupancy = 0;
+static bool audio_buffer_underrun_likely = false;
+static bool skip_frame = false;
+static unsigned frames_skipped = 0;
+static bool can_dupe = false;
+
 #if !defined(PSP) && !defined(PS2)
 static void audio_set_state (bool enable) {
 }
@@ -50,13 +68,33 @@ static void fallback_log(enum retro_log_level level,
 
 static retro_log_printf_t log_cb = fallback_log;
 
+static void bind () {
+    if (loaded) {
+        w4_runtimeLoadContext(&context);
+    }
+}
+
+static void unbind () {
+    if (loaded) {
+        w4_runtimeSaveContext(&context);
+    }
+}
+
 #if !defined(PSP) && !defined(PS2)
 static void audio_callback () {
+    // May come from a thread of the frontend's, which plays the APU state the game updates
+    w4_apuBindState(context.apu);
     w4_apuWriteSamples(audio_output, AUDIO_BUFFER_FRAMES_CALLBACK);
     audio_batch_cb(audio_output, AUDIO_BUFFER_FRAMES_CALLBACK);
 }
 #endif
 
+static void audio_buffer_status (bool active, unsigned occupancy, bool underrun_likely) {
+    audio_buffer_active = active;
+    audio_buffer_occupancy = occupancy;
+    audio_buffer_underrun_likely = underrun_likely;
+}
+
 unsigned retro_api_version () {
     return RETRO_API_VERSION;
 }
@@ -82,6 +120,10 @@ static struct retro_variable variables[] =
 	"wasm4_touchscreen_hold_frames",
 	"Frames to hold touch value; 10|20|30|5"
     },
+    {
+	"wasm4_frameskip_threshold",
+	"Skip frames when audio buffer is below (%); disabled|15|20|25|30|40|50"
+    },
     { NULL, NULL },
 };
 
@@ -131,10 +173,12 @@ void retro_set_controller_port_device (unsigned port, unsigned device) {
 }
 
 size_t retro_serialize_size () {
+    bind();
     return w4_runtimeSerializeSize();
 }
 
 bool retro_serialize (void* dest, size_t size) {
+    bind();
     if (size < w4_runtimeSerializeSize()) {
         return false;
     }
@@ -143,10 +187,12 @@ bool retro_serialize (void* dest, size_t size) {
 }
 
 bool retro_unserialize (const void* src, size_t size) {
+    bind();
     if (size < w4_runtimeSerializeSize()) {
         return false;
     }
     w4_runtimeUnserialize(src);
+    unbind();
     return true;
 }
 
@@ -208,6 +254,29 @@ static void try_pixel_format(enum retro_pixel_format format) {
     }
 }
 
+static void update_frameskip() {
+    struct retro_audio_buffer_status_callback buffer_status_cb = { audio_buffer_status };
+    unsigned audio_latency = 0;
+
+    // Occupancy is only meaningful when the frontend holds several frames of audio, so ask for
+    // 6 frames' worth, rounded up to a multiple of 32 ms. A skipped frame shows the previous one
+    // again, which needs the frontend to allow duping.
+    if (frameskip_threshold > 0 && !use_audio_callback && can_dupe
+	&& environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &buffer_status_cb)) {
+	audio_latency = (6 * 1000 / 60 + 31) & ~31u;
+	log_cb(RETRO_LOG_INFO, "Skipping frames below %u%% audio buffer\n", frameskip_threshold);
+    } else {
+	if (frameskip_threshold > 0 && !use_audio_callback && !can_dupe)
+	    log_cb(RETRO_LOG_WARN, "Frontend can't repeat frames, frameskip disabled\n");
+	else if (frameskip_threshold > 0 && !use_audio_callback)
+	    log_cb(RETRO_LOG_WARN, "Frontend doesn't report audio buffer status, frameskip disabled\n");
+	environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, NULL);
+	audio_buffer_active = false;
+    }
+    environ_cb(RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY, &audio_latency);
+    frames_skipped = 0;
+}
+
 static void load_variables(bool startup) {
     struct retro_variable var;
 
@@ -233,6 +302,19 @@ static void load_variables(bool startup) {
 
     if (hold_in_start_value < 0 || hold_in_start_value > 120)
 	hold_in_start_value = 10;
+
+    unsigned old_frameskip_threshold = frameskip_threshold;
+    var.key = "wasm4_frameskip_threshold";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && strcmp(var.value, "disabled") != 0) {
+	frameskip_threshold = strtoul(var.value, 0, 0);
+    } else {
+	frameskip_threshold = 0;
+    }
+
+    if (startup || frameskip_threshold != old_frameskip_threshold)
+	update_frameskip();
 }
 
 bool retro_load_game (const struct retro_game_info* game) {
@@ -319,6 +401,11 @@ bool retro_load_game (const struct retro_game_info* game) {
     memory = w4_wasmInit();
     w4_runtimeInit(memory, &disk);
     w4_wasmLoadModule(wasmData, wasmLength);
+    w4_runtimeSaveContext(&context);
+    loaded = true;
+
+    if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+	can_dupe = false;
 
     load_variables(true);
 
@@ -342,15 +429,20 @@ bool retro_load_game_special (unsigned type, const struct retro_game_info *info,
 }
 
 void retro_unload_game () {
+    bind();
     w4_wasmDestroy();
+    w4_runtimeUnloadContext();
+    loaded = false;
     if (wasmCopy) {
         free(wasmData);
     }
 }
 
 void retro_reset () {
+    bind();
     w4_runtimeInit(memory, &disk);
     w4_wasmLoadModule(wasmData, wasmLength);
+    unbind();
 }
 
 void retro_get_system_av_info (struct retro_system_av_info* info) {
@@ -369,6 +461,8 @@ void retro_get_system_av_info (struct retro_system_av_info* info) {
 }
 
 void retro_run () {
+    bind();
+
     bool updated = false;
     if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated) {
 	load_variables(false);
@@ -478,12 +572,27 @@ void retro_run () {
 
     w4_runtimeSetMouse(80+80*mouseX/0x7fff, 80+80*mouseY/0x7fff, mouseButtons);
 
+    // When the frontend is about to run out of audio, keep the game and the audio going but
+    // don't spend time on the picture
+    skip_frame = false;
+    if (frameskip_threshold > 0 && audio_buffer_active && can_dupe) {
+	if ((audio_buffer_underrun_likely || audio_buffer_occupancy < frameskip_threshold)
+	    && frames_skipped < FRAMESKIP_MAX) {
+	    skip_frame = true;
+	    frames_skipped++;
+	} else {
+	    frames_skipped = 0;
+	}
+    }
+
     w4_runtimeUpdate();
 
     if (!use_audio_callback) {
 	w4_apuWriteSamples(audio_output, AUDIO_BUFFER_FRAMES_PER_VIDEO_FRAME);
 	audio_batch_cb(audio_output, AUDIO_BUFFER_FRAMES_PER_VIDEO_FRAME);
     }
+
+    unbind();
 }
 
 #define do_composite(type, palette) {			\
@@ -526,6 +635,12 @@ void w4_windowComposite (const uint32_t* palette, const uint8_t* framebuffer) {
 
     static uint32_t dest[160*160];
 
+    if (skip_frame) {
+	// Show the previous frame again, frames are only skipped where the frontend allows it
+	video_cb(NULL, 160, 160, 0);
+	return;
+    }
+
     // Convert indexed 2bpp framebuffer to XRGB output
     if (pixel_format == RETRO_PIXEL_FORMAT_RGB565) {
 	uint16_t transform_palette[4];
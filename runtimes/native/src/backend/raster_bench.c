@@ -0,0 +1,295 @@
+// Replays a capture of framebuffer host calls (see capture.h) straight into the rasterizer, to
+// measure it on real carts without any wasm in the way.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../capture.h"
+#include "../framebuffer.h"
+#include "../util.h"
+
+#define FRAMEBUFFER_SIZE (WIDTH*HEIGHT >> 2)
+
+// Blits may sample past the end of what was captured when the cart read past its memory
+#define SPRITE_PADDING 64
+
+typedef struct {
+    uint8_t op;
+    uint8_t drawColors[2];
+    int32_t args[8];
+    uint32_t length;
+    const uint8_t* data;
+} Call;
+
+typedef struct {
+    const uint8_t* bytes;
+    size_t length;
+    size_t offset;
+    bool error;
+} Reader;
+
+static const char* opNames[] = {
+    "frame", "frameEnd", "hline", "vline", "rect", "oval", "line", "blit", "text", "textUtf8",
+    "textUtf16",
+};
+
+static const uint8_t* readBytes (Reader* reader, size_t length) {
+    if (reader->error || reader->length - reader->offset < length) {
+        reader->error = true;
+        return NULL;
+    }
+    const uint8_t* bytes = reader->bytes + reader->offset;
+    reader->offset += length;
+    return bytes;
+}
+
+static uint8_t readU8 (Reader* reader) {
+    const uint8_t* bytes = readBytes(reader, 1);
+    return bytes ? *bytes : 0;
+}
+
+static uint32_t readU32 (Reader* reader) {
+    const uint8_t* bytes = readBytes(reader, 4);
+    return bytes ? w4_read32LE(bytes) : 0;
+}
+
+static int argCount (uint8_t op) {
+    switch (op) {
+    case W4_CAPTURE_FRAME: case W4_CAPTURE_FRAME_END:
+        return 0;
+    case W4_CAPTURE_HLINE: case W4_CAPTURE_VLINE:
+        return 3;
+    case W4_CAPTURE_RECT: case W4_CAPTURE_OVAL: case W4_CAPTURE_LINE:
+        return 4;
+    case W4_CAPTURE_BLIT:
+        return 8;
+    default:
+        return 2;
+    }
+}
+
+static bool readCall (Reader* reader, Call* call) {
+    memset(call, 0, sizeof(Call));
+    call->op = readU8(reader);
+
+    if (call->op == W4_CAPTURE_FRAME) {
+        call->args[0] = readU8(reader);
+        return !reader->error;
+    }
+    if (call->op == W4_CAPTURE_FRAME_END) {
+        call->args[0] = readU32(reader);
+        return !reader->error;
+    }
+    if (call->op > W4_CAPTURE_TEXT_UTF16) {
+        return false;
+    }
+
+    const uint8_t* drawColors = readBytes(reader, 2);
+    if (drawColors != NULL) {
+        memcpy(call->drawColors, drawColors, 2);
+    }
+    for (int ii = 0; ii < argCount(call->op); ++ii) {
+        call->args[ii] = readU32(reader);
+    }
+
+    if (call->op >= W4_CAPTURE_BLIT) {
+        call->length = readU32(reader);
+        const uint8_t* data = readBytes(reader, call->length);
+        if (data == NULL) {
+            return false;
+        }
+        if (call->op == W4_CAPTURE_BLIT) {
+            uint8_t* sprite = xmalloc(call->length + SPRITE_PADDING);
+            memcpy(sprite, data, call->length);
+            memset(sprite + call->length, 0, SPRITE_PADDING);
+            call->data = sprite;
+        } else if (call->op == W4_CAPTURE_TEXT && (call->length == 0 || data[call->length-1] != 0)) {
+            return false;
+        } else {
+            call->data = data;
+        }
+    }
+    return !reader->error;
+}
+
+static void replay (const Call* call, uint8_t* drawColors) {
+    const int32_t* args = call->args;
+    memcpy(drawColors, call->drawColors, 2);
+
+    switch (call->op) {
+    case W4_CAPTURE_FRAME:
+        if (args[0]) {
+            w4_framebufferClear();
+        }
+        break;
+    case W4_CAPTURE_HLINE:
+        w4_framebufferHLine(args[0], args[1], args[2]);
+        break;
+    case W4_CAPTURE_VLINE:
+        w4_framebufferVLine(args[0], args[1], args[2]);
+        break;
+    case W4_CAPTURE_RECT:
+        w4_framebufferRect(args[0], args[1], args[2], args[3]);
+        break;
+    case W4_CAPTURE_OVAL:
+        w4_framebufferOval(args[0], args[1], args[2], args[3]);
+        break;
+    case W4_CAPTURE_LINE:
+        w4_framebufferLine(args[0], args[1], args[2], args[3]);
+        break;
+    case W4_CAPTURE_BLIT: {
+        int flags = args[7];
+        w4_framebufferBlit(call->data, args[0], args[1], args[2], args[3], args[4], args[5], args[6],
+            flags & 1, flags & 2, flags & 4, flags & 8);
+        break;
+    }
+    case W4_CAPTURE_TEXT:
+        w4_framebufferText(call->data, args[0], args[1]);
+        break;
+    case W4_CAPTURE_TEXT_UTF8:
+        w4_framebufferTextUtf8(call->data, call->length, args[0], args[1]);
+        break;
+    case W4_CAPTURE_TEXT_UTF16:
+        w4_framebufferTextUtf16((const uint16_t*)call->data, call->length, args[0], args[1]);
+        break;
+    }
+}
+
+static double now () {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec + spec.tv_nsec * 1e-9;
+}
+
+int main (int argc, const char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: wasm4_rasterbench <capture> [iterations] [only-op]\n");
+        return 1;
+    }
+    int iterations = (argc > 2) ? atoi(argv[2]) : 10;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    // Restrict the timed replay to one kind of call, frame clears are always kept
+    int onlyOp = -1;
+    if (argc > 3) {
+        for (int op = W4_CAPTURE_HLINE; op <= W4_CAPTURE_TEXT_UTF16; ++op) {
+            if (!strcmp(argv[3], opNames[op])) {
+                onlyOp = op;
+            }
+        }
+        if (onlyOp < 0) {
+            fprintf(stderr, "Unknown call: %s\n", argv[3]);
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", argv[1]);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t fileLength = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* fileBytes = xmalloc(fileLength);
+    fileLength = fread(fileBytes, 1, fileLength, file);
+    fclose(file);
+
+    Reader reader = { fileBytes, fileLength, 0, false };
+    const uint8_t* magic = readBytes(&reader, 4);
+    uint32_t version = readU32(&reader);
+    if (magic == NULL || memcmp(magic, W4_CAPTURE_MAGIC, 4) || version != W4_CAPTURE_VERSION) {
+        fprintf(stderr, "Not a version %d capture: %s\n", W4_CAPTURE_VERSION, argv[1]);
+        return 1;
+    }
+
+    // Decoded up front so the timed loop only runs the rasterizer
+    int callCount = 0;
+    int callCapacity = 1024;
+    Call* calls = xmalloc(callCapacity * sizeof(Call));
+    int opCounts[W4_CAPTURE_TEXT_UTF16 + 1] = { 0 };
+    while (reader.offset < reader.length) {
+        if (callCount == callCapacity) {
+            callCapacity *= 2;
+            calls = xrealloc(calls, callCapacity * sizeof(Call));
+        }
+        if (!readCall(&reader, &calls[callCount])) {
+            fprintf(stderr, "Malformed capture at offset %zu\n", reader.offset);
+            return 1;
+        }
+        ++opCounts[calls[callCount].op];
+        ++callCount;
+    }
+
+    uint8_t drawColors[2] = { 0 };
+    uint8_t* framebuffer = xmalloc(FRAMEBUFFER_SIZE);
+    memset(framebuffer, 0, FRAMEBUFFER_SIZE);
+    w4_framebufferInit(drawColors, framebuffer);
+
+    // Check the replay against the cart, frames where the cart wrote to the framebuffer memory
+    // directly will differ
+    int mismatches = 0;
+    int firstMismatch = -1;
+    int frame = -1;
+    for (int ii = 0; ii < callCount; ++ii) {
+        if (calls[ii].op == W4_CAPTURE_FRAME) {
+            ++frame;
+        }
+        if (calls[ii].op == W4_CAPTURE_FRAME_END) {
+            if (w4_captureHash(framebuffer, FRAMEBUFFER_SIZE) != (uint32_t)calls[ii].args[0]) {
+                if (mismatches++ == 0) {
+                    firstMismatch = frame;
+                }
+            }
+        } else {
+            replay(&calls[ii], drawColors);
+        }
+    }
+
+    // Drop what isn't timed, so the loop below is only the rasterizer
+    int timedCount = 0;
+    for (int ii = 0; ii < callCount; ++ii) {
+        uint8_t op = calls[ii].op;
+        if (op == W4_CAPTURE_FRAME || (op != W4_CAPTURE_FRAME_END && (onlyOp < 0 || op == onlyOp))) {
+            calls[timedCount++] = calls[ii];
+        }
+    }
+
+    int frames = opCounts[W4_CAPTURE_FRAME];
+    long long drawCount = (long long)(timedCount - frames) * iterations;
+
+    double start = now();
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        memset(framebuffer, 0, FRAMEBUFFER_SIZE);
+        for (int ii = 0; ii < timedCount; ++ii) {
+            replay(&calls[ii], drawColors);
+        }
+    }
+    double elapsed = now() - start;
+
+    printf("Calls:\n");
+    for (int op = W4_CAPTURE_HLINE; op <= W4_CAPTURE_TEXT_UTF16; ++op) {
+        if (opCounts[op] > 0) {
+            printf("  %-10s %d\n", opNames[op], opCounts[op]);
+        }
+    }
+    printf("Frames:     %d (%d differ from the cart)\n", frames, mismatches);
+    if (mismatches > 0) {
+        printf("First differing frame: %d\n", firstMismatch);
+    }
+    printf("Iterations: %d\n", iterations);
+    printf("Time:       %.3f ms\n", elapsed * 1e3);
+    if (frames > 0) {
+        printf("Per frame:  %.3f us\n", elapsed * 1e6 / ((double)frames * iterations));
+    }
+    if (drawCount > 0) {
+        printf("Per call:   %.1f ns\n", elapsed * 1e9 / drawCount);
+    }
+    printf("Hash:       %08x\n", w4_captureHash(framebuffer, FRAMEBUFFER_SIZE));
+
+    return 0;
+}
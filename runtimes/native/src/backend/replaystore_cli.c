@@ -0,0 +1,136 @@
+// Archives gamepad event logs (the serialized recorder format) in a prefix sharing replay store,
+// and streams them back out.
+//
+//   wasm4_replaystore add <store> <log>...
+//   wasm4_replaystore cat <store> <name>
+//   wasm4_replaystore ls <store>
+//   wasm4_replaystore stats <store>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "../replaystore.h"
+#include "../util.h"
+
+static uint8_t* readFile (const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* bytes = xmalloc(size > 0 ? size : 1);
+    *length = fread(bytes, 1, size > 0 ? size : 0, file);
+    fclose(file);
+    return bytes;
+}
+
+static void printStats (const w4_ReplayStore* store) {
+    w4_ReplayStoreStats stats;
+    w4_replayStoreGetStats(store, &stats);
+    printf("%u replays, %u chunks, %llu bytes of logs stored in %llu bytes (%.1fx)\n",
+        stats.replays, stats.chunks, (unsigned long long)stats.logBytes,
+        (unsigned long long)stats.storedBytes,
+        stats.storedBytes ? (double)stats.logBytes / stats.storedBytes : 0);
+}
+
+// Logs are named after their file, without its directory and extension
+static int addLogs (w4_ReplayStore* store, int logCount, const char* logs[]) {
+    int failed = 0;
+    for (int ii = 0; ii < logCount; ++ii) {
+        const char* base = strrchr(logs[ii], '/');
+        base = (base != NULL) ? base + 1 : logs[ii];
+        char* name = xmalloc(strlen(base) + 1);
+        strcpy(name, base);
+        char* extension = strrchr(name, '.');
+        if (extension != NULL && extension != name) {
+            *extension = '\0';
+        }
+
+        size_t length = 0;
+        uint8_t* log = readFile(logs[ii], &length);
+        if (log == NULL || w4_replayStoreAdd(store, name, log, length) != 0) {
+            fprintf(stderr, "Skipping %s\n", logs[ii]);
+            ++failed;
+        }
+        free(log);
+        free(name);
+    }
+    printStats(store);
+    return failed ? 1 : 0;
+}
+
+static int catReplay (w4_ReplayStore* store, const char* name) {
+    w4_ReplayStream* stream = w4_replayStreamOpen(store, name);
+    if (stream == NULL) {
+        fprintf(stderr, "No replay named %s\n", name);
+        return 1;
+    }
+
+#if defined(_WIN32)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    uint8_t buffer[4096];
+    long length;
+    while ((length = w4_replayStreamRead(stream, buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, length, stdout);
+    }
+    w4_replayStreamClose(stream);
+    if (length < 0) {
+        fprintf(stderr, "Corrupt replay store\n");
+        return 1;
+    }
+    return fflush(stdout) ? 1 : 0;
+}
+
+static int usage () {
+    fprintf(stderr, "Usage: wasm4_replaystore add <store> <log>...\n");
+    fprintf(stderr, "       wasm4_replaystore cat <store> <name>\n");
+    fprintf(stderr, "       wasm4_replaystore ls <store>\n");
+    fprintf(stderr, "       wasm4_replaystore stats <store>\n");
+    return 1;
+}
+
+int main (int argc, const char* argv[]) {
+    if (argc < 3) {
+        return usage();
+    }
+    const char* command = argv[1];
+    bool known = !strcmp(command, "add") || !strcmp(command, "cat") || !strcmp(command, "ls")
+        || !strcmp(command, "stats");
+    if (!known || (!strcmp(command, "cat") && argc != 4)) {
+        return usage();
+    }
+
+    // Only adding may create the store or touch its files
+    w4_ReplayStore* store = !strcmp(command, "add")
+        ? w4_replayStoreOpen(argv[2]) : w4_replayStoreOpenReadOnly(argv[2]);
+    if (store == NULL) {
+        fprintf(stderr, "Error opening %s\n", argv[2]);
+        return 1;
+    }
+
+    int result = 0;
+    if (!strcmp(command, "add")) {
+        result = addLogs(store, argc - 3, argv + 3);
+    } else if (!strcmp(command, "cat")) {
+        result = catReplay(store, argv[3]);
+    } else if (!strcmp(command, "ls")) {
+        for (uint32_t idx = 0; idx < w4_replayStoreCount(store); ++idx) {
+            printf("%s\n", w4_replayStoreName(store, idx));
+        }
+    } else {
+        printStats(store);
+    }
+
+    w4_replayStoreClose(store);
+    return result;
+}
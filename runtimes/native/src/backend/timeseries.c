@@ -0,0 +1,442 @@
+// Replays a directory of recorded gamepad event logs headlessly, sampling the persistent data
+// every N frames into one time series per replay.
+//
+//   wasm4_timeseries [options] <cart> <replay-dir> <output-dir>
+//   wasm4_timeseries [options] --pack <cart> <replay-dir> <output-file>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../w4core.h"
+#include "../batchio.h"
+#include "../util.h"
+
+#define TIMESERIES_MAGIC "W4TS"
+#define TIMESERIES_VERSION 1
+
+#define PACK_MAGIC "W4TP"
+#define PACK_VERSION 1
+
+// Columns of every sample, in file order
+#define COLUMN_COUNT 5
+static const char* const columnNames[COLUMN_COUNT] = {
+    "update", "game_mode", "frames", "score", "health",
+};
+
+typedef struct {
+    const uint8_t* cart;
+    size_t cartLength;
+    const char* replayDir;
+    const char* outputDir;
+
+    uint32_t every;
+    uint32_t limit;
+    uint32_t gameMode;
+    uint32_t maxFrames;
+    uint32_t seed;
+    bool binary;
+
+    char** replays;
+    int replayCount;
+
+    /** Reads the replays ahead, and with --pack the one file every series is appended to. */
+    w4_FileReader* reader;
+    w4_AppendFile* pack;
+
+    pthread_mutex_t mutex;
+    int failed;
+    unsigned long long updates;
+} Batch;
+
+typedef struct {
+    uint32_t* values;
+    uint32_t rows;
+    uint32_t capacity;
+} Series;
+
+static void addSample (Series* series, uint32_t update, const w4_CorePersistentData* data) {
+    if (series->rows == series->capacity) {
+        series->capacity = series->capacity ? 2*series->capacity : 1024;
+        series->values = xrealloc(series->values, series->capacity * COLUMN_COUNT * sizeof(uint32_t));
+    }
+    uint32_t* row = series->values + series->rows * COLUMN_COUNT;
+    row[0] = update;
+    row[1] = data->game_mode;
+    row[2] = data->frames;
+    row[3] = data->score;
+    row[4] = data->health;
+    ++series->rows;
+}
+
+typedef struct {
+    uint8_t* bytes;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static void bufferAppend (Buffer* buffer, const void* data, size_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        while (buffer->length + length > buffer->capacity) {
+            buffer->capacity = buffer->capacity ? 2*buffer->capacity : 64 * 1024;
+        }
+        buffer->bytes = xrealloc(buffer->bytes, buffer->capacity);
+    }
+    memcpy(buffer->bytes + buffer->length, data, length);
+    buffer->length += length;
+}
+
+// Binary files are column major: magic, u32 version, u32 rows, u32 columns, then each column as
+// rows u32 values. All little-endian.
+static void formatSeries (const Batch* batch, const Series* series, Buffer* buffer) {
+    if (batch->binary) {
+        uint8_t header[16];
+        memcpy(header, TIMESERIES_MAGIC, 4);
+        w4_write32LE(header + 4, TIMESERIES_VERSION);
+        w4_write32LE(header + 8, series->rows);
+        w4_write32LE(header + 12, COLUMN_COUNT);
+        bufferAppend(buffer, header, sizeof(header));
+
+        for (int col = 0; col < COLUMN_COUNT; ++col) {
+            for (uint32_t row = 0; row < series->rows; ++row) {
+                uint8_t value[4];
+                w4_write32LE(value, series->values[row*COLUMN_COUNT + col]);
+                bufferAppend(buffer, value, sizeof(value));
+            }
+        }
+    } else {
+        char line[64];
+        for (int col = 0; col < COLUMN_COUNT; ++col) {
+            int length = snprintf(line, sizeof(line), col ? ",%s" : "%s", columnNames[col]);
+            bufferAppend(buffer, line, length);
+        }
+        bufferAppend(buffer, "\n", 1);
+        for (uint32_t row = 0; row < series->rows; ++row) {
+            const uint32_t* values = series->values + row * COLUMN_COUNT;
+            int length = snprintf(line, sizeof(line), "%u,%u,%u,%u,%u\n",
+                values[0], values[1], values[2], values[3], values[4]);
+            bufferAppend(buffer, line, length);
+        }
+    }
+}
+
+// Packed output is one file of records, starting with the magic and a u32 version. Each record is
+// a u32 name length, a u32 data length, the name, then the data as it would be in a file of its
+// own, padded with zeros to a multiple of 4 bytes. Records are in the order replays finished.
+static int writeSeries (const Batch* batch, const char* name, const Series* series, Buffer* buffer) {
+    buffer->length = 0;
+
+    if (batch->pack != NULL) {
+        size_t nameLength = strlen(name);
+        uint8_t header[8] = { 0 };
+        bufferAppend(buffer, header, sizeof(header));
+        bufferAppend(buffer, name, nameLength);
+        size_t dataStart = buffer->length;
+        formatSeries(batch, series, buffer);
+        w4_write32LE(buffer->bytes, nameLength);
+        w4_write32LE(buffer->bytes + 4, buffer->length - dataStart);
+
+        static const uint8_t padding[4] = { 0 };
+        bufferAppend(buffer, padding, (4 - buffer->length % 4) % 4);
+        return w4_appendFileWrite(batch->pack, buffer->bytes, buffer->length) < 0 ? -1 : 0;
+    }
+
+    size_t pathLength = strlen(batch->outputDir) + strlen(name) + 16;
+    char* path = xmalloc(pathLength);
+    snprintf(path, pathLength, "%s/%s.%s", batch->outputDir, name, batch->binary ? "w4ts" : "csv");
+    FILE* file = fopen(path, "wb");
+    free(path);
+    if (file == NULL) {
+        return -1;
+    }
+    formatSeries(batch, series, buffer);
+    bool ok = fwrite(buffer->bytes, 1, buffer->length, file) == buffer->length;
+    return (fclose(file) == 0 && ok) ? 0 : -1;
+}
+
+// Same input semantics as w4_coreReplay(), but sampling along the way. Returns the number of
+// updates run, or -1 if the log is malformed.
+static int runReplay (Batch* batch, w4_Core* core, const void* initialState, const char* name,
+    const uint8_t* events, size_t eventsLength, Series* series) {
+    if (eventsLength < 4 || (eventsLength - 4) % 8 != 0 || w4_read32LE(events) != (eventsLength - 4) / 8) {
+        return -1;
+    }
+    uint32_t eventCount = w4_read32LE(events);
+    events += 4;
+
+    // Logs saved by wasm4 are named after the seed they were played with
+    uint32_t seed = batch->seed;
+    sscanf(name, "gamepad-events-%u", &seed);
+
+    w4_coreUnserialize(core, initialState);
+    w4_CorePersistentData data = {
+        .game_mode = batch->gameMode,
+        .max_frames = batch->maxFrames,
+        .game_seed = seed,
+    };
+    w4_coreSetPersistentData(core, &data);
+
+    uint8_t gamepads[4] = { 0 };
+    uint32_t cursor = 0;
+    uint32_t update = 0;
+    series->rows = 0;
+    while (update < batch->limit) {
+        for (; cursor < eventCount && w4_read32LE(events + cursor*8) <= update; ++cursor) {
+            const uint8_t* event = events + cursor*8;
+            uint8_t playerIdx = event[4], button = event[5], eventType = event[6];
+            if (playerIdx >= 4) {
+                continue;
+            }
+            if (eventType == 0) {
+                gamepads[playerIdx] |= button;
+            } else if (eventType == 1) {
+                gamepads[playerIdx] &= ~button;
+            }
+        }
+        for (int playerIdx = 0; playerIdx < 4; ++playerIdx) {
+            w4_coreSetGamepad(core, playerIdx, gamepads[playerIdx]);
+        }
+
+        ++update;
+        bool running = w4_coreUpdate(core);
+        w4_coreGetPersistentData(core, &data);
+
+        // The last update is always kept, so every series ends with the final result
+        if (!running || update % batch->every == 0 || update == batch->limit) {
+            addSample(series, update, &data);
+        }
+        if (!running) {
+            break;
+        }
+    }
+    return update;
+}
+
+static void* workerMain (void* userData) {
+    Batch* batch = userData;
+
+    w4_Core* core = w4_coreNew(batch->cart, batch->cartLength, NULL, 0);
+    w4_coreSetTrace(core, W4_CORE_TRACE_DISABLED, 0);
+    void* initialState = xmalloc(w4_coreSerializeSize(core));
+    w4_coreSerialize(core, initialState);
+
+    Series series = { 0 };
+    Buffer output = { 0 };
+    for (;;) {
+        size_t eventsLength = 0;
+        uint8_t* events = NULL;
+        int idx = w4_fileReaderNext(batch->reader, &events, &eventsLength);
+        if (idx < 0) {
+            break;
+        }
+        const char* name = batch->replays[idx];
+
+        int updates = (events != NULL)
+            ? runReplay(batch, core, initialState, name, events, eventsLength, &series)
+            : -1;
+        free(events);
+
+        // Output files are named after the replay, without its extension
+        char* outputName = xmalloc(strlen(name) + 1);
+        strcpy(outputName, name);
+        char* extension = strrchr(outputName, '.');
+        if (extension != NULL && extension != outputName) {
+            *extension = '\0';
+        }
+        bool ok = (updates >= 0) && writeSeries(batch, outputName, &series, &output) == 0;
+        free(outputName);
+
+        pthread_mutex_lock(&batch->mutex);
+        if (ok) {
+            batch->updates += updates;
+        } else {
+            ++batch->failed;
+            fprintf(stderr, "Failed: %s\n", name);
+        }
+        pthread_mutex_unlock(&batch->mutex);
+    }
+
+    free(output.bytes);
+    free(series.values);
+    free(initialState);
+    w4_coreDelete(core);
+    return NULL;
+}
+
+static int compareNames (const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static double now () {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec + spec.tv_nsec * 1e-9;
+}
+
+static int usage () {
+    fprintf(stderr, "Usage: wasm4_timeseries [options] <cart> <replay-dir> <output-dir|output-file>\n"
+        "  --every <n>       Sample every n updates (1)\n"
+        "  --limit <n>       Stop replays that run longer than n updates (36000)\n"
+        "  --threads <n>     Replays to run at once (1)\n"
+        "  --game-mode <n>   Persistent data every replay starts with (1)\n"
+        "  --max-frames <n>  (600)\n"
+        "  --seed <n>        For logs not named gamepad-events-<seed>.bin (0)\n"
+        "  --huge-pages <n>  Reserve instance memory up front, on 0 normal, 1 transparent huge\n"
+        "                    or 2 explicit huge pages\n"
+        "  --binary          Write columnar .w4ts files instead of CSV\n"
+        "  --pack            Append every series to one output file instead of a directory\n"
+        "  --read-ahead <n>  Replays to read ahead of the workers (64)\n");
+    return 1;
+}
+
+int main (int argc, const char* argv[]) {
+    Batch batch = { 0 };
+    batch.every = 1;
+    batch.limit = 36000;
+    batch.gameMode = 1;
+    batch.maxFrames = 600;
+    int threads = 1;
+    int hugePages = -1;
+    int readAhead = 64;
+    bool pack = false;
+
+    int arg = 1;
+    for (; arg < argc && !strncmp(argv[arg], "--", 2); ++arg) {
+        const char* option = argv[arg];
+        if (!strcmp(option, "--binary")) {
+            batch.binary = true;
+            continue;
+        }
+        if (!strcmp(option, "--pack")) {
+            pack = true;
+            continue;
+        }
+        if (arg + 1 >= argc) {
+            return usage();
+        }
+        uint32_t value = strtoul(argv[++arg], NULL, 10);
+        if (!strcmp(option, "--every")) {
+            batch.every = value ? value : 1;
+        } else if (!strcmp(option, "--limit")) {
+            batch.limit = value;
+        } else if (!strcmp(option, "--threads")) {
+            threads = value ? value : 1;
+        } else if (!strcmp(option, "--game-mode")) {
+            batch.gameMode = value;
+        } else if (!strcmp(option, "--max-frames")) {
+            batch.maxFrames = value;
+        } else if (!strcmp(option, "--seed")) {
+            batch.seed = value;
+        } else if (!strcmp(option, "--huge-pages")) {
+            hugePages = value;
+        } else if (!strcmp(option, "--read-ahead")) {
+            readAhead = value ? value : 1;
+        } else {
+            return usage();
+        }
+    }
+    if (argc - arg != 3) {
+        return usage();
+    }
+
+    uint8_t* cart = NULL;
+    w4_FileReader* cartReader = w4_fileReaderNew(&argv[arg], 1, 1);
+    w4_fileReaderNext(cartReader, &cart, &batch.cartLength);
+    w4_fileReaderDelete(cartReader);
+    if (cart == NULL) {
+        fprintf(stderr, "Error opening %s\n", argv[arg]);
+        return 1;
+    }
+    batch.cart = cart;
+    batch.replayDir = argv[arg + 1];
+    batch.outputDir = argv[arg + 2];
+
+    DIR* dir = opendir(batch.replayDir);
+    if (dir == NULL) {
+        fprintf(stderr, "Error opening %s\n", batch.replayDir);
+        return 1;
+    }
+    int capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        if (batch.replayCount == capacity) {
+            capacity = capacity ? 2*capacity : 256;
+            batch.replays = xrealloc(batch.replays, capacity * sizeof(char*));
+        }
+        batch.replays[batch.replayCount] = xmalloc(strlen(entry->d_name) + 1);
+        strcpy(batch.replays[batch.replayCount++], entry->d_name);
+    }
+    closedir(dir);
+    qsort(batch.replays, batch.replayCount, sizeof(char*), compareNames);
+
+    if (threads > batch.replayCount) {
+        threads = batch.replayCount > 0 ? batch.replayCount : 1;
+    }
+
+    if (hugePages >= 0 && !w4_corePoolReserve(threads, hugePages)) {
+        fprintf(stderr, "Could not reserve instance memory, using malloc\n");
+    }
+
+    if (pack) {
+        batch.pack = w4_appendFileOpen(batch.outputDir);
+        if (batch.pack == NULL) {
+            fprintf(stderr, "Error opening %s\n", batch.outputDir);
+            return 1;
+        }
+        uint8_t header[8];
+        memcpy(header, PACK_MAGIC, 4);
+        w4_write32LE(header + 4, PACK_VERSION);
+        w4_appendFileWrite(batch.pack, header, sizeof(header));
+    }
+
+    char** paths = xmalloc((batch.replayCount + 1) * sizeof(char*));
+    for (int ii = 0; ii < batch.replayCount; ++ii) {
+        size_t pathLength = strlen(batch.replayDir) + strlen(batch.replays[ii]) + 2;
+        paths[ii] = xmalloc(pathLength);
+        snprintf(paths[ii], pathLength, "%s/%s", batch.replayDir, batch.replays[ii]);
+    }
+
+    pthread_mutex_init(&batch.mutex, NULL);
+    double start = now();
+    batch.reader = w4_fileReaderNew((const char* const*)paths, batch.replayCount, readAhead);
+
+    // The calling thread is one of the workers
+    pthread_t* workers = xmalloc(threads * sizeof(pthread_t));
+    for (int ii = 1; ii < threads; ++ii) {
+        pthread_create(&workers[ii], NULL, workerMain, &batch);
+    }
+    workerMain(&batch);
+    for (int ii = 1; ii < threads; ++ii) {
+        pthread_join(workers[ii], NULL);
+    }
+
+    double elapsed = now() - start;
+    pthread_mutex_destroy(&batch.mutex);
+
+    printf("%d replays (%d failed), %llu updates in %.2f s, %.0f updates/s, read with %s\n",
+        batch.replayCount, batch.failed, batch.updates, elapsed,
+        (elapsed > 0) ? batch.updates / elapsed : 0, w4_fileReaderMethod(batch.reader));
+    w4_fileReaderDelete(batch.reader);
+
+    if (batch.pack != NULL && w4_appendFileClose(batch.pack) != 0) {
+        fprintf(stderr, "Error writing %s\n", batch.outputDir);
+        batch.failed = 1;
+    }
+
+    for (int ii = 0; ii < batch.replayCount; ++ii) {
+        free(paths[ii]);
+        free(batch.replays[ii]);
+    }
+    free(paths);
+    free(batch.replays);
+    free(workers);
+    free(cart);
+    return batch.failed ? 1 : 0;
+}
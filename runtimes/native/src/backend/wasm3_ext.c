@@ -0,0 +1,66 @@
+#include "wasm3_ext.h"
+
+#include <string.h>
+
+#include <m3_env.h>
+
+// Everything below depends on the layout of M3Runtime and M3MemoryHeader, and on what
+// m3_NewRuntime() and m3_FreeRuntime() allocate and free, as of wasm3 0.5 (v0.5.0 up to the
+// vendor/wasm3 submodule). Check them against m3_env.c before moving the submodule to another
+// version.
+#if M3_VERSION_MAJOR != 0 || M3_VERSION_MINOR != 5
+#error "wasm3_ext.c was written against wasm3 0.5, check it against this version of wasm3"
+#endif
+
+#define PAGE_SIZE (1 << 16)
+
+size_t w4_m3StackBytes (uint32_t stackSize) {
+    // As allocated by m3_NewRuntime()
+    return stackSize + 4*sizeof(m3slot_t);
+}
+
+size_t w4_m3MemoryBytes () {
+    // As allocated by ResizeMemory(), the header followed by the pages
+    return sizeof(M3MemoryHeader) + PAGE_SIZE;
+}
+
+void w4_m3InitMemory (void* memory) {
+    M3MemoryHeader* header = memory;
+    header->length = PAGE_SIZE;
+}
+
+uint8_t* w4_m3MemoryData (void* memory) {
+    return (uint8_t*)((M3MemoryHeader*)memory + 1);
+}
+
+IM3Runtime w4_m3NewRuntime (IM3Environment env, uint32_t stackSize, void* stack, void* memory) {
+    IM3Runtime runtime = m3_NewRuntime(env, stackSize, NULL);
+    m3_Free(runtime->originStack);
+    runtime->originStack = stack;
+    runtime->stack = stack;
+
+    w4_m3InitMemory(memory);
+    runtime->memory.numPages = 1;
+    runtime->memory.maxPages = 1;
+    w4_m3SwapMemory(runtime, memory);
+    return runtime;
+}
+
+void w4_m3FreeRuntime (IM3Runtime runtime, void** stack, void** memory) {
+    *memory = runtime->memory.mallocated;
+    runtime->memory.mallocated = NULL;
+    *stack = runtime->originStack;
+    runtime->originStack = NULL;
+    runtime->stack = NULL;
+    m3_FreeRuntime(runtime);
+}
+
+void* w4_m3SwapMemory (IM3Runtime runtime, void* memory) {
+    M3MemoryHeader* header = memory;
+    header->runtime = runtime;
+    header->maxStack = (m3slot_t*)runtime->originStack + runtime->numStackSlots;
+
+    void* previous = runtime->memory.mallocated;
+    runtime->memory.mallocated = header;
+    return previous;
+}
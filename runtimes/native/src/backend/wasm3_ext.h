@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <wasm3.h>
+
+// Runtime and memory setup that wasm3's public API doesn't offer: creating a runtime on a stack and
+// memory the caller provides, and swapping memories between calls. These reach into wasm3's
+// internals, so they're kept out of wasm_wasm3.c and checked against one wasm3 version, see
+// wasm3_ext.c.
+
+// Bytes to provide for a runtime's stack, and for a memory of one page
+size_t w4_m3StackBytes (uint32_t stackSize);
+size_t w4_m3MemoryBytes ();
+
+// Sets up a zeroed memory block of w4_m3MemoryBytes(), before it's given to a runtime
+void w4_m3InitMemory (void* memory);
+
+// The page of a memory block, where the cart's memory starts
+uint8_t* w4_m3MemoryData (void* memory);
+
+// Creates a runtime on the given stack and memory, which the caller keeps owning.
+// w4_m3FreeRuntime() hands them back instead of freeing them.
+IM3Runtime w4_m3NewRuntime (IM3Environment env, uint32_t stackSize, void* stack, void* memory);
+void w4_m3FreeRuntime (IM3Runtime runtime, void** stack, void** memory);
+
+// Points the runtime at another memory block for the following calls, and returns the one it had
+void* w4_m3SwapMemory (IM3Runtime runtime, void* memory);
@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <toywasm/exec_context.h>
 #include <toywasm/exec_debug.h>
@@ -13,6 +14,7 @@
 #include <toywasm/type.h>
 
 #include "../runtime.h"
+#include "../util.h"
 #include "../wasm.h"
 
 static const struct memtype memtype = {
@@ -27,14 +29,19 @@ static const struct memtype memtype = {
 #endif
 };
 
-static struct mem_context mctx;
-static struct meminst *meminst;
-static struct import_object *host_import_obj;
-static struct import_object *mem_import_obj;
-static struct module *module;
-static struct instance *instance;
-static uint32_t start;
-static uint32_t update;
+struct w4_instance {
+    struct mem_context mctx;
+    struct meminst *meminst;
+    uint8_t *base;
+    struct import_object *host_import_obj;
+    struct import_object *mem_import_obj;
+    struct module *module;
+    struct instance *instance;
+    uint32_t start;
+    uint32_t update;
+};
+
+static W4_THREAD_LOCAL struct w4_instance *w4;
 
 static void *convert_to_ptr(struct exec_context *ctx, uint32_t wp) {
     /*
@@ -42,7 +49,7 @@ static void *convert_to_ptr(struct exec_context *ctx, uint32_t wp) {
      * know the size of the access. especially for things like tracef.
      */
     void *p;
-    int ret = host_func_getptr(ctx, meminst, wp, 1, &p);
+    int ret = host_func_getptr(ctx, w4->meminst, wp, 1, &p);
     if (ret != 0) {
         fprintf(stderr,
                 "host_func_getptr failed with %d: wasm ptr 0x%" PRIx32 "\n",
@@ -58,186 +65,213 @@ static void *convert_to_ptr(struct exec_context *ctx, uint32_t wp) {
 #define W4_HOST_FUNC(n, t) HOST_FUNC_PREFIX(w4_, n, t)
 #define W4_HOST_FUNC_DECL(n) HOST_FUNC_DECL(w4_##n)
 
-#define HOST_FUNC_PARAM_PTR(ft, params, i)                                     \
-    convert_to_ptr(ctx, HOST_FUNC_PARAM(ft, params, i, i32))
+/*
+ * the console memory is a single fixed 64KB page which never moves,
+ * so a wasm pointer is just an offset from its base. the size-aware
+ * bounds checks are done by runtime.c, which knows how much each call
+ * reads or writes.
+ */
+static inline void *host_ptr(struct exec_context *ctx, uint32_t wp) {
+    if (wp > 0xffff) {
+        /* let toywasm report the trap */
+        return convert_to_ptr(ctx, wp);
+    }
+    return w4->base + wp;
+}
+
+#if defined(TOYWASM_USE_SMALL_CELLS)
+/*
+ * every import only takes i32s, which are exactly one cell each.
+ * parameter i is cell i, so there's nothing to convert.
+ */
+#define W4_PARAMS_BEGIN()
+#define W4_PARAMS_END()
+#define W4_PARAM_I32(i) (params[i].x)
+#else
+#define W4_PARAMS_BEGIN() HOST_FUNC_CONVERT_PARAMS(ft, params)
+#define W4_PARAMS_END() HOST_FUNC_FREE_CONVERTED_PARAMS()
+#define W4_PARAM_I32(i) HOST_FUNC_PARAM(ft, params, i, i32)
+#endif
+
+#define W4_PARAM_PTR(i) host_ptr(ctx, W4_PARAM_I32(i))
 
 static W4_HOST_FUNC_DECL(blit) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *sprite = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t width = HOST_FUNC_PARAM(ft, params, 3, i32);
-    uint32_t height = HOST_FUNC_PARAM(ft, params, 4, i32);
-    uint32_t flags = HOST_FUNC_PARAM(ft, params, 5, i32);
+    W4_PARAMS_BEGIN();
+    const uint8_t *sprite = W4_PARAM_PTR(0);
+    uint32_t x = W4_PARAM_I32(1);
+    uint32_t y = W4_PARAM_I32(2);
+    uint32_t width = W4_PARAM_I32(3);
+    uint32_t height = W4_PARAM_I32(4);
+    uint32_t flags = W4_PARAM_I32(5);
     w4_runtimeBlit(sprite, x, y, width, height, flags);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(blitSub) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *sprite = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t width = HOST_FUNC_PARAM(ft, params, 3, i32);
-    uint32_t height = HOST_FUNC_PARAM(ft, params, 4, i32);
-    uint32_t srcX = HOST_FUNC_PARAM(ft, params, 5, i32);
-    uint32_t srcY = HOST_FUNC_PARAM(ft, params, 6, i32);
-    uint32_t stride = HOST_FUNC_PARAM(ft, params, 7, i32);
-    uint32_t flags = HOST_FUNC_PARAM(ft, params, 8, i32);
+    W4_PARAMS_BEGIN();
+    const uint8_t *sprite = W4_PARAM_PTR(0);
+    uint32_t x = W4_PARAM_I32(1);
+    uint32_t y = W4_PARAM_I32(2);
+    uint32_t width = W4_PARAM_I32(3);
+    uint32_t height = W4_PARAM_I32(4);
+    uint32_t srcX = W4_PARAM_I32(5);
+    uint32_t srcY = W4_PARAM_I32(6);
+    uint32_t stride = W4_PARAM_I32(7);
+    uint32_t flags = W4_PARAM_I32(8);
     w4_runtimeBlitSub(sprite, x, y, width, height, srcX, srcY, stride, flags);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(line) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint32_t x1 = HOST_FUNC_PARAM(ft, params, 0, i32);
-    uint32_t y1 = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t x2 = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t y2 = HOST_FUNC_PARAM(ft, params, 3, i32);
+    W4_PARAMS_BEGIN();
+    uint32_t x1 = W4_PARAM_I32(0);
+    uint32_t y1 = W4_PARAM_I32(1);
+    uint32_t x2 = W4_PARAM_I32(2);
+    uint32_t y2 = W4_PARAM_I32(3);
     w4_runtimeLine(x1, y1, x2, y2);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(hline) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 0, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t len = HOST_FUNC_PARAM(ft, params, 2, i32);
+    W4_PARAMS_BEGIN();
+    uint32_t x = W4_PARAM_I32(0);
+    uint32_t y = W4_PARAM_I32(1);
+    uint32_t len = W4_PARAM_I32(2);
     w4_runtimeHLine(x, y, len);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(vline) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 0, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t len = HOST_FUNC_PARAM(ft, params, 2, i32);
+    W4_PARAMS_BEGIN();
+    uint32_t x = W4_PARAM_I32(0);
+    uint32_t y = W4_PARAM_I32(1);
+    uint32_t len = W4_PARAM_I32(2);
     w4_runtimeVLine(x, y, len);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(oval) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 0, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t width = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t height = HOST_FUNC_PARAM(ft, params, 3, i32);
+    W4_PARAMS_BEGIN();
+    uint32_t x = W4_PARAM_I32(0);
+    uint32_t y = W4_PARAM_I32(1);
+    uint32_t width = W4_PARAM_I32(2);
+    uint32_t height = W4_PARAM_I32(3);
     w4_runtimeOval(x, y, width, height);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(rect) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 0, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t width = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t height = HOST_FUNC_PARAM(ft, params, 3, i32);
+    W4_PARAMS_BEGIN();
+    uint32_t x = W4_PARAM_I32(0);
+    uint32_t y = W4_PARAM_I32(1);
+    uint32_t width = W4_PARAM_I32(2);
+    uint32_t height = W4_PARAM_I32(3);
     w4_runtimeRect(x, y, width, height);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(text) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 2, i32);
+    W4_PARAMS_BEGIN();
+    const uint8_t *str = W4_PARAM_PTR(0);
+    uint32_t x = W4_PARAM_I32(1);
+    uint32_t y = W4_PARAM_I32(2);
     w4_runtimeText(str, x, y);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(textUtf8) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t byteLength = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 3, i32);
+    W4_PARAMS_BEGIN();
+    const uint8_t *str = W4_PARAM_PTR(0);
+    uint32_t byteLength = W4_PARAM_I32(1);
+    uint32_t x = W4_PARAM_I32(2);
+    uint32_t y = W4_PARAM_I32(3);
     w4_runtimeTextUtf8(str, byteLength, x, y);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(textUtf16) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint16_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t byteLength = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t x = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t y = HOST_FUNC_PARAM(ft, params, 3, i32);
+    W4_PARAMS_BEGIN();
+    const uint16_t *str = W4_PARAM_PTR(0);
+    uint32_t byteLength = W4_PARAM_I32(1);
+    uint32_t x = W4_PARAM_I32(2);
+    uint32_t y = W4_PARAM_I32(3);
     w4_runtimeTextUtf16(str, byteLength, x, y);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(tone) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint32_t frequency = HOST_FUNC_PARAM(ft, params, 0, i32);
-    uint32_t duration = HOST_FUNC_PARAM(ft, params, 1, i32);
-    uint32_t volume = HOST_FUNC_PARAM(ft, params, 2, i32);
-    uint32_t flags = HOST_FUNC_PARAM(ft, params, 3, i32);
+    W4_PARAMS_BEGIN();
+    uint32_t frequency = W4_PARAM_I32(0);
+    uint32_t duration = W4_PARAM_I32(1);
+    uint32_t volume = W4_PARAM_I32(2);
+    uint32_t flags = W4_PARAM_I32(3);
     w4_runtimeTone(frequency, duration, volume, flags);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(diskr) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    uint8_t *dest = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t size = HOST_FUNC_PARAM(ft, params, 1, i32);
+    W4_PARAMS_BEGIN();
+    uint8_t *dest = W4_PARAM_PTR(0);
+    uint32_t size = W4_PARAM_I32(1);
     int wasmret = w4_runtimeDiskr(dest, size);
     HOST_FUNC_RESULT_SET(ft, results, 0, i32, wasmret);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(diskw) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *src = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t size = HOST_FUNC_PARAM(ft, params, 1, i32);
+    W4_PARAMS_BEGIN();
+    const uint8_t *src = W4_PARAM_PTR(0);
+    uint32_t size = W4_PARAM_I32(1);
     int wasmret = w4_runtimeDiskw(src, size);
     HOST_FUNC_RESULT_SET(ft, results, 0, i32, wasmret);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(trace) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
+    W4_PARAMS_BEGIN();
+    const uint8_t *str = W4_PARAM_PTR(0);
     w4_runtimeTrace(str);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(traceUtf8) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t byteLength = HOST_FUNC_PARAM(ft, params, 1, i32);
+    W4_PARAMS_BEGIN();
+    const uint8_t *str = W4_PARAM_PTR(0);
+    uint32_t byteLength = W4_PARAM_I32(1);
     w4_runtimeTraceUtf8(str, byteLength);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(traceUtf16) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint16_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    uint32_t byteLength = HOST_FUNC_PARAM(ft, params, 1, i32);
+    W4_PARAMS_BEGIN();
+    const uint16_t *str = W4_PARAM_PTR(0);
+    uint32_t byteLength = W4_PARAM_I32(1);
     w4_runtimeTraceUtf16(str, byteLength);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
 static W4_HOST_FUNC_DECL(tracef) {
-    HOST_FUNC_CONVERT_PARAMS(ft, params);
-    const uint8_t *str = HOST_FUNC_PARAM_PTR(ft, params, 0);
-    const void *stack = HOST_FUNC_PARAM_PTR(ft, params, 1);
+    W4_PARAMS_BEGIN();
+    const uint8_t *str = W4_PARAM_PTR(0);
+    const void *stack = W4_PARAM_PTR(1);
     w4_runtimeTracef(str, stack);
-    HOST_FUNC_FREE_CONVERTED_PARAMS();
+    W4_PARAMS_END();
     return 0;
 }
 
@@ -262,51 +296,70 @@ static const struct host_module host_modules[] = {{
     .nfuncs = ARRAYCOUNT(host_inst_funcs),
 }};
 
+bool w4_wasmSetShareCode(bool share) {
+    return false;
+}
+
 uint8_t *w4_wasmInit() {
     int ret;
-    mem_context_init(&mctx);
+    w4 = xmalloc(sizeof(*w4));
+    memset(w4, 0, sizeof(*w4));
+    struct mem_context *mctx = &w4->mctx;
+    mem_context_init(mctx);
     /*
      * set an arbitrary limit.
      * this includes the 64KB linear memory.
      * REVISIT: how much operand stack etc typical carts can consume?
      */
-    ret = mem_context_setlimit(&mctx, 128 * 1024);
+    ret = mem_context_setlimit(mctx, 128 * 1024);
     if (ret != 0) {
         fprintf(stderr, "failed to set memory limit with %d\n", ret);
         exit(1);
     }
-    ret = memory_instance_create(&mctx, &meminst, &memtype);
+    ret = memory_instance_create(mctx, &w4->meminst, &memtype);
     if (ret != 0) {
         fprintf(stderr, "memory_instance_create failed with %d\n", ret);
         exit(1);
     }
     void *p;
     bool moved;
-    ret = memory_instance_getptr2(meminst, 0, 0, 64 * 1024, &p, &moved);
+    ret = memory_instance_getptr2(w4->meminst, 0, 0, 64 * 1024, &p, &moved);
     if (ret != 0) {
         fprintf(stderr, "memory_instance_getptr2 failed with %d\n", ret);
         exit(1);
     }
+    w4->base = p;
     return p;
 }
 
 void w4_wasmDestroy() {
-    if (instance != NULL) {
-        instance_destroy(instance);
+    struct mem_context *mctx = &w4->mctx;
+    if (w4->instance != NULL) {
+        instance_destroy(w4->instance);
     }
-    if (module != NULL) {
-        module_destroy(&mctx, module);
+    if (w4->module != NULL) {
+        module_destroy(mctx, w4->module);
     }
-    if (host_import_obj != NULL) {
-        import_object_destroy(&mctx, host_import_obj);
+    if (w4->host_import_obj != NULL) {
+        import_object_destroy(mctx, w4->host_import_obj);
     }
-    if (mem_import_obj != NULL) {
-        import_object_destroy(&mctx, mem_import_obj);
+    if (w4->mem_import_obj != NULL) {
+        import_object_destroy(mctx, w4->mem_import_obj);
     }
-    if (meminst != NULL) {
-        memory_instance_destroy(&mctx, meminst);
+    if (w4->meminst != NULL) {
+        memory_instance_destroy(mctx, w4->meminst);
     }
-    mem_context_clear(&mctx);
+    mem_context_clear(mctx);
+    free(w4);
+    w4 = NULL;
+}
+
+void *w4_wasmGetInstance() {
+    return w4;
+}
+
+void w4_wasmSetInstance(void *instance) {
+    w4 = instance;
 }
 
 static uint32_t find_func(const struct module *m, const char *name_cstr,
@@ -327,11 +380,16 @@ static uint32_t find_func(const struct module *m, const char *name_cstr,
     return idx;
 }
 
-int run_func(struct instance *inst, uint32_t funcidx) {
+// results may be NULL for functions without results
+int run_func(struct instance *inst, uint32_t funcidx, struct val *results) {
     struct exec_context ctx;
     int ret;
-    exec_context_init(&ctx, inst, &mctx);
-    ret = instance_execute_func_nocheck(&ctx, funcidx);
+    exec_context_init(&ctx, inst, &w4->mctx);
+    if (results != NULL) {
+        ret = instance_execute_func(&ctx, funcidx, NULL, results);
+    } else {
+        ret = instance_execute_func_nocheck(&ctx, funcidx);
+    }
     ret = instance_execute_handle_restart(&ctx, ret);
     if (ret == ETOYWASMTRAP) {
         fprintf(stderr, "wasm function execution failed: %s\n",
@@ -344,10 +402,13 @@ int run_func(struct instance *inst, uint32_t funcidx) {
 }
 
 void w4_wasmLoadModule(const uint8_t *wasmBuffer, int byteLength) {
+    struct mem_context *mctx = &w4->mctx;
     struct import_object *import_obj;
+    struct import_object *mem_import_obj;
+    struct import_object *host_import_obj;
     int ret;
 
-    ret = import_object_alloc(&mctx, 1, &mem_import_obj);
+    ret = import_object_alloc(mctx, 1, &mem_import_obj);
     if (ret != 0) {
         fprintf(stderr, "import_object_alloc failed with %d\n", ret);
         exit(1);
@@ -355,20 +416,22 @@ void w4_wasmLoadModule(const uint8_t *wasmBuffer, int byteLength) {
     mem_import_obj->entries[0].module_name = &name_env;
     mem_import_obj->entries[0].name = &name_memory;
     mem_import_obj->entries[0].type = EXTERNTYPE_MEMORY;
-    mem_import_obj->entries[0].u.mem = meminst;
+    mem_import_obj->entries[0].u.mem = w4->meminst;
+    w4->mem_import_obj = mem_import_obj;
     ret = import_object_create_for_host_funcs(
-        &mctx, host_modules, ARRAYCOUNT(host_modules), NULL, &host_import_obj);
+        mctx, host_modules, ARRAYCOUNT(host_modules), NULL, &host_import_obj);
     if (ret != 0) {
         fprintf(stderr, "import_object_create_for_host_funcs failed with %d\n",
                 ret);
         exit(1);
     }
+    w4->host_import_obj = host_import_obj;
     import_obj = host_import_obj;
     host_import_obj->next = mem_import_obj;
 
     struct load_context lctx;
-    load_context_init(&lctx, &mctx);
-    ret = module_create(&module, wasmBuffer, wasmBuffer + byteLength, &lctx);
+    load_context_init(&lctx, mctx);
+    ret = module_create(&w4->module, wasmBuffer, wasmBuffer + byteLength, &lctx);
     if (ret != 0) {
         fprintf(stderr, "module_create failed with %d: %s\n", ret,
                 report_getmessage(&lctx.report));
@@ -378,7 +441,7 @@ void w4_wasmLoadModule(const uint8_t *wasmBuffer, int byteLength) {
 
     struct report report;
     report_init(&report);
-    ret = instance_create(&mctx, module, &instance, import_obj, &report);
+    ret = instance_create(mctx, w4->module, &w4->instance, import_obj, &report);
     if (ret != 0) {
         fprintf(stderr, "instance_create failed with %d: %s\n", ret,
                 report_getmessage(&report));
@@ -386,22 +449,50 @@ void w4_wasmLoadModule(const uint8_t *wasmBuffer, int byteLength) {
     }
     report_clear(&report);
 
-    start = find_func(module, "start", false);
-    update = find_func(module, "update", true);
-    uint32_t init = find_func(module, "_initialize", false);
+    w4->start = find_func(w4->module, "start", false);
+    w4->update = find_func(w4->module, "update", true);
+    uint32_t init = find_func(w4->module, "_initialize", false);
     if (init != (uint32_t)-1) {
-        run_func(instance, init);
+        run_func(w4->instance, init, NULL);
     }
 }
 
 void w4_wasmCallStart() {
-    if (start != (uint32_t)-1) {
-        run_func(instance, start);
+    if (w4->start != (uint32_t)-1) {
+        run_func(w4->instance, w4->start, NULL);
+    }
+}
+
+bool w4_wasmCallUpdate() {
+    // update() returns 0 once the game is over, carts that return nothing keep running
+    struct val result;
+    result.u.i32 = 1;
+    if (w4->update != (uint32_t)-1) {
+        run_func(w4->instance, w4->update, &result);
+    }
+    return result.u.i32 != 0;
+}
+
+int w4_wasmGlobalsSize() {
+    if (w4->instance == NULL) {
+        return 0;
+    }
+    return w4->instance->globals.lsize * sizeof(struct val);
+}
+
+void w4_wasmSaveGlobals(void *dest) {
+    struct val *out = dest;
+    for (uint32_t i = 0; w4->instance != NULL && i < w4->instance->globals.lsize; i++) {
+        memcpy(&out[i], &w4->instance->globals.p[i]->val, sizeof(struct val));
     }
 }
 
-void w4_wasmCallUpdate() {
-    if (update != (uint32_t)-1) {
-        run_func(instance, update);
+void w4_wasmLoadGlobals(const void *src) {
+    const struct val *in = src;
+    for (uint32_t i = 0; w4->instance != NULL && i < w4->instance->globals.lsize; i++) {
+        struct globalinst *ginst = w4->instance->globals.p[i];
+        if (ginst->type->mut == GLOBAL_VAR) {
+            memcpy(&ginst->val, &in[i], sizeof(struct val));
+        }
     }
 }
@@ -1,15 +1,107 @@
+#include <stdbool.h>
+#include <string.h>
+
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#define W4_WASM3_THREADS
+#endif
+
 #include <wasm3.h>
 #include <m3_env.h>
 
 #include "../wasm.h"
+#include "../pool.h"
 #include "../runtime.h"
+#include "../util.h"
+#include "wasm3_ext.h"
+
+// This is an arbitrary limit corresponding to the implementation details
+// of the wasm3 interpreter. It's unrelated to the resource constraints of
+// the wasm4 VM. Making this too small will ultimately result in `[trap]
+// stack overflow` at the command line.
+//
+// Using 64 KB, since this is the default of wasm3 standalone binary on
+// desktop platforms (from wasm3/platforms/app/main.c).
+#define WASM3_STACK_SIZE (64 * 1024)
+
+// One loaded copy of a cart, with its own compiled code and stack. Shared instances of the cart
+// borrow a slot for each call into wasm, swapping in their own memory and globals.
+typedef struct Slot {
+    M3Environment* env;
+    M3Runtime* runtime;
+    M3Module* module;
+
+    /** The memory the runtime was created with, bound whenever no instance is. */
+    void* scratch;
+
+    M3Function* start;
+    M3Function* update;
+    M3Function* startSection;
+    M3Function* wasiStart;
+    M3Function* wasiInitialize;
+
+    struct Slot* nextFree;
+} Slot;
+
+// Everything instances of one cart have in common when sharing code
+typedef struct SharedCode {
+    uint8_t* cart;
+    int cartLength;
+    int refs;
+
+    /** Slots not in use, and every slot ever created. */
+    Slot* freeSlots;
+    Slot** slots;
+    int slotCount;
+
+    /** The bytes the data segments write, where the mask is set. */
+    uint8_t* segmentMask;
+    uint8_t* segmentBytes;
+
+    uint32_t numGlobals;
+    uint64_t* initialGlobals;
+
+    struct SharedCode* next;
+} SharedCode;
+
+typedef struct {
+    M3Environment* env;
+    M3Runtime* runtime;
+    M3Module* module;
+
+    M3Function* start;
+    M3Function* update;
+
+    // When sharing code, the fields above belong to the borrowed slot and are only set during a
+    // call. The instance itself only owns its memory and globals.
+    SharedCode* shared;
+    Slot* slot;
+    void* memory;
+    uint64_t* globals;
+} Instance;
+
+static W4_THREAD_LOCAL Instance* instance;
+
+// Applies to instances created afterwards
+static bool shareCode = false;
+
+// Every cart being shared, and their slots
+static SharedCode* sharedCodes = NULL;
+#ifdef W4_WASM3_THREADS
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
-static M3Environment* env;
-static M3Runtime* runtime;
-static M3Module* module;
+static void lockShared () {
+#ifdef W4_WASM3_THREADS
+    pthread_mutex_lock(&sharedMutex);
+#endif
+}
 
-static M3Function* start;
-static M3Function* update;
+static void unlockShared () {
+#ifdef W4_WASM3_THREADS
+    pthread_mutex_unlock(&sharedMutex);
+#endif
+}
 
 static m3ApiRawFunction (blit) {
     m3ApiGetArgMem(const uint8_t*, sprite);
@@ -158,46 +250,102 @@ static m3ApiRawFunction (tracef) {
 static void check (M3Result result) {
     if (result != m3Err_none) {
         M3ErrorInfo info;
-        m3_GetErrorInfo(runtime, &info);
+        m3_GetErrorInfo(instance->runtime, &info);
         fprintf(stderr, "WASM error: %s (%s)\n", result, info.message);
         exit(1);
     }
 }
 
-uint8_t* w4_wasmInit () {
-    env = m3_NewEnvironment();
+bool w4_wasmSetShareCode (bool share) {
+    bool previous = shareCode;
+    shareCode = share;
+    return previous;
+}
 
-    // This is an arbitrary limit corresponding to the implementation details
-    // of the wasm3 interpreter. It's unrelated to the resource constraints of
-    // the wasm4 VM. Making this too small will ultimately result in `[trap]
-    // stack overflow` at the command line.
-    //
-    // Using 64 KB, since this is the default of wasm3 standalone binary on
-    // desktop platforms (from wasm3/platforms/app/main.c).
-    uint32_t wasm3StackSize = 64 * 1024;
+// Creates a runtime with its stack and its one page of memory taken from the pool, in place of the
+// ones wasm3 would allocate. freeRuntime() returns them.
+static IM3Runtime newRuntime (IM3Environment env) {
+    void* memory = w4_poolAlloc(w4_m3MemoryBytes());
+    memset(memory, 0, w4_m3MemoryBytes());
+    return w4_m3NewRuntime(env, WASM3_STACK_SIZE, w4_poolAlloc(w4_m3StackBytes(WASM3_STACK_SIZE)),
+        memory);
+}
 
-    runtime = m3_NewRuntime(env, wasm3StackSize, NULL);
+static void freeRuntime (IM3Runtime runtime) {
+    void* stack;
+    void* memory;
+    w4_m3FreeRuntime(runtime, &stack, &memory);
+    w4_poolFree(memory, w4_m3MemoryBytes());
+    w4_poolFree(stack, w4_m3StackBytes(WASM3_STACK_SIZE));
+}
 
-    runtime->memory.maxPages = 1;
-    ResizeMemory(runtime, 1);
+uint8_t* w4_wasmInit () {
+    instance = xmalloc(sizeof(Instance));
+    memset(instance, 0, sizeof(Instance));
+
+    if (shareCode) {
+        // The runtime comes from the cart's slots once it's loaded, only the memory is needed now
+        instance->memory = w4_poolAlloc(w4_m3MemoryBytes());
+        memset(instance->memory, 0, w4_m3MemoryBytes());
+        w4_m3InitMemory(instance->memory);
+        return w4_m3MemoryData(instance->memory);
+    }
 
-    return m3_GetMemory(runtime, NULL, 0);
+    instance->env = m3_NewEnvironment();
+
+    instance->runtime = newRuntime(instance->env);
+    return m3_GetMemory(instance->runtime, NULL, 0);
 }
 
-void w4_wasmDestroy () {
-    m3_FreeRuntime(runtime);
-    m3_FreeEnvironment(env);
+static void freeSharedCode (SharedCode* shared) {
+    for (int ii = 0; ii < shared->slotCount; ++ii) {
+        Slot* slot = shared->slots[ii];
+        freeRuntime(slot->runtime);
+        m3_FreeEnvironment(slot->env);
+        free(slot);
+    }
+    free(shared->slots);
+    free(shared->segmentMask);
+    free(shared->segmentBytes);
+    free(shared->initialGlobals);
+    free(shared->cart);
+    free(shared);
 }
 
-void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
-    check(m3_ParseModule(env, &module, wasmBuffer, byteLength));
+void w4_wasmDestroy () {
+    if (instance->memory != NULL) {
+        SharedCode* shared = instance->shared;
+        if (shared != NULL) {
+            lockShared();
+            if (--shared->refs == 0) {
+                SharedCode** link = &sharedCodes;
+                while (*link != shared) {
+                    link = &(*link)->next;
+                }
+                *link = shared->next;
+                freeSharedCode(shared);
+            }
+            unlockShared();
+        }
+        free(instance->globals);
+        w4_poolFree(instance->memory, w4_m3MemoryBytes());
+    } else {
+        freeRuntime(instance->runtime);
+        m3_FreeEnvironment(instance->env);
+    }
+    free(instance);
+    instance = NULL;
+}
 
-    // wasm3 will reallocate a new memory if the module doesn't import a memory. We set this to
-    // prevent that from happening: https://github.com/aduros/wasm4/issues/292
-    module->memoryImported = true;
+void* w4_wasmGetInstance () {
+    return instance;
+}
 
-    check(m3_LoadModule(runtime, module));
+void w4_wasmSetInstance (void* instance_) {
+    instance = instance_;
+}
 
+static void linkImports (IM3Module module) {
     m3_LinkRawFunction(module, "env", "blit", "v(iiiiii)", blit);
     m3_LinkRawFunction(module, "env", "blitSub", "v(iiiiiiiii)", blitSub);
     m3_LinkRawFunction(module, "env", "line", "v(iiii)", line);
@@ -221,14 +369,207 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
 
 #ifndef NDEBUG
     M3ErrorInfo error;
-    m3_GetErrorInfo(runtime, &error);
+    m3_GetErrorInfo(module->runtime, &error);
     if (error.result) {
         fprintf(stderr, "Error in load: %s: %s\n", error.result, error.message);
     }
 #endif
+}
+
+static void loadModule (IM3Runtime runtime, IM3Module* module, const uint8_t* wasmBuffer, int byteLength) {
+    check(m3_ParseModule(runtime->environment, module, wasmBuffer, byteLength));
+
+    // wasm3 will reallocate a new memory if the module doesn't import a memory. We set this to
+    // prevent that from happening: https://github.com/aduros/wasm4/issues/292
+    (*module)->memoryImported = true;
+
+    check(m3_LoadModule(runtime, *module));
+}
+
+// Globals are saved as 8 bytes each, in the module's order
+static void saveGlobals (IM3Module module, void* dest) {
+    uint8_t* out = dest;
+    for (uint32_t ii = 0; ii < module->numGlobals; ++ii, out += sizeof(uint64_t)) {
+        M3TaggedValue value = { 0 };
+        m3_GetGlobal(&module->globals[ii], &value);
+        memcpy(out, &value.value, sizeof(uint64_t));
+    }
+}
+
+static void loadGlobals (IM3Module module, const void* src) {
+    const uint8_t* in = src;
+    for (uint32_t ii = 0; ii < module->numGlobals; ++ii, in += sizeof(uint64_t)) {
+        IM3Global global = &module->globals[ii];
+        if (global->isMutable) {
+            M3TaggedValue value;
+            value.type = m3_GetGlobalType(global);
+            memcpy(&value.value, in, sizeof(uint64_t));
+            m3_SetGlobal(global, &value);
+        }
+    }
+}
+
+// Loads another copy of a shared cart, with its scratch memory filled with the given byte.
+// Called with the shared lock held.
+static Slot* newSlot (SharedCode* shared, uint8_t fill) {
+    Slot* slot = xmalloc(sizeof(Slot));
+    memset(slot, 0, sizeof(Slot));
+
+    slot->env = m3_NewEnvironment();
+    slot->runtime = newRuntime(slot->env);
+    memset(m3_GetMemory(slot->runtime, NULL, 0), fill, 1 << 16);
+
+    // So check() can report errors while loading
+    instance->runtime = slot->runtime;
+    loadModule(slot->runtime, &slot->module, shared->cart, shared->cartLength);
+    linkImports(slot->module);
+
+    IM3Module module = slot->module;
+    if (module->startFunction >= 0) {
+        slot->startSection = &module->functions[module->startFunction];
+    }
+
+    shared->slots = xrealloc(shared->slots, (shared->slotCount + 1) * sizeof(Slot*));
+    shared->slots[shared->slotCount++] = slot;
+    return slot;
+}
+
+// Finds the functions and compiles the start section, after the data segments and globals were
+// recorded. The start section runs against the scratch memory here, and again for every instance.
+static void prepareSlot (Slot* slot) {
+    check(m3_RunStart(slot->module));
+    m3_FindFunction(&slot->start, slot->runtime, "start");
+    m3_FindFunction(&slot->update, slot->runtime, "update");
+    m3_FindFunction(&slot->wasiStart, slot->runtime, "_start");
+    m3_FindFunction(&slot->wasiInitialize, slot->runtime, "_initialize");
+}
+
+static SharedCode* newSharedCode (const uint8_t* wasmBuffer, int byteLength) {
+    SharedCode* shared = xmalloc(sizeof(SharedCode));
+    memset(shared, 0, sizeof(SharedCode));
+    shared->cart = xmalloc(byteLength);
+    memcpy(shared->cart, wasmBuffer, byteLength);
+    shared->cartLength = byteLength;
+
+    // Loading into memories filled with different bytes tells which bytes the data segments
+    // write, including the zeros
+    Slot* zeros = newSlot(shared, 0x00);
+    Slot* ones = newSlot(shared, 0xff);
+    const uint8_t* a = m3_GetMemory(zeros->runtime, NULL, 0);
+    const uint8_t* b = m3_GetMemory(ones->runtime, NULL, 0);
+    shared->segmentMask = xmalloc(1 << 16);
+    shared->segmentBytes = xmalloc(1 << 16);
+    for (int ii = 0; ii < (1 << 16); ++ii) {
+        shared->segmentMask[ii] = (a[ii] == b[ii]);
+        shared->segmentBytes[ii] = a[ii];
+    }
+
+    shared->numGlobals = zeros->module->numGlobals;
+    shared->initialGlobals = xmalloc(shared->numGlobals * sizeof(uint64_t) + 1);
+    saveGlobals(zeros->module, shared->initialGlobals);
+
+    prepareSlot(zeros);
+    prepareSlot(ones);
+    zeros->nextFree = ones;
+    shared->freeSlots = zeros;
+    return shared;
+}
+
+// Borrows a slot of the instance's cart and points it at the instance's memory and globals
+static void enterShared () {
+    SharedCode* shared = instance->shared;
+    lockShared();
+    Slot* slot = shared->freeSlots;
+    if (slot != NULL) {
+        shared->freeSlots = slot->nextFree;
+    } else {
+        slot = newSlot(shared, 0);
+        prepareSlot(slot);
+    }
+    unlockShared();
+
+    slot->scratch = w4_m3SwapMemory(slot->runtime, instance->memory);
+    loadGlobals(slot->module, instance->globals);
+
+    instance->slot = slot;
+    instance->env = slot->env;
+    instance->runtime = slot->runtime;
+    instance->module = slot->module;
+    instance->start = slot->start;
+    instance->update = slot->update;
+}
+
+static void leaveShared () {
+    Slot* slot = instance->slot;
+    saveGlobals(slot->module, instance->globals);
+    w4_m3SwapMemory(slot->runtime, slot->scratch);
+
+    instance->slot = NULL;
+    instance->env = NULL;
+    instance->runtime = NULL;
+    instance->module = NULL;
+    instance->start = NULL;
+    instance->update = NULL;
+
+    lockShared();
+    slot->nextFree = instance->shared->freeSlots;
+    instance->shared->freeSlots = slot;
+    unlockShared();
+}
+
+static void loadShared (const uint8_t* wasmBuffer, int byteLength) {
+    lockShared();
+    SharedCode* shared = sharedCodes;
+    while (shared != NULL && (shared->cartLength != byteLength
+            || memcmp(shared->cart, wasmBuffer, byteLength))) {
+        shared = shared->next;
+    }
+    if (shared == NULL) {
+        shared = newSharedCode(wasmBuffer, byteLength);
+        shared->next = sharedCodes;
+        sharedCodes = shared;
+    }
+    ++shared->refs;
+    unlockShared();
+
+    instance->shared = shared;
+    instance->globals = xmalloc(shared->numGlobals * sizeof(uint64_t) + 1);
+    memcpy(instance->globals, shared->initialGlobals, shared->numGlobals * sizeof(uint64_t));
+
+    uint8_t* memory = w4_m3MemoryData(instance->memory);
+    for (int ii = 0; ii < (1 << 16); ++ii) {
+        if (shared->segmentMask[ii]) {
+            memory[ii] = shared->segmentBytes[ii];
+        }
+    }
 
-    m3_FindFunction(&start, runtime, "start");
-    m3_FindFunction(&update, runtime, "update");
+    enterShared();
+    Slot* slot = instance->slot;
+    if (slot->startSection) {
+        check(m3_CallV(slot->startSection));
+    }
+    if (slot->wasiStart) {
+        check(m3_CallV(slot->wasiStart));
+    }
+    if (slot->wasiInitialize) {
+        check(m3_CallV(slot->wasiInitialize));
+    }
+    leaveShared();
+}
+
+void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
+    if (instance->memory != NULL) {
+        loadShared(wasmBuffer, byteLength);
+        return;
+    }
+
+    IM3Runtime runtime = instance->runtime;
+    loadModule(runtime, &instance->module, wasmBuffer, byteLength);
+    IM3Module module = instance->module;
+    linkImports(module);
+
+    m3_FindFunction(&instance->start, runtime, "start");
+    m3_FindFunction(&instance->update, runtime, "update");
 
     // First call wasm built-in start
     check(m3_RunStart(module));
@@ -246,19 +587,56 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
 }
 
 void w4_wasmCallStart () {
-    if (start) {
-        check(m3_CallV(start));
+    if (instance->shared) {
+        enterShared();
+    }
+    if (instance->start) {
+        check(m3_CallV(instance->start));
+    }
+    if (instance->shared) {
+        leaveShared();
     }
 }
 
 bool w4_wasmCallUpdate () {
-    if (update) {
-        check(m3_CallV(update));
+    if (instance->shared) {
+        enterShared();
+    }
+    bool running = true;
+    if (instance->update) {
+        check(m3_CallV(instance->update));
 
         int32_t result = 0;
-        check(m3_GetResultsV(update, &result));
-        return result != 0;
+        check(m3_GetResultsV(instance->update, &result));
+        running = result != 0;
+    }
+    if (instance->shared) {
+        leaveShared();
+    }
+    return running;
+}
+
+int w4_wasmGlobalsSize () {
+    if (instance->shared) {
+        return instance->shared->numGlobals * sizeof(uint64_t);
     }
+    const IM3Module module = instance->module;
+    return module ? module->numGlobals * sizeof(uint64_t) : 0;
+}
 
-    return true;
+void w4_wasmSaveGlobals (void* dest) {
+    if (instance->shared) {
+        memcpy(dest, instance->globals, instance->shared->numGlobals * sizeof(uint64_t));
+    } else if (instance->module) {
+        saveGlobals(instance->module, dest);
+    }
+}
+
+void w4_wasmLoadGlobals (const void* src) {
+    if (instance->shared) {
+        // Immutable globals are the same in every instance, so they can be copied over too
+        memcpy(instance->globals, src, instance->shared->numGlobals * sizeof(uint64_t));
+    } else if (instance->module) {
+        loadGlobals(instance->module, src);
+    }
 }
@@ -1,22 +1,52 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <wasm.h>
+#include <sys/stat.h>
+#include <wasmer.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#include <windows.h>
+#define mkdir(path, mode) _mkdir(path)
+#define getpid() _getpid()
+#define utime(path, times) _utime(path, times)
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#if !defined(_MSC_VER)
+#define ADD_RELAXED(ptr, value) __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED)
+#else
+#define ADD_RELAXED(ptr, value) (*(ptr) += (value))
+#endif
 
 #include "../wasm.h"
 #include "../runtime.h"
+#include "../util.h"
 
-static wasm_engine_t* engine;
-static wasm_store_t* store;
-static wasm_memory_t* memory;
-static wasm_module_t* module;
-static wasm_instance_t* instance;
+typedef struct {
+    wasm_engine_t* engine;
+    wasm_store_t* store;
+    wasm_memory_t* memory;
+    wasm_module_t* module;
+    wasm_instance_t* instance;
 
-static wasm_func_t* start = NULL;
-static wasm_func_t* update = NULL;
+    wasm_func_t* start;
+    wasm_func_t* update;
+
+    /** The cart's mutable globals, which every module exports once compileModule() patched it. */
+    wasm_global_t** globals;
+    int globalCount;
+} Instance;
+
+static W4_THREAD_LOCAL Instance* current;
 
 static void* getMemoryPointer (wasm_val_t* val) {
-    byte_t* data = wasm_memory_data(memory);
+    byte_t* data = wasm_memory_data(current->memory);
     int32_t offset = val->of.i32;
     return (offset < 0 || offset >= (1 << 16)) ? NULL : (void*)(data + offset);
 }
@@ -169,24 +199,42 @@ static wasm_trap_t* tracef (const wasm_val_vec_t* args, wasm_val_vec_t* results)
     return NULL;
 }
 
+bool w4_wasmSetShareCode (bool share) {
+    return false;
+}
+
 uint8_t* w4_wasmInit () {
-    engine = wasm_engine_new();
-    store = wasm_store_new(engine);
+    current = xmalloc(sizeof(Instance));
+    memset(current, 0, sizeof(Instance));
+
+    current->engine = wasm_engine_new();
+    current->store = wasm_store_new(current->engine);
 
     wasm_limits_t limits = { .max = 1, .min = 1 };
     wasm_memorytype_t* memorytype = wasm_memorytype_new(&limits);
-    memory = wasm_memory_new(store, memorytype);
+    current->memory = wasm_memory_new(current->store, memorytype);
 
-    byte_t* data = wasm_memory_data(memory);
+    byte_t* data = wasm_memory_data(current->memory);
     memset(data, 0, 1 << 16);
     return (uint8_t*)data;
 }
 
 void w4_wasmDestroy () {
-    wasm_instance_delete(instance);
-    wasm_module_delete(module);
-    wasm_store_delete(store);
-    wasm_engine_delete(engine);
+    free(current->globals);
+    wasm_instance_delete(current->instance);
+    wasm_module_delete(current->module);
+    wasm_store_delete(current->store);
+    wasm_engine_delete(current->engine);
+    free(current);
+    current = NULL;
+}
+
+void* w4_wasmGetInstance () {
+    return current;
+}
+
+void w4_wasmSetInstance (void* instance) {
+    current = instance;
 }
 
 static wasm_functype_t* createFuncType (int params, int results) {
@@ -216,12 +264,522 @@ void check (wasm_trap_t* trap) {
     }
 }
 
-void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
+// Compiled modules are cached on disk, named after the cart's hash. Each file holds the magic,
+// u32 format version, u32 engine version length, the engine version, u32 cart length, u64 cart
+// hash, u32 module length, u64 module hash, the cart, then the serialized module. All
+// little-endian. The hash can be made to collide, so a module is only used for the exact cart it
+// was compiled from.
+#define CACHE_MAGIC "W4WC"
+#define CACHE_VERSION 3
+
+// Every rebuild of a watched cart adds a module, so only the most recently used ones are kept. A
+// module counts as used when it's written or loaded, which sets its modification time.
+#define CACHE_MAX_MODULES 32
+#define CACHE_MAX_BYTES (256ull * 1024 * 1024)
+
+static uint64_t hash64 (const uint8_t* bytes, size_t length) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t ii = 0; ii < length; ++ii) {
+        hash = (hash ^ bytes[ii]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t read64LE (const uint8_t* ptr) {
+    return w4_read32LE(ptr) | ((uint64_t)w4_read32LE(ptr + 4) << 32);
+}
+
+static void write64LE (uint8_t* ptr, uint64_t value) {
+    w4_write32LE(ptr, value);
+    w4_write32LE(ptr + 4, value >> 32);
+}
+
+// WASM4_CACHE_DIR overrides where modules are cached, and disables the cache when empty
+static char* getCacheDir () {
+    const char* dir = getenv("WASM4_CACHE_DIR");
+    if (dir != NULL) {
+        if (*dir == '\0') {
+            return NULL;
+        }
+        mkdir(dir, 0755);
+        char* path = xmalloc(strlen(dir) + 1);
+        strcpy(path, dir);
+        return path;
+    }
+
+#if defined(_WIN32)
+    const char* base = getenv("LOCALAPPDATA");
+    const char* suffix = "/wasm4";
+#else
+    const char* base = getenv("XDG_CACHE_HOME");
+    const char* suffix = "/wasm4";
+    if (base == NULL || *base == '\0') {
+        base = getenv("HOME");
+        suffix = "/.cache/wasm4";
+    }
+#endif
+    if (base == NULL || *base == '\0') {
+        return NULL;
+    }
+    char* path = xmalloc(strlen(base) + strlen(suffix) + 1);
+    strcpy(path, base);
+    strcat(path, suffix);
+
+    // Create every missing directory after the base
+    for (char* slash = path + strlen(base) + 1; *slash; ++slash) {
+        if (*slash == '/') {
+            *slash = '\0';
+            mkdir(path, 0755);
+            *slash = '/';
+        }
+    }
+    mkdir(path, 0755);
+    return path;
+}
+
+typedef struct {
+    char* path;
+    uint64_t used;
+    uint64_t size;
+} CacheEntry;
+
+static int compareCacheEntries (const void* a, const void* b) {
+    uint64_t usedA = ((const CacheEntry*)a)->used;
+    uint64_t usedB = ((const CacheEntry*)b)->used;
+    return (usedA < usedB) - (usedA > usedB);
+}
+
+static void addCacheEntry (CacheEntry** entries, int* count, int* capacity, const char* dir,
+        const char* name, uint64_t used, uint64_t size) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 64;
+        *entries = xrealloc(*entries, *capacity * sizeof(CacheEntry));
+    }
+    CacheEntry* entry = &(*entries)[(*count)++];
+    entry->path = xmalloc(strlen(dir) + strlen(name) + 2);
+    sprintf(entry->path, "%s/%s", dir, name);
+    entry->used = used;
+    entry->size = size;
+}
+
+// Removes the least recently used modules past the limits, never the one just written
+static void pruneCache (const char* dir, const char* keep) {
+    CacheEntry* entries = NULL;
+    int count = 0;
+    int capacity = 0;
+
+#if defined(_WIN32)
+    char* pattern = xmalloc(strlen(dir) + 16);
+    sprintf(pattern, "%s/*.wasmer", dir);
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA(pattern, &found);
+    free(pattern);
+    if (search == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        uint64_t used = ((uint64_t)found.ftLastWriteTime.dwHighDateTime << 32)
+            | found.ftLastWriteTime.dwLowDateTime;
+        uint64_t size = ((uint64_t)found.nFileSizeHigh << 32) | found.nFileSizeLow;
+        addCacheEntry(&entries, &count, &capacity, dir, found.cFileName, used, size);
+    } while (FindNextFileA(search, &found));
+    FindClose(search);
+#else
+    DIR* listing = opendir(dir);
+    if (listing == NULL) {
+        return;
+    }
+    struct dirent* found;
+    while ((found = readdir(listing)) != NULL) {
+        size_t nameLength = strlen(found->d_name);
+        if (nameLength < 7 || strcmp(found->d_name + nameLength - 7, ".wasmer")) {
+            continue;
+        }
+        char* path = xmalloc(strlen(dir) + nameLength + 2);
+        sprintf(path, "%s/%s", dir, found->d_name);
+        struct stat info;
+        if (stat(path, &info) == 0) {
+            addCacheEntry(&entries, &count, &capacity, dir, found->d_name, info.st_mtime, info.st_size);
+        }
+        free(path);
+    }
+    closedir(listing);
+#endif
+
+    qsort(entries, count, sizeof(CacheEntry), compareCacheEntries);
+    int kept = 0;
+    uint64_t keptBytes = 0;
+    for (int ii = 0; ii < count; ++ii) {
+        CacheEntry* entry = &entries[ii];
+        if (!strcmp(entry->path, keep)
+                || (kept < CACHE_MAX_MODULES && keptBytes + entry->size <= CACHE_MAX_BYTES)) {
+            ++kept;
+            keptBytes += entry->size;
+        } else {
+            remove(entry->path);
+        }
+        free(entry->path);
+    }
+    free(entries);
+}
+
+// Up to and including the cart
+static size_t cacheHeaderSize (const char* engineVersion, int byteLength) {
+    return 4 + 4 + 4 + strlen(engineVersion) + 4 + 8 + 4 + 8 + byteLength;
+}
+
+// Returns NULL if there is no valid cached module for this cart and engine
+static wasm_module_t* loadCachedModule (const char* path, const uint8_t* wasmBuffer, int byteLength,
+        uint64_t cartHash, const char* engineVersion) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    size_t headerSize = cacheHeaderSize(engineVersion, byteLength);
+    if (size <= 0 || (size_t)size < headerSize) {
+        fclose(file);
+        return NULL;
+    }
+    uint8_t* data = xmalloc(size);
+    size_t length = fread(data, 1, size, file);
+    fclose(file);
+
+    size_t versionLength = strlen(engineVersion);
+    const uint8_t* cursor = data;
+    bool valid = length == (size_t)size
+        && !memcmp(cursor, CACHE_MAGIC, 4)
+        && w4_read32LE(cursor + 4) == CACHE_VERSION
+        && w4_read32LE(cursor + 8) == versionLength
+        && !memcmp(cursor + 12, engineVersion, versionLength);
+    cursor += 12 + versionLength;
+    valid = valid
+        && w4_read32LE(cursor) == (uint32_t)byteLength
+        && read64LE(cursor + 4) == cartHash
+        && w4_read32LE(cursor + 12) == length - headerSize
+        && !memcmp(cursor + 24, wasmBuffer, byteLength);
+    cursor += 12;
+
+    wasm_module_t* module = NULL;
+    if (valid) {
+        // Deserializing trusts the compiled code, so at least make sure it was written whole
+        const uint8_t* compiled = cursor + 12 + byteLength;
+        size_t compiledLength = w4_read32LE(cursor);
+        if (read64LE(cursor + 4) == hash64(compiled, compiledLength)) {
+            wasm_byte_vec_t bytes;
+            wasm_byte_vec_new(&bytes, compiledLength, (const char*)compiled);
+            module = wasm_module_deserialize(current->store, &bytes);
+            wasm_byte_vec_delete(&bytes);
+        }
+    }
+    free(data);
+    if (module != NULL) {
+        // Marks it as recently used, for pruneCache()
+        utime(path, NULL);
+    }
+    return module;
+}
+
+// Returns true if the module was written
+static bool saveCachedModule (const char* path, const wasm_module_t* module,
+        const uint8_t* wasmBuffer, int byteLength, uint64_t cartHash, const char* engineVersion) {
+    wasm_byte_vec_t compiled;
+    wasm_module_serialize(module, &compiled);
+    if (compiled.size == 0) {
+        return false;
+    }
+
+    size_t versionLength = strlen(engineVersion);
+    size_t headerSize = cacheHeaderSize(engineVersion, byteLength);
+    uint8_t* header = xmalloc(headerSize);
+    memcpy(header, CACHE_MAGIC, 4);
+    w4_write32LE(header + 4, CACHE_VERSION);
+    w4_write32LE(header + 8, versionLength);
+    memcpy(header + 12, engineVersion, versionLength);
+    uint8_t* cursor = header + 12 + versionLength;
+    w4_write32LE(cursor, byteLength);
+    write64LE(cursor + 4, cartHash);
+    w4_write32LE(cursor + 12, compiled.size);
+    write64LE(cursor + 16, hash64((const uint8_t*)compiled.data, compiled.size));
+    memcpy(cursor + 24, wasmBuffer, byteLength);
+
+    // Written beside the final file and renamed over it, so concurrent launches never see a
+    // partial module. The process id and a counter keep every writer's temp file apart.
+    static unsigned tempCounter = 0;
+    char* tempPath = xmalloc(strlen(path) + 32);
+    sprintf(tempPath, "%s.%ld.%u.tmp", path, (long)getpid(), ADD_RELAXED(&tempCounter, 1));
+    bool ok = false;
+    FILE* file = fopen(tempPath, "wb");
+    if (file != NULL) {
+        ok = fwrite(header, 1, headerSize, file) == headerSize
+            && fwrite(compiled.data, 1, compiled.size, file) == compiled.size;
+        if (fclose(file) == 0 && ok) {
+#if defined(_WIN32)
+            remove(path);
+#endif
+            ok = rename(tempPath, path) == 0;
+        }
+        if (!ok) {
+            remove(tempPath);
+        }
+    }
+    free(tempPath);
+    free(header);
+    wasm_byte_vec_delete(&compiled);
+    return ok;
+}
+
+#define WASM_SECTION_IMPORT 2
+#define WASM_SECTION_GLOBAL 6
+#define WASM_SECTION_EXPORT 7
+#define WASM_EXTERNAL_GLOBAL 3
+
+// Returns false past the end of the module
+static bool readLeb (const uint8_t* bytes, int length, int* offset, uint32_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*offset >= length) {
+            return false;
+        }
+        uint8_t byte = bytes[(*offset)++];
+        *value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int writeLeb (uint8_t* dest, uint32_t value) {
+    int length = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        dest[length++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return length;
+}
+
+static bool skipLimits (const uint8_t* bytes, int length, int* offset) {
+    uint32_t flags, value;
+    return readLeb(bytes, length, offset, &flags) && readLeb(bytes, length, offset, &value)
+        && (!(flags & 1) || readLeb(bytes, length, offset, &value));
+}
+
+// Counts the imported globals, which come first in the global index space
+static bool countGlobalImports (const uint8_t* bytes, int end, int offset, uint32_t* globals) {
+    uint32_t count, value;
+    if (!readLeb(bytes, end, &offset, &count)) {
+        return false;
+    }
+    for (uint32_t ii = 0; ii < count; ++ii) {
+        // Module and field names
+        for (int name = 0; name < 2; ++name) {
+            if (!readLeb(bytes, end, &offset, &value) || value > (uint32_t)(end - offset)) {
+                return false;
+            }
+            offset += value;
+        }
+        if (offset >= end) {
+            return false;
+        }
+        switch (bytes[offset++]) {
+        case 0: // Function
+            if (!readLeb(bytes, end, &offset, &value)) {
+                return false;
+            }
+            break;
+        case 1: // Table
+            if (++offset > end || !skipLimits(bytes, end, &offset)) {
+                return false;
+            }
+            break;
+        case 2: // Memory
+            if (!skipLimits(bytes, end, &offset)) {
+                return false;
+            }
+            break;
+        case WASM_EXTERNAL_GLOBAL:
+            offset += 2;
+            ++*globals;
+            break;
+        default:
+            return false;
+        }
+    }
+    return offset <= end;
+}
+
+// The wasm C API only reaches exported globals, so every global the cart doesn't export already is
+// exported as __global_<index>, like wasmPatchExportGlobals() in the web runtime does. Returns NULL
+// if the module can't be parsed, and leaves it to fail to compile.
+static uint8_t* exportGlobals (const uint8_t* wasm, int length, int* patchedLength) {
+    if (length < 8 || memcmp(wasm, "\0asm", 4) || w4_read32LE(wasm + 4) != 1) {
+        return NULL;
+    }
+
+    uint32_t globalCount = 0;
+    int exportStart = -1, exportEnd = -1, exportContent = -1;
+    int insertAt = length;
+    for (int offset = 8; offset < length; ) {
+        int sectionStart = offset;
+        uint8_t id = wasm[offset++];
+        uint32_t size, count;
+        if (!readLeb(wasm, length, &offset, &size) || size > (uint32_t)(length - offset)) {
+            return NULL;
+        }
+        int content = offset;
+        offset += size;
+
+        if (id == WASM_SECTION_IMPORT) {
+            if (!countGlobalImports(wasm, offset, content, &globalCount)) {
+                return NULL;
+            }
+        } else if (id == WASM_SECTION_GLOBAL) {
+            if (!readLeb(wasm, offset, &content, &count)) {
+                return NULL;
+            }
+            globalCount += count;
+        } else if (id == WASM_SECTION_EXPORT) {
+            exportStart = sectionStart;
+            exportEnd = offset;
+            exportContent = content;
+        } else if (id > WASM_SECTION_EXPORT && insertAt == length) {
+            // Without an export section, one is added where it belongs
+            insertAt = sectionStart;
+        }
+    }
+
+    bool* exported = xmalloc(globalCount + 1);
+    memset(exported, 0, globalCount + 1);
+    uint32_t exportCount = 0;
+    int entriesStart = 0, entriesEnd = 0;
+    if (exportStart >= 0) {
+        int offset = exportContent;
+        if (!readLeb(wasm, exportEnd, &offset, &exportCount)) {
+            free(exported);
+            return NULL;
+        }
+        entriesStart = offset;
+        for (uint32_t ii = 0; ii < exportCount; ++ii) {
+            uint32_t nameLength, index;
+            if (!readLeb(wasm, exportEnd, &offset, &nameLength)
+                    || nameLength >= (uint32_t)(exportEnd - offset)) {
+                free(exported);
+                return NULL;
+            }
+            offset += nameLength;
+            uint8_t kind = wasm[offset++];
+            if (!readLeb(wasm, exportEnd, &offset, &index)) {
+                free(exported);
+                return NULL;
+            }
+            if (kind == WASM_EXTERNAL_GLOBAL && index < globalCount) {
+                exported[index] = true;
+            }
+        }
+        entriesEnd = offset;
+        insertAt = exportStart;
+    }
+
+    // The new section: id, size, count, the existing entries, then one per missing global of at
+    // most 1 + 19 (name) + 1 + 5 bytes
+    uint32_t missing = 0;
+    for (uint32_t ii = 0; ii < globalCount; ++ii) {
+        missing += !exported[ii];
+    }
+    int entriesLength = entriesEnd - entriesStart;
+    uint8_t* section = xmalloc(entriesLength + missing * 26 + 1);
+    int sectionLength = 0;
+    uint8_t countBytes[5];
+    int countLength = writeLeb(countBytes, exportCount + missing);
+    memcpy(section, wasm + entriesStart, entriesLength);
+    sectionLength = entriesLength;
+    for (uint32_t ii = 0; ii < globalCount; ++ii) {
+        if (!exported[ii]) {
+            char name[24];
+            int nameLength = sprintf(name, "__global_%u", ii);
+            sectionLength += writeLeb(section + sectionLength, nameLength);
+            memcpy(section + sectionLength, name, nameLength);
+            sectionLength += nameLength;
+            section[sectionLength++] = WASM_EXTERNAL_GLOBAL;
+            sectionLength += writeLeb(section + sectionLength, ii);
+        }
+    }
+    free(exported);
+
+    uint8_t sizeBytes[5];
+    int sizeLength = writeLeb(sizeBytes, countLength + sectionLength);
+    int resumeAt = (exportStart >= 0) ? exportEnd : insertAt;
+
+    *patchedLength = insertAt + 1 + sizeLength + countLength + sectionLength + (length - resumeAt);
+    uint8_t* patched = xmalloc(*patchedLength);
+    uint8_t* out = patched;
+    memcpy(out, wasm, insertAt);
+    out += insertAt;
+    *out++ = WASM_SECTION_EXPORT;
+    memcpy(out, sizeBytes, sizeLength);
+    out += sizeLength;
+    memcpy(out, countBytes, countLength);
+    out += countLength;
+    memcpy(out, section, sectionLength);
+    out += sectionLength;
+    memcpy(out, wasm + resumeAt, length - resumeAt);
+    free(section);
+    return patched;
+}
+
+static wasm_module_t* compileModule (const uint8_t* wasmBuffer, int byteLength) {
+    char* cacheDir = getCacheDir();
+    char* path = NULL;
+    uint64_t cartHash = hash64(wasmBuffer, byteLength);
+    const char* engineVersion = wasmer_version();
+
+    if (cacheDir != NULL) {
+        path = xmalloc(strlen(cacheDir) + 32);
+        sprintf(path, "%s/%016llx.wasmer", cacheDir, (unsigned long long)cartHash);
+
+        wasm_module_t* module = loadCachedModule(path, wasmBuffer, byteLength, cartHash, engineVersion);
+        if (module != NULL) {
+            free(path);
+            free(cacheDir);
+            return module;
+        }
+    }
+
+    int patchedLength;
+    uint8_t* patched = exportGlobals(wasmBuffer, byteLength, &patchedLength);
+
     wasm_byte_vec_t bytes;
-    wasm_byte_vec_new(&bytes, byteLength, (const char*)wasmBuffer);
-    module = wasm_module_new(store, &bytes);
+    if (patched != NULL) {
+        wasm_byte_vec_new(&bytes, patchedLength, (const char*)patched);
+        free(patched);
+    } else {
+        wasm_byte_vec_new(&bytes, byteLength, (const char*)wasmBuffer);
+    }
+    wasm_module_t* module = wasm_module_new(current->store, &bytes);
     wasm_byte_vec_delete(&bytes);
 
+    if (module != NULL && path != NULL
+            && saveCachedModule(path, module, wasmBuffer, byteLength, cartHash, engineVersion)) {
+        pruneCache(cacheDir, path);
+    }
+    free(path);
+    free(cacheDir);
+    return module;
+}
+
+void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
+    wasm_store_t* store = current->store;
+    wasm_module_t* module;
+    wasm_instance_t* instance;
+
+    module = compileModule(wasmBuffer, byteLength);
+    current->module = module;
+
     if (!module) {
         fprintf(stderr, "Error compiling module");
         exit(1);
@@ -322,7 +880,7 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
 
             } else if (externkind == WASM_EXTERN_MEMORY) {
                 if (strcmp(name->data, "memory") == 0) {
-                    externs[ii] = wasm_memory_as_extern(memory);
+                    externs[ii] = wasm_memory_as_extern(current->memory);
                 }
             }
         }
@@ -331,6 +889,7 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
     wasm_extern_vec_t extern_vec;
     wasm_extern_vec_new(&extern_vec, imports.size, externs);
     instance = wasm_instance_new(store, module, &extern_vec, NULL);
+    current->instance = instance;
 
     if (!instance) {
         fprintf(stderr, "Error instantiating module");
@@ -345,6 +904,9 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
     wasm_func_t* _start = NULL;
     wasm_func_t* _initialize = NULL;
 
+    current->globals = xmalloc(exports.size * sizeof(wasm_global_t*) + 1);
+    current->globalCount = 0;
+
     for (int ii = 0; ii < exports.size; ++ii) {
         const wasm_exporttype_t* exporttype = exports.data[ii];
         const wasm_name_t* name = wasm_exporttype_name(exporttype);
@@ -357,13 +919,18 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
         if (externkind == WASM_EXTERN_FUNC) {
             wasm_func_t* func = wasm_extern_as_func(extern_vec.data[ii]);
             if (strcmp(name->data, "start") == 0) {
-                start = func;
+                current->start = func;
             } else if (strcmp(name->data, "_start") == 0) {
                 _start = func;
             } else if (strcmp(name->data, "_initialize") == 0) {
                 _initialize = func;
             } else if (strcmp(name->data, "update") == 0) {
-                update = func;
+                current->update = func;
+            }
+        } else if (externkind == WASM_EXTERN_GLOBAL) {
+            const wasm_globaltype_t* globaltype = wasm_externtype_as_globaltype_const(externtype);
+            if (wasm_globaltype_mutability(globaltype) == WASM_VAR) {
+                current->globals[current->globalCount++] = wasm_extern_as_global(extern_vec.data[ii]);
             }
         }
     }
@@ -384,17 +951,58 @@ void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength) {
 }
 
 void w4_wasmCallStart () {
-    if (start) {
+    if (current->start) {
         wasm_val_vec_t args = WASM_EMPTY_VEC;
         wasm_val_vec_t results = WASM_EMPTY_VEC;
-        check(wasm_func_call(start, &args, &results));
+        check(wasm_func_call(current->start, &args, &results));
     }
 }
 
-void w4_wasmCallUpdate () {
-    if (update) {
+bool w4_wasmCallUpdate () {
+    if (current->update) {
+        wasm_val_t result = WASM_I32_VAL(1);
         wasm_val_vec_t args = WASM_EMPTY_VEC;
-        wasm_val_vec_t results = WASM_EMPTY_VEC;
-        check(wasm_func_call(update, &args, &results));
+        wasm_val_vec_t results = { wasm_func_result_arity(current->update) ? 1 : 0, &result };
+        check(wasm_func_call(current->update, &args, &results));
+        return result.of.i32 != 0;
+    }
+
+    return true;
+}
+
+// Globals are saved as 8 bytes each, in the order the module exports them
+int w4_wasmGlobalsSize () {
+    return current->globalCount * sizeof(uint64_t);
+}
+
+void w4_wasmSaveGlobals (void* dest) {
+    uint8_t* out = dest;
+    for (int ii = 0; ii < current->globalCount; ++ii, out += sizeof(uint64_t)) {
+        wasm_val_t value;
+        wasm_global_get(current->globals[ii], &value);
+        memset(out, 0, sizeof(uint64_t));
+        switch (value.kind) {
+        case WASM_I32: memcpy(out, &value.of.i32, sizeof(value.of.i32)); break;
+        case WASM_I64: memcpy(out, &value.of.i64, sizeof(value.of.i64)); break;
+        case WASM_F32: memcpy(out, &value.of.f32, sizeof(value.of.f32)); break;
+        case WASM_F64: memcpy(out, &value.of.f64, sizeof(value.of.f64)); break;
+        default: break;
+        }
+    }
+}
+
+void w4_wasmLoadGlobals (const void* src) {
+    const uint8_t* in = src;
+    for (int ii = 0; ii < current->globalCount; ++ii, in += sizeof(uint64_t)) {
+        wasm_val_t value;
+        wasm_global_get(current->globals[ii], &value);
+        switch (value.kind) {
+        case WASM_I32: memcpy(&value.of.i32, in, sizeof(value.of.i32)); break;
+        case WASM_I64: memcpy(&value.of.i64, in, sizeof(value.of.i64)); break;
+        case WASM_F32: memcpy(&value.of.f32, in, sizeof(value.of.f32)); break;
+        case WASM_F64: memcpy(&value.of.f64, in, sizeof(value.of.f64)); break;
+        default: continue;
+        }
+        wasm_global_set(current->globals[ii], &value);
     }
 }
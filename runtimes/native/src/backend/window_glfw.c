@@ -6,9 +6,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "../audiostats.h"
+#include "../timeline.h"
 #include "../window.h"
 #include "../runtime.h"
 
+#define UPDATE_RATE 60
+
 static uint32_t table[256];
 static GLuint paletteLocation;
 
@@ -160,6 +164,9 @@ static void onGlfwError(int error, const char* description)
 }
 
 static void update (GLFWwindow* window) {
+    w4_windowGameFrame();
+    w4_timelineBegin(W4_TIMELINE_INPUT);
+
     // Keyboard handling
     uint8_t gamepad = 0;
     if (glfwGetKey(window, GLFW_KEY_X)) {
@@ -186,6 +193,14 @@ static void update (GLFWwindow* window) {
         should_close = true;
     }
 
+    // F9 - Audio telemetry
+    static bool audioStatsKey = false;
+    bool audioStatsPressed = glfwGetKey(window, GLFW_KEY_F9);
+    if (audioStatsPressed && !audioStatsKey) {
+        w4_audioStatsPrint();
+    }
+    audioStatsKey = audioStatsPressed;
+
     // Mouse handling
     double mouseX, mouseY;
     uint8_t mouseButtons = 0;
@@ -201,7 +216,12 @@ static void update (GLFWwindow* window) {
     }
     w4_runtimeSetMouse(160*(mouseX-contentX)/contentSizeX, 160*(mouseY-contentY)/contentSizeY, mouseButtons);
 
-    w4_runtimeUpdate();
+    bool runUpdate = w4_windowGameInput();
+    w4_timelineEnd(W4_TIMELINE_INPUT);
+    if (runUpdate) {
+        w4_runtimeUpdate();
+        w4_windowGameTick();
+    }
 }
 
 void w4_windowBoot (const char* title) {
@@ -227,7 +247,7 @@ void w4_windowBoot (const char* title) {
 
     while (!glfwWindowShouldClose(window) && !should_close) {
         double timeStart = glfwGetTime();
-        double timeEnd = timeStart + 1.0/60.0;
+        double timeEnd = timeStart + 1.0/UPDATE_RATE;
         if (update_viewport) {
             glViewport(viewportX, viewportY, viewportSize, viewportSize);
             /*
@@ -242,19 +262,27 @@ void w4_windowBoot (const char* title) {
         }
 
         update(window);
+        w4_timelineBegin(W4_TIMELINE_PRESENT);
         glfwSwapBuffers(window);
+        w4_timelineEnd(W4_TIMELINE_PRESENT);
         glfwPollEvents();
 
+        w4_timelineBegin(W4_TIMELINE_SLEEP);
         double timeRemaining;
         while ((timeRemaining = timeEnd - glfwGetTime()) > 0) {
             glfwWaitEventsTimeout(timeRemaining);
         }
+        w4_timelineEnd(W4_TIMELINE_SLEEP);
     }
 
     glfwDestroyWindow(window);
     glfwTerminate();
 }
 
+int w4_windowUpdateRate () {
+    return UPDATE_RATE;
+}
+
 void w4_windowComposite (const uint32_t* palette, const uint8_t* framebuffer) {
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -0,0 +1,9 @@
+#include "../window.h"
+
+// For frontends that read the framebuffer themselves and drive updates on their own
+
+void w4_windowBoot (const char* title) {
+}
+
+void w4_windowComposite (const uint32_t* palette, const uint8_t* framebuffer) {
+}
@@ -1,12 +1,15 @@
 #include <MiniFB.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
 
+#include "../audiostats.h"
+#include "../timeline.h"
 #include "../window.h"
 #include "../runtime.h"
 
-
+#define UPDATE_RATE 10
 
 static uint32_t pixels[160*160];
 
@@ -27,18 +30,20 @@ void w4_windowBoot (const char* title) {
 
     mfb_set_resize_callback(window, onResize);
     
-    // Target 15 FPS (66.67ms per frame)
-    const double targetFrameTime = 1.0 / 10.0;
+    const double targetFrameTime = 1.0 / UPDATE_RATE;
     struct timespec lastTime, currentTime;
     clock_gettime(CLOCK_MONOTONIC, &lastTime);
     struct timespec statTime = lastTime;
     long statFps = 0;
 
     do {
+        w4_windowGameFrame();
+        w4_timelineBegin(W4_TIMELINE_INPUT);
+
         // Keyboard handling
         const uint8_t* keyBuffer = mfb_get_key_buffer(window);
         
-        // Handle hotkeys (F4-F8)
+        // Handle hotkeys (F4-F9)
         static uint8_t prevKeyState[KB_KEY_LAST] = {0};
         
 
@@ -89,6 +94,11 @@ void w4_windowBoot (const char* title) {
             }
         }
         
+        // F9 - Audio telemetry
+        if (keyBuffer[KB_KEY_F9] && !prevKeyState[KB_KEY_F9]) {
+            w4_audioStatsPrint();
+        }
+
         // F8 - Show Help
         if (keyBuffer[KB_KEY_F8] && !prevKeyState[KB_KEY_F8]) {
             printf("\n🎮 WASM-4 MiniFB Runtime Hotkeys:\n");
@@ -97,7 +107,8 @@ void w4_windowBoot (const char* title) {
             printf("Shift+F5 - Export Gamepad Events to file (JSON)\n");
             printf("F6 - Show Recording Status\n");
             printf("F7 - Load & Replay Events from file (restarts runtime)\n");
-            printf("F8 - Show This Help\n\n");
+            printf("F8 - Show This Help\n");
+            printf("F9 - Show Audio Telemetry\n\n");
         }
         
         // Update previous key state
@@ -149,7 +160,7 @@ void w4_windowBoot (const char* title) {
 
         // Collect gamepad states for recording
         uint8_t currentGamepadState[4];
-        memcpy(currentGamepadState, memory->gamepads, 4);
+        memcpy(currentGamepadState, w4_memory->gamepads, 4);
         
         // Use playback events if playing, otherwise use real input
 
@@ -182,15 +193,24 @@ void w4_windowBoot (const char* title) {
         int mouseY = mfb_get_mouse_y(window);
         w4_runtimeSetMouse(160*(mouseX-viewportX)/viewportSize, 160*(mouseY-viewportY)/viewportSize, mouseButtons);
 
-        if (!w4_runtimeUpdate()) {
-            break;
+        bool runUpdate = w4_windowGameInput();
+        w4_timelineEnd(W4_TIMELINE_INPUT);
+        if (runUpdate) {
+            bool running = w4_runtimeUpdate();
+            w4_windowGameTick();
+            if (!running) {
+                break;
+            }
         }
 
-        if (mfb_update_ex(window, pixels, 160, 160) < 0) {
+        w4_timelineBegin(W4_TIMELINE_PRESENT);
+        mfb_update_state state = mfb_update_ex(window, pixels, 160, 160);
+        w4_timelineEnd(W4_TIMELINE_PRESENT);
+        if (state < 0) {
             break;
         }
         
-        // Frame rate limiting to 15 FPS
+        // Frame rate limiting to UPDATE_RATE
         clock_gettime(CLOCK_MONOTONIC, &currentTime);
         double elapsed = (currentTime.tv_sec - lastTime.tv_sec) + 
                         (currentTime.tv_nsec - lastTime.tv_nsec) / 1000000000.0;
@@ -201,7 +221,9 @@ void w4_windowBoot (const char* title) {
                 .tv_sec = (time_t)sleepTime,
                 .tv_nsec = (long)((sleepTime - (time_t)sleepTime) * 1000000000)
             };
+            w4_timelineBegin(W4_TIMELINE_SLEEP);
             nanosleep(&sleepSpec, NULL);
+            w4_timelineEnd(W4_TIMELINE_SLEEP);
         }
 
         clock_gettime(CLOCK_MONOTONIC, &currentTime);
@@ -235,6 +257,10 @@ void w4_windowBoot (const char* title) {
     }
 }
 
+int w4_windowUpdateRate () {
+    return UPDATE_RATE;
+}
+
 void w4_windowComposite (const uint32_t* palette, const uint8_t* framebuffer) {
     // Convert indexed 2bpp framebuffer to XRGB output
     uint32_t* out = pixels;
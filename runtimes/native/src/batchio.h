@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// File I/O for batch tools that go through thousands of small files, where opening, reading and
+// closing each one in turn would keep the workers waiting on the disk.
+
+typedef struct w4_FileReader w4_FileReader;
+
+// Reads the files ahead of time in the background, on an io_uring where the kernel allows it and
+// otherwise on a few threads with pread(). At most maxInFlight files are being read or waiting to
+// be taken at once.
+w4_FileReader* w4_fileReaderNew (const char* const* paths, int count, int maxInFlight);
+
+// Stops reading ahead, and frees the files that weren't taken
+void w4_fileReaderDelete (w4_FileReader* reader);
+
+// Blocks until another file was read, in whatever order they complete, and returns its index in
+// paths. The contents are set to a buffer the caller frees, or NULL if the file couldn't be read.
+// Returns -1 once every file was handed out. Safe to call from several threads.
+int w4_fileReaderNext (w4_FileReader* reader, uint8_t** bytes, size_t* length);
+
+// "io_uring" or "pread"
+const char* w4_fileReaderMethod (const w4_FileReader* reader);
+
+typedef struct w4_AppendFile w4_AppendFile;
+
+// Creates or truncates a file that is only ever appended to, through a shared memory mapping
+// instead of stdio. Returns NULL on failure.
+w4_AppendFile* w4_appendFileOpen (const char* path);
+
+// Appends the bytes in one piece, and returns the offset they were written at, or -1 on failure.
+// Safe to call from several threads, concurrent appends land in disjoint ranges.
+int64_t w4_appendFileWrite (w4_AppendFile* file, const void* data, size_t length);
+
+// Trims the file to what was appended and closes it. Returns 0 on success.
+int w4_appendFileClose (w4_AppendFile* file);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Spectating a game over the network by streaming its input instead of its video. The host sends
+// every frame's input as a UDP datagram, along with a compressed save state every few seconds.
+// Spectators run the same cart themselves: they wait for a save state, load it, and from then on
+// replay the host's input frame by frame, fast-forwarding whenever they fall behind.
+//
+// The address is "host:port". A multicast group (e.g. 239.0.0.1) reaches any number of
+// spectators on the LAN or the same machine, a unicast or broadcast address works as well.
+
+typedef struct w4_Broadcast w4_Broadcast;
+
+// Number of frames between two save states, how long a late joiner may have to wait
+#define W4_BROADCAST_KEYFRAME_INTERVAL 120
+
+// Returns NULL if the address can't be resolved or the socket can't be opened
+w4_Broadcast* w4_broadcastHostNew (const char* address, int keyframeInterval);
+w4_Broadcast* w4_broadcastSpectatorNew (const char* address);
+void w4_broadcastDelete (w4_Broadcast* broadcast);
+
+// Called before every update, once the local input is set. The host sends the input, and returns
+// true. A spectator takes in what arrived, loads a save state if it has none yet, runs the updates
+// it's behind by, and sets the input of the next one. Returns false if it has nothing to run yet,
+// or if one of the updates it ran ended the game.
+bool w4_broadcastUpdate (w4_Broadcast* broadcast);
+
+bool w4_broadcastIsSpectator (const w4_Broadcast* broadcast);
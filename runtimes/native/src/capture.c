@@ -0,0 +1,128 @@
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "runtime.h"
+#include "util.h"
+
+// Only the instance that started the capture is recorded
+static W4_THREAD_LOCAL FILE* file = NULL;
+
+static void writeU8 (uint8_t value) {
+    putc(value, file);
+}
+
+static void writeU32 (uint32_t value) {
+    uint8_t bytes[4];
+    w4_write32LE(bytes, value);
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+static void writeHeader (w4_CaptureOp op) {
+    uint8_t bytes[3];
+    bytes[0] = op;
+    memcpy(bytes + 1, w4_memory->drawColors, 2);
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+uint32_t w4_captureHash (const uint8_t* framebuffer, int length) {
+    uint32_t hash = 2166136261u;
+    for (int n = 0; n < length; ++n) {
+        hash = (hash ^ framebuffer[n]) * 16777619u;
+    }
+    return hash;
+}
+
+bool w4_captureStart (const char* path) {
+    w4_captureStop();
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 16);
+
+    fwrite(W4_CAPTURE_MAGIC, 1, 4, file);
+    writeU32(W4_CAPTURE_VERSION);
+    return true;
+}
+
+void w4_captureStop () {
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+void w4_captureFrame (bool cleared) {
+    if (file == NULL) {
+        return;
+    }
+    writeU8(W4_CAPTURE_FRAME);
+    writeU8(cleared);
+}
+
+void w4_captureFrameEnd () {
+    if (file == NULL) {
+        return;
+    }
+    writeU8(W4_CAPTURE_FRAME_END);
+    writeU32(w4_captureHash(w4_memory->framebuffer, sizeof(w4_memory->framebuffer)));
+}
+
+void w4_captureDraw (w4_CaptureOp op, int a, int b, int c, int d) {
+    if (file == NULL) {
+        return;
+    }
+    writeHeader(op);
+    writeU32(a);
+    writeU32(b);
+    writeU32(c);
+    if (op != W4_CAPTURE_HLINE && op != W4_CAPTURE_VLINE) {
+        writeU32(d);
+    }
+}
+
+void w4_captureBlit (const uint8_t* sprite, int x, int y, int width, int height,
+    int srcX, int srcY, int stride, int flags) {
+    if (file == NULL) {
+        return;
+    }
+    writeHeader(W4_CAPTURE_BLIT);
+    writeU32(x);
+    writeU32(y);
+    writeU32(width);
+    writeU32(height);
+    writeU32(srcX);
+    writeU32(srcY);
+    writeU32(stride);
+    writeU32(flags);
+
+    // Everything up to the last pixel the blit can sample, which may be past width*height
+    int64_t length = 0;
+    if (width > 0 && height > 0) {
+        int64_t lastBit = ((int64_t)srcY + height - 1) * stride + srcX + width - 1;
+        length = (flags & 1) ? (lastBit >> 2) + 1 : (lastBit >> 3) + 1;
+    }
+    int64_t available = ((const uint8_t*)w4_memory + (1 << 16)) - sprite;
+    if (length > available) {
+        length = available;
+    }
+    if (length < 0) {
+        length = 0;
+    }
+    writeU32(length);
+    fwrite(sprite, 1, length, file);
+}
+
+void w4_captureText (w4_CaptureOp op, const void* str, int byteLength, int x, int y) {
+    if (file == NULL) {
+        return;
+    }
+    writeHeader(op);
+    writeU32(x);
+    writeU32(y);
+    writeU32(byteLength);
+    fwrite(str, 1, byteLength, file);
+}
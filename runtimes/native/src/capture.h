@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Capture of the framebuffer host calls a cart makes, to replay them into the rasterizer without
+// any wasm (see backend/raster_bench.c).
+//
+// File format, all values little-endian:
+//
+//   "W4DC", u32 version
+//   records, each starting with a u8 opcode:
+//
+//   FRAME      u8 cleared (whether the framebuffer was cleared before this update)
+//   FRAME_END  u32 FNV-1a hash of the framebuffer after the update
+//   HLINE      u16 drawColors, i32 x, y, length
+//   VLINE      u16 drawColors, i32 x, y, length
+//   RECT       u16 drawColors, i32 x, y, width, height
+//   OVAL       u16 drawColors, i32 x, y, width, height
+//   LINE       u16 drawColors, i32 x1, y1, x2, y2
+//   BLIT       u16 drawColors, i32 x, y, width, height, srcX, srcY, stride, flags,
+//              u32 length, the sprite bytes the call can read
+//   TEXT       u16 drawColors, i32 x, y, u32 length, the string including its null terminator
+//   TEXT_UTF8  u16 drawColors, i32 x, y, u32 length, the string bytes
+//   TEXT_UTF16 u16 drawColors, i32 x, y, u32 length, the string bytes
+
+#define W4_CAPTURE_MAGIC "W4DC"
+#define W4_CAPTURE_VERSION 1
+
+typedef enum {
+    W4_CAPTURE_FRAME = 0,
+    W4_CAPTURE_FRAME_END = 1,
+    W4_CAPTURE_HLINE = 2,
+    W4_CAPTURE_VLINE = 3,
+    W4_CAPTURE_RECT = 4,
+    W4_CAPTURE_OVAL = 5,
+    W4_CAPTURE_LINE = 6,
+    W4_CAPTURE_BLIT = 7,
+    W4_CAPTURE_TEXT = 8,
+    W4_CAPTURE_TEXT_UTF8 = 9,
+    W4_CAPTURE_TEXT_UTF16 = 10,
+} w4_CaptureOp;
+
+// Hash of the framebuffer stored in FRAME_END records
+uint32_t w4_captureHash (const uint8_t* framebuffer, int length);
+
+// Captures the host calls of the instance bound to the calling thread into a new file
+bool w4_captureStart (const char* path);
+void w4_captureStop ();
+
+// Called by the runtime, these do nothing unless a capture is running on the calling thread
+void w4_captureFrame (bool cleared);
+void w4_captureFrameEnd ();
+void w4_captureDraw (w4_CaptureOp op, int a, int b, int c, int d);
+void w4_captureBlit (const uint8_t* sprite, int x, int y, int width, int height,
+    int srcX, int srcY, int stride, int flags);
+void w4_captureText (w4_CaptureOp op, const void* str, int byteLength, int x, int y);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Notices when a cart file is rewritten, for reloading it in place. Uses inotify on Linux, where
+// the directory is watched so that carts replaced by a rename are caught too, and otherwise checks
+// the file's modification time.
+
+typedef struct w4_CartWatch w4_CartWatch;
+
+// Returns NULL if the file can't be watched
+w4_CartWatch* w4_cartWatchNew (const char* path);
+void w4_cartWatchDelete (w4_CartWatch* watch);
+
+// Polled once per frame, without blocking. Returns true once after the file changed, when it has
+// been left alone long enough for a build to have finished writing it.
+bool w4_cartWatchChanged (w4_CartWatch* watch);
@@ -0,0 +1,250 @@
+#include "w4core.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "apu.h"
+#include "audioring.h"
+#include "pool.h"
+#include "runtime.h"
+#include "trace.h"
+#include "util.h"
+#include "wasm.h"
+
+#if !defined(_MSC_VER)
+#define LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#else
+#define LOAD_ACQUIRE(ptr) (*(ptr))
+#define STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#endif
+
+// One update's worth of audio at 60 updates per second
+#define TICK_FRAMES (W4_CORE_SAMPLE_RATE / 60)
+
+// Ring fill kept on top of one update, enough to ride out a late update or two
+#define AUDIO_RING_TARGET (3 * TICK_FRAMES)
+#define AUDIO_RING_CAPACITY 8192
+
+struct w4_Core {
+    w4_RuntimeContext context;
+    w4_Disk disk;
+
+    // Created by the first w4_coreWriteSamples(). From then on every update synthesizes its audio
+    // into it, so the APU is only ever touched by the thread running the updates.
+    w4_AudioRing* audioRing;
+    int16_t* tickSamples;
+};
+
+// The runtime state is bound per thread, so every call binds the instance first and saves it
+// afterwards in case another thread uses it next
+static void bind (w4_Core* core) {
+    w4_runtimeLoadContext(&core->context);
+}
+
+static void unbind (w4_Core* core) {
+    w4_runtimeSaveContext(&core->context);
+}
+
+uint32_t w4_coreVersion (void) {
+    return W4_CORE_VERSION;
+}
+
+w4_Core* w4_coreNew (const uint8_t* cart, size_t cartLength, const uint8_t* diskData, size_t diskLength) {
+    w4_Core* core = xmalloc(sizeof(w4_Core));
+    memset(core, 0, sizeof(w4_Core));
+
+    if (diskData != NULL) {
+        if (diskLength > sizeof(core->disk.data)) {
+            diskLength = sizeof(core->disk.data);
+        }
+        memcpy(core->disk.data, diskData, diskLength);
+        core->disk.size = diskLength;
+    }
+
+    void* apuState = w4_poolAlloc(w4_apuStateSize());
+    memset(apuState, 0, w4_apuStateSize());
+    w4_apuBindState(apuState);
+    w4_traceBind(w4_traceNew(0, W4_TRACE_BUFFERED));
+
+    uint8_t* memoryBytes = w4_wasmInit();
+    w4_runtimeInit(memoryBytes, &core->disk);
+    w4_wasmLoadModule(cart, cartLength);
+    unbind(core);
+
+    w4_apuBindState(NULL);
+    w4_traceBind(NULL);
+    return core;
+}
+
+void w4_coreShareCode (int enabled) {
+    w4_wasmSetShareCode(enabled != 0);
+}
+
+int w4_corePoolReserve (uint32_t instances, int pages) {
+    return w4_poolReserve((size_t)instances * W4_POOL_INSTANCE_BYTES, pages);
+}
+
+void w4_coreDelete (w4_Core* core) {
+    bind(core);
+    w4_wasmDestroy();
+    w4_runtimeUnloadContext();
+    w4_traceDelete(core->context.trace);
+    w4_poolFree(core->context.apu, w4_apuStateSize());
+    if (core->audioRing != NULL) {
+        w4_audioRingDelete(core->audioRing);
+    }
+    free(core->tickSamples);
+    free(core);
+}
+
+int w4_coreUpdate (w4_Core* core) {
+    bind(core);
+    bool running = w4_runtimeUpdate();
+
+    w4_AudioRing* audioRing = LOAD_ACQUIRE(&core->audioRing);
+    if (audioRing != NULL) {
+        if (core->tickSamples == NULL) {
+            core->tickSamples = xmalloc(2 * TICK_FRAMES * sizeof(int16_t));
+        }
+        w4_apuWriteSamples(core->tickSamples, TICK_FRAMES);
+        w4_audioRingPush(audioRing, core->tickSamples, TICK_FRAMES);
+    }
+    unbind(core);
+    return running;
+}
+
+void w4_coreSetTrace (w4_Core* core, int mode, uint32_t instanceId) {
+    w4_Trace* trace = core->context.trace;
+    w4_traceDelete(trace);
+    core->context.trace = w4_traceNew(instanceId, mode);
+}
+
+void w4_coreSetGamepad (w4_Core* core, int idx, uint8_t buttons) {
+    if (idx >= 0 && idx < 4) {
+        core->context.memory->gamepads[idx] = buttons;
+    }
+}
+
+void w4_coreSetMouse (w4_Core* core, int16_t x, int16_t y, uint8_t buttons) {
+    Memory* memory = core->context.memory;
+    w4_write16LE(&memory->mouseX, x);
+    w4_write16LE(&memory->mouseY, y);
+    memory->mouseButtons = buttons;
+}
+
+void w4_coreGetPersistentData (w4_Core* core, w4_CorePersistentData* data) {
+    const w4_PersistentData* persistent = &core->context.memory->persistent;
+    data->game_mode = w4_read32LE(&persistent->game_mode);
+    data->max_frames = w4_read32LE(&persistent->max_frames);
+    data->game_seed = w4_read32LE(&persistent->game_seed);
+    data->frames = w4_read32LE(&persistent->frames);
+    data->score = w4_read32LE(&persistent->score);
+    data->health = w4_read32LE(&persistent->health);
+}
+
+void w4_coreSetPersistentData (w4_Core* core, const w4_CorePersistentData* data) {
+    w4_PersistentData* persistent = &core->context.memory->persistent;
+    w4_write32LE(&persistent->game_mode, data->game_mode);
+    w4_write32LE(&persistent->max_frames, data->max_frames);
+    w4_write32LE(&persistent->game_seed, data->game_seed);
+    w4_write32LE(&persistent->frames, data->frames);
+    w4_write32LE(&persistent->score, data->score);
+    w4_write32LE(&persistent->health, data->health);
+}
+
+const uint8_t* w4_coreFramebuffer (w4_Core* core) {
+    return core->context.memory->framebuffer;
+}
+
+void w4_coreGetPalette (w4_Core* core, uint32_t palette[4]) {
+    for (int ii = 0; ii < 4; ++ii) {
+        palette[ii] = w4_read32LE(&core->context.memory->palette[ii]);
+    }
+}
+
+void w4_coreRenderRGB (w4_Core* core, uint32_t* pixels) {
+    uint32_t palette[4];
+    w4_coreGetPalette(core, palette);
+
+    const uint8_t* framebuffer = core->context.memory->framebuffer;
+    for (int n = 0; n < W4_CORE_FRAMEBUFFER_SIZE; ++n) {
+        uint8_t quartet = framebuffer[n];
+        *pixels++ = palette[quartet & 0x3] & 0xffffff;
+        *pixels++ = palette[(quartet >> 2) & 0x3] & 0xffffff;
+        *pixels++ = palette[(quartet >> 4) & 0x3] & 0xffffff;
+        *pixels++ = palette[quartet >> 6] & 0xffffff;
+    }
+}
+
+void w4_coreWriteSamples (w4_Core* core, int16_t* output, unsigned long frames) {
+    // Only this thread ever creates the ring, the updating thread picks it up from the next update
+    w4_AudioRing* audioRing = core->audioRing;
+    if (audioRing == NULL) {
+        audioRing = w4_audioRingNew(AUDIO_RING_CAPACITY, AUDIO_RING_TARGET);
+        STORE_RELEASE(&core->audioRing, audioRing);
+    }
+    w4_audioRingPull(audioRing, output, frames);
+}
+
+const uint8_t* w4_coreDisk (w4_Core* core, size_t* length) {
+    *length = core->disk.size;
+    return core->disk.data;
+}
+
+size_t w4_coreSerializeSize (w4_Core* core) {
+    bind(core);
+    return w4_runtimeSerializeSize();
+}
+
+void w4_coreSerialize (w4_Core* core, void* dest) {
+    bind(core);
+    w4_runtimeSerialize(dest);
+}
+
+void w4_coreUnserialize (w4_Core* core, const void* src) {
+    bind(core);
+    w4_runtimeUnserialize(src);
+    unbind(core);
+}
+
+int w4_coreReplay (w4_Core* core, const uint8_t* events, size_t eventsLength, uint32_t maxFrames) {
+    w4_GamepadRecorder* recorder = w4_poolAlloc(sizeof(w4_GamepadRecorder));
+    w4_gamepadRecorderInit(recorder);
+    if (eventsLength > INT32_MAX || w4_gamepadRecorderDeserialize(recorder, events, eventsLength) != 0) {
+        w4_poolFree(recorder, sizeof(w4_GamepadRecorder));
+        return -1;
+    }
+
+    bind(core);
+
+    // Events are recorded in frame order, and apply from the frame they were recorded on
+    uint8_t gamepads[4] = { 0 };
+    uint32_t cursor = 0;
+    uint32_t frame = 0;
+    while (frame < maxFrames) {
+        for (; cursor < recorder->eventCount && recorder->events[cursor].frame <= frame; ++cursor) {
+            const w4_GamepadEvent* event = &recorder->events[cursor];
+            if (event->playerIdx >= 4) {
+                continue;
+            }
+            if (event->eventType == W4_GAMEPAD_EVENT_PRESS) {
+                gamepads[event->playerIdx] |= event->button;
+            } else if (event->eventType == W4_GAMEPAD_EVENT_RELEASE) {
+                gamepads[event->playerIdx] &= ~event->button;
+            }
+        }
+        for (int playerIdx = 0; playerIdx < 4; ++playerIdx) {
+            w4_runtimeSetGamepad(playerIdx, gamepads[playerIdx]);
+        }
+
+        ++frame;
+        if (!w4_runtimeUpdate()) {
+            break;
+        }
+    }
+
+    unbind(core);
+    w4_poolFree(recorder, sizeof(w4_GamepadRecorder));
+    return frame;
+}
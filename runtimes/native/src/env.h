@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+// Batched stepping of many console instances of one cart, for bots and analysis. Each instance
+// runs without a window or audio output, and the instances of a batch are spread across threads.
+
+// Size of one instance's packed 2bpp framebuffer in the observation buffer
+#define W4_ENV_OBSERVATION_SIZE (160*160>>2)
+
+typedef struct {
+    /** Number of console instances. */
+    int count;
+
+    /** Number of threads to step on, including the calling thread. 1 or less steps serially. */
+    int threads;
+
+    /** Persistent data every episode starts with. */
+    uint32_t gameMode;
+    uint32_t maxFrames;
+
+    /** Episode k of instance i is seeded with seed + k*count + i. */
+    uint32_t seed;
+
+    /** Cart traces: 0 drops them, 1 writes them to stdout, 2 also prefixes them with
+     * "[instance:frame] ". */
+    int trace;
+
+    /** Non-zero to compile the cart once for all instances, so each one costs little more than
+     * its 64 KB of memory. */
+    int shareCode;
+
+    /** Non-zero to take the instances' memory, stacks and buffers from one region reserved up
+     * front, recycled when the environment is deleted and another one created. */
+    int pool;
+
+    /** With pool, 1 backs the region with transparent huge pages and 2 with explicit ones
+     * (MAP_HUGETLB), falling back to transparent ones when none are free. */
+    int hugePages;
+} w4_EnvConfig;
+
+// The persistent data of every instance, as one array of count values per field
+typedef struct {
+    uint32_t* game_mode;
+    uint32_t* max_frames;
+    uint32_t* game_seed;
+    uint32_t* frames;
+    uint32_t* score;
+    uint32_t* health;
+} w4_EnvPersistentData;
+
+typedef struct w4_Env w4_Env;
+
+w4_Env* w4_envNew (const uint8_t* cart, int cartLength, const w4_EnvConfig* config);
+void w4_envDelete (w4_Env* env);
+
+// Runs one update of every instance, with pads[i] as the first gamepad of instance i. Instances
+// that finished in the previous step are first reset to the start of a new episode, so the final
+// observation and persistent data of an episode stay readable until the next step.
+void w4_envStep (w4_Env* env, const uint8_t* pads);
+
+// count * W4_ENV_OBSERVATION_SIZE bytes, instance i's framebuffer at i * W4_ENV_OBSERVATION_SIZE
+const uint8_t* w4_envObservations (const w4_Env* env);
+
+const w4_EnvPersistentData* w4_envPersistentData (const w4_Env* env);
+
+// 1 for the instances whose cart returned 0 from update in the last step
+const uint8_t* w4_envDone (const w4_Env* env);
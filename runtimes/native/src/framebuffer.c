@@ -232,8 +232,8 @@ static const uint8_t font[1792] = {
     0x93, 0xff, 0x39, 0x39, 0x39, 0x81, 0xf9, 0x83
 };
 
-static const uint8_t* drawColors;
-static uint8_t* framebuffer;
+static W4_THREAD_LOCAL const uint8_t* drawColors;
+static W4_THREAD_LOCAL uint8_t* framebuffer;
 
 static int w4_min (int a, int b) {
     return a < b ? a : b;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Streams the framebuffer to any number of clients over TCP or a Unix socket, for displays that
+// only mirror a game and can't run wasm. Each frame is sent as its XOR against the frame before,
+// which is mostly zero, coded as runs, so a static screen costs a few bytes per frame. Frames are
+// encoded and sent on a thread of their own; if it can't keep up, it skips to the latest frame.
+//
+// A connection starts with the magic "W4FS" and a little-endian u32 version (1), then one message
+// per frame:
+//
+//   u32 frame         Number of the frame, counting from 0 when the stream was opened
+//   u8 flags          1: the palette follows, 2: a delta against a zeroed framebuffer
+//   u32 palette[4]    0xRRGGBB colors, only when flagged
+//   u16 length        Length of the delta that follows
+//   delta             Until the end: a varint number of zero bytes to skip, then a varint n, with
+//                     either n>>1 literal bytes to XOR (n even), or one byte to XOR over the next
+//                     n>>1 bytes (n odd). Whatever is left is unchanged.
+//
+// Integers are little-endian, varints are LEB128. The framebuffer is the 6400 byte, 2 bits per
+// pixel layout the carts draw to. A client's first frame is always flagged 3.
+
+typedef struct w4_FrameStream w4_FrameStream;
+
+// Listens on "[host:]port" for TCP, or "unix:<path>". Returns NULL on failure.
+w4_FrameStream* w4_frameStreamOpen (const char* address);
+
+// Disconnects the clients and removes the Unix socket
+void w4_frameStreamClose (w4_FrameStream* stream);
+
+// Hands over the frame drawn by the last update, without waiting on the encoder
+void w4_frameStreamPush (w4_FrameStream* stream, const uint8_t* framebuffer, const uint32_t* palette);
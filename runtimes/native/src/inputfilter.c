@@ -0,0 +1,272 @@
+#include "inputfilter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Keeps features that barely vary across honest logs from turning tiny differences into huge
+// scores
+#define MIN_STDDEV_ABSOLUTE 0.01
+#define MIN_STDDEV_RELATIVE 0.05
+
+#define WINDOW_SIZE (sizeof(((w4_InputAnalyzer*)0)->window) / sizeof(uint32_t))
+#define HISTOGRAM_SIZE (sizeof(((w4_InputAnalyzer*)0)->intervalHistogram) / sizeof(uint32_t))
+
+const char* const w4_inputFeatureNames[W4_INPUT_FEATURE_COUNT] = {
+    "press_rate",
+    "peak_press_rate",
+    "interval_mean",
+    "interval_cv",
+    "interval_entropy",
+    "repeat_ratio",
+    "hold_mean",
+    "hold_cv",
+    "same_frame_ratio",
+    "opposite_ratio",
+};
+
+static bool holdsOpposite (uint8_t held) {
+    return ((held & W4_BUTTON_LEFT) && (held & W4_BUTTON_RIGHT))
+        || ((held & W4_BUTTON_UP) && (held & W4_BUTTON_DOWN));
+}
+
+// Accounts for the frames the held buttons stayed as they are
+static void holdFrames (w4_InputAnalyzer* analyzer, uint32_t frames) {
+    for (int playerIdx = 0; playerIdx < 4; ++playerIdx) {
+        if (holdsOpposite(analyzer->held[playerIdx])) {
+            analyzer->oppositeFrames += frames;
+            break;
+        }
+    }
+}
+
+static double coefficientOfVariation (uint32_t count, double sum, double squares) {
+    if (count == 0 || sum <= 0) {
+        return 0;
+    }
+    double mean = sum / count;
+    double variance = squares / count - mean*mean;
+    return (variance > 0) ? sqrt(variance) / mean : 0;
+}
+
+void w4_inputAnalyzerInit (w4_InputAnalyzer* analyzer, uint32_t updateRate) {
+    memset(analyzer, 0, sizeof(w4_InputAnalyzer));
+    analyzer->updateRate = updateRate;
+}
+
+void w4_inputAnalyzerAdd (w4_InputAnalyzer* analyzer, const w4_GamepadEvent* event) {
+    uint8_t button = event->button;
+    if (event->playerIdx >= 4 || event->eventType > W4_GAMEPAD_EVENT_RELEASE
+            || button == 0 || (button & (button - 1))) {
+        ++analyzer->inconsistentEvents;
+        return;
+    }
+
+    uint32_t frame = event->frame;
+    if (!analyzer->started || frame != analyzer->lastFrame) {
+        if (analyzer->started) {
+            if (frame < analyzer->lastFrame) {
+                ++analyzer->inconsistentEvents;
+                return;
+            }
+            holdFrames(analyzer, frame - analyzer->lastFrame);
+        }
+        analyzer->started = true;
+        analyzer->lastFrame = frame;
+        memset(analyzer->framePresses, 0, sizeof(analyzer->framePresses));
+    }
+
+    int playerIdx = event->playerIdx;
+    int bit = 0;
+    while (!(button & (1 << bit))) {
+        ++bit;
+    }
+    uint8_t* held = &analyzer->held[playerIdx];
+
+    if (event->eventType == W4_GAMEPAD_EVENT_RELEASE) {
+        if (!(*held & button)) {
+            ++analyzer->inconsistentEvents;
+            return;
+        }
+        *held &= ~button;
+
+        double hold = frame - (analyzer->lastPress[playerIdx][bit] - 1);
+        ++analyzer->holds;
+        analyzer->holdSum += hold;
+        analyzer->holdSquares += hold*hold;
+        return;
+    }
+
+    if (*held & button) {
+        ++analyzer->inconsistentEvents;
+        return;
+    }
+    *held |= button;
+    ++analyzer->presses;
+
+    // The first two presses on a frame both count as simultaneous
+    uint32_t framePresses = ++analyzer->framePresses[playerIdx];
+    if (framePresses == 2) {
+        analyzer->sameFramePresses += 2;
+    } else if (framePresses > 2) {
+        ++analyzer->sameFramePresses;
+    }
+
+    // Last press frames are stored plus one, so zero means never pressed
+    uint32_t lastPress = analyzer->lastPress[playerIdx][bit];
+    if (lastPress != 0) {
+        uint32_t interval = frame - (lastPress - 1);
+        ++analyzer->intervals;
+        analyzer->intervalSum += interval;
+        analyzer->intervalSquares += (double)interval*interval;
+        ++analyzer->intervalHistogram[interval < HISTOGRAM_SIZE ? interval : HISTOGRAM_SIZE - 1];
+
+        if (analyzer->hasInterval[playerIdx][bit] && analyzer->lastInterval[playerIdx][bit] == interval) {
+            ++analyzer->repeats;
+        }
+        analyzer->lastInterval[playerIdx][bit] = interval;
+        analyzer->hasInterval[playerIdx][bit] = true;
+    }
+    analyzer->lastPress[playerIdx][bit] = frame + 1;
+
+    // At most 8 buttons of 4 players can be pressed per frame, so up to W4_INPUT_MAX_UPDATE_RATE
+    // the window never overflows
+    analyzer->window[analyzer->windowEnd++ % WINDOW_SIZE] = frame;
+    while (analyzer->window[analyzer->windowStart % WINDOW_SIZE] + analyzer->updateRate <= frame) {
+        ++analyzer->windowStart;
+    }
+    uint32_t windowPresses = analyzer->windowEnd - analyzer->windowStart;
+    if (windowPresses > analyzer->peakPresses) {
+        analyzer->peakPresses = windowPresses;
+    }
+}
+
+void w4_inputAnalyzerFinish (w4_InputAnalyzer* analyzer, w4_InputFeatures* features) {
+    memset(features, 0, sizeof(w4_InputFeatures));
+
+    // Whatever is held after the last event is only known to last for its frame
+    if (analyzer->started) {
+        holdFrames(analyzer, 1);
+    }
+    features->inconsistentEvents = analyzer->inconsistentEvents;
+
+    double* values = features->values;
+    uint32_t frames = analyzer->lastFrame + 1;
+    double seconds = frames / (double)analyzer->updateRate;
+    values[W4_INPUT_PRESS_RATE] = analyzer->started ? analyzer->presses / seconds : 0;
+    values[W4_INPUT_PEAK_PRESS_RATE] = analyzer->peakPresses;
+
+    if (analyzer->intervals > 0) {
+        values[W4_INPUT_INTERVAL_MEAN] = analyzer->intervalSum / analyzer->intervals;
+        values[W4_INPUT_INTERVAL_CV] = coefficientOfVariation(analyzer->intervals,
+            analyzer->intervalSum, analyzer->intervalSquares);
+        values[W4_INPUT_REPEAT_RATIO] = (double)analyzer->repeats / analyzer->intervals;
+
+        double entropy = 0;
+        for (int n = 0; n < (int)HISTOGRAM_SIZE; ++n) {
+            if (analyzer->intervalHistogram[n] > 0) {
+                double p = (double)analyzer->intervalHistogram[n] / analyzer->intervals;
+                entropy -= p * log2(p);
+            }
+        }
+        values[W4_INPUT_INTERVAL_ENTROPY] = entropy;
+    }
+
+    if (analyzer->holds > 0) {
+        values[W4_INPUT_HOLD_MEAN] = analyzer->holdSum / analyzer->holds;
+        values[W4_INPUT_HOLD_CV] = coefficientOfVariation(analyzer->holds,
+            analyzer->holdSum, analyzer->holdSquares);
+    }
+
+    if (analyzer->presses > 0) {
+        values[W4_INPUT_SAME_FRAME_RATIO] = (double)analyzer->sameFramePresses / analyzer->presses;
+    }
+
+    if (analyzer->started) {
+        values[W4_INPUT_OPPOSITE_RATIO] = (double)analyzer->oppositeFrames / frames;
+    }
+}
+
+void w4_inputBaselineInit (w4_InputBaseline* baseline) {
+    memset(baseline, 0, sizeof(w4_InputBaseline));
+}
+
+void w4_inputBaselineAdd (w4_InputBaseline* baseline, const w4_InputFeatures* features) {
+    // Welford's online algorithm
+    ++baseline->count;
+    for (int n = 0; n < W4_INPUT_FEATURE_COUNT; ++n) {
+        double value = features->values[n];
+        double delta = value - baseline->mean[n];
+        baseline->mean[n] += delta / baseline->count;
+        baseline->m2[n] += delta * (value - baseline->mean[n]);
+    }
+}
+
+int w4_inputBaselineSave (const w4_InputBaseline* baseline, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    fprintf(file, "count %u\n", baseline->count);
+    for (int n = 0; n < W4_INPUT_FEATURE_COUNT; ++n) {
+        double variance = (baseline->count > 1) ? baseline->m2[n] / (baseline->count - 1) : 0;
+        fprintf(file, "%s %.17g %.17g\n", w4_inputFeatureNames[n], baseline->mean[n], variance);
+    }
+    return fclose(file) ? -1 : 0;
+}
+
+int w4_inputBaselineLoad (w4_InputBaseline* baseline, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    w4_inputBaselineInit(baseline);
+    int result = (fscanf(file, "count %u", &baseline->count) == 1) ? 0 : -1;
+    bool found[W4_INPUT_FEATURE_COUNT] = { false };
+
+    char name[64];
+    double mean, variance;
+    while (result == 0 && fscanf(file, "%63s %lf %lf", name, &mean, &variance) == 3) {
+        int n = 0;
+        while (n < W4_INPUT_FEATURE_COUNT && strcmp(name, w4_inputFeatureNames[n])) {
+            ++n;
+        }
+        if (n == W4_INPUT_FEATURE_COUNT) {
+            result = -1;
+            break;
+        }
+        baseline->mean[n] = mean;
+        baseline->m2[n] = (baseline->count > 1) ? variance * (baseline->count - 1) : 0;
+        found[n] = true;
+    }
+    fclose(file);
+
+    for (int n = 0; n < W4_INPUT_FEATURE_COUNT; ++n) {
+        if (!found[n]) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+double w4_inputBaselineScore (const w4_InputBaseline* baseline, const w4_InputFeatures* features,
+    w4_InputFeature* worst) {
+    double score = 0;
+    *worst = 0;
+    for (int n = 0; n < W4_INPUT_FEATURE_COUNT; ++n) {
+        double mean = baseline->mean[n];
+        double stddev = (baseline->count > 1) ? sqrt(baseline->m2[n] / (baseline->count - 1)) : 0;
+        double minStddev = MIN_STDDEV_ABSOLUTE + MIN_STDDEV_RELATIVE * fabs(mean);
+        if (stddev < minStddev) {
+            stddev = minStddev;
+        }
+
+        double z = fabs(features->values[n] - mean) / stddev;
+        if (z > score) {
+            score = z;
+            *worst = n;
+        }
+    }
+    return score;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "runtime.h"
+
+// Statistical prefilter for submitted gamepad event logs. Features are computed in one pass over
+// the events, and scored against a baseline built from honest replays, so obviously scripted
+// submissions can be rejected before anything replays or proves them.
+
+// Highest update rate the one second press window has room for
+#define W4_INPUT_MAX_UPDATE_RATE 64
+
+typedef enum {
+    /** Presses per second over the whole log. */
+    W4_INPUT_PRESS_RATE,
+    /** Most presses in any one second window. */
+    W4_INPUT_PEAK_PRESS_RATE,
+    /** Frames between presses of the same button: mean, coefficient of variation and the entropy
+     * in bits of their distribution. Scripts tend to be regular. */
+    W4_INPUT_INTERVAL_MEAN,
+    W4_INPUT_INTERVAL_CV,
+    W4_INPUT_INTERVAL_ENTROPY,
+    /** Share of intervals exactly equal to the previous interval of the same button. */
+    W4_INPUT_REPEAT_RATIO,
+    /** Frames buttons are held for: mean and coefficient of variation. */
+    W4_INPUT_HOLD_MEAN,
+    W4_INPUT_HOLD_CV,
+    /** Share of presses on the same frame as another press of the same player. */
+    W4_INPUT_SAME_FRAME_RATIO,
+    /** Share of frames where a player held left and right, or up and down, at once. A gamepad
+     * can't, but keyboards can. */
+    W4_INPUT_OPPOSITE_RATIO,
+
+    W4_INPUT_FEATURE_COUNT
+} w4_InputFeature;
+
+extern const char* const w4_inputFeatureNames[W4_INPUT_FEATURE_COUNT];
+
+typedef struct {
+    double values[W4_INPUT_FEATURE_COUNT];
+
+    /** Events out of frame order, presses of held buttons, releases of released buttons, and
+     * unknown players, buttons or event types. Any is a hard failure. */
+    uint32_t inconsistentEvents;
+} w4_InputFeatures;
+
+typedef struct {
+    uint32_t updateRate;
+    uint32_t lastFrame;
+    bool started;
+
+    uint8_t held[4];
+    uint32_t lastPress[4][8];
+    uint32_t lastInterval[4][8];
+    bool hasInterval[4][8];
+
+    uint32_t presses;
+    uint32_t framePresses[4];
+    uint32_t sameFramePresses;
+
+    /** Frames of the presses in the last second, a ring. */
+    uint32_t window[2048];
+    uint32_t windowStart;
+    uint32_t windowEnd;
+    uint32_t peakPresses;
+
+    uint32_t intervals;
+    double intervalSum;
+    double intervalSquares;
+    uint32_t intervalHistogram[64];
+    uint32_t repeats;
+
+    uint32_t holds;
+    double holdSum;
+    double holdSquares;
+
+    uint32_t oppositeFrames;
+    uint32_t inconsistentEvents;
+} w4_InputAnalyzer;
+
+// Frames are counted at the update rate the log was recorded at, 1 to W4_INPUT_MAX_UPDATE_RATE
+void w4_inputAnalyzerInit (w4_InputAnalyzer* analyzer, uint32_t updateRate);
+
+// Events must be added in the order they were recorded
+void w4_inputAnalyzerAdd (w4_InputAnalyzer* analyzer, const w4_GamepadEvent* event);
+
+void w4_inputAnalyzerFinish (w4_InputAnalyzer* analyzer, w4_InputFeatures* features);
+
+// Running mean and variance of every feature over a set of honest logs
+typedef struct {
+    uint32_t count;
+    double mean[W4_INPUT_FEATURE_COUNT];
+    double m2[W4_INPUT_FEATURE_COUNT];
+} w4_InputBaseline;
+
+void w4_inputBaselineInit (w4_InputBaseline* baseline);
+void w4_inputBaselineAdd (w4_InputBaseline* baseline, const w4_InputFeatures* features);
+
+// A text file with one "name mean variance" line per feature. Return 0 on success.
+int w4_inputBaselineSave (const w4_InputBaseline* baseline, const char* path);
+int w4_inputBaselineLoad (w4_InputBaseline* baseline, const char* path);
+
+// The largest absolute z-score of any feature against the baseline, and which feature it was
+double w4_inputBaselineScore (const w4_InputBaseline* baseline, const w4_InputFeatures* features,
+    w4_InputFeature* worst);
@@ -0,0 +1,199 @@
+#include "memprofile.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "runtime.h"
+#include "util.h"
+
+typedef struct {
+    uint32_t framesWritten;
+    uint64_t bytesWritten;
+    uint32_t framesAccessed;
+    uint64_t bytesAccessed;
+} Page;
+
+typedef struct {
+    char* heatmapPath;
+
+    /** Memory as it was at the start of the frame. */
+    uint8_t snapshot[1 << 16];
+    bool inFrame;
+
+    Page pages[W4_MEMPROFILE_PAGES];
+
+    /** Pages the host accessed this frame. */
+    bool accessed[W4_MEMPROFILE_PAGES];
+
+    /** Pages written and touched (written or accessed) in every frame. */
+    uint16_t* written;
+    uint16_t* touched;
+    uint32_t frames;
+    uint32_t frameCapacity;
+} Profile;
+
+static W4_THREAD_LOCAL Profile* profile = NULL;
+
+static int compareU16 (const void* a, const void* b) {
+    return *(const uint16_t*)a - *(const uint16_t*)b;
+}
+
+static void printFrameStats (const char* label, const uint16_t* values, uint32_t count) {
+    uint16_t* sorted = xmalloc(count * sizeof(uint16_t));
+    memcpy(sorted, values, count * sizeof(uint16_t));
+    qsort(sorted, count, sizeof(uint16_t), compareU16);
+
+    uint64_t sum = 0;
+    for (uint32_t n = 0; n < count; ++n) {
+        sum += sorted[n];
+    }
+    printf("%s min %u, mean %.1f, p50 %u, p99 %u, max %u\n", label, sorted[0],
+        (double)sum / count, sorted[count / 2], sorted[(uint64_t)count * 99 / 100], sorted[count - 1]);
+    free(sorted);
+}
+
+static void printSummary () {
+    static const char ramp[] = " .:-=+*#%@";
+
+    printf("--- Memory Profile ---\n");
+    printf("Frames:         %u\n", profile->frames);
+    if (profile->frames == 0) {
+        return;
+    }
+
+    int workingSet = 0;
+    for (int page = 0; page < W4_MEMPROFILE_PAGES; ++page) {
+        if (profile->pages[page].framesWritten > 0) {
+            ++workingSet;
+        }
+    }
+    printf("Working set:    %d pages (%d bytes) written at least once\n",
+        workingSet, workingSet * W4_MEMPROFILE_PAGE_SIZE);
+    printFrameStats("Pages written: ", profile->written, profile->frames);
+    printFrameStats("Pages touched: ", profile->touched, profile->frames);
+
+    // One character per page, darker for pages written in more frames
+    printf("Writes per page (%d bytes per character):\n", W4_MEMPROFILE_PAGE_SIZE);
+    for (int row = 0; row < W4_MEMPROFILE_PAGES; row += 64) {
+        printf("  %04x |", row * W4_MEMPROFILE_PAGE_SIZE);
+        for (int page = row; page < row + 64; ++page) {
+            uint32_t framesWritten = profile->pages[page].framesWritten;
+            int level = (framesWritten == 0) ? 0
+                : 1 + (int)((uint64_t)(framesWritten - 1) * (sizeof(ramp) - 2) / profile->frames);
+            putchar(ramp[level]);
+        }
+        printf("|\n");
+    }
+    printf("----------------------\n");
+}
+
+static void writeHeatmap () {
+    FILE* file = fopen(profile->heatmapPath, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", profile->heatmapPath);
+        return;
+    }
+    fprintf(file, "page,address,frames_written,bytes_written,frames_accessed,bytes_accessed\n");
+    for (int page = 0; page < W4_MEMPROFILE_PAGES; ++page) {
+        const Page* stats = &profile->pages[page];
+        fprintf(file, "%d,0x%04x,%u,%llu,%u,%llu\n", page, page * W4_MEMPROFILE_PAGE_SIZE,
+            stats->framesWritten, (unsigned long long)stats->bytesWritten,
+            stats->framesAccessed, (unsigned long long)stats->bytesAccessed);
+    }
+    fclose(file);
+}
+
+void w4_memProfileStart (const char* heatmapPath) {
+    w4_memProfileStop();
+
+    profile = xmalloc(sizeof(Profile));
+    memset(profile, 0, sizeof(Profile));
+    profile->heatmapPath = xmalloc(strlen(heatmapPath) + 1);
+    strcpy(profile->heatmapPath, heatmapPath);
+}
+
+void w4_memProfileStop () {
+    if (profile == NULL) {
+        return;
+    }
+    writeHeatmap();
+    printSummary();
+
+    free(profile->written);
+    free(profile->touched);
+    free(profile->heatmapPath);
+    free(profile);
+    profile = NULL;
+}
+
+void w4_memProfileBeginFrame () {
+    if (profile == NULL) {
+        return;
+    }
+    memcpy(profile->snapshot, w4_memory, sizeof(profile->snapshot));
+    profile->inFrame = true;
+}
+
+void w4_memProfileEndFrame () {
+    if (profile == NULL || !profile->inFrame) {
+        return;
+    }
+    profile->inFrame = false;
+
+    if (profile->frames == profile->frameCapacity) {
+        profile->frameCapacity = profile->frameCapacity ? 2*profile->frameCapacity : 1024;
+        profile->written = xrealloc(profile->written, profile->frameCapacity * sizeof(uint16_t));
+        profile->touched = xrealloc(profile->touched, profile->frameCapacity * sizeof(uint16_t));
+    }
+
+    const uint8_t* current = (const uint8_t*)w4_memory;
+    uint16_t written = 0;
+    uint16_t touched = 0;
+    for (int page = 0; page < W4_MEMPROFILE_PAGES; ++page) {
+        int offset = page * W4_MEMPROFILE_PAGE_SIZE;
+        int changed = 0;
+        if (memcmp(profile->snapshot + offset, current + offset, W4_MEMPROFILE_PAGE_SIZE)) {
+            for (int n = offset; n < offset + W4_MEMPROFILE_PAGE_SIZE; ++n) {
+                changed += (profile->snapshot[n] != current[n]);
+            }
+        }
+
+        Page* stats = &profile->pages[page];
+        if (changed > 0) {
+            ++stats->framesWritten;
+            stats->bytesWritten += changed;
+            ++written;
+        }
+        bool accessed = profile->accessed[page];
+        if (accessed) {
+            ++stats->framesAccessed;
+            profile->accessed[page] = false;
+        }
+        if (changed > 0 || accessed) {
+            ++touched;
+        }
+    }
+
+    profile->written[profile->frames] = written;
+    profile->touched[profile->frames] = touched;
+    ++profile->frames;
+}
+
+void w4_memProfileHostAccess (const void* ptr, size_t length) {
+    if (profile == NULL || !profile->inFrame || length == 0) {
+        return;
+    }
+
+    size_t start = (const uint8_t*)ptr - (const uint8_t*)w4_memory;
+    size_t end = start + length;
+    for (size_t page = start / W4_MEMPROFILE_PAGE_SIZE; page * W4_MEMPROFILE_PAGE_SIZE < end; ++page) {
+        size_t pageStart = page * W4_MEMPROFILE_PAGE_SIZE;
+        size_t pageEnd = pageStart + W4_MEMPROFILE_PAGE_SIZE;
+        size_t from = (start > pageStart) ? start : pageStart;
+        size_t to = (end < pageEnd) ? end : pageEnd;
+        profile->pages[page].bytesAccessed += to - from;
+        profile->accessed[page] = true;
+    }
+}
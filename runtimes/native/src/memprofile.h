@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Per page profile of how a cart uses its 64 KB of memory, frame by frame. Writes are found by
+// comparing each page against its contents at the start of the frame, and host accesses are the
+// buffers the cart passes to host functions (sprites, strings, disk data).
+
+#define W4_MEMPROFILE_PAGE_SIZE 256
+#define W4_MEMPROFILE_PAGES ((1 << 16) / W4_MEMPROFILE_PAGE_SIZE)
+
+// Profiles the instance bound to the calling thread. Stopping writes the heatmap as CSV, one row
+// per page, and prints a summary with the pages touched per frame.
+void w4_memProfileStart (const char* heatmapPath);
+void w4_memProfileStop ();
+
+// Called by the runtime, these do nothing unless a profile is running on the calling thread
+void w4_memProfileBeginFrame ();
+void w4_memProfileEndFrame ();
+void w4_memProfileHostAccess (const void* ptr, size_t length);
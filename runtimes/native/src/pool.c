@@ -0,0 +1,211 @@
+#include "pool.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#define W4_POOL_THREADS
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define W4_POOL_MMAP
+#endif
+
+#include "util.h"
+
+// Slot sizes are rounded up to whole cache lines, so neighbouring slots never share one
+#define SLOT_ALIGN 64
+
+// Instances only allocate a handful of distinct sizes
+#define MAX_CLASSES 32
+
+// Each w4_poolReserve() call that grows the reservation adds one
+#define MAX_ARENAS 16
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+typedef struct FreeSlot {
+    struct FreeSlot* next;
+} FreeSlot;
+
+// Every slot ever carved for one size, that isn't currently allocated
+typedef struct {
+    size_t size;
+    FreeSlot* free;
+} SizeClass;
+
+typedef struct {
+    uint8_t* base;
+    size_t length;
+
+    /** Bytes carved into slots so far, from the start. */
+    size_t used;
+} Arena;
+
+static Arena arenas[MAX_ARENAS];
+static int arenaCount = 0;
+static size_t reserved = 0;
+
+static SizeClass classes[MAX_CLASSES];
+static int classCount = 0;
+
+#ifdef W4_POOL_THREADS
+static pthread_mutex_t poolMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void lockPool () {
+#ifdef W4_POOL_THREADS
+    pthread_mutex_lock(&poolMutex);
+#endif
+}
+
+static void unlockPool () {
+#ifdef W4_POOL_THREADS
+    pthread_mutex_unlock(&poolMutex);
+#endif
+}
+
+#ifdef W4_POOL_MMAP
+// Maps length bytes of address space, aligned to huge pages unless pages is the default. Pages
+// are only backed by memory once touched.
+static uint8_t* mapArena (size_t length, int pages) {
+#ifdef MAP_HUGETLB
+    if (pages == W4_POOL_PAGES_HUGE) {
+        void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping != MAP_FAILED) {
+            return mapping;
+        }
+    }
+#endif
+
+#ifdef MAP_NORESERVE
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#endif
+    if (pages == W4_POOL_PAGES_DEFAULT) {
+        void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+        return (mapping != MAP_FAILED) ? mapping : NULL;
+    }
+
+    // Transparent huge pages only back aligned 2 MB ranges, so map an extra one and trim the ends
+    void* mapping = mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    uintptr_t start = (uintptr_t)mapping;
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) {
+        munmap(mapping, aligned - start);
+    }
+    if (aligned + length < start + length + HUGE_PAGE_SIZE) {
+        munmap((void*)(aligned + length), start + length + HUGE_PAGE_SIZE - (aligned + length));
+    }
+#ifdef MADV_HUGEPAGE
+    madvise((void*)aligned, length, MADV_HUGEPAGE);
+#endif
+    return (uint8_t*)aligned;
+}
+#endif
+
+bool w4_poolReserve (size_t bytes, int pages) {
+#ifdef W4_POOL_MMAP
+    bool ok = true;
+    lockPool();
+    if (bytes > reserved && arenaCount < MAX_ARENAS) {
+        size_t length = (bytes - reserved + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+        uint8_t* base = mapArena(length, pages);
+        if (base != NULL) {
+            Arena* arena = &arenas[arenaCount++];
+            arena->base = base;
+            arena->length = length;
+            arena->used = 0;
+            reserved += length;
+        } else {
+            ok = false;
+        }
+    }
+    ok = ok && reserved > 0;
+    unlockPool();
+    return ok;
+#else
+    (void)bytes;
+    (void)pages;
+    return false;
+#endif
+}
+
+// Called with the lock held
+static SizeClass* findClass (size_t size, bool create) {
+    for (int ii = 0; ii < classCount; ++ii) {
+        if (classes[ii].size == size) {
+            return &classes[ii];
+        }
+    }
+    if (!create || classCount == MAX_CLASSES) {
+        return NULL;
+    }
+    SizeClass* sizeClass = &classes[classCount++];
+    sizeClass->size = size;
+    sizeClass->free = NULL;
+    return sizeClass;
+}
+
+static bool inArena (const void* ptr) {
+    for (int ii = 0; ii < arenaCount; ++ii) {
+        const Arena* arena = &arenas[ii];
+        if ((const uint8_t*)ptr >= arena->base && (const uint8_t*)ptr < arena->base + arena->used) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void* w4_poolAlloc (size_t size) {
+    size = (size + SLOT_ALIGN - 1) & ~(size_t)(SLOT_ALIGN - 1);
+    void* slot = NULL;
+
+    lockPool();
+    if (arenaCount > 0) {
+        SizeClass* sizeClass = findClass(size, true);
+        if (sizeClass != NULL && sizeClass->free != NULL) {
+            slot = sizeClass->free;
+            sizeClass->free = sizeClass->free->next;
+        } else if (sizeClass != NULL) {
+            for (int ii = 0; ii < arenaCount; ++ii) {
+                Arena* arena = &arenas[ii];
+                if (arena->length - arena->used >= size) {
+                    slot = arena->base + arena->used;
+                    arena->used += size;
+                    break;
+                }
+            }
+        }
+    }
+    unlockPool();
+
+    return (slot != NULL) ? slot : xmalloc(size);
+}
+
+void w4_poolFree (void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    size = (size + SLOT_ALIGN - 1) & ~(size_t)(SLOT_ALIGN - 1);
+
+    lockPool();
+    if (inArena(ptr)) {
+        // Kept for the next allocation of this size, the pages stay mapped
+        SizeClass* sizeClass = findClass(size, false);
+        FreeSlot* slot = ptr;
+        slot->next = sizeClass->free;
+        sizeClass->free = slot;
+        ptr = NULL;
+    }
+    unlockPool();
+
+    free(ptr);
+}
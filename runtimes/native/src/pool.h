@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Storage for the fixed size allocations console instances make as they come and go: console
+// memory, wasm stacks, APU states, snapshots and replay recorders. The space is reserved up front
+// as one region, so thousands of instances share few TLB entries, and freed slots are kept for the
+// next allocation of the same size instead of being returned to the OS.
+//
+// Until w4_poolReserve() is called, and once the reservation runs out, allocations fall back to
+// xmalloc(). Safe to use from any thread.
+
+// Page sizes backing the reservation
+#define W4_POOL_PAGES_DEFAULT 0
+#define W4_POOL_PAGES_TRANSPARENT_HUGE 1 // madvise(MADV_HUGEPAGE), needs THP enabled
+#define W4_POOL_PAGES_HUGE 2 // MAP_HUGETLB from the preallocated pool, or transparent ones if empty
+
+// Roughly what one instance allocates from the pool, for sizing reservations
+#define W4_POOL_INSTANCE_BYTES (192 * 1024)
+
+// Grows the reservation to at least bytes in total. Returns false if nothing could be reserved,
+// in which case allocations keep using xmalloc().
+bool w4_poolReserve (size_t bytes, int pages);
+
+// Never returns NULL. Memory is not cleared.
+void* w4_poolAlloc (size_t size);
+
+// Size must be the one ptr was allocated with. NULL is ignored.
+void w4_poolFree (void* ptr, size_t size);
@@ -0,0 +1,648 @@
+// For fseeko() and ftruncate(), with 64-bit offsets on 32-bit platforms too
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
+#include "replaystore.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "util.h"
+
+#define CHUNK_MAGIC "W4RC"
+#define REPLAY_MAGIC "W4RR"
+#define STORE_VERSION 1
+
+#define CHUNK_FILE "chunks.w4c"
+#define REPLAY_FILE "replays.w4r"
+
+// Chunks end on event boundaries where the top bits of the rolling hash are zero, which averages
+// one boundary every 64 events, within these bounds. The hash only covers the last 64 bytes, and
+// the minimum is longer than that, so boundaries only depend on the content before them.
+#define CHUNK_MIN_EVENTS 16
+#define CHUNK_MAX_EVENTS 512
+#define CHUNK_BOUNDARY_MASK (0x3fULL << 58)
+
+// A zigzag varint frame delta of up to 5 bytes, then the player, button, event type and padding
+#define MAX_ENCODED_EVENT 9
+#define MAX_CHUNK_BYTES (CHUNK_MAX_EVENTS * MAX_ENCODED_EVENT)
+
+typedef struct {
+    /** Where the chunk's bytes start in the chunk file. */
+    uint64_t offset;
+    uint32_t length;
+    uint64_t hash;
+} Chunk;
+
+typedef struct {
+    char* name;
+    uint32_t eventCount;
+
+    /** The replay's chunk ids, in the store's list of references. */
+    uint32_t firstRef;
+    uint32_t chunkCount;
+} Replay;
+
+struct w4_ReplayStore {
+    bool readOnly;
+    FILE* chunkFile;
+    FILE* replayFile;
+    uint64_t chunkFileSize;
+    uint64_t replayFileSize;
+
+    Chunk* chunks;
+    uint32_t chunkCount;
+    uint32_t chunkCapacity;
+
+    Replay* replays;
+    uint32_t replayCount;
+    uint32_t replayCapacity;
+
+    uint32_t* refs;
+    uint32_t refCount;
+    uint32_t refCapacity;
+
+    /** Open addressed hash tables of chunk and replay indices plus one, 0 for empty. */
+    uint32_t* chunkTable;
+    uint32_t chunkTableSize;
+    uint32_t* nameTable;
+    uint32_t nameTableSize;
+
+    /** The chunk being encoded, and a chunk read back to compare against. */
+    uint8_t encoded[MAX_CHUNK_BYTES];
+    uint8_t existing[MAX_CHUNK_BYTES];
+};
+
+struct w4_ReplayStream {
+    w4_ReplayStore* store;
+    uint32_t replayIdx;
+
+    uint32_t nextChunk;
+    uint8_t chunk[MAX_CHUNK_BYTES];
+    uint32_t chunkLength;
+    uint32_t chunkPos;
+
+    uint32_t eventsRead;
+    uint32_t frame;
+
+    /** Bytes of the serialized format not yet copied by w4_replayStreamRead(). */
+    uint8_t pending[8];
+    uint32_t pendingPos;
+    uint32_t pendingLength;
+    bool headerDone;
+};
+
+static uint64_t gear[256];
+
+// A fixed table of random values, so chunk boundaries are the same across runs and stores
+static void initGear () {
+    if (gear[0] != 0) {
+        return;
+    }
+    uint64_t state = 0x5741534d34ULL;
+    for (int ii = 0; ii < 256; ++ii) {
+        // splitmix64
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[ii] = z ^ (z >> 31);
+    }
+}
+
+static uint64_t fnv1a (const void* data, size_t length) {
+    const uint8_t* bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t ii = 0; ii < length; ++ii) {
+        hash = (hash ^ bytes[ii]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint32_t hashName (const char* name) {
+    uint64_t hash = fnv1a(name, strlen(name));
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static void write64LE (void* ptr, uint64_t value) {
+    w4_write32LE(ptr, (uint32_t)value);
+    w4_write32LE((uint8_t*)ptr + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t read64LE (const void* ptr) {
+    return w4_read32LE(ptr) | ((uint64_t)w4_read32LE((const uint8_t*)ptr + 4) << 32);
+}
+
+static void insertChunk (w4_ReplayStore* store, uint32_t id);
+static void insertName (w4_ReplayStore* store, uint32_t idx);
+
+static void growChunkTable (w4_ReplayStore* store) {
+    free(store->chunkTable);
+    store->chunkTableSize = store->chunkTableSize ? 2*store->chunkTableSize : 1024;
+    store->chunkTable = xmalloc(store->chunkTableSize * sizeof(uint32_t));
+    memset(store->chunkTable, 0, store->chunkTableSize * sizeof(uint32_t));
+    for (uint32_t id = 0; id < store->chunkCount; ++id) {
+        insertChunk(store, id);
+    }
+}
+
+static void insertChunk (w4_ReplayStore* store, uint32_t id) {
+    uint32_t mask = store->chunkTableSize - 1;
+    uint32_t slot = (uint32_t)store->chunks[id].hash & mask;
+    while (store->chunkTable[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    store->chunkTable[slot] = id + 1;
+}
+
+static void growNameTable (w4_ReplayStore* store) {
+    free(store->nameTable);
+    store->nameTableSize = store->nameTableSize ? 2*store->nameTableSize : 1024;
+    store->nameTable = xmalloc(store->nameTableSize * sizeof(uint32_t));
+    memset(store->nameTable, 0, store->nameTableSize * sizeof(uint32_t));
+    for (uint32_t idx = 0; idx < store->replayCount; ++idx) {
+        insertName(store, idx);
+    }
+}
+
+static void insertName (w4_ReplayStore* store, uint32_t idx) {
+    uint32_t mask = store->nameTableSize - 1;
+    uint32_t slot = hashName(store->replays[idx].name) & mask;
+    while (store->nameTable[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    store->nameTable[slot] = idx + 1;
+}
+
+static const Replay* findReplay (const w4_ReplayStore* store, const char* name) {
+    uint32_t mask = store->nameTableSize - 1;
+    for (uint32_t slot = hashName(name) & mask; store->nameTable[slot] != 0; slot = (slot + 1) & mask) {
+        const Replay* replay = &store->replays[store->nameTable[slot] - 1];
+        if (!strcmp(replay->name, name)) {
+            return replay;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t addChunk (w4_ReplayStore* store, uint64_t offset, uint32_t length, uint64_t hash) {
+    if (store->chunkCount == store->chunkCapacity) {
+        store->chunkCapacity = store->chunkCapacity ? 2*store->chunkCapacity : 1024;
+        store->chunks = xrealloc(store->chunks, store->chunkCapacity * sizeof(Chunk));
+    }
+    uint32_t id = store->chunkCount++;
+    store->chunks[id].offset = offset;
+    store->chunks[id].length = length;
+    store->chunks[id].hash = hash;
+
+    if (2 * store->chunkCount > store->chunkTableSize) {
+        growChunkTable(store);
+    } else {
+        insertChunk(store, id);
+    }
+    return id;
+}
+
+static void addRef (w4_ReplayStore* store, uint32_t id) {
+    if (store->refCount == store->refCapacity) {
+        store->refCapacity = store->refCapacity ? 2*store->refCapacity : 4096;
+        store->refs = xrealloc(store->refs, store->refCapacity * sizeof(uint32_t));
+    }
+    store->refs[store->refCount++] = id;
+}
+
+static void addReplay (w4_ReplayStore* store, const char* name, size_t nameLength,
+    uint32_t eventCount, uint32_t firstRef, uint32_t chunkCount) {
+    if (store->replayCount == store->replayCapacity) {
+        store->replayCapacity = store->replayCapacity ? 2*store->replayCapacity : 256;
+        store->replays = xrealloc(store->replays, store->replayCapacity * sizeof(Replay));
+    }
+    Replay* replay = &store->replays[store->replayCount++];
+    replay->name = xmalloc(nameLength + 1);
+    memcpy(replay->name, name, nameLength);
+    replay->name[nameLength] = '\0';
+    replay->eventCount = eventCount;
+    replay->firstRef = firstRef;
+    replay->chunkCount = chunkCount;
+
+    if (2 * store->replayCount > store->nameTableSize) {
+        growNameTable(store);
+    } else {
+        insertName(store, store->replayCount - 1);
+    }
+}
+
+// A long is 32 bits on Windows and 32-bit platforms, and the files may grow past 2 GB
+static bool seekTo (FILE* file, uint64_t offset) {
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool truncateTo (FILE* file, uint64_t size) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _chsize_s(_fileno(file), (__int64)size) == 0;
+#else
+    return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+static bool readAt (FILE* file, uint64_t offset, void* dest, size_t length) {
+    return seekTo(file, offset) && fread(dest, 1, length, file) == length;
+}
+
+static bool writeAt (FILE* file, uint64_t offset, const void* src, size_t length) {
+    return seekTo(file, offset) && fwrite(src, 1, length, file) == length;
+}
+
+// Opens one of the store's files, writing its header if it's new and the store is writable.
+// Returns the file and sets its size to just after the header.
+static FILE* openFile (const char* dir, const char* name, const char* magic, bool readOnly,
+    uint64_t* size) {
+    size_t pathLength = strlen(dir) + strlen(name) + 2;
+    char* path = xmalloc(pathLength);
+    snprintf(path, pathLength, "%s/%s", dir, name);
+    FILE* file = fopen(path, readOnly ? "rb" : "r+b");
+    bool created = false;
+    if (file == NULL && !readOnly) {
+        file = fopen(path, "w+b");
+        created = true;
+    }
+    free(path);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    uint8_t header[8];
+    if (created) {
+        memcpy(header, magic, 4);
+        w4_write32LE(header + 4, STORE_VERSION);
+        if (!writeAt(file, 0, header, sizeof(header))) {
+            fclose(file);
+            return NULL;
+        }
+    } else if (!readAt(file, 0, header, sizeof(header)) || memcmp(header, magic, 4)
+            || w4_read32LE(header + 4) != STORE_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+    *size = sizeof(header);
+    return file;
+}
+
+// Both files are scanned record by record. A record cut short by a crash ends the scan, and a
+// writable store cuts it off, so that what's left of it can't be read as a record after a shorter
+// one is written over its start.
+static void scanChunks (w4_ReplayStore* store) {
+    uint8_t header[12];
+    uint64_t offset = store->chunkFileSize;
+    while (readAt(store->chunkFile, offset, header, sizeof(header))) {
+        uint32_t length = w4_read32LE(header);
+        if (length > MAX_CHUNK_BYTES
+                || !readAt(store->chunkFile, offset + sizeof(header), store->existing, length)
+                || fnv1a(store->existing, length) != read64LE(header + 4)) {
+            break;
+        }
+        addChunk(store, offset + sizeof(header), length, read64LE(header + 4));
+        offset += sizeof(header) + length;
+    }
+    store->chunkFileSize = offset;
+}
+
+static void scanReplays (w4_ReplayStore* store) {
+    uint8_t header[12];
+    uint64_t offset = store->replayFileSize;
+    char* name = NULL;
+    uint8_t* ids = NULL;
+    while (readAt(store->replayFile, offset, header, sizeof(header))) {
+        uint32_t nameLength = w4_read32LE(header);
+        uint32_t eventCount = w4_read32LE(header + 4);
+        uint32_t chunkCount = w4_read32LE(header + 8);
+        if (nameLength > 4096 || chunkCount > eventCount / CHUNK_MIN_EVENTS + 1) {
+            break;
+        }
+        name = xrealloc(name, nameLength + 1);
+        ids = xrealloc(ids, 4 * chunkCount + 1);
+        if (!readAt(store->replayFile, offset + sizeof(header), name, nameLength)
+                || !readAt(store->replayFile, offset + sizeof(header) + nameLength, ids, 4 * chunkCount)) {
+            break;
+        }
+
+        uint32_t firstRef = store->refCount;
+        bool valid = true;
+        for (uint32_t ii = 0; ii < chunkCount; ++ii) {
+            uint32_t id = w4_read32LE(ids + 4*ii);
+            valid = valid && id < store->chunkCount;
+            addRef(store, id);
+        }
+        name[nameLength] = '\0';
+        if (!valid || findReplay(store, name) != NULL) {
+            store->refCount = firstRef;
+            break;
+        }
+        addReplay(store, name, nameLength, eventCount, firstRef, chunkCount);
+        offset += sizeof(header) + nameLength + 4 * chunkCount;
+    }
+    free(ids);
+    free(name);
+    store->replayFileSize = offset;
+}
+
+static w4_ReplayStore* openStore (const char* dir, bool readOnly) {
+    initGear();
+
+    if (!readOnly) {
+#if defined(_WIN32)
+        _mkdir(dir);
+#else
+        mkdir(dir, 0755);
+#endif
+    }
+
+    w4_ReplayStore* store = xmalloc(sizeof(w4_ReplayStore));
+    memset(store, 0, sizeof(w4_ReplayStore));
+    store->readOnly = readOnly;
+    store->chunkFile = openFile(dir, CHUNK_FILE, CHUNK_MAGIC, readOnly, &store->chunkFileSize);
+    store->replayFile = openFile(dir, REPLAY_FILE, REPLAY_MAGIC, readOnly, &store->replayFileSize);
+    if (store->chunkFile == NULL || store->replayFile == NULL) {
+        w4_replayStoreClose(store);
+        return NULL;
+    }
+    growChunkTable(store);
+    growNameTable(store);
+
+    scanChunks(store);
+    scanReplays(store);
+    if (!readOnly && (!truncateTo(store->chunkFile, store->chunkFileSize)
+            || !truncateTo(store->replayFile, store->replayFileSize))) {
+        w4_replayStoreClose(store);
+        return NULL;
+    }
+    return store;
+}
+
+w4_ReplayStore* w4_replayStoreOpen (const char* dir) {
+    return openStore(dir, false);
+}
+
+w4_ReplayStore* w4_replayStoreOpenReadOnly (const char* dir) {
+    return openStore(dir, true);
+}
+
+void w4_replayStoreClose (w4_ReplayStore* store) {
+    if (store->chunkFile != NULL) {
+        fclose(store->chunkFile);
+    }
+    if (store->replayFile != NULL) {
+        fclose(store->replayFile);
+    }
+    for (uint32_t idx = 0; idx < store->replayCount; ++idx) {
+        free(store->replays[idx].name);
+    }
+    free(store->replays);
+    free(store->chunks);
+    free(store->refs);
+    free(store->chunkTable);
+    free(store->nameTable);
+    free(store);
+}
+
+// Returns the id of a chunk with the same bytes as the one being encoded, writing it if there is
+// none. Returns -1 if writing failed.
+static int64_t storeChunk (w4_ReplayStore* store, uint32_t length) {
+    uint64_t hash = fnv1a(store->encoded, length);
+    uint32_t mask = store->chunkTableSize - 1;
+    for (uint32_t slot = (uint32_t)hash & mask; store->chunkTable[slot] != 0; slot = (slot + 1) & mask) {
+        const Chunk* chunk = &store->chunks[store->chunkTable[slot] - 1];
+        if (chunk->hash == hash && chunk->length == length
+                && readAt(store->chunkFile, chunk->offset, store->existing, length)
+                && !memcmp(store->existing, store->encoded, length)) {
+            return store->chunkTable[slot] - 1;
+        }
+    }
+
+    uint8_t header[12];
+    w4_write32LE(header, length);
+    write64LE(header + 4, hash);
+    uint64_t offset = store->chunkFileSize;
+    if (!writeAt(store->chunkFile, offset, header, sizeof(header))
+            || !writeAt(store->chunkFile, offset + sizeof(header), store->encoded, length)) {
+        return -1;
+    }
+    store->chunkFileSize = offset + sizeof(header) + length;
+    return addChunk(store, offset + sizeof(header), length, hash);
+}
+
+// Frame deltas are zigzag encoded, so logs with events out of order still round trip
+static uint32_t encodeEvent (uint8_t* dest, const uint8_t* event, uint32_t previousFrame) {
+    int64_t delta = (int64_t)w4_read32LE(event) - previousFrame;
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    uint32_t length = 0;
+    while (zigzag >= 0x80) {
+        dest[length++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    dest[length++] = (uint8_t)zigzag;
+    memcpy(dest + length, event + 4, 4);
+    return length + 4;
+}
+
+int w4_replayStoreAdd (w4_ReplayStore* store, const char* name, const uint8_t* log, size_t length) {
+    if (length < 4 || (length - 4) % 8 != 0 || w4_read32LE(log) != (length - 4) / 8) {
+        return -1;
+    }
+    if (store->readOnly || findReplay(store, name) != NULL) {
+        return -1;
+    }
+
+    uint32_t eventCount = w4_read32LE(log);
+    uint32_t firstRef = store->refCount;
+    uint32_t previousFrame = 0;
+    uint32_t chunkLength = 0;
+    uint32_t chunkEvents = 0;
+    uint64_t hash = 0;
+    for (uint32_t ii = 0; ii < eventCount; ++ii) {
+        const uint8_t* event = log + 4 + 8*ii;
+        uint32_t eventLength = encodeEvent(store->encoded + chunkLength, event, previousFrame);
+        for (uint32_t n = 0; n < eventLength; ++n) {
+            hash = (hash << 1) + gear[store->encoded[chunkLength + n]];
+        }
+        chunkLength += eventLength;
+        ++chunkEvents;
+        previousFrame = w4_read32LE(event);
+
+        bool boundary = (chunkEvents >= CHUNK_MIN_EVENTS && (hash & CHUNK_BOUNDARY_MASK) == 0)
+            || chunkEvents == CHUNK_MAX_EVENTS || ii == eventCount - 1;
+        if (boundary) {
+            int64_t id = storeChunk(store, chunkLength);
+            if (id < 0) {
+                store->refCount = firstRef;
+                return -1;
+            }
+            addRef(store, id);
+            chunkLength = 0;
+            chunkEvents = 0;
+        }
+    }
+    fflush(store->chunkFile);
+
+    // The replay is only recorded once all its chunks are
+    uint32_t chunkCount = store->refCount - firstRef;
+    size_t nameLength = strlen(name);
+    size_t recordLength = 12 + nameLength + 4 * chunkCount;
+    uint8_t* record = xmalloc(recordLength);
+    w4_write32LE(record, nameLength);
+    w4_write32LE(record + 4, eventCount);
+    w4_write32LE(record + 8, chunkCount);
+    memcpy(record + 12, name, nameLength);
+    for (uint32_t ii = 0; ii < chunkCount; ++ii) {
+        w4_write32LE(record + 12 + nameLength + 4*ii, store->refs[firstRef + ii]);
+    }
+    bool ok = writeAt(store->replayFile, store->replayFileSize, record, recordLength)
+        && fflush(store->replayFile) == 0;
+    free(record);
+    if (!ok) {
+        store->refCount = firstRef;
+        return -1;
+    }
+    store->replayFileSize += recordLength;
+    addReplay(store, name, nameLength, eventCount, firstRef, chunkCount);
+    return 0;
+}
+
+void w4_replayStoreGetStats (const w4_ReplayStore* store, w4_ReplayStoreStats* stats) {
+    stats->replays = store->replayCount;
+    stats->chunks = store->chunkCount;
+    stats->logBytes = 0;
+    for (uint32_t idx = 0; idx < store->replayCount; ++idx) {
+        stats->logBytes += 4 + 8 * (uint64_t)store->replays[idx].eventCount;
+    }
+    stats->storedBytes = store->chunkFileSize + store->replayFileSize;
+}
+
+uint32_t w4_replayStoreCount (const w4_ReplayStore* store) {
+    return store->replayCount;
+}
+
+const char* w4_replayStoreName (const w4_ReplayStore* store, uint32_t idx) {
+    return (idx < store->replayCount) ? store->replays[idx].name : NULL;
+}
+
+w4_ReplayStream* w4_replayStreamOpen (w4_ReplayStore* store, const char* name) {
+    const Replay* replay = findReplay(store, name);
+    if (replay == NULL) {
+        return NULL;
+    }
+    w4_ReplayStream* stream = xmalloc(sizeof(w4_ReplayStream));
+    memset(stream, 0, sizeof(w4_ReplayStream));
+    stream->store = store;
+    stream->replayIdx = replay - store->replays;
+    return stream;
+}
+
+void w4_replayStreamClose (w4_ReplayStream* stream) {
+    free(stream);
+}
+
+uint32_t w4_replayStreamEventCount (const w4_ReplayStream* stream) {
+    return stream->store->replays[stream->replayIdx].eventCount;
+}
+
+int w4_replayStreamNext (w4_ReplayStream* stream, w4_GamepadEvent* event) {
+    const Replay* replay = &stream->store->replays[stream->replayIdx];
+    if (stream->eventsRead == replay->eventCount) {
+        return 0;
+    }
+
+    if (stream->chunkPos == stream->chunkLength) {
+        if (stream->nextChunk == replay->chunkCount) {
+            return -1;
+        }
+        w4_ReplayStore* store = stream->store;
+        const Chunk* chunk = &store->chunks[store->refs[replay->firstRef + stream->nextChunk]];
+        if (!readAt(store->chunkFile, chunk->offset, stream->chunk, chunk->length)) {
+            return -1;
+        }
+        ++stream->nextChunk;
+        stream->chunkLength = chunk->length;
+        stream->chunkPos = 0;
+    }
+
+    uint64_t zigzag = 0;
+    for (int shift = 0;; shift += 7) {
+        if (stream->chunkPos == stream->chunkLength || shift > 35) {
+            return -1;
+        }
+        uint8_t byte = stream->chunk[stream->chunkPos++];
+        zigzag |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    if (stream->chunkLength - stream->chunkPos < 4) {
+        return -1;
+    }
+    int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    const uint8_t* fields = stream->chunk + stream->chunkPos;
+    stream->chunkPos += 4;
+
+    stream->frame = (uint32_t)((int64_t)stream->frame + delta);
+    event->frame = stream->frame;
+    event->playerIdx = fields[0];
+    event->button = fields[1];
+    event->eventType = fields[2];
+    event->padding = fields[3];
+    ++stream->eventsRead;
+    return 1;
+}
+
+long w4_replayStreamRead (w4_ReplayStream* stream, uint8_t* dest, size_t capacity) {
+    size_t copied = 0;
+    while (copied < capacity) {
+        if (stream->pendingPos == stream->pendingLength) {
+            if (!stream->headerDone) {
+                w4_write32LE(stream->pending, w4_replayStreamEventCount(stream));
+                stream->pendingLength = 4;
+                stream->headerDone = true;
+            } else {
+                w4_GamepadEvent event;
+                int result = w4_replayStreamNext(stream, &event);
+                if (result < 0) {
+                    return -1;
+                } else if (result == 0) {
+                    break;
+                }
+                w4_write32LE(stream->pending, event.frame);
+                stream->pending[4] = event.playerIdx;
+                stream->pending[5] = event.button;
+                stream->pending[6] = event.eventType;
+                stream->pending[7] = event.padding;
+                stream->pendingLength = 8;
+            }
+            stream->pendingPos = 0;
+        }
+
+        size_t count = stream->pendingLength - stream->pendingPos;
+        if (count > capacity - copied) {
+            count = capacity - copied;
+        }
+        memcpy(dest + copied, stream->pending + stream->pendingPos, count);
+        stream->pendingPos += count;
+        copied += count;
+    }
+    return (long)copied;
+}
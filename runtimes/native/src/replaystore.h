@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "runtime.h"
+
+// Content addressed archive of gamepad event logs. Replays of the same cart tend to share long
+// runs of identical input (menu navigation, the opening of a seed), so each log is delta encoded,
+// split into chunks at content defined boundaries, and only chunks not already in the store are
+// written. A replay is its event count and the list of its chunks. Logs are read back event by
+// event, or as the serialized recorder format, without materializing the whole log.
+//
+// A store is a directory holding two append-only files, and is not safe to use from several
+// threads or processes at once.
+
+typedef struct w4_ReplayStore w4_ReplayStore;
+
+typedef struct {
+    uint32_t replays;
+    uint32_t chunks;
+
+    /** Total size of the logs as added, in the serialized recorder format. */
+    uint64_t logBytes;
+
+    /** Size of the store's files. */
+    uint64_t storedBytes;
+} w4_ReplayStoreStats;
+
+// Opens the store in a directory, creating it if needed. Returns NULL on failure.
+w4_ReplayStore* w4_replayStoreOpen (const char* dir);
+
+// Opens an existing store without creating or modifying anything. Adding to it fails.
+w4_ReplayStore* w4_replayStoreOpenReadOnly (const char* dir);
+void w4_replayStoreClose (w4_ReplayStore* store);
+
+// Adds a log in the serialized recorder format (a little-endian u32 count, then 8 bytes per
+// event). Returns 0 on success, or -1 if the log is malformed, the name is taken, the store is
+// read-only or writing failed.
+int w4_replayStoreAdd (w4_ReplayStore* store, const char* name, const uint8_t* log, size_t length);
+
+void w4_replayStoreGetStats (const w4_ReplayStore* store, w4_ReplayStoreStats* stats);
+
+// Names of the replays, in the order they were added
+uint32_t w4_replayStoreCount (const w4_ReplayStore* store);
+const char* w4_replayStoreName (const w4_ReplayStore* store, uint32_t idx);
+
+typedef struct w4_ReplayStream w4_ReplayStream;
+
+// Streams a replay back one chunk at a time. Returns NULL if there is no replay of that name. The
+// stream must be closed before the store.
+w4_ReplayStream* w4_replayStreamOpen (w4_ReplayStore* store, const char* name);
+void w4_replayStreamClose (w4_ReplayStream* stream);
+
+uint32_t w4_replayStreamEventCount (const w4_ReplayStream* stream);
+
+// Decodes the next event. Returns 1, 0 at the end of the log, or -1 if the store is corrupt.
+int w4_replayStreamNext (w4_ReplayStream* stream, w4_GamepadEvent* event);
+
+// Copies up to capacity more bytes of the log in the serialized recorder format. Returns the
+// number of bytes copied, 0 at the end of the log, or -1 if the store is corrupt.
+long w4_replayStreamRead (w4_ReplayStream* stream, uint8_t* dest, size_t capacity);
@@ -2,12 +2,17 @@
 #include <stdbool.h>
 
 #include <inttypes.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "apu.h"
+#include "capture.h"
 #include "framebuffer.h"
+#include "memprofile.h"
+#include "timeline.h"
+#include "trace.h"
 #include "util.h"
 #include "wasm.h"
 #include "window.h"
@@ -20,6 +25,7 @@
 
 
 
+// Followed by the APU state and the wasm globals
 typedef struct {
     Memory memory;
     w4_Disk disk;
@@ -33,9 +39,9 @@ static bool recordingInput = false;
 static uint32_t frameNumber = 0;
 w4_GamepadRecorder gamepadRecorder = {0};
 
-Memory* memory;
-w4_Disk* disk;
-static bool firstFrame;
+W4_THREAD_LOCAL Memory* w4_memory;
+W4_THREAD_LOCAL w4_Disk* w4_disk;
+static W4_THREAD_LOCAL bool firstFrame;
 
 static void panic(const char *msg)
 {
@@ -60,17 +66,18 @@ static uint32_t mul_u32_with_overflow_check(uint32_t a, uint32_t b)
 
 static void bounds_check(const void *sp, size_t sz)
 {
-    const void *memory_sp = (const void *)memory;
+    const void *memory_sp = (const void *)w4_memory;
     const void *memory_ep = (const uint8_t *)memory_sp + (1 << 16);
     const void *ep = (const uint8_t *)sp + sz;
     if (ep < sp || sp < memory_sp || memory_ep < ep) {
         out_of_bounds_access();
     }
+    w4_memProfileHostAccess(sp, sz);
 }
 
 static void bounds_check_cstr(const void* p)
 {
-    const uint8_t* memory_sp = (uint8_t*)memory;
+    const uint8_t* memory_sp = (uint8_t*)w4_memory;
     const uint8_t* memory_ep = memory_sp + (1 << 16);
     const uint8_t* ptr_p = (const uint8_t*)p;
     if (ptr_p < memory_sp || memory_ep <= ptr_p) {
@@ -81,66 +88,99 @@ static void bounds_check_cstr(const void* p)
             out_of_bounds_access();
         }
         if (*ptr == 0) {
+            w4_memProfileHostAccess(ptr_p, ptr - ptr_p + 1);
             break;
         }
     }
 }
 
 void w4_runtimeInit (uint8_t* memoryBytes, w4_Disk* diskBytes) {
-    memory = (Memory*)memoryBytes;
-    disk = diskBytes;
+    w4_memory = (Memory*)memoryBytes;
+    w4_disk = diskBytes;
     firstFrame = true;
 
     // Set memory to initial state
-    memset(memory, 0, 1 << 16);
-    w4_write32LE(&memory->palette[0], 0xe0f8cf);
-    w4_write32LE(&memory->palette[1], 0x86c06c);
-    w4_write32LE(&memory->palette[2], 0x306850);
-    w4_write32LE(&memory->palette[3], 0x071821);
-    memory->drawColors[0] = 0x03;
-    memory->drawColors[1] = 0x12;
-    w4_write16LE(&memory->mouseX, 0x7fff);
-    w4_write16LE(&memory->mouseY, 0x7fff);
+    memset(w4_memory, 0, 1 << 16);
+    w4_write32LE(&w4_memory->palette[0], 0xe0f8cf);
+    w4_write32LE(&w4_memory->palette[1], 0x86c06c);
+    w4_write32LE(&w4_memory->palette[2], 0x306850);
+    w4_write32LE(&w4_memory->palette[3], 0x071821);
+    w4_memory->drawColors[0] = 0x03;
+    w4_memory->drawColors[1] = 0x12;
+    w4_write16LE(&w4_memory->mouseX, 0x7fff);
+    w4_write16LE(&w4_memory->mouseY, 0x7fff);
 
     // Initialize gamepad recorder
 
 
     w4_apuInit();
-    w4_framebufferInit(memory->drawColors, memory->framebuffer);
+    w4_framebufferInit(w4_memory->drawColors, w4_memory->framebuffer);
 }
 
 void w4_runtimeReset (void) {
-    if (memory == NULL) {
+    if (w4_memory == NULL) {
         return; // Runtime not initialized
     }
     
     // Reset memory to initial state (but don't re-initialize WASM)
     // memset(memory, 0, sizeof(Memory));
-    w4_write32LE(&memory->palette[0], 0xe0f8cf);
-    w4_write32LE(&memory->palette[1], 0x86c06c);
-    w4_write32LE(&memory->palette[2], 0x306850);
-    w4_write32LE(&memory->palette[3], 0x071821);
-    memory->drawColors[0] = 0x03;
-    memory->drawColors[1] = 0x12;
-    w4_write16LE(&memory->mouseX, 0x7fff);
-    w4_write16LE(&memory->mouseY, 0x7fff);
+    w4_write32LE(&w4_memory->palette[0], 0xe0f8cf);
+    w4_write32LE(&w4_memory->palette[1], 0x86c06c);
+    w4_write32LE(&w4_memory->palette[2], 0x306850);
+    w4_write32LE(&w4_memory->palette[3], 0x071821);
+    w4_memory->drawColors[0] = 0x03;
+    w4_memory->drawColors[1] = 0x12;
+    w4_write16LE(&w4_memory->mouseX, 0x7fff);
+    w4_write16LE(&w4_memory->mouseY, 0x7fff);
     
     // Reset frame counter
     firstFrame = true;
     
     // Re-initialize audio and framebuffer
     w4_apuInit();
-    w4_framebufferInit(memory->drawColors, memory->framebuffer);
+    w4_framebufferInit(w4_memory->drawColors, w4_memory->framebuffer);
+}
+
+void w4_runtimeSkipStart (void) {
+    firstFrame = false;
+}
+
+void w4_runtimeSaveContext (w4_RuntimeContext* context) {
+    context->memory = w4_memory;
+    context->disk = w4_disk;
+    context->firstFrame = firstFrame;
+    context->apu = w4_apuGetState();
+    context->wasm = w4_wasmGetInstance();
+    context->trace = w4_traceGet();
+}
+
+void w4_runtimeLoadContext (const w4_RuntimeContext* context) {
+    w4_memory = context->memory;
+    w4_disk = context->disk;
+    firstFrame = context->firstFrame;
+    w4_apuBindState(context->apu);
+    w4_wasmSetInstance(context->wasm);
+    w4_traceBind(context->trace);
+    if (w4_memory != NULL) {
+        w4_framebufferInit(w4_memory->drawColors, w4_memory->framebuffer);
+    } else {
+        w4_framebufferInit(NULL, NULL);
+    }
+}
+
+void w4_runtimeUnloadContext () {
+    static const w4_RuntimeContext empty;
+    w4_runtimeLoadContext(&empty);
 }
 
 void w4_runtimeSetGamepad (int idx, uint8_t gamepad) {
-    memory->gamepads[idx] = gamepad;
+    w4_memory->gamepads[idx] = gamepad;
 }
 
 void w4_runtimeSetMouse (int16_t x, int16_t y, uint8_t buttons) {
-    w4_write16LE(&memory->mouseX, x);
-    w4_write16LE(&memory->mouseY, y);
-    memory->mouseButtons = buttons;
+    w4_write16LE(&w4_memory->mouseX, x);
+    w4_write16LE(&w4_memory->mouseY, y);
+    w4_memory->mouseButtons = buttons;
 }
 
 void w4_runtimeBlit (const uint8_t* sprite, int x, int y, int width, int height, int flags) {
@@ -159,188 +199,368 @@ void w4_runtimeBlitSub (const uint8_t* sprite, int x, int y, int width, int heig
     uint32_t bpp = (int)bpp2 + 1;
     uint32_t nbits = mul_u32_with_overflow_check(mul_u32_with_overflow_check(width, height), bpp);
     bounds_check(sprite, nbits / 8);
+    w4_captureBlit(sprite, x, y, width, height, srcX, srcY, stride, flags);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferBlit(sprite, x, y, width, height, srcX, srcY, stride, bpp2, flipX, flipY, rotate);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeLine (int x1, int y1, int x2, int y2) {
     // printf("line: %d, %d, %d, %d\n", x1, y1, x2, y2);
+    w4_captureDraw(W4_CAPTURE_LINE, x1, y1, x2, y2);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferLine(x1, y1, x2, y2);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeHLine (int x, int y, int len) {
     // printf("hline: %d, %d, %d\n", x, y, len);
+    w4_captureDraw(W4_CAPTURE_HLINE, x, y, len, 0);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferHLine(x, y, len);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeVLine (int x, int y, int len) {
     // printf("vline: %d, %d, %d\n", x, y, len);
+    w4_captureDraw(W4_CAPTURE_VLINE, x, y, len, 0);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferVLine(x, y, len);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeOval (int x, int y, int width, int height) {
     // printf("oval: %d, %d, %d, %d\n", x, y, width, height);
+    w4_captureDraw(W4_CAPTURE_OVAL, x, y, width, height);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferOval(x, y, width, height);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeRect (int x, int y, int width, int height) {
     // printf("rect: %d, %d, %d, %d\n", x, y, width, height);
+    w4_captureDraw(W4_CAPTURE_RECT, x, y, width, height);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferRect(x, y, width, height);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeText (const uint8_t* str, int x, int y) {
     bounds_check_cstr(str);
     // printf("text: %s, %d, %d\n", str, x, y);
+    w4_captureText(W4_CAPTURE_TEXT, str, strlen((const char*)str) + 1, x, y);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferText(str, x, y);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeTextUtf8 (const uint8_t* str, int byteLength, int x, int y) {
     bounds_check(str, byteLength);
     // printf("textUtf8: %p, %d, %d, %d\n", str, byteLength, x, y);
+    w4_captureText(W4_CAPTURE_TEXT_UTF8, str, byteLength, x, y);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferTextUtf8(str, byteLength, x, y);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeTextUtf16 (const uint16_t* str, int byteLength, int x, int y) {
     bounds_check(str, byteLength);
     // printf("textUtf16: %p, %d, %d, %d\n", str, byteLength, x, y);
+    w4_captureText(W4_CAPTURE_TEXT_UTF16, str, byteLength, x, y);
+    w4_timelineBegin(W4_TIMELINE_DRAW);
     w4_framebufferTextUtf16(str, byteLength, x, y);
+    w4_timelineEnd(W4_TIMELINE_DRAW);
 }
 
 void w4_runtimeTone (int frequency, int duration, int volume, int flags) {
     // printf("tone: %d, %d, %d, %d\n", frequency, duration, volume, flags);
+    w4_timelineBegin(W4_TIMELINE_SOUND);
     w4_apuTone(frequency, duration, volume, flags);
+    w4_timelineEnd(W4_TIMELINE_SOUND);
 }
 
 int w4_runtimeDiskr (uint8_t* dest, int size) {
     bounds_check(dest, size);
-    if (!disk) {
+    if (!w4_disk) {
         return 0;
     }
 
-    if (size > disk->size) {
-        size = disk->size;
+    w4_timelineBegin(W4_TIMELINE_DISK);
+    if (size > w4_disk->size) {
+        size = w4_disk->size;
     }
-    memcpy(dest, disk->data, size);
+    memcpy(dest, w4_disk->data, size);
+    w4_timelineEnd(W4_TIMELINE_DISK);
     return size;
 }
 
 int w4_runtimeDiskw (const uint8_t* src, int size) {
     bounds_check(src, size);
-    if (!disk) {
+    if (!w4_disk) {
         return 0;
     }
 
+    w4_timelineBegin(W4_TIMELINE_DISK);
     if (size > 1024) {
         size = 1024;
     }
-    disk->size = size;
-    memcpy(disk->data, src, size);
+    w4_disk->size = size;
+    memcpy(w4_disk->data, src, size);
+    w4_timelineEnd(W4_TIMELINE_DISK);
     return size;
 }
 
-void w4_runtimeTrace (const uint8_t* str) {
+// A trace being formatted, truncated at W4_TRACE_MAX_LENGTH
+typedef struct {
+    char text[W4_TRACE_MAX_LENGTH];
+    size_t length;
+} TraceText;
+
+static void traceAppend (TraceText* trace, const char* src, size_t length) {
+    size_t available = sizeof(trace->text) - trace->length;
+    if (length > available) {
+        length = available;
+    }
+    memcpy(trace->text + trace->length, src, length);
+    trace->length += length;
+}
+
+static void traceAppendf (TraceText* trace, const char* format, ...) {
+    char buffer[64];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > 0) {
+        traceAppend(trace, buffer, length < (int)sizeof(buffer) ? length : (int)sizeof(buffer) - 1);
+    }
+}
+
+static void traceAppendCodepoint (TraceText* trace, uint32_t codepoint) {
+    char utf8[4];
+    if (codepoint < 0x80) {
+        utf8[0] = codepoint;
+        traceAppend(trace, utf8, 1);
+    } else if (codepoint < 0x800) {
+        utf8[0] = 0xc0 | (codepoint >> 6);
+        utf8[1] = 0x80 | (codepoint & 0x3f);
+        traceAppend(trace, utf8, 2);
+    } else if (codepoint < 0x10000) {
+        utf8[0] = 0xe0 | (codepoint >> 12);
+        utf8[1] = 0x80 | ((codepoint >> 6) & 0x3f);
+        utf8[2] = 0x80 | (codepoint & 0x3f);
+        traceAppend(trace, utf8, 3);
+    } else {
+        utf8[0] = 0xf0 | (codepoint >> 18);
+        utf8[1] = 0x80 | ((codepoint >> 12) & 0x3f);
+        utf8[2] = 0x80 | ((codepoint >> 6) & 0x3f);
+        utf8[3] = 0x80 | (codepoint & 0x3f);
+        traceAppend(trace, utf8, 4);
+    }
+}
+
+static void traceCstr (const uint8_t* str) {
     bounds_check_cstr(str);
-    puts(str);
+    if (w4_traceEnabled()) {
+        w4_traceWrite((const char*)str, strlen((const char*)str));
+    }
 }
 
-void w4_runtimeTraceUtf8 (const uint8_t* str, int byteLength) {
+static void traceUtf8 (const uint8_t* str, int byteLength) {
     bounds_check(str, byteLength);
-    printf("%.*s\n", byteLength, str);
+    w4_traceWrite((const char*)str, byteLength);
 }
 
-void w4_runtimeTraceUtf16 (const uint16_t* str, int byteLength) {
+static void traceUtf16 (const uint16_t* str, int byteLength) {
     bounds_check(str, byteLength);
-    printf("TODO: traceUtf16: %p, %d\n", str, byteLength);
+    if (!w4_traceEnabled()) {
+        return;
+    }
+
+    TraceText trace;
+    trace.length = 0;
+    int length = byteLength >> 1;
+    for (int ii = 0; ii < length && trace.length < sizeof(trace.text); ++ii) {
+        uint32_t unit = w4_read16LE(&str[ii]);
+        if (unit >= 0xd800 && unit < 0xdc00 && ii + 1 < length) {
+            uint32_t low = w4_read16LE(&str[ii + 1]);
+            if (low >= 0xdc00 && low < 0xe000) {
+                ++ii;
+                traceAppendCodepoint(&trace, 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00));
+                continue;
+            }
+        }
+        // Unpaired surrogates become the replacement character
+        traceAppendCodepoint(&trace, (unit >= 0xd800 && unit < 0xe000) ? 0xfffd : unit);
+    }
+    w4_traceWrite(trace.text, trace.length);
 }
 
-void w4_runtimeTracef (const uint8_t* str, const void* stack) {
+static void tracef (const uint8_t* str, const void* stack) {
     const uint8_t* argPtr = stack;
     uint32_t strPtr;
     bounds_check_cstr(str);
+
+    // The arguments are bounds checked even when tracing is off, only the formatting is skipped
+    bool enabled = w4_traceEnabled();
+
+    TraceText trace;
+    trace.length = 0;
     for (; *str != 0; ++str) {
         if (*str == '%') {
             const uint8_t sym = *(++str);
             switch (sym) {
             case 0:
-                return; // Interrupted
+                // Interrupted
+                if (enabled) {
+                    w4_traceWrite(trace.text, trace.length);
+                }
+                return;
             case '%':
-                putc('%', stdout);
+                if (enabled) {
+                    traceAppend(&trace, "%", 1);
+                }
                 break;
             case 'c':
                 bounds_check(argPtr, 4);
-                putc((char)w4_read32LE(argPtr), stdout);
+                if (enabled) {
+                    traceAppendf(&trace, "%c", (char)w4_read32LE(argPtr));
+                }
                 argPtr += 4;
                 break;
             case 'd':
                 bounds_check(argPtr, 4);
-                printf("%" PRId32, w4_read32LE(argPtr));
+                if (enabled) {
+                    traceAppendf(&trace, "%" PRId32, w4_read32LE(argPtr));
+                }
                 argPtr += 4;
                 break;
             case 'x':
                 bounds_check(argPtr, 4);
-                printf("%" PRIx32, w4_read32LE(argPtr));
+                if (enabled) {
+                    traceAppendf(&trace, "%" PRIx32, w4_read32LE(argPtr));
+                }
                 argPtr += 4;
                 break;
             case 's':
                 bounds_check(argPtr, 4);
                 strPtr = w4_read32LE(argPtr);
                 argPtr += 4;
-                const char *strPtr_host = (const char *)memory + strPtr;
+                const char *strPtr_host = (const char *)w4_memory + strPtr;
                 bounds_check_cstr(strPtr_host);
-                printf("%s", strPtr_host);
+                if (enabled) {
+                    traceAppend(&trace, strPtr_host, strlen(strPtr_host));
+                }
                 break;
             case 'f':
                 bounds_check(argPtr, 8);
-                printf("%lg", w4_readf64LE(argPtr));
+                if (enabled) {
+                    traceAppendf(&trace, "%lg", w4_readf64LE(argPtr));
+                }
                 argPtr += 8;
                 break;
             default:
-                printf("%%%c", sym);
+                if (enabled) {
+                    traceAppendf(&trace, "%%%c", sym);
+                }
             }
-        } else {
-            putc(*str, stdout);
+        } else if (enabled) {
+            traceAppend(&trace, (const char*)str, 1);
         }
     }
-    putc('\n', stdout);
+    if (enabled) {
+        w4_traceWrite(trace.text, trace.length);
+    }
+}
+
+void w4_runtimeTrace (const uint8_t* str) {
+    w4_timelineBegin(W4_TIMELINE_TRACE);
+    traceCstr(str);
+    w4_timelineEnd(W4_TIMELINE_TRACE);
+}
+
+void w4_runtimeTraceUtf8 (const uint8_t* str, int byteLength) {
+    w4_timelineBegin(W4_TIMELINE_TRACE);
+    traceUtf8(str, byteLength);
+    w4_timelineEnd(W4_TIMELINE_TRACE);
+}
+
+void w4_runtimeTraceUtf16 (const uint16_t* str, int byteLength) {
+    w4_timelineBegin(W4_TIMELINE_TRACE);
+    traceUtf16(str, byteLength);
+    w4_timelineEnd(W4_TIMELINE_TRACE);
+}
+
+void w4_runtimeTracef (const uint8_t* str, const void* stack) {
+    w4_timelineBegin(W4_TIMELINE_TRACE);
+    tracef(str, stack);
+    w4_timelineEnd(W4_TIMELINE_TRACE);
 }
 
 bool w4_runtimeUpdate () {
+    w4_memProfileBeginFrame();
     if (firstFrame) {
         firstFrame = false;
+        w4_captureFrame(false);
+        w4_timelineBegin(W4_TIMELINE_START);
         w4_wasmCallStart();
-    } else if (!(memory->systemFlags & SYSTEM_PRESERVE_FRAMEBUFFER)) {
-        w4_framebufferClear();
+        w4_timelineEnd(W4_TIMELINE_START);
+    } else {
+        bool cleared = !(w4_memory->systemFlags & SYSTEM_PRESERVE_FRAMEBUFFER);
+        if (cleared) {
+            w4_timelineBegin(W4_TIMELINE_CLEAR);
+            w4_framebufferClear();
+            w4_timelineEnd(W4_TIMELINE_CLEAR);
+        }
+        w4_captureFrame(cleared);
     }
-    if (!w4_wasmCallUpdate()) {
+    w4_timelineBegin(W4_TIMELINE_UPDATE);
+    bool running = w4_wasmCallUpdate();
+    w4_timelineEnd(W4_TIMELINE_UPDATE);
+    w4_captureFrameEnd();
+    w4_memProfileEndFrame();
+    w4_traceEndFrame();
+    if (!running) {
         return false;
     }
     w4_apuTick();
     uint32_t palette[4] = {
-        w4_read32LE(&memory->palette[0]),
-        w4_read32LE(&memory->palette[1]),
-        w4_read32LE(&memory->palette[2]),
-        w4_read32LE(&memory->palette[3]),
+        w4_read32LE(&w4_memory->palette[0]),
+        w4_read32LE(&w4_memory->palette[1]),
+        w4_read32LE(&w4_memory->palette[2]),
+        w4_read32LE(&w4_memory->palette[3]),
     };
-    w4_windowComposite(palette, memory->framebuffer);
+    w4_timelineBegin(W4_TIMELINE_COMPOSITE);
+    w4_windowComposite(palette, w4_memory->framebuffer);
+    w4_timelineEnd(W4_TIMELINE_COMPOSITE);
 
     return true;
 }
 
 int w4_runtimeSerializeSize () {
-    return sizeof(SerializedState);
+    return sizeof(SerializedState) + w4_apuStateSize() + w4_wasmGlobalsSize();
 }
 
 void w4_runtimeSerialize (void* dest) {
     SerializedState* state = dest;
-    memcpy(&state->memory, memory, 1 << 16);
-    memcpy(&state->disk, disk, sizeof(w4_Disk));
+    memcpy(&state->memory, w4_memory, 1 << 16);
+    memcpy(&state->disk, w4_disk, sizeof(w4_Disk));
     state->firstFrame = firstFrame;
+
+    uint8_t* apuState = (uint8_t*)dest + sizeof(SerializedState);
+    memcpy(apuState, w4_apuGetState(), w4_apuStateSize());
+    w4_wasmSaveGlobals(apuState + w4_apuStateSize());
 }
 
 void w4_runtimeUnserialize (const void* src) {
     const SerializedState* state = src;
-    memcpy(memory, &state->memory, 1 << 16);
-    memcpy(disk, &state->disk, sizeof(w4_Disk));
+    memcpy(w4_memory, &state->memory, 1 << 16);
+    memcpy(w4_disk, &state->disk, sizeof(w4_Disk));
     firstFrame = state->firstFrame;
+
+    const uint8_t* apuState = (const uint8_t*)src + sizeof(SerializedState);
+    memcpy(w4_apuGetState(), apuState, w4_apuStateSize());
+    w4_wasmLoadGlobals(apuState + w4_apuStateSize());
 }
 
 // Gamepad recording function implementations
@@ -585,7 +805,7 @@ void w4_gamepadRecorderExportToJSONFile(const w4_GamepadRecorder* recorder, cons
     fprintf(file, "{\n");
     fprintf(file, "  \"persistent\": {\n");
 
-    uint8_t* persistent_base = ((uint8_t*)memory) + 0xa0;
+    uint8_t* persistent_base = ((uint8_t*)w4_memory) + 0xa0;
     fprintf(file, "    \"game_mode\": %u,\n", w4_read32LE(persistent_base + 0));
     fprintf(file, "    \"max_frames\": %u,\n", w4_read32LE(persistent_base + 4));
     fprintf(file, "    \"game_seed\": %u,\n", w4_read32LE(persistent_base + 8));
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "util.h"
+
 #define W4_BUTTON_X 1
 #define W4_BUTTON_Z 2
 // #define W4_BUTTON_RESERVED 4
@@ -72,6 +74,10 @@ typedef struct {
 void w4_runtimeInit (uint8_t* memory, w4_Disk* disk);
 void w4_runtimeReset (void);
 
+// Carries on with the memory as it is instead of calling the cart's start() on the next update,
+// for hot swapping a cart under a running game
+void w4_runtimeSkipStart (void);
+
 void w4_runtimeSetGamepad (int idx, uint8_t gamepad);
 void w4_runtimeSetMouse (int16_t x, int16_t y, uint8_t buttons);
 
@@ -134,7 +140,25 @@ typedef struct {
 } Memory;
 #pragma pack()
 
+// Everything a console instance keeps outside of its memory. The runtime, APU, framebuffer and wasm
+// state are bound per thread, so several instances can be stepped on different threads. Save the
+// context after creating an instance with w4_wasmInit(), w4_runtimeInit() and w4_wasmLoadModule(),
+// and load it on whichever thread steps the instance next. Unload it before freeing the instance, so
+// the thread isn't left pointing at freed memory.
+typedef struct {
+    Memory* memory;
+    w4_Disk* disk;
+    bool firstFrame;
+    void* apu;
+    void* wasm;
+    struct w4_Trace* trace;
+} w4_RuntimeContext;
+
+void w4_runtimeSaveContext (w4_RuntimeContext* context);
+void w4_runtimeLoadContext (const w4_RuntimeContext* context);
+void w4_runtimeUnloadContext ();
+
 // Global variable declarations
 extern w4_GamepadRecorder gamepadRecorder;
-extern Memory* memory;
-extern w4_Disk* disk;
+extern W4_THREAD_LOCAL Memory* w4_memory;
+extern W4_THREAD_LOCAL w4_Disk* w4_disk;
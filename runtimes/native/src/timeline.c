@@ -0,0 +1,399 @@
+// For clock_gettime()
+#define _POSIX_C_SOURCE 200809L
+
+#include "timeline.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "util.h"
+
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#include <sched.h>
+#define W4_TIMELINE_THREAD
+#define LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#define LOAD_SEQ_CST(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define STORE_SEQ_CST(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST)
+#define ADD_RELAXED(ptr, value) __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED)
+#define ADD_SEQ_CST(ptr, value) __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST)
+#else
+#include <intrin.h>
+#include <windows.h>
+#define LOAD_ACQUIRE(ptr) (*(ptr))
+#define STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#define LOAD_SEQ_CST(ptr) _InterlockedOr((volatile long*)(ptr), 0)
+#define STORE_SEQ_CST(ptr, value) _InterlockedExchange((volatile long*)(ptr), value)
+#define ADD_RELAXED(ptr, value) _InterlockedExchangeAdd((volatile long*)(ptr), value)
+#define ADD_SEQ_CST(ptr, value) _InterlockedExchangeAdd((volatile long*)(ptr), value)
+#endif
+
+// Events per chunk of a thread's buffer. A thread moves on to its next chunk whenever one fills
+// up, and full chunks are written out to the file and handed back. Everything is allocated when the
+// timeline starts, a thread whose chunks are all waiting to be written drops its events instead.
+#define CHUNK_EVENTS 4096
+#define THREAD_CHUNKS 4
+
+// Threads after these aren't recorded
+#define MAX_THREADS 16
+
+// A recording thread never waits for the writer's lock, so a wakeup can lose the race with the
+// writer going back to sleep. The writer looks again after this long regardless.
+#define WRITER_TIMEOUT_NS 100000000
+
+// Longer thread names are cut short
+#define NAME_SIZE 32
+
+typedef struct {
+    uint64_t time;
+    uint8_t phase;
+    bool begin;
+} Event;
+
+typedef struct {
+    /** Events written so far, published by the owning thread after writing each one. */
+    uint32_t count;
+    Event events[CHUNK_EVENTS];
+} Chunk;
+
+// Only ever appended to by the thread that owns it. Chunks from readIndex up to writeIndex are full
+// and belong to whoever writes them out, the one at writeIndex is being filled.
+typedef struct {
+    uint32_t id;
+    char name[NAME_SIZE];
+
+    /** Counts chunks started by the owner and written out, wrapping around the chunks. */
+    uint32_t writeIndex;
+    uint32_t readIndex;
+
+    /** Events the owner had no room for. */
+    uint32_t dropped;
+
+    /** Phases begun and not yet ended in what was written out so far. */
+    uint32_t depth[W4_TIMELINE_PHASES];
+
+    Chunk chunks[THREAD_CHUNKS];
+} ThreadBuffer;
+
+static const char* const phaseNames[W4_TIMELINE_PHASES] = {
+    "input", "start", "update", "clear", "composite", "present", "sleep", "audio",
+    "draw", "sound", "disk", "trace",
+};
+
+/** The calling thread's buffer, if it claimed one in the timeline being recorded. NULL with a
+ * current threadBufferTimeline means there were none left. */
+static W4_THREAD_LOCAL ThreadBuffer* threadBuffer = NULL;
+static W4_THREAD_LOCAL uint32_t threadBufferTimeline = 0;
+
+/** Set by w4_timelineNameThread(), whether or not a timeline was recording yet. */
+static W4_THREAD_LOCAL char threadName[NAME_SIZE];
+
+/** MAX_THREADS buffers, claimed by threads in the order they record their first event. */
+static ThreadBuffer* threads = NULL;
+static uint32_t threadCount = 0;
+
+static uint32_t recording = 0;
+static FILE* output = NULL;
+static uint64_t startTime;
+
+/** Counts timelines started, so threads know to drop the buffer of an earlier one. */
+static uint32_t timelineCount = 0;
+
+/** Threads between checking that the timeline is recording and being done with their buffer.
+ * w4_timelineStop() waits for them before freeing the buffers. */
+static uint32_t activeThreads = 0;
+
+#ifdef W4_TIMELINE_THREAD
+// Writes out full chunks in the background, when a thread has filled one since it last looked
+static pthread_t writer;
+static pthread_mutex_t wakeupMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeupCond = PTHREAD_COND_INITIALIZER;
+static uint32_t writerPending = 0;
+static uint32_t writerStopping = 0;
+#endif
+
+static uint64_t nowNs () {
+    struct timespec spec;
+#if !defined(_MSC_VER)
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+#else
+    timespec_get(&spec, TIME_UTC);
+#endif
+    return (uint64_t)spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+// Returns NULL if every buffer was already claimed
+static ThreadBuffer* getThreadBuffer () {
+    if (threadBufferTimeline != timelineCount) {
+        uint32_t slot = ADD_RELAXED(&threadCount, 1);
+        threadBuffer = NULL;
+        if (slot < MAX_THREADS) {
+            threadBuffer = &threads[slot];
+            memcpy(threadBuffer->name, threadName, NAME_SIZE);
+        }
+        threadBufferTimeline = timelineCount;
+    }
+    return threadBuffer;
+}
+
+#ifdef W4_TIMELINE_THREAD
+static void wakeWriter () {
+    STORE_RELEASE(&writerPending, 1);
+    // If the lock is taken, the writer is awake or about to be
+    if (pthread_mutex_trylock(&wakeupMutex) == 0) {
+        pthread_cond_signal(&wakeupCond);
+        pthread_mutex_unlock(&wakeupMutex);
+    }
+}
+#endif
+
+// Returns false if the timeline isn't recording. Otherwise the buffers stay alive until
+// leaveTimeline().
+static bool enterTimeline () {
+    if (!LOAD_ACQUIRE(&recording)) {
+        return false;
+    }
+    ADD_SEQ_CST(&activeThreads, 1);
+    if (!LOAD_SEQ_CST(&recording)) {
+        // Stopped in the meantime
+        ADD_SEQ_CST(&activeThreads, -1);
+        return false;
+    }
+    return true;
+}
+
+static void leaveTimeline () {
+    ADD_SEQ_CST(&activeThreads, -1);
+}
+
+static void writeEvents (ThreadBuffer* buffer, const Chunk* chunk) {
+    // Phases still open when the timeline started end without a begin, and are left out
+    uint32_t count = LOAD_ACQUIRE(&chunk->count);
+    for (uint32_t ii = 0; ii < count; ++ii) {
+        const Event* event = &chunk->events[ii];
+        if (event->time < startTime) {
+            continue;
+        }
+        if (event->begin) {
+            ++buffer->depth[event->phase];
+        } else if (buffer->depth[event->phase] == 0) {
+            continue;
+        } else {
+            --buffer->depth[event->phase];
+        }
+        const char* category = event->phase >= W4_TIMELINE_DRAW ? "host"
+            : event->phase == W4_TIMELINE_AUDIO ? "audio" : "frame";
+        fprintf(output, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+            phaseNames[event->phase], category, event->begin ? 'B' : 'E',
+            (event->time - startTime) / 1000.0, buffer->id);
+    }
+}
+
+// Writes out the chunks the owning thread is done with and hands them back
+static void writeFullChunks (ThreadBuffer* buffer) {
+    uint32_t writeIndex = LOAD_ACQUIRE(&buffer->writeIndex);
+    for (uint32_t ii = buffer->readIndex; ii != writeIndex; ++ii) {
+        writeEvents(buffer, &buffer->chunks[ii % THREAD_CHUNKS]);
+        STORE_RELEASE(&buffer->readIndex, ii + 1);
+    }
+}
+
+static void writeJsonString (const char* text) {
+    fputc('"', output);
+    for (; *text != '\0'; ++text) {
+        unsigned char c = *text;
+        if (c == '"' || c == '\\') {
+            fprintf(output, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(output, "\\u%04x", c);
+        } else {
+            fputc(c, output);
+        }
+    }
+    fputc('"', output);
+}
+
+#ifdef W4_TIMELINE_THREAD
+static void* writerMain (void* userData) {
+    for (;;) {
+        pthread_mutex_lock(&wakeupMutex);
+        if (!LOAD_ACQUIRE(&writerPending) && !LOAD_ACQUIRE(&writerStopping)) {
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_nsec += WRITER_TIMEOUT_NS;
+            if (timeout.tv_nsec >= 1000000000) {
+                timeout.tv_sec += 1;
+                timeout.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&wakeupCond, &wakeupMutex, &timeout);
+        }
+        pthread_mutex_unlock(&wakeupMutex);
+        if (LOAD_ACQUIRE(&writerStopping)) {
+            return NULL;
+        }
+
+        // Cleared first, so a chunk filled while writing gets picked up next time
+        STORE_RELEASE(&writerPending, 0);
+        for (uint32_t ii = 0; ii < MAX_THREADS; ++ii) {
+            writeFullChunks(&threads[ii]);
+        }
+    }
+}
+#endif
+
+static void record (w4_TimelinePhase phase, bool begin) {
+    if (!enterTimeline()) {
+        return;
+    }
+    ThreadBuffer* buffer = getThreadBuffer();
+    if (buffer == NULL) {
+        leaveTimeline();
+        return;
+    }
+    uint32_t writeIndex = buffer->writeIndex;
+    Chunk* chunk = &buffer->chunks[writeIndex % THREAD_CHUNKS];
+    uint32_t count = chunk->count;
+    if (count == CHUNK_EVENTS) {
+        if (writeIndex + 1 - LOAD_ACQUIRE(&buffer->readIndex) == THREAD_CHUNKS) {
+            // Every other chunk is still waiting to be written out
+            ++buffer->dropped;
+            leaveTimeline();
+            return;
+        }
+        chunk = &buffer->chunks[(writeIndex + 1) % THREAD_CHUNKS];
+        chunk->count = 0;
+        count = 0;
+        STORE_RELEASE(&buffer->writeIndex, writeIndex + 1);
+#ifdef W4_TIMELINE_THREAD
+        wakeWriter();
+#else
+        // Without a background thread, the owner writes out its own chunks as they fill
+        writeFullChunks(buffer);
+#endif
+    }
+
+    Event* event = &chunk->events[count];
+    event->time = nowNs();
+    event->phase = phase;
+    event->begin = begin;
+    STORE_RELEASE(&chunk->count, count + 1);
+    leaveTimeline();
+}
+
+void w4_timelineBegin (w4_TimelinePhase phase) {
+    record(phase, true);
+}
+
+void w4_timelineEnd (w4_TimelinePhase phase) {
+    record(phase, false);
+}
+
+void w4_timelineNameThread (const char* name) {
+    strncpy(threadName, name, NAME_SIZE - 1);
+    if (!enterTimeline()) {
+        return;
+    }
+    // Names are only read once every thread has left the timeline, at stop
+    ThreadBuffer* buffer = getThreadBuffer();
+    if (buffer != NULL) {
+        memcpy(buffer->name, threadName, NAME_SIZE);
+    }
+    leaveTimeline();
+}
+
+bool w4_timelineStart (const char* path) {
+    if (output != NULL) {
+        return false;
+    }
+    output = fopen(path, "w");
+    if (output == NULL) {
+        return false;
+    }
+    fprintf(output, "{\"traceEvents\":[\n");
+    fprintf(output, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"WASM-4\"}}");
+
+    // Only the bookkeeping is cleared, the chunks are left for the kernel to fault in as they fill
+    threads = xmalloc(MAX_THREADS * sizeof(ThreadBuffer));
+    for (uint32_t ii = 0; ii < MAX_THREADS; ++ii) {
+        ThreadBuffer* buffer = &threads[ii];
+        buffer->id = ii + 1;
+        buffer->name[0] = '\0';
+        buffer->writeIndex = 0;
+        buffer->readIndex = 0;
+        buffer->dropped = 0;
+        memset(buffer->depth, 0, sizeof(buffer->depth));
+        buffer->chunks[0].count = 0;
+    }
+    threadCount = 0;
+
+    startTime = nowNs();
+    ++timelineCount;
+#ifdef W4_TIMELINE_THREAD
+    writerPending = 0;
+    writerStopping = 0;
+    if (pthread_create(&writer, NULL, writerMain, NULL) != 0) {
+        free(threads);
+        threads = NULL;
+        fclose(output);
+        output = NULL;
+        return false;
+    }
+#endif
+    STORE_SEQ_CST(&recording, 1);
+    return true;
+}
+
+void w4_timelineStop () {
+    if (output == NULL) {
+        return;
+    }
+    // Threads still recording finish the event they're on, anything after is dropped
+    STORE_SEQ_CST(&recording, 0);
+    while (LOAD_SEQ_CST(&activeThreads) != 0) {
+#ifdef W4_TIMELINE_THREAD
+        sched_yield();
+#else
+        SwitchToThread();
+#endif
+    }
+#ifdef W4_TIMELINE_THREAD
+    STORE_RELEASE(&writerStopping, 1);
+    pthread_mutex_lock(&wakeupMutex);
+    pthread_cond_signal(&wakeupCond);
+    pthread_mutex_unlock(&wakeupMutex);
+    pthread_join(writer, NULL);
+#endif
+
+    // Nothing else touches the buffers now, write out what's left and free them
+    uint32_t claimed = threadCount < MAX_THREADS ? threadCount : MAX_THREADS;
+    uint32_t dropped = 0;
+    for (uint32_t ii = 0; ii < claimed; ++ii) {
+        ThreadBuffer* buffer = &threads[ii];
+        writeFullChunks(buffer);
+        writeEvents(buffer, &buffer->chunks[buffer->writeIndex % THREAD_CHUNKS]);
+        if (buffer->name[0] != '\0') {
+            fprintf(output, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                buffer->id);
+            writeJsonString(buffer->name);
+            fprintf(output, "}}");
+        }
+        dropped += buffer->dropped;
+    }
+    free(threads);
+    threads = NULL;
+
+    if (dropped > 0) {
+        fprintf(stderr, "The timeline dropped %u events that it couldn't write out in time\n", dropped);
+    }
+    if (threadCount > MAX_THREADS) {
+        fprintf(stderr, "The timeline only recorded the first %d threads\n", MAX_THREADS);
+    }
+
+    fprintf(output, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(output);
+    output = NULL;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Timeline of where each frame's time goes, written as Chrome trace event JSON for
+// chrome://tracing or ui.perfetto.dev. Phases are recorded as begin and end events on the thread
+// they run on, so stalls on the audio thread line up against the frame thread's. Every thread
+// appends to a buffer of its own without taking locks or allocating.
+
+typedef enum {
+    W4_TIMELINE_INPUT,
+    W4_TIMELINE_START,
+    W4_TIMELINE_UPDATE,
+    W4_TIMELINE_CLEAR,
+    W4_TIMELINE_COMPOSITE,
+    W4_TIMELINE_PRESENT,
+    W4_TIMELINE_SLEEP,
+    W4_TIMELINE_AUDIO,
+
+    // Host calls made by the cart, by category
+    W4_TIMELINE_DRAW,
+    W4_TIMELINE_SOUND,
+    W4_TIMELINE_DISK,
+    W4_TIMELINE_TRACE,
+
+    W4_TIMELINE_PHASES,
+} w4_TimelinePhase;
+
+// Records until stopped, which writes the JSON. Returns false if the file can't be created.
+bool w4_timelineStart (const char* path);
+void w4_timelineStop ();
+
+// These do nothing unless a timeline is being recorded
+void w4_timelineBegin (w4_TimelinePhase phase);
+void w4_timelineEnd (w4_TimelinePhase phase);
+
+// Names the calling thread in timelines recorded from now on, otherwise it's numbered. Only
+// touches the thread's own state, so it can be called once when a thread starts.
+void w4_timelineNameThread (const char* name);
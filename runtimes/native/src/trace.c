@@ -0,0 +1,417 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#define W4_TRACE_THREAD
+#endif
+
+#include "util.h"
+
+// Must be a power of two
+#define RING_SIZE (32*1024)
+
+// frame (u32), length (u16)
+#define RECORD_HEADER_SIZE 6
+
+#ifdef W4_TRACE_THREAD
+#define LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#else
+#define LOAD_ACQUIRE(ptr) (*(ptr))
+#define STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#endif
+
+// A single producer, single consumer ring of trace records. The thread it's bound to writes, and
+// the background thread reads while holding the registry lock. Threads without a trace of their
+// own share the default one, and take turns writing to it under its lock.
+struct w4_Trace {
+    /** Unique for every trace created, so a thread can tell its trace apart from a new one that
+     * was allocated at the same address. */
+    uint32_t serial;
+
+    uint32_t instanceId;
+    w4_TraceMode mode;
+
+    /** Frame number stamped on new records. */
+    uint32_t frame;
+
+    /** What was traced this frame, for the rate limits. */
+    uint32_t frameRecords;
+    uint32_t frameBytes;
+
+    /** Records dropped this frame, reported at the end of the frame. */
+    uint32_t dropped;
+
+    /** Free running byte positions. */
+    uint32_t writePos;
+    uint32_t readPos;
+
+    w4_Trace* next;
+    uint8_t data[RING_SIZE];
+};
+
+static w4_Trace defaultTrace = { .instanceId = 0, .mode = W4_TRACE_BUFFERED };
+static W4_THREAD_LOCAL w4_Trace* current = &defaultTrace;
+static W4_THREAD_LOCAL uint32_t currentSerial = 0;
+
+/** All traces that are being written out, starting with the default one. */
+static w4_Trace* registry = &defaultTrace;
+static uint32_t nextSerial = 1;
+
+/** Bumped after each w4_traceDelete(), so that every thread rechecks that its trace still exists
+ * before using it again. */
+static uint32_t deleteCount = 0;
+static W4_THREAD_LOCAL uint32_t checkedDeleteCount = 0;
+
+/** Records taken out of the rings, written to stdout once the registry lock is released. */
+static char* drained = NULL;
+static size_t drainedLength = 0;
+static size_t drainedCapacity = 0;
+
+#ifdef W4_TRACE_THREAD
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t defaultMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t startOnce = PTHREAD_ONCE_INIT;
+
+// Held from draining the rings until what was drained is written out, so that creating and
+// deleting traces never waits on stdout, and output keeps its order between drains
+static pthread_mutex_t outputMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// The background thread sleeps until there's something to write out. Kept apart from the registry
+// lock so that waking it never waits on a write to stdout.
+static pthread_mutex_t wakeupMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeupCond = PTHREAD_COND_INITIALIZER;
+static bool wakeupPending = false;
+#endif
+
+static void lockRegistry () {
+#ifdef W4_TRACE_THREAD
+    pthread_mutex_lock(&registryMutex);
+#endif
+}
+
+static void unlockRegistry () {
+#ifdef W4_TRACE_THREAD
+    pthread_mutex_unlock(&registryMutex);
+#endif
+}
+
+static void lockOutput () {
+#ifdef W4_TRACE_THREAD
+    pthread_mutex_lock(&outputMutex);
+#endif
+}
+
+static void unlockOutput () {
+#ifdef W4_TRACE_THREAD
+    pthread_mutex_unlock(&outputMutex);
+#endif
+}
+
+// Only the default trace has more than one writer
+static void lockWriter (w4_Trace* trace) {
+#ifdef W4_TRACE_THREAD
+    if (trace == &defaultTrace) {
+        pthread_mutex_lock(&defaultMutex);
+    }
+#endif
+}
+
+static void unlockWriter (w4_Trace* trace) {
+#ifdef W4_TRACE_THREAD
+    if (trace == &defaultTrace) {
+        pthread_mutex_unlock(&defaultMutex);
+    }
+#endif
+}
+
+static void ringCopyIn (w4_Trace* trace, uint32_t pos, const void* src, size_t length) {
+    uint32_t offset = pos & (RING_SIZE - 1);
+    size_t first = RING_SIZE - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(trace->data + offset, src, first);
+    memcpy(trace->data, (const uint8_t*)src + first, length - first);
+}
+
+static void ringCopyOut (const w4_Trace* trace, uint32_t pos, void* dest, size_t length) {
+    uint32_t offset = pos & (RING_SIZE - 1);
+    size_t first = RING_SIZE - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(dest, trace->data + offset, first);
+    memcpy((uint8_t*)dest + first, trace->data, length - first);
+}
+
+static void wakeFlusher () {
+#ifdef W4_TRACE_THREAD
+    pthread_mutex_lock(&wakeupMutex);
+    if (!wakeupPending) {
+        wakeupPending = true;
+        pthread_cond_signal(&wakeupCond);
+    }
+    pthread_mutex_unlock(&wakeupMutex);
+#endif
+}
+
+static bool ringPush (w4_Trace* trace, const char* text, uint16_t length) {
+    uint32_t writePos = trace->writePos;
+    uint32_t used = writePos - LOAD_ACQUIRE(&trace->readPos);
+    if (RING_SIZE - used < RECORD_HEADER_SIZE + (uint32_t)length) {
+        return false;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    w4_write32LE(header, trace->frame);
+    w4_write16LE(header + 4, length);
+    ringCopyIn(trace, writePos, header, RECORD_HEADER_SIZE);
+    ringCopyIn(trace, writePos + RECORD_HEADER_SIZE, text, length);
+
+    // Publish the record
+    STORE_RELEASE(&trace->writePos, writePos + RECORD_HEADER_SIZE + length);
+
+    // Don't wait for the end of the frame once the buffer is half full
+    uint32_t added = RECORD_HEADER_SIZE + length;
+    if (used < RING_SIZE/2 && used + added >= RING_SIZE/2) {
+        wakeFlusher();
+    }
+    return true;
+}
+
+// Must hold the output lock
+static void appendDrained (const void* data, size_t length) {
+    if (drainedLength + length > drainedCapacity) {
+        drainedCapacity = 2 * (drainedLength + length);
+        drained = xrealloc(drained, drainedCapacity);
+    }
+    memcpy(drained + drainedLength, data, length);
+    drainedLength += length;
+}
+
+// Must hold the output lock, but not the registry lock
+static void writeDrained () {
+    fwrite(drained, 1, drainedLength, stdout);
+    fflush(stdout);
+    drainedLength = 0;
+}
+
+// Must hold the output and registry locks
+static void drain (w4_Trace* trace) {
+    uint32_t readPos = trace->readPos;
+    uint32_t writePos = LOAD_ACQUIRE(&trace->writePos);
+    char text[W4_TRACE_MAX_LENGTH];
+
+    while (readPos != writePos) {
+        uint8_t header[RECORD_HEADER_SIZE];
+        ringCopyOut(trace, readPos, header, RECORD_HEADER_SIZE);
+        uint32_t frame = w4_read32LE(header);
+        uint16_t length = w4_read16LE(header + 4);
+        ringCopyOut(trace, readPos + RECORD_HEADER_SIZE, text, length);
+        readPos += RECORD_HEADER_SIZE + length;
+
+        if (trace->mode == W4_TRACE_STRUCTURED) {
+            char prefix[32];
+            appendDrained(prefix, snprintf(prefix, sizeof(prefix), "[%u:%u] ", trace->instanceId, frame));
+        }
+        appendDrained(text, length);
+        appendDrained("\n", 1);
+    }
+
+    // Release the space back to the frame thread
+    STORE_RELEASE(&trace->readPos, readPos);
+}
+
+static void flushAll () {
+    lockOutput();
+    lockRegistry();
+    for (w4_Trace* trace = registry; trace != NULL; trace = trace->next) {
+        drain(trace);
+    }
+    unlockRegistry();
+    writeDrained();
+    unlockOutput();
+}
+
+#ifdef W4_TRACE_THREAD
+static void* flusherMain (void* userData) {
+    for (;;) {
+        pthread_mutex_lock(&wakeupMutex);
+        while (!wakeupPending) {
+            pthread_cond_wait(&wakeupCond, &wakeupMutex);
+        }
+        wakeupPending = false;
+        pthread_mutex_unlock(&wakeupMutex);
+
+        flushAll();
+    }
+    return NULL;
+}
+
+static void startFlusher () {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, flusherMain, NULL) == 0) {
+        pthread_detach(thread);
+    }
+    atexit(flushAll);
+}
+#endif
+
+static void ensureStarted () {
+#ifdef W4_TRACE_THREAD
+    pthread_once(&startOnce, startFlusher);
+#else
+    static bool started = false;
+    if (!started) {
+        started = true;
+        atexit(flushAll);
+    }
+#endif
+}
+
+w4_Trace* w4_traceNew (uint32_t instanceId, w4_TraceMode mode) {
+    ensureStarted();
+
+    w4_Trace* trace = xmalloc(sizeof(w4_Trace));
+    memset(trace, 0, offsetof(w4_Trace, data));
+    trace->instanceId = instanceId;
+    trace->mode = mode;
+
+    lockRegistry();
+    trace->serial = nextSerial++;
+    trace->next = registry->next;
+    registry->next = trace;
+    unlockRegistry();
+
+    return trace;
+}
+
+void w4_traceDelete (w4_Trace* trace) {
+    lockOutput();
+    lockRegistry();
+    drain(trace);
+    for (w4_Trace* prev = registry; prev != NULL; prev = prev->next) {
+        if (prev->next == trace) {
+            prev->next = trace->next;
+            break;
+        }
+    }
+    STORE_RELEASE(&deleteCount, deleteCount + 1);
+    unlockRegistry();
+    writeDrained();
+    unlockOutput();
+
+    if (current == trace) {
+        current = &defaultTrace;
+        currentSerial = 0;
+    }
+    free(trace);
+}
+
+// Returns the trace bound to the calling thread, falling back to the default one if it was deleted
+// since, possibly from another thread
+static w4_Trace* getCurrent () {
+    uint32_t deletes = LOAD_ACQUIRE(&deleteCount);
+    if (deletes != checkedDeleteCount) {
+        checkedDeleteCount = deletes;
+        if (current != &defaultTrace) {
+            bool found = false;
+            lockRegistry();
+            for (w4_Trace* trace = registry; trace != NULL; trace = trace->next) {
+                if (trace == current && trace->serial == currentSerial) {
+                    found = true;
+                    break;
+                }
+            }
+            unlockRegistry();
+            if (!found) {
+                current = &defaultTrace;
+                currentSerial = 0;
+            }
+        }
+    }
+    return current;
+}
+
+void w4_traceSetMode (w4_Trace* trace, w4_TraceMode mode) {
+    trace->mode = mode;
+}
+
+w4_Trace* w4_traceGet () {
+    return getCurrent();
+}
+
+void w4_traceBind (w4_Trace* trace) {
+    // Traces bound from here on are alive, until the next delete
+    checkedDeleteCount = LOAD_ACQUIRE(&deleteCount);
+    current = (trace != NULL) ? trace : &defaultTrace;
+    currentSerial = current->serial;
+}
+
+bool w4_traceEnabled () {
+    return getCurrent()->mode != W4_TRACE_DISABLED;
+}
+
+void w4_traceWrite (const char* text, size_t length) {
+    w4_Trace* trace = getCurrent();
+    if (trace->mode == W4_TRACE_DISABLED) {
+        return;
+    }
+    if (trace == &defaultTrace) {
+        ensureStarted();
+    }
+
+    if (length > W4_TRACE_MAX_LENGTH) {
+        length = W4_TRACE_MAX_LENGTH;
+    }
+    lockWriter(trace);
+    if (trace->frameRecords >= W4_TRACE_MAX_RECORDS_PER_FRAME
+            || trace->frameBytes + length > W4_TRACE_MAX_BYTES_PER_FRAME
+            || !ringPush(trace, text, length)) {
+        ++trace->dropped;
+    } else {
+        ++trace->frameRecords;
+        trace->frameBytes += length;
+    }
+    unlockWriter(trace);
+}
+
+void w4_traceEndFrame () {
+    w4_Trace* trace = getCurrent();
+    lockWriter(trace);
+    bool traced = trace->frameRecords > 0 || trace->dropped > 0;
+    if (trace->dropped > 0) {
+        // Reported past the limits, but only if the buffer has room
+        char text[64];
+        int length = snprintf(text, sizeof(text), "(%u traces dropped)", trace->dropped);
+        ringPush(trace, text, length);
+        trace->dropped = 0;
+    }
+    trace->frameRecords = 0;
+    trace->frameBytes = 0;
+    ++trace->frame;
+    unlockWriter(trace);
+
+    if (traced) {
+#ifdef W4_TRACE_THREAD
+        wakeFlusher();
+#else
+        // Without a background thread, write out at the end of the frame instead
+        lockOutput();
+        lockRegistry();
+        drain(trace);
+        unlockRegistry();
+        writeDrained();
+        unlockOutput();
+#endif
+    }
+}
+
+void w4_traceFlush () {
+    flushAll();
+}
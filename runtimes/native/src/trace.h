@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    /** Traces are dropped before being formatted, for verification and batch runs. */
+    W4_TRACE_DISABLED = 0,
+
+    /** Each trace is written to stdout as a line, from a background thread. */
+    W4_TRACE_BUFFERED = 1,
+
+    /** Like buffered, with each line prefixed by "[instance:frame] ". */
+    W4_TRACE_STRUCTURED = 2,
+} w4_TraceMode;
+
+// Traces longer than this are truncated
+#define W4_TRACE_MAX_LENGTH 1024
+
+// Per frame limits, traces past them are dropped and counted instead
+#define W4_TRACE_MAX_RECORDS_PER_FRAME 64
+#define W4_TRACE_MAX_BYTES_PER_FRAME 8192
+
+typedef struct w4_Trace w4_Trace;
+
+// Each console instance has its own trace buffer. Until one is bound, the calling thread uses a
+// shared default buffer with instance id 0, which threads write to under a lock.
+w4_Trace* w4_traceNew (uint32_t instanceId, w4_TraceMode mode);
+
+// Writes out everything still buffered before freeing. Threads that still have it bound go back
+// to the default buffer.
+void w4_traceDelete (w4_Trace* trace);
+
+void w4_traceSetMode (w4_Trace* trace, w4_TraceMode mode);
+
+w4_Trace* w4_traceGet ();
+void w4_traceBind (w4_Trace* trace);
+
+// These operate on the buffer bound to the calling thread
+bool w4_traceEnabled ();
+void w4_traceWrite (const char* text, size_t length);
+void w4_traceEndFrame ();
+
+// Blocks until every trace buffered so far has been written out
+void w4_traceFlush ();
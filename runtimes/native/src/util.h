@@ -3,6 +3,13 @@
 #include <stdint.h>
 #include <stddef.h>
 
+// Storage for state that is bound per thread, so several console instances can run side by side
+#if defined(_MSC_VER)
+#    define W4_THREAD_LOCAL __declspec(thread)
+#else
+#    define W4_THREAD_LOCAL __thread
+#endif
+
 // Safe versions of malloc and realloc that abort on failure, and never return null.
 void* xmalloc(size_t size);
 void* xrealloc(void* ptr, size_t size);
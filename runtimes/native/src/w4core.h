@@ -0,0 +1,125 @@
+#pragma once
+
+// Public interface of the w4core library: a WASM-4 console without any window or audio device.
+// Frontends, verifiers and bindings use this instead of the internal runtime headers.
+//
+// Every function takes the instance it operates on. An instance may be used from any thread, but
+// only from one thread at a time, audio pulls aside. Traps in the cart currently abort the process.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define W4_CORE_VERSION_MAJOR 1
+#define W4_CORE_VERSION_MINOR 4
+#define W4_CORE_VERSION ((W4_CORE_VERSION_MAJOR << 16) | W4_CORE_VERSION_MINOR)
+
+#if defined(_WIN32)
+#    if defined(W4_CORE_BUILD)
+#        define W4_CORE_API __declspec(dllexport)
+#    elif defined(W4_CORE_SHARED)
+#        define W4_CORE_API __declspec(dllimport)
+#    else
+#        define W4_CORE_API
+#    endif
+#else
+#    define W4_CORE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define W4_CORE_WIDTH 160
+#define W4_CORE_HEIGHT 160
+
+// Size of the packed 2bpp framebuffer, leftmost pixel in the lowest bits
+#define W4_CORE_FRAMEBUFFER_SIZE (W4_CORE_WIDTH*W4_CORE_HEIGHT >> 2)
+
+#define W4_CORE_SAMPLE_RATE 44100
+
+// Trace modes, see w4_coreSetTrace()
+#define W4_CORE_TRACE_DISABLED 0
+#define W4_CORE_TRACE_BUFFERED 1
+#define W4_CORE_TRACE_STRUCTURED 2
+
+typedef struct w4_Core w4_Core;
+
+typedef struct {
+    uint32_t game_mode;
+    uint32_t max_frames;
+    uint32_t game_seed;
+    uint32_t frames;
+    uint32_t score;
+    uint32_t health;
+} w4_CorePersistentData;
+
+// The version the library was built as, compare against W4_CORE_VERSION_MAJOR
+W4_CORE_API uint32_t w4_coreVersion (void);
+
+// Lifecycle. The disk contents may be NULL.
+W4_CORE_API w4_Core* w4_coreNew (const uint8_t* cart, size_t cartLength, const uint8_t* disk, size_t diskLength);
+W4_CORE_API void w4_coreDelete (w4_Core* core);
+
+// Non-zero makes instances created afterwards share the compiled code of other instances of the
+// same cart, so each one costs little more than its 64 KB of memory. Process wide, off by
+// default, and only supported by the wasm3 backend.
+W4_CORE_API void w4_coreShareCode (int enabled);
+
+// Huge page modes, see w4_corePoolReserve()
+#define W4_CORE_PAGES_DEFAULT 0
+#define W4_CORE_PAGES_TRANSPARENT_HUGE 1
+#define W4_CORE_PAGES_HUGE 2
+
+// Reserves address space for the memory, stacks and buffers of this many instances up front, and
+// recycles them as instances are deleted and created instead of going through malloc. Meant to
+// be called once at startup by tools that churn through instances. Process wide. Returns 0 if
+// nothing could be reserved, in which case instances are allocated as usual.
+W4_CORE_API int w4_corePoolReserve (uint32_t instances, int pages);
+
+// Runs one update, calling the cart's start() first if needed. Returns 0 once the cart's update
+// returned 0 to end the game.
+W4_CORE_API int w4_coreUpdate (w4_Core* core);
+
+// Where the cart's traces go. Buffered (the default) writes them to stdout from a background
+// thread, structured also prefixes them with "[instanceId:frame] ", and disabled drops them
+// without formatting. Traces are rate limited per update either way.
+W4_CORE_API void w4_coreSetTrace (w4_Core* core, int mode, uint32_t instanceId);
+
+// Input
+W4_CORE_API void w4_coreSetGamepad (w4_Core* core, int idx, uint8_t buttons);
+W4_CORE_API void w4_coreSetMouse (w4_Core* core, int16_t x, int16_t y, uint8_t buttons);
+
+// Persistent data. Set game_mode, max_frames and game_seed before the first update.
+W4_CORE_API void w4_coreGetPersistentData (w4_Core* core, w4_CorePersistentData* data);
+W4_CORE_API void w4_coreSetPersistentData (w4_Core* core, const w4_CorePersistentData* data);
+
+// Framebuffer
+W4_CORE_API const uint8_t* w4_coreFramebuffer (w4_Core* core);
+W4_CORE_API void w4_coreGetPalette (w4_Core* core, uint32_t palette[4]);
+
+// Converts the framebuffer to W4_CORE_WIDTH*W4_CORE_HEIGHT 0xRRGGBB pixels
+W4_CORE_API void w4_coreRenderRGB (w4_Core* core, uint32_t* pixels);
+
+// Audio pull, interleaved stereo at W4_CORE_SAMPLE_RATE. Unlike the other functions this may be
+// called from a thread of its own, one thread at most, while another thread updates the instance.
+// Audio is synthesized by w4_coreUpdate() once this has been called, and pulled through a short
+// ring, so it plays slightly behind the updates and is silent until they've caught up. Stop
+// pulling before w4_coreDelete().
+W4_CORE_API void w4_coreWriteSamples (w4_Core* core, int16_t* output, unsigned long frames);
+
+// Disk contents as last written by the cart
+W4_CORE_API const uint8_t* w4_coreDisk (w4_Core* core, size_t* length);
+
+// Save states, which are only valid for instances of the same cart and library version
+W4_CORE_API size_t w4_coreSerializeSize (w4_Core* core);
+W4_CORE_API void w4_coreSerialize (w4_Core* core, void* dest);
+W4_CORE_API void w4_coreUnserialize (w4_Core* core, const void* src);
+
+// Replays recorded gamepad events in the serialized recorder format (a little-endian u32 count,
+// then 8 bytes per event) from the current state, until the cart ends or maxFrames updates ran.
+// Returns the number of updates run, or -1 if the events are malformed.
+W4_CORE_API int w4_coreReplay (w4_Core* core, const uint8_t* events, size_t eventsLength, uint32_t maxFrames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,7 +6,22 @@
 uint8_t* w4_wasmInit ();
 void w4_wasmDestroy ();
 
+// When enabled, instances created afterwards compile a cart once for all instances of it in the
+// process, and only own their memory and globals. Returns the previous setting. Backends that
+// can't share code ignore it.
+bool w4_wasmSetShareCode (bool share);
+
 void w4_wasmLoadModule (const uint8_t* wasmBuffer, int byteLength);
 
 void w4_wasmCallStart ();
 bool w4_wasmCallUpdate ();
+
+// w4_wasmInit() creates a new instance and binds it to the calling thread. The other functions
+// operate on the instance bound to the calling thread.
+void* w4_wasmGetInstance ();
+void w4_wasmSetInstance (void* instance);
+
+// Mutable globals aren't part of the memory, so they are saved separately for save states
+int w4_wasmGlobalsSize ();
+void w4_wasmSaveGlobals (void* dest);
+void w4_wasmLoadGlobals (const void* src);
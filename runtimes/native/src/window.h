@@ -1,7 +1,22 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 void w4_windowBoot (const char* title);
 
 void w4_windowComposite (const uint32_t* palette, const uint8_t* framebuffer);
+
+// Game updates per second the window runs at
+int w4_windowUpdateRate ();
+
+// Implemented by the frontend, called by the window at the start of every frame, before any input
+// is set
+void w4_windowGameFrame ();
+
+// Implemented by the frontend, called by the window once the input is set, before every game
+// update. The update is skipped when it returns false.
+bool w4_windowGameInput ();
+
+// Implemented by the frontend, called by the window after every game update
+void w4_windowGameTick ();
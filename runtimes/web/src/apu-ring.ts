@@ -0,0 +1,81 @@
+// A lock-free single producer, single consumer ring of tone commands in a SharedArrayBuffer.
+// The main thread writes, and the APU worklet reads it at the start of every render quantum.
+// Shared with apu-worklet.ts, so this file must not import anything from the DOM side.
+
+// Must be a power of two
+const CAPACITY = 256;
+
+// tick, frequency, duration, volume, flags
+const RECORD_SIZE = 5;
+
+// Header slots. The indices are free running and wrap around as int32.
+const WRITE_INDEX = 0;
+const READ_INDEX = 1;
+const TICKS = 2;
+const HEADER_SIZE = 4;
+
+export type ToneCommandHandler = (tick: number, frequency: number, duration: number, volume: number, flags: number) => void;
+
+export class APUCommandRing {
+    private readonly header: Int32Array;
+    private readonly records: Int32Array;
+
+    constructor (readonly buffer: SharedArrayBuffer) {
+        this.header = new Int32Array(buffer, 0, HEADER_SIZE);
+        this.records = new Int32Array(buffer, 4*HEADER_SIZE, CAPACITY * RECORD_SIZE);
+    }
+
+    static create (): APUCommandRing {
+        return new APUCommandRing(new SharedArrayBuffer(4*(HEADER_SIZE + CAPACITY * RECORD_SIZE)));
+    }
+
+    /**
+     * Queues a tone issued during the given tick. Returns false if the ring is full, which only
+     * happens while the audio thread isn't running, in which case the tone wouldn't be heard anyway.
+     */
+    pushTone (tick: number, frequency: number, duration: number, volume: number, flags: number): boolean {
+        const header = this.header;
+        const writeIdx = header[WRITE_INDEX];
+        if (((writeIdx - Atomics.load(header, READ_INDEX)) | 0) >= CAPACITY) {
+            return false;
+        }
+
+        const records = this.records;
+        const offset = (writeIdx & (CAPACITY - 1)) * RECORD_SIZE;
+        records[offset] = tick;
+        records[offset + 1] = frequency;
+        records[offset + 2] = duration;
+        records[offset + 3] = volume;
+        records[offset + 4] = flags;
+
+        // Publish the record
+        Atomics.store(header, WRITE_INDEX, (writeIdx + 1) | 0);
+        return true;
+    }
+
+    /** Publishes the tick count, replacing the 'tick' message. */
+    setTicks (ticks: number) {
+        Atomics.store(this.header, TICKS, ticks);
+    }
+
+    getTicks (): number {
+        return Atomics.load(this.header, TICKS);
+    }
+
+    /** Consumes all queued tones in order. */
+    drain (handler: ToneCommandHandler) {
+        const header = this.header;
+        const records = this.records;
+        const writeIdx = Atomics.load(header, WRITE_INDEX);
+        let readIdx = header[READ_INDEX];
+
+        while (readIdx != writeIdx) {
+            const offset = (readIdx & (CAPACITY - 1)) * RECORD_SIZE;
+            handler(records[offset], records[offset + 1], records[offset + 2], records[offset + 3], records[offset + 4]);
+            readIdx = (readIdx + 1) | 0;
+        }
+
+        // Release the slots back to the producer
+        Atomics.store(header, READ_INDEX, readIdx);
+    }
+}
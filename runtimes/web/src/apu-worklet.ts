@@ -1,6 +1,8 @@
 "use strict";
 
 // Audio worklet file: do not export anything directly.
+import { APUCommandRing } from "./apu-ring";
+
 const SAMPLE_RATE = 44100;
 const MAX_VOLUME = 0.15;
 // The triangle channel sounds a bit quieter than the others, so give it higher amplitude
@@ -79,10 +81,14 @@ class APUProcessor extends AudioWorkletProcessor {
     time: number;
     ticks: number;
     channels: Channel[];
+    ring: APUCommandRing | null;
 
-    constructor () {
+    constructor (options?: AudioWorkletNodeOptions) {
         super();
 
+        const ringBuffer = options?.processorOptions?.ring;
+        this.ring = (ringBuffer != null) ? new APUCommandRing(ringBuffer) : null;
+
         this.time = 0;
         this.ticks = 0;
         this.channels = new Array(4);
@@ -136,6 +142,14 @@ class APUProcessor extends AudioWorkletProcessor {
         this.ticks++;
     }
 
+    applyToneCommand = (tick: number, frequency: number, duration: number, volume: number, flags: number) => {
+        // Ticks only move forward, tones re-sent after a rollback play at the current tick
+        if (tick > this.ticks) {
+            this.ticks = tick;
+        }
+        this.tone(frequency, duration, volume, flags);
+    }
+
     tone (frequency: number, duration: number, volume: number, flags: number) {
         const freq1 = frequency & 0xffff;
         const freq2 = (frequency >> 16) & 0xffff;
@@ -198,6 +212,15 @@ class APUProcessor extends AudioWorkletProcessor {
     }
 
     process (_inputs: Float32Array[][] | null, [[ outputLeft, outputRight ]]: Float32Array[][], _parameters: Record<string, Float32Array> | null) {
+        const ring = this.ring;
+        if (ring != null) {
+            ring.drain(this.applyToneCommand);
+            const ticks = ring.getTicks();
+            if (ticks > this.ticks) {
+                this.ticks = ticks;
+            }
+        }
+
         for (let ii = 0, frames = outputLeft.length; ii < frames; ++ii, ++this.time) {
             let mixLeft = 0, mixRight = 0;
 
@@ -1,6 +1,7 @@
 // Created using `npm run build:apu-worklet` and
 // is automatically generated in build and start scripts.
 import workletRawSource from "./apu-worklet.min.generated.js?raw";
+import { APUCommandRing } from "./apu-ring";
 
 declare global {
     interface Window {
@@ -8,11 +9,36 @@ declare global {
     }
 }
 
+// How many ticks of sent tones to remember for rollbacks, should cover netplay's HISTORY_LENGTH
+const SENT_TONES_TICKS = 64;
+
+/** A tone that was already sent to the audio thread. */
+interface SentTone {
+    tick: number;
+    frequency: number;
+    duration: number;
+    volume: number;
+    flags: number;
+
+    /** Whether the tone was issued again while re-simulating its tick after a rollback. */
+    reissued: boolean;
+}
+
 export class APU {
     audioCtx: AudioContext;
     processor!: APUProcessor;
     processorPort!: MessagePort;
 
+    /** Shared with the worklet when cross-origin isolated, otherwise commands go through processorPort. */
+    ring: APUCommandRing | null = null;
+
+    /** The current tick of the simulation, rewound by rollbacks. */
+    ticks = 0;
+
+    /** The furthest tick that was sent to the audio thread. Ticks before it are being re-simulated. */
+    private sentTicks = 0;
+    private sentTones: SentTone[] = [];
+
     constructor () {
         this.audioCtx = new (window.AudioContext || window.webkitAudioContext)({
             sampleRate: 44100, // must match SAMPLE_RATE in worklet
@@ -27,8 +53,14 @@ export class APU {
         try {
             await audioCtx.audioWorklet.addModule(url);
 
+            // SharedArrayBuffers can only be passed to the worklet when cross-origin isolated
+            if (typeof SharedArrayBuffer != "undefined" && self.crossOriginIsolated) {
+                this.ring = APUCommandRing.create();
+            }
+
             const workletNode = new AudioWorkletNode(audioCtx, "wasm4-apu", {
                 outputChannelCount: [2],
+                processorOptions: { ring: this.ring?.buffer },
             });
             this.processorPort = workletNode.port;
             workletNode.connect(audioCtx.destination);
@@ -56,15 +88,71 @@ export class APU {
     }
 
     tick() {
-        if (this.processorPort != null) {
+        const tick = this.ticks++;
+        if (tick < this.sentTicks) {
+            // The audio thread already heard this tick. Forget tones that were played for it before
+            // the rollback but weren't issued again with the corrected inputs, and silence their
+            // channel unless something else replaced them.
+            const sentTones = this.sentTones;
+            for (let ii = 0; ii < sentTones.length; ++ii) {
+                const sent = sentTones[ii];
+                if (sent.tick == tick && !sent.reissued) {
+                    sentTones.splice(ii--, 1);
+                    const channel = sent.flags & 0x3;
+                    if (!sentTones.some(other => other.tick == tick && (other.flags & 0x3) == channel)) {
+                        this.sendTone(tick, 0, 0, 0, channel);
+                    }
+                }
+            }
+            for (const sent of sentTones) {
+                if (sent.tick == tick) {
+                    sent.reissued = false;
+                }
+            }
+            return;
+        }
+        this.sentTicks = this.ticks;
+
+        const sentTones = this.sentTones;
+        while (sentTones.length > 0 && sentTones[0].tick < tick - SENT_TONES_TICKS) {
+            sentTones.shift();
+        }
+
+        if (this.ring != null) {
+            this.ring.setTicks(this.sentTicks);
+        } else if (this.processorPort != null) {
             this.processorPort.postMessage('tick');
         } else {
             this.processor.tick();
         }
     }
 
+    /** Rewinds to an earlier tick. Until the present is reached again, only new tones are played. */
+    rollback (ticks: number) {
+        this.ticks = ticks;
+    }
+
     tone (frequency: number, duration: number, volume: number, flags: number) {
-        if (this.processorPort != null) {
+        const tick = this.ticks;
+        if (tick < this.sentTicks) {
+            // Don't restart tones that were already played for this tick
+            for (const sent of this.sentTones) {
+                if (sent.tick == tick && !sent.reissued && sent.frequency == frequency
+                        && sent.duration == duration && sent.volume == volume && sent.flags == flags) {
+                    sent.reissued = true;
+                    return;
+                }
+            }
+        }
+
+        this.sentTones.push({ tick, frequency, duration, volume, flags, reissued: tick < this.sentTicks });
+        this.sendTone(tick, frequency, duration, volume, flags);
+    }
+
+    private sendTone (tick: number, frequency: number, duration: number, volume: number, flags: number) {
+        if (this.ring != null) {
+            this.ring.pushTone(tick, frequency, duration, volume, flags);
+        } else if (this.processorPort != null) {
             // Send params out to the worker
             this.processorPort.postMessage([frequency, duration, volume, flags]);
         } else {
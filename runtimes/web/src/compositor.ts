@@ -5,30 +5,22 @@ import type { Framebuffer } from "./framebuffer";
 
 const PALETTE_SIZE = 4;
 
+// The framebuffer is uploaded as is, one texel per byte of 4 packed pixels
+const TEXTURE_WIDTH = WIDTH >> 2;
+
 export class WebGLCompositor {
-    table: Uint32Array;
-    colorBuffer: Uint32Array;
     paletteBuffer: Float32Array;
     lastPalette: number[];
     paletteLocation: WebGLUniformLocation | null;
 
+    /** Copy of the framebuffer that was last uploaded, or null if the texture needs uploading. */
+    lastFramebuffer: Uint32Array | null;
+
     constructor (public gl: WebGLRenderingContext) {
-        this.colorBuffer = new Uint32Array(WIDTH * HEIGHT >> 2);
         this.paletteBuffer = new Float32Array(3 * PALETTE_SIZE);
         this.lastPalette = Array(PALETTE_SIZE);
         this.paletteLocation = null;
-
-        // Create a lookup table for each byte mapping to 4 bytes:
-        // 0bxxyyzzww --> 0bxx000000_yy000000_zz000000_ww000000
-        const table = new Uint32Array(256);
-        for (let ii = 0; ii < 256; ++ii) {
-            const xx = (ii >> 6) & 3;
-            const yy = (ii >> 4) & 3;
-            const zz = (ii >> 2) & 3;
-            const ww = ii & 3;
-            table[ii] = (xx << 30) | (yy << 22) | (zz << 14) | (ww << 6);
-        }
-        this.table = table;
+        this.lastFramebuffer = null;
 
         const canvas = gl.canvas;
         canvas.addEventListener("webglcontextlost", event => {
@@ -53,6 +45,7 @@ export class WebGLCompositor {
         const gl = this.gl;
 
         this.lastPalette = Array(PALETTE_SIZE);
+        this.lastFramebuffer = null;
 
         function createShader (type: number, source: string) {
             const shader = gl.createShader(type)!;
@@ -87,11 +80,16 @@ export class WebGLCompositor {
 
         const lookupBlock = Array.from({length: PALETTE_SIZE - 1},
                 (_, i) => {
-                    return `p = mix(p, palette[${i + 1}],  step(${((i + 1) / PALETTE_SIZE).toFixed(2)}, index));`
+                    return `p = mix(p, palette[${i + 1}],  step(${(i + 1).toFixed(1)}, index));`
                 }).join('\n');
 
+        // Each texel holds 4 pixels, with the leftmost pixel in the lowest 2 bits
         const fragmentShader = createShader(GL.FRAGMENT_SHADER, `
+            #ifdef GL_FRAGMENT_PRECISION_HIGH
+            precision highp float;
+            #else
             precision mediump float;
+            #endif
             uniform vec3 palette[${PALETTE_SIZE}];
             uniform sampler2D framebuffer;
             varying vec2 framebufferCoord;
@@ -103,7 +101,12 @@ export class WebGLCompositor {
             }
 
             void main () {
-                gl_FragColor = vec4(lookup(texture2D(framebuffer, framebufferCoord).r), 1.);
+                float x = floor(framebufferCoord.x * ${WIDTH}.0);
+                float texelX = floor(x / 4.0);
+                float packed = floor(texture2D(framebuffer, vec2((texelX + 0.5) / ${TEXTURE_WIDTH}.0, framebufferCoord.y)).r * 255.0 + 0.5);
+                float shift = exp2(2.0 * (x - 4.0 * texelX));
+                float index = mod(floor(packed / shift), 4.0);
+                gl_FragColor = vec4(lookup(index), 1.);
             }
         `);
 
@@ -130,7 +133,8 @@ export class WebGLCompositor {
 
         // Create framebuffer texture
         createTexture(GL.TEXTURE0);
-        gl.texImage2D(GL.TEXTURE_2D, 0, GL.LUMINANCE, WIDTH, HEIGHT, 0, GL.LUMINANCE, GL.UNSIGNED_BYTE, null);
+        // WebGL 1 has no R8, LUMINANCE is the single channel equivalent
+        gl.texImage2D(GL.TEXTURE_2D, 0, GL.LUMINANCE, TEXTURE_WIDTH, HEIGHT, 0, GL.LUMINANCE, GL.UNSIGNED_BYTE, null);
 
         // Setup static geometry
         const positionAttrib = gl.getAttribLocation(program, "pos");
@@ -148,9 +152,6 @@ export class WebGLCompositor {
     composite (palette: Uint32Array, framebuffer: Framebuffer) {
         const gl = this.gl;
         const
-            bytes = framebuffer.bytes,
-            colorBuffer = this.colorBuffer,
-            table = this.table,
             lastPalette = this.lastPalette,
             rgb = this.paletteBuffer;
 
@@ -173,15 +174,27 @@ export class WebGLCompositor {
             gl.uniform3fv(this.paletteLocation, this.paletteBuffer);
         }
 
-        // Unpack the framebuffer into one byte per pixel
-        for (let ii = 0; ii < WIDTH*HEIGHT >> 2; ++ii) {
-            colorBuffer[ii] = table[bytes[ii]];
+        // Upload the packed framebuffer, unless it's the same as last time
+        const words = framebuffer.words;
+        let lastFramebuffer = this.lastFramebuffer;
+        if (lastFramebuffer == null || !wordsEqual(words, lastFramebuffer)) {
+            if (lastFramebuffer == null) {
+                lastFramebuffer = this.lastFramebuffer = new Uint32Array(words.length);
+            }
+            lastFramebuffer.set(words);
+            gl.texSubImage2D(GL.TEXTURE_2D, 0, 0, 0, TEXTURE_WIDTH, HEIGHT, GL.LUMINANCE, GL.UNSIGNED_BYTE, framebuffer.bytes);
         }
 
-        // Upload framebuffer
-        gl.texImage2D(GL.TEXTURE_2D, 0, GL.LUMINANCE, WIDTH, HEIGHT, 0, GL.LUMINANCE, GL.UNSIGNED_BYTE, new Uint8Array(colorBuffer.buffer));
-
         // Draw the fullscreen quad
         gl.drawArrays(GL.TRIANGLES, 0, 6);
     }
 }
+
+function wordsEqual (a: Uint32Array, b: Uint32Array): boolean {
+    for (let ii = 0, len = a.length; ii < len; ++ii) {
+        if (a[ii] !== b[ii]) {
+            return false;
+        }
+    }
+    return true;
+}
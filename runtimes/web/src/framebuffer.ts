@@ -6,12 +6,62 @@ import {
     ADDR_DRAW_COLORS
 } from "./constants";
 
+// Lookup tables from a sprite byte to the pixels it draws, for the current draw colors.
+// Each entry packs the framebuffer bits in the low 16 bits and their mask in the high 16 bits.
+// Entries are filled lazily and invalidated by bumping the generation when the colors change.
+class ExpansionTable {
+    readonly entries = new Uint32Array(256);
+    readonly generations = new Uint32Array(256);
+    generation = 0;
+    drawColors = -1;
+
+    constructor (readonly bpp2: boolean) {}
+
+    setDrawColors (drawColors: number) {
+        if (drawColors !== this.drawColors) {
+            this.drawColors = drawColors;
+            ++this.generation;
+        }
+    }
+
+    get (byte: number): number {
+        if (this.generations[byte] === this.generation) {
+            return this.entries[byte];
+        }
+
+        // Sprite pixels are stored from the most significant bits, framebuffer pixels from the least
+        const drawColors = this.drawColors;
+        const pixels = this.bpp2 ? 4 : 8;
+        let bits = 0, mask = 0;
+        for (let ii = 0; ii < pixels; ++ii) {
+            const colorIdx = this.bpp2
+                ? (byte >>> (6 - (ii << 1))) & 0b11
+                : (byte >>> (7 - ii)) & 0b1;
+            const dc = (drawColors >>> (colorIdx << 2)) & 0x0f;
+            if (dc !== 0) {
+                bits |= ((dc - 1) & 0x03) << (ii << 1);
+                mask |= 0b11 << (ii << 1);
+            }
+        }
+
+        const entry = ((mask << 16) | bits) >>> 0;
+        this.entries[byte] = entry;
+        this.generations[byte] = this.generation;
+        return entry;
+    }
+}
+
 export class Framebuffer {
     drawColors: Uint16Array;
     bytes: Uint8Array;
+    words: Uint32Array;
+
+    private readonly expand1bpp = new ExpansionTable(false);
+    private readonly expand2bpp = new ExpansionTable(true);
 
     constructor (memory: ArrayBuffer) {
         this.bytes = new Uint8Array(memory, ADDR_FRAMEBUFFER, WIDTH * HEIGHT >>> 2);
+        this.words = new Uint32Array(memory, ADDR_FRAMEBUFFER, WIDTH * HEIGHT >>> 4);
         this.drawColors = new Uint16Array(memory, ADDR_DRAW_COLORS, 1);
     }
 
@@ -19,6 +69,16 @@ export class Framebuffer {
         this.bytes.fill(0);
     }
 
+    /** FNV-1a over the framebuffer words, used to compare frames between runs. */
+    hash (): number {
+        const words = this.words;
+        let hash = 0x811c9dc5;
+        for (let ii = 0, len = words.length; ii < len; ++ii) {
+            hash = Math.imul(hash ^ words[ii], 0x01000193);
+        }
+        return hash >>> 0;
+    }
+
     drawPoint (color: number, x: number, y: number) {
         const idx = (WIDTH * y + x) >>> 2;
         const shift = (x & 0x3) << 1;
@@ -33,24 +93,39 @@ export class Framebuffer {
     }
 
     drawHLineFast(color: number, startX: number, y: number, endX: number) {
-        const fillEnd = endX - (endX & 3);
-        const fillStart = Math.min((startX + 3) & ~3, fillEnd);
-
-        if (fillEnd - fillStart > 3) {
-            for (let xx = startX; xx < fillStart; xx++) {
-                this.drawPoint(color, xx, y);
-            }
-
-            const from = (WIDTH * y + fillStart) >>> 2;
-            const to = (WIDTH * y + fillEnd) >>> 2;
-            const fillColor = color * 0b01010101;
-
-            this.bytes.fill(fillColor, from, to);
-            startX = fillEnd;
+        const bytes = this.bytes;
+        const rowStart = WIDTH * y;
+        const fillColor = color * 0b01010101;
+
+        // Partial bytes at either end are masked in, whole bytes in between are filled. Rows start
+        // on a word boundary, so the middle of long spans is filled a word (16 pixels) at a time.
+        let from = (rowStart + startX + 3) >>> 2;
+        const to = (rowStart + endX) >>> 2;
+        if (from > to) {
+            // The span is within a single byte
+            this.fillPixels(fillColor, rowStart + startX, endX - startX);
+            return;
         }
+        this.fillPixels(fillColor, rowStart + startX, (from << 2) - rowStart - startX);
+        this.fillPixels(fillColor, to << 2, rowStart + endX - (to << 2));
+
+        const wordFrom = (from + 3) >>> 2;
+        const wordTo = to >>> 2;
+        if (wordTo > wordFrom) {
+            bytes.fill(fillColor, from, wordFrom << 2);
+            this.words.fill(fillColor * 0x01010101, wordFrom, wordTo);
+            from = wordTo << 2;
+        }
+        bytes.fill(fillColor, from, to);
+    }
 
-        for (let xx = startX; xx < endX; xx++) {
-            this.drawPoint(color, xx, y);
+    /** Sets up to 3 pixels within one byte, starting at the given pixel index. */
+    private fillPixels (fillColor: number, pixel: number, count: number) {
+        if (count > 0) {
+            const shift = (pixel & 0x3) << 1;
+            const mask = ((1 << (count << 1)) - 1) << shift;
+            const idx = pixel >>> 2;
+            this.bytes[idx] = (fillColor & mask) | (this.bytes[idx] & ~mask);
         }
     }
 
@@ -286,7 +361,11 @@ export class Framebuffer {
                 y += 8;
                 currentX = x;
             } else if (charCode >= 32 && charCode <= 255) {
-                this.blit(FONT, currentX, y, 8, 8, 0, (charCode - 32) << 3, 8);
+                if (currentX >= 0 && currentX <= WIDTH - 8 && y >= 0 && y <= HEIGHT - 8) {
+                    this.drawGlyph(charCode, currentX, y);
+                } else {
+                    this.blit(FONT, currentX, y, 8, 8, 0, (charCode - 32) << 3, 8);
+                }
                 currentX += 8;
             } else {
                 currentX += 8;
@@ -294,6 +373,82 @@ export class Framebuffer {
         }
     }
 
+    /** Draws a font character that is entirely on screen. */
+    private drawGlyph (charCode: number, x: number, y: number) {
+        const table = this.expand1bpp;
+        table.setDrawColors(this.drawColors[0]);
+
+        // Each 8 pixel glyph row is one font byte
+        const glyph = (charCode - 32) << 3;
+        for (let row = 0; row < 8; ++row) {
+            this.writeExpanded(table.get(FONT[glyph + row]), WIDTH * (y + row) + x);
+        }
+    }
+
+    /** Writes a lookup table entry to the framebuffer, starting at the given pixel index. */
+    private writeExpanded (entry: number, pixel: number) {
+        const bytes = this.bytes;
+        const shift = (pixel & 0x3) << 1;
+        let bits = (entry & 0xffff) << shift;
+        let mask = (entry >>> 16) << shift;
+
+        // 8 pixels at any alignment cover at most 3 bytes
+        for (let idx = pixel >>> 2; mask !== 0; ++idx) {
+            const byteMask = mask & 0xff;
+            if (byteMask !== 0) {
+                bytes[idx] = (bits & byteMask) | (bytes[idx] & ~byteMask);
+            }
+            bits >>>= 8;
+            mask >>>= 8;
+        }
+    }
+
+    /**
+     * Blits the columns of a non-rotated, non-X-flipped sprite where each run of source pixels
+     * starts a byte, using the expansion tables. Returns the range of columns that were drawn, the
+     * remaining columns on either side are left to the per-pixel loop.
+     */
+    private blitBytes (
+        sprite: Uint8Array,
+        dstX: number, dstY: number,
+        height: number,
+        srcX: number, srcY: number,
+        srcStride: number,
+        bpp2: boolean, flipY: boolean,
+        clipXMin: number, clipYMin: number, clipXMax: number, clipYMax: number,
+    ): [number, number] {
+        const pixelsPerByte = bpp2 ? 4 : 8;
+        const log2PixelsPerByte = bpp2 ? 2 : 3;
+        if (srcStride & (pixelsPerByte - 1)) {
+            // Rows don't start on a byte boundary
+            return [clipXMin, clipXMin];
+        }
+
+        // First column whose source pixel starts a byte, and the end of the last whole byte
+        const xStart = clipXMin + ((pixelsPerByte - ((srcX + clipXMin) & (pixelsPerByte - 1))) & (pixelsPerByte - 1));
+        const byteCount = (clipXMax - xStart) >> log2PixelsPerByte;
+        if (byteCount <= 0) {
+            return [clipXMin, clipXMin];
+        }
+
+        const table = bpp2 ? this.expand2bpp : this.expand1bpp;
+        table.setDrawColors(this.drawColors[0]);
+
+        for (let y = clipYMin; y < clipYMax; y++) {
+            const sy = srcY + (flipY ? height - y - 1 : y);
+            const srcByte = (sy * srcStride + srcX + xStart) >>> log2PixelsPerByte;
+            let pixel = WIDTH * (dstY + y) + dstX + xStart;
+            for (let ii = 0; ii < byteCount; ++ii, pixel += pixelsPerByte) {
+                const entry = table.get(sprite[srcByte + ii]);
+                if (entry !== 0) {
+                    this.writeExpanded(entry, pixel);
+                }
+            }
+        }
+
+        return [xStart, xStart + (byteCount << log2PixelsPerByte)];
+    }
+
     blit (
         sprite: Uint8Array,
         dstX: number, dstY: number,
@@ -322,9 +477,21 @@ export class Framebuffer {
             clipYMax = Math.min(height, HEIGHT - dstY);
         }
 
-        // Iterate pixels in rectangle
+        // Draw whole source bytes at once when possible
+        let skipXMin = clipXMin, skipXMax = clipXMin;
+        if (!rotate && !flipX) {
+            [skipXMin, skipXMax] = this.blitBytes(sprite, dstX, dstY, height, srcX, srcY, srcStride,
+                !!bpp2, !!flipY, clipXMin, clipYMin, clipXMax, clipYMax);
+        }
+
+        // Iterate the remaining pixels in rectangle
         for (let y = clipYMin; y < clipYMax; y++) {
             for (let x = clipXMin; x < clipXMax; x++) {
+                if (x == skipXMin && skipXMax > skipXMin) {
+                    x = skipXMax - 1;
+                    continue;
+                }
+
                 // Calculate sprite target coords
                 const tx = dstX + (rotate ? y : x);
                 const ty = dstY + (rotate ? x : y);
@@ -347,7 +514,6 @@ export class Framebuffer {
                 }
 
                 // Get the final color using the drawColors indirection
-                // TODO(2021-08-11): Use a lookup table here?
                 const dc = (drawColors >>> (colorIdx << 2)) & 0x0f;
                 if (dc !== 0) {
                     this.drawPoint((dc - 1) & 0x03, tx, ty);
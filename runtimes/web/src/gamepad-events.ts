@@ -0,0 +1,77 @@
+// Binary format for recorded gamepad events, shared with the native runtime and the prover:
+// a 4 byte little endian event count, followed by 8 bytes per event.
+
+export enum GamepadEventType {
+    PRESS = 0,
+    RELEASE = 1
+}
+
+export interface GamepadEvent {
+    frame: number;
+    playerIdx: number;
+    button: number;
+    eventType: GamepadEventType;
+}
+
+const HEADER_SIZE = 4; // 4 bytes for event count
+const EVENT_SIZE = 8; // 4 bytes frame + 1 byte player + 1 byte button + 1 byte type + 1 byte padding
+
+export function serializeGamepadEvents (events: GamepadEvent[]): Uint8Array {
+    const buffer = new ArrayBuffer(HEADER_SIZE + events.length * EVENT_SIZE);
+    const view = new DataView(buffer);
+
+    view.setUint32(0, events.length, true);
+
+    let offset = HEADER_SIZE;
+    for (const event of events) {
+        view.setUint32(offset, event.frame, true);
+        view.setUint8(offset + 4, event.playerIdx);
+        view.setUint8(offset + 5, event.button);
+        view.setUint8(offset + 6, event.eventType);
+        view.setUint8(offset + 7, 0);
+        offset += EVENT_SIZE;
+    }
+
+    return new Uint8Array(buffer);
+}
+
+export function deserializeGamepadEvents (data: Uint8Array): GamepadEvent[] {
+    const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+    const eventCount = view.getUint32(0, true);
+    const events: GamepadEvent[] = [];
+
+    let offset = HEADER_SIZE;
+    for (let i = 0; i < eventCount; i++) {
+        events.push({
+            frame: view.getUint32(offset, true),
+            playerIdx: view.getUint8(offset + 4),
+            button: view.getUint8(offset + 5),
+            eventType: view.getUint8(offset + 6)
+        });
+        offset += EVENT_SIZE;
+    }
+
+    return events;
+}
+
+/** Applies recorded events to a gamepad state, one frame at a time. Events must be sorted by frame. */
+export class GamepadEventPlayer {
+    readonly gamepad = [0, 0, 0, 0];
+    private nextEvent = 0;
+
+    constructor (private readonly events: GamepadEvent[]) {}
+
+    /** Returns the gamepad state to use for the given frame. Frames must be visited in order. */
+    advance (frame: number): number[] {
+        const events = this.events;
+        while (this.nextEvent < events.length && events[this.nextEvent].frame <= frame) {
+            const event = events[this.nextEvent++];
+            if (event.eventType === GamepadEventType.PRESS) {
+                this.gamepad[event.playerIdx] |= event.button;
+            } else if (event.eventType === GamepadEventType.RELEASE) {
+                this.gamepad[event.playerIdx] &= ~event.button;
+            }
+        }
+        return this.gamepad;
+    }
+}
@@ -1,5 +1,5 @@
-import { State } from "../state";
 import { Runtime } from "../runtime";
+import { StateHistory } from "./state-history";
 
 export const HISTORY_LENGTH = 20;
 
@@ -18,12 +18,7 @@ class History {
     // For each input, whether it was a prediction
     readonly predicted: boolean[];
 
-    // The state at the beginning of this frame
-    readonly state: State;
-
     constructor () {
-        this.state = new State();
-
         this.inputs = new Array(PLAYER_COUNT);
         this.predicted = new Array(PLAYER_COUNT);
         for (let ii = 0; ii < PLAYER_COUNT; ++ii) {
@@ -45,6 +40,9 @@ export class RollbackManager {
     private history: History[];
     private players: Player[];
 
+    // The state at the beginning of each history frame, indexed the same as `history`
+    private states: StateHistory;
+
     private rollbackIdx: number = HISTORY_LENGTH;
 
     constructor (public currentFrame: number, private runtime: Runtime) {
@@ -52,6 +50,7 @@ export class RollbackManager {
         for (let ii = 0; ii < HISTORY_LENGTH; ++ii) {
             this.history[ii] = new History();
         }
+        this.states = new StateHistory(HISTORY_LENGTH, runtime);
 
         this.players = new Array(PLAYER_COUNT);
         for (let ii = 0; ii < PLAYER_COUNT; ++ii) {
@@ -117,18 +116,19 @@ export class RollbackManager {
             let first = true;
 
             while (this.rollbackIdx < HISTORY_LENGTH) {
-                const history = this.history[this.rollbackIdx++];
+                const history = this.history[this.rollbackIdx];
 
                 if (first) {
                     first = false;
 
                     // Restore runtime state to the beginning of the rollback
-                    history.state.write(this.runtime);
+                    this.states.restore(this.rollbackIdx);
 
                 } else {
                     // Update the saved state for this frame
-                    history.state.read(this.runtime);
+                    this.states.save(this.rollbackIdx);
                 }
+                ++this.rollbackIdx;
 
                 for (let playerIdx = 0; playerIdx < PLAYER_COUNT; ++playerIdx) {
                     this.runtime.setGamepad(playerIdx, history.inputs[playerIdx]);
@@ -141,11 +141,12 @@ export class RollbackManager {
 
         const nextHistory = this.history.shift()!;
         this.history.push(nextHistory);
+        this.states.shift();
 
         nextHistory.frame = this.currentFrame;
 
         // Save state before executing the frame
-        nextHistory.state.read(this.runtime);
+        this.states.save(HISTORY_LENGTH-1);
 
         // Copy inputs into the next frame
         for (let playerIdx = 0; playerIdx < PLAYER_COUNT; ++playerIdx) {
@@ -0,0 +1,216 @@
+import * as constants from "../constants";
+import { Runtime } from "../runtime";
+
+const PAGE_SIZE = 1024;
+
+// Linear memory pages, followed by one page for the disk
+const MEMORY_PAGES = (1 << 16) / PAGE_SIZE;
+const DISK_PAGE = MEMORY_PAGES;
+const PAGE_COUNT = MEMORY_PAGES + 1;
+
+/** Pages that changed since the previous entry, and the small state that is always saved. */
+class Entry {
+    /** Pool slot of each page that changed since the previous entry, or -1. */
+    readonly pageSlots = new Int16Array(PAGE_COUNT).fill(-1);
+
+    globalValues: (number | bigint)[] = [];
+    diskSize = 0;
+    apuTicks = 0;
+}
+
+/**
+ * A fixed length history of runtime states for rollbacks. Instead of copying the whole memory for
+ * every frame, each entry only stores the 1 KB pages that differ from the entry before it, and the
+ * oldest entry is folded into a full base image as it falls off the end. All storage is allocated
+ * up front, so saving and restoring states doesn't create garbage.
+ *
+ * Writes to wasm memory can't be observed, so dirty pages are found by comparing against the
+ * previously saved state, which is kept in `latest`. Comparing is read-only and stops at the first
+ * differing word of each page, which is much cheaper than copying everything.
+ */
+export class StateHistory {
+    private readonly entries: Entry[];
+
+    /** Full image of the oldest entry. */
+    private readonly base: Uint8Array;
+
+    /** Full image of the most recently saved or restored entry. */
+    private readonly latest: Uint8Array;
+    private readonly latest32: Uint32Array;
+
+    private readonly memory: Uint8Array;
+    private readonly memory32: Uint32Array;
+
+    private readonly pool: Uint8Array;
+    private readonly freeSlots: Int16Array;
+    private freeCount: number;
+
+    private globalNames: string[] = [];
+    private globalsOwner: WebAssembly.Instance | null = null;
+
+    constructor (readonly length: number, private runtime: Runtime) {
+        // The memory is fixed at one wasm page and never grows, so its views can be kept around
+        this.memory = new Uint8Array(runtime.memory.buffer);
+        this.memory32 = new Uint32Array(runtime.memory.buffer);
+
+        this.entries = new Array(length);
+        for (let ii = 0; ii < length; ++ii) {
+            this.entries[ii] = new Entry();
+        }
+
+        this.base = new Uint8Array(PAGE_COUNT * PAGE_SIZE);
+        this.latest = new Uint8Array(PAGE_COUNT * PAGE_SIZE);
+        this.latest32 = new Uint32Array(this.latest.buffer);
+
+        // Enough for every entry changing every page
+        const slotCount = length * PAGE_COUNT;
+        this.pool = new Uint8Array(slotCount * PAGE_SIZE);
+        this.freeSlots = new Int16Array(slotCount);
+        for (let ii = 0; ii < slotCount; ++ii) {
+            this.freeSlots[ii] = slotCount - 1 - ii;
+        }
+        this.freeCount = slotCount;
+
+        // Every entry starts out identical to the current state
+        this.readImage(this.base);
+        this.latest.set(this.base);
+    }
+
+    /** Saves the runtime state into the entry at the given index. Later entries become invalid. */
+    save (idx: number) {
+        const runtime = this.runtime;
+        const entry = this.entries[idx];
+
+        // Entries are always saved in order after restoring the one before them, so `latest` holds
+        // the previous entry's image
+        this.releasePages(entry);
+        if (idx > 0) {
+            for (let page = 0; page < MEMORY_PAGES; ++page) {
+                if (!pageEquals(this.memory32, this.latest32, page)) {
+                    this.storePage(entry, page, this.memory, page * PAGE_SIZE);
+                }
+            }
+            const disk32 = new Uint32Array(runtime.diskBuffer, 0, PAGE_SIZE >> 2);
+            if (!pageEquals(disk32, this.latest32, DISK_PAGE, 0)) {
+                this.storePage(entry, DISK_PAGE, new Uint8Array(runtime.diskBuffer), 0);
+            }
+        } else {
+            this.readImage(this.base);
+            this.latest.set(this.base);
+        }
+
+        this.readGlobals(entry);
+        entry.diskSize = runtime.diskSize;
+        entry.apuTicks = runtime.apu.ticks;
+    }
+
+    /** Restores the runtime to the state saved in the entry at the given index. */
+    restore (idx: number) {
+        const runtime = this.runtime;
+        const entry = this.entries[idx];
+        const latest = this.latest;
+        const pool = this.pool;
+
+        latest.set(this.base);
+        for (let page = 0; page < PAGE_COUNT; ++page) {
+            // Find the most recent change to this page up to this entry
+            for (let ii = idx; ii > 0; --ii) {
+                const slot = this.entries[ii].pageSlots[page];
+                if (slot >= 0) {
+                    latest.set(pool.subarray(slot * PAGE_SIZE, (slot+1) * PAGE_SIZE), page * PAGE_SIZE);
+                    break;
+                }
+            }
+        }
+
+        this.memory.set(latest.subarray(0, MEMORY_PAGES * PAGE_SIZE));
+        new Uint8Array(runtime.diskBuffer).set(latest.subarray(DISK_PAGE * PAGE_SIZE, PAGE_COUNT * PAGE_SIZE));
+        runtime.diskSize = entry.diskSize;
+
+        this.writeGlobals(entry);
+        runtime.apu.rollback(entry.apuTicks);
+    }
+
+    /** Drops the oldest entry and moves the others down by one, freeing up the last entry. */
+    shift () {
+        const entries = this.entries;
+        const oldest = entries.shift()!;
+        this.releasePages(oldest);
+
+        // The new oldest entry's changes become part of the base image
+        const next = entries[0];
+        for (let page = 0; page < PAGE_COUNT; ++page) {
+            const slot = next.pageSlots[page];
+            if (slot >= 0) {
+                this.base.set(this.pool.subarray(slot * PAGE_SIZE, (slot+1) * PAGE_SIZE), page * PAGE_SIZE);
+            }
+        }
+        this.releasePages(next);
+
+        entries.push(oldest);
+    }
+
+    private readImage (dest: Uint8Array) {
+        dest.set(this.memory, 0);
+        dest.set(new Uint8Array(this.runtime.diskBuffer, 0, constants.STORAGE_SIZE), DISK_PAGE * PAGE_SIZE);
+    }
+
+    private storePage (entry: Entry, page: number, src: Uint8Array, srcOffset: number) {
+        const slot = this.freeSlots[--this.freeCount];
+        const data = src.subarray(srcOffset, srcOffset + PAGE_SIZE);
+        this.pool.set(data, slot * PAGE_SIZE);
+        this.latest.set(data, page * PAGE_SIZE);
+        entry.pageSlots[page] = slot;
+    }
+
+    private releasePages (entry: Entry) {
+        const pageSlots = entry.pageSlots;
+        for (let page = 0; page < PAGE_COUNT; ++page) {
+            const slot = pageSlots[page];
+            if (slot >= 0) {
+                this.freeSlots[this.freeCount++] = slot;
+                pageSlots[page] = -1;
+            }
+        }
+    }
+
+    private readGlobals (entry: Entry) {
+        const exports = this.runtime.wasm!.exports;
+        if (this.globalsOwner != this.runtime.wasm) {
+            this.globalsOwner = this.runtime.wasm;
+            this.globalNames = Object.keys(exports).filter(name => exports[name] instanceof WebAssembly.Global);
+        }
+
+        const names = this.globalNames;
+        const values = entry.globalValues;
+        values.length = names.length;
+        for (let ii = 0; ii < names.length; ++ii) {
+            values[ii] = (exports[names[ii]] as WebAssembly.Global).value;
+        }
+    }
+
+    private writeGlobals (entry: Entry) {
+        const exports = this.runtime.wasm!.exports;
+        const names = this.globalNames;
+        const values = entry.globalValues;
+        for (let ii = 0; ii < values.length; ++ii) {
+            const global = exports[names[ii]] as WebAssembly.Global;
+            if (global.value !== values[ii]) {
+                try {
+                    // this will fail for immutable globals that have been exported, but is safe
+                    global.value = values[ii];
+                } catch {}
+            }
+        }
+    }
+}
+
+function pageEquals (a: Uint32Array, b: Uint32Array, bPage: number, aPage = bPage): boolean {
+    const words = PAGE_SIZE >> 2;
+    for (let ii = 0, aIdx = aPage * words, bIdx = bPage * words; ii < words; ++ii) {
+        if (a[aIdx + ii] !== b[bIdx + ii]) {
+            return false;
+        }
+    }
+    return true;
+}
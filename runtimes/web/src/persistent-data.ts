@@ -1,5 +1,18 @@
 
 
+export interface PersistentDataValues {
+    game_mode: number;
+    max_frames: number;
+    game_seed: number;
+    frames: number;
+    score: number;
+    health: number;
+}
+
+export const PERSISTENT_DATA_FIELDS: (keyof PersistentDataValues)[] = [
+    "game_mode", "max_frames", "game_seed", "frames", "score", "health",
+];
+
 export class PersistentData {
     constructor(private view: DataView, private baseAddr: number) {}
 
@@ -50,4 +63,15 @@ export class PersistentData {
     set health(value: number) {
         this.view.setUint32(this.baseAddr + 20, value, true);
     }
+
+    toObject(): PersistentDataValues {
+        return {
+            game_mode: this.game_mode,
+            max_frames: this.max_frames,
+            game_seed: this.game_seed,
+            frames: this.frames,
+            score: this.score,
+            health: this.health,
+        };
+    }
 }
@@ -0,0 +1,92 @@
+// Web Worker entry point for verifyReplay() in replay.ts.
+
+import * as constants from "./constants";
+import { HeadlessRuntime } from "./headless-runtime";
+import { GamepadEventPlayer, deserializeGamepadEvents } from "./gamepad-events";
+import { PERSISTENT_DATA_FIELDS } from "./persistent-data";
+import type { ReplayRequest, ReplayResult } from "./replay";
+
+class ReplayRuntime extends HeadlessRuntime {
+    print () {
+        // The live run already printed these traces
+    }
+}
+
+async function replay (request: ReplayRequest): Promise<ReplayResult> {
+    const expected = request.persistentData;
+    const expectedHashes = request.frameHashes;
+    const frameHashes = new Uint32Array(expectedHashes.length);
+    const result: ReplayResult = {
+        ok: false,
+        frames: 0,
+        persistentData: null,
+        frameHashes,
+        mismatches: [],
+        divergedAtFrame: -1,
+    };
+
+    // Only what gets submitted goes into the replay: the seed and the gamepad events. The backend
+    // and the prover start from an empty disk and never see the mouse, so neither does this.
+    const runtime = new ReplayRuntime();
+    await runtime.load(request.cart);
+    if (runtime.wasm == null) {
+        result.error = "Cart failed to load";
+        return result;
+    }
+
+    // Same initialization order as the live run in App.init()
+    const initial = request.initialPersistentData;
+    runtime.persistentData.game_mode = initial.game_mode;
+    runtime.persistentData.max_frames = initial.max_frames;
+    runtime.persistentData.game_seed = initial.game_seed;
+    runtime.start();
+
+    const player = new GamepadEventPlayer(deserializeGamepadEvents(request.events));
+    let running = true;
+    while (running && result.frames < expectedHashes.length) {
+        const gamepad = player.advance(result.frames);
+        for (let playerIdx = 0; playerIdx < 4; ++playerIdx) {
+            runtime.setGamepad(playerIdx, gamepad[playerIdx]);
+        }
+        running = runtime.update();
+
+        const hash = runtime.framebuffer.hash();
+        if (hash != expectedHashes[result.frames] && result.divergedAtFrame < 0) {
+            result.divergedAtFrame = result.frames;
+        }
+        frameHashes[result.frames++] = hash;
+    }
+
+    if (runtime.pauseState & constants.PAUSE_CRASHED) {
+        result.error = "Cart crashed during replay";
+    } else if (running) {
+        result.error = "Cart did not exit when the live run did";
+    } else if (result.frames < expectedHashes.length && result.divergedAtFrame < 0) {
+        result.divergedAtFrame = result.frames;
+    }
+
+    const persistentData = runtime.persistentData.toObject();
+    result.persistentData = persistentData;
+    result.mismatches = PERSISTENT_DATA_FIELDS.filter(field => persistentData[field] != expected[field]);
+    result.frameHashes = frameHashes.slice(0, result.frames);
+    result.ok = result.error == null && result.mismatches.length == 0 && result.divergedAtFrame < 0;
+    return result;
+}
+
+addEventListener("message", async (event: MessageEvent<ReplayRequest>) => {
+    let result: ReplayResult;
+    try {
+        result = await replay(event.data);
+    } catch (error) {
+        result = {
+            ok: false,
+            frames: 0,
+            persistentData: null,
+            frameHashes: new Uint32Array(0),
+            mismatches: [],
+            divergedAtFrame: -1,
+            error: String(error),
+        };
+    }
+    postMessage(result, { transfer: [result.frameHashes.buffer] });
+});
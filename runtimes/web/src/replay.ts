@@ -0,0 +1,58 @@
+import { PersistentDataValues } from "./persistent-data";
+import ReplayWorker from "./replay-worker?worker&inline";
+
+export interface ReplayRequest {
+    /** The original (unpatched) cart. */
+    cart: Uint8Array;
+
+    /** Recorded gamepad events, in the serialized byte format. */
+    events: Uint8Array;
+
+    /** What the live run started with. game_mode, max_frames and game_seed are the replay's inputs. */
+    initialPersistentData: PersistentDataValues;
+
+    /** What the live run ended with. */
+    persistentData: PersistentDataValues;
+
+    /** Framebuffer hash after every update of the live run. */
+    frameHashes: Uint32Array;
+}
+
+export interface ReplayResult {
+    /** True if the replay ended in the same state, with the same frames along the way. */
+    ok: boolean;
+
+    /** Number of updates the replay ran. */
+    frames: number;
+
+    persistentData: PersistentDataValues | null;
+    frameHashes: Uint32Array;
+
+    /** Names of the persistent data fields that differ from the live run. */
+    mismatches: string[];
+
+    /** First frame whose framebuffer differs from the live run, or -1. */
+    divergedAtFrame: number;
+
+    /** Set if the cart failed to load or run. */
+    error?: string;
+}
+
+/**
+ * Re-simulates a recorded run from its seed in a worker with a headless runtime, and compares it
+ * against what the live run ended with. Catches nondeterministic carts before a proof is requested.
+ */
+export function verifyReplay (request: ReplayRequest): Promise<ReplayResult> {
+    return new Promise((resolve, reject) => {
+        const worker = new ReplayWorker();
+        worker.onmessage = (event: MessageEvent<ReplayResult>) => {
+            worker.terminate();
+            resolve(event.data);
+        };
+        worker.onerror = event => {
+            worker.terminate();
+            reject(new Error(`Replay worker failed: ${event.message}`));
+        };
+        worker.postMessage(request);
+    });
+}
@@ -8,7 +8,7 @@ export class State {
     diskSize: number;
     diskBuffer: ArrayBuffer;
 
-    // TODO(2022-03-17): APU state
+    // The APU isn't part of saved states. Rollbacks rewind it through netplay/state-history.ts.
 
     constructor () {
         this.memory = new ArrayBuffer(1 << 16);
@@ -8,8 +8,10 @@ import * as utils from "./utils";
 import * as z85 from "../z85";
 import { Netplay, DEV_NETPLAY } from "../netplay";
 import { Runtime } from "../runtime";
-import { PersistentData } from "../persistent-data";
+import { PersistentData, PersistentDataValues } from "../persistent-data";
 import { State } from "../state";
+import { GamepadEvent, GamepadEventType, serializeGamepadEvents, deserializeGamepadEvents } from "../gamepad-events";
+import { ReplayResult, verifyReplay } from "../replay";
 
 import { MenuOverlay } from "./menu-overlay";
 import { Notifications } from "./notifications";
@@ -21,23 +23,24 @@ class InputState {
     mouseButtons = 0;
 }
 
-// Gamepad event types
-const enum GamepadEventType {
-    PRESS = 0,
-    RELEASE = 1
-}
+/** What run() resolves with when the cart exits. */
+export interface ExitData {
+    persistentData: PersistentData;
+
+    /** What the persistent data held when the run started, before the cart's start(). */
+    initialPersistentData: PersistentDataValues;
+
+    events_serialized: string;
 
-// Gamepad event structure
-interface GamepadEvent {
-    frame: number;
-    playerIdx: number;
-    button: number;
-    eventType: GamepadEventType;
+    /** z85 encoded framebuffer hash after every update, see Framebuffer.hash(). */
+    framebuffer_hashes: string;
 }
 
 // Gamepad event recorder
 class GamepadEventRecorder {
     private events: GamepadEvent[] = [];
+    private frameHashes: number[] = [];
+    private initialPersistentData: PersistentDataValues | null = null;
     private previousGamepadState = [0, 0, 0, 0];
     private currentFrame = 0;
     private isRecording = false;
@@ -45,9 +48,11 @@ class GamepadEventRecorder {
     private playbackEvents: GamepadEvent[] = [];
     private playbackFrame = 0;
 
-    startRecording() {
+    startRecording(initialPersistentData: PersistentDataValues) {
         this.isRecording = true;
         this.events = [];
+        this.frameHashes = [];
+        this.initialPersistentData = initialPersistentData;
         this.currentFrame = 0;
         this.previousGamepadState = [0, 0, 0, 0];
         console.log("Started gamepad event recording");
@@ -180,59 +185,31 @@ class GamepadEventRecorder {
         this.currentFrame++;
     }
 
+    recordFrameHash(hash: number) {
+        if (!this.isRecording) return;
+
+        this.frameHashes.push(hash);
+    }
+
     getEvents(): GamepadEvent[] {
         return [...this.events];
     }
 
+    getInitialPersistentData(): PersistentDataValues | null {
+        return this.initialPersistentData;
+    }
+
+    serializeFrameHashes(): Uint8Array {
+        const hashes = new Uint32Array(this.frameHashes);
+        return new Uint8Array(hashes.buffer);
+    }
+
     serializeToByteStream(): Uint8Array {
-        // Calculate buffer size: 4 bytes header + 8 bytes per event
-        const headerSize = 4; // 4 bytes for event count
-        const eventSize = 8; // 4 bytes frame + 1 byte player + 1 byte button + 1 byte type + 1 byte padding
-        const bufferSize = headerSize + (this.events.length * eventSize);
-        
-        const buffer = new ArrayBuffer(bufferSize);
-        const view = new DataView(buffer);
-        
-        // Write header: event count (4 bytes)
-        view.setUint32(0, this.events.length, true); // little endian
-        
-        // Write events
-        let offset = headerSize;
-        for (const event of this.events) {
-            view.setUint32(offset, event.frame, true);     // Frame number (4 bytes)
-            view.setUint8(offset + 4, event.playerIdx);    // Player index (1 byte)
-            view.setUint8(offset + 5, event.button);       // Button mask (1 byte)
-            view.setUint8(offset + 6, event.eventType);    // Event type (1 byte)
-            view.setUint8(offset + 7, 0);                  // Padding (1 byte)
-            offset += eventSize;
-        }
-        
-        return new Uint8Array(buffer);
+        return serializeGamepadEvents(this.events);
     }
 
     deserializeFromByteStream(data: Uint8Array): GamepadEvent[] {
-        const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
-        
-        // Read header: event count
-        const eventCount = view.getUint32(0, true);
-        const events: GamepadEvent[] = [];
-        
-        // Read events
-        const headerSize = 4;
-        const eventSize = 8;
-        let offset = headerSize;
-        
-        for (let i = 0; i < eventCount; i++) {
-            events.push({
-                frame: view.getUint32(offset, true),
-                playerIdx: view.getUint8(offset + 4),
-                button: view.getUint8(offset + 5),
-                eventType: view.getUint8(offset + 6)
-            });
-            offset += eventSize;
-        }
-        
-        return events;
+        return deserializeGamepadEvents(data);
     }
 
     exportToFile(persistentData: PersistentData) {
@@ -240,14 +217,7 @@ class GamepadEventRecorder {
         const encodedEvents = z85.encode(byteStream);
 
         const exportData = {
-            persistentData: {
-                game_mode: persistentData.game_mode,
-                max_frames: persistentData.max_frames,
-                game_seed: persistentData.game_seed,
-                frames: persistentData.frames,
-                score: persistentData.score,
-                health: persistentData.health,
-            },
+            persistentData: persistentData.toObject(),
             gamepadEvents: encodedEvents,
         };
 
@@ -357,8 +327,8 @@ export class App extends LitElement {
 
     private readonly diskPrefix: string;
 
-    @state() private onExit!: (data: { persistentData: PersistentData, events_serialized: string }) => void;
-    private resolveRunPromise?: (value: { persistentData: PersistentData, events_serialized: string }) => void;
+    @state() private onExit!: (data: ExitData) => void;
+    private resolveRunPromise?: (value: ExitData) => void;
 
     readonly onPointerUp = (event: PointerEvent) => {
         if (event.pointerType == "touch") {
@@ -383,16 +353,12 @@ export class App extends LitElement {
 
     }
 
-    run = (cartUrl: string) => new Promise(async (resolve) => {
+    run = (cartUrl: string) => new Promise<ExitData>(async (resolve) => {
         this.resolveRunPromise = resolve;
         await this.init(cartUrl);
     });
 
     async init (cartUrl: string) {
-        this.runtime.persistentData.game_mode = 1;
-        this.runtime.persistentData.max_frames = 60 * 60 * 2; // 2 minutes
-        this.runtime.persistentData.game_seed = Date.now();
-
         async function loadCartWasm (): Promise<Uint8Array> {
             const cartJson = document.getElementById("wasm4-cart-json");
 
@@ -442,19 +408,20 @@ export class App extends LitElement {
             devtoolsManager = await import('@wasm4/web-devtools').then(({ DevtoolsManager}) => new DevtoolsManager());
         }
 
-        if (!this.netplay) {
-            runtime.start();
-        }
-
         // Initialize persistent data for recording mode
         runtime.persistentData.game_mode = 1;
         runtime.persistentData.max_frames = 600;
         runtime.persistentData.game_seed = Date.now() & 0xFFFFFFFF; // Use current time as seed
-        
-        // Start recording automatically
-        this.gamepadRecorder.startRecording();
+
+        // Start recording automatically. The recording keeps the persistent data as it is before
+        // start(), which is free to change it, so that replays begin from the same values.
+        this.gamepadRecorder.startRecording(runtime.persistentData.toObject());
         console.log(`Starting in recording mode with seed: ${runtime.persistentData.game_seed}`);
 
+        if (!this.netplay) {
+            runtime.start();
+        }
+
         if (DEV_NETPLAY) {
             this.copyNetplayLink();
         }
@@ -817,6 +784,9 @@ export class App extends LitElement {
                     }
                     runtime.setMouse(input.mouseX, input.mouseY, input.mouseButtons);
                     const continueRunning = runtime.update();
+                    if (!this.gamepadRecorder.isPlayingActive) {
+                        this.gamepadRecorder.recordFrameHash(runtime.framebuffer.hash());
+                    }
                     if (!continueRunning) {
                         if (this.requestAnimationFrameId) {
                             cancelAnimationFrame(this.requestAnimationFrameId);
@@ -824,9 +794,11 @@ export class App extends LitElement {
                         const byteStream = this.gamepadRecorder.serializeToByteStream();
                         const encodedEvents = z85.encode(byteStream);
 
-                        const exitData = {
+                        const exitData: ExitData = {
                             persistentData: this.runtime.persistentData,
+                            initialPersistentData: this.gamepadRecorder.getInitialPersistentData()!,
                             events_serialized: encodedEvents,
+                            framebuffer_hashes: z85.encode(this.gamepadRecorder.serializeFrameHashes()),
                         };
 
                         // Resolve the promise returned by run()
@@ -1082,10 +1054,27 @@ export class App extends LitElement {
         super.disconnectedCallback();
     }
 
-    setOnExit(callback: (data: { persistentData: PersistentData, events_serialized: string }) => void) {
+    setOnExit(callback: (data: ExitData) => void) {
         this.onExit = callback;
     }
 
+    /** Re-simulates a finished run off the main thread, see verifyReplay(). */
+    verifyReplay(exitData: ExitData): Promise<ReplayResult> {
+        const events = new Uint8Array(exitData.events_serialized.length / 5 * 4);
+        z85.decode(exitData.events_serialized, events);
+
+        const hashes = new Uint8Array(exitData.framebuffer_hashes.length / 5 * 4);
+        z85.decode(exitData.framebuffer_hashes, hashes);
+
+        return verifyReplay({
+            cart: this.runtime.wasmBuffer!,
+            events,
+            initialPersistentData: exitData.initialPersistentData,
+            persistentData: exitData.persistentData.toObject(),
+            frameHashes: new Uint32Array(hashes.buffer),
+        });
+    }
+
     render () {
         return html`
             <div class="content">
@@ -0,0 +1,234 @@
+// Checks that the web rasterizer (src/framebuffer.ts) draws exactly what the native one
+// (runtimes/native/src/framebuffer.c) does.
+//
+// Renders a fixed corpus of draw calls with the web rasterizer and writes them out as a draw
+// capture (see runtimes/native/src/capture.h), one call per frame with the framebuffer hash after
+// it. wasm4_rasterbench then replays the capture into the native rasterizer and counts the frames
+// whose framebuffer differs, so a mismatch points at the exact call that caused it.
+//
+//   npm run test:framebuffer -- ../native/build/wasm4_rasterbench
+
+import { execFileSync } from "node:child_process";
+import { mkdtempSync, rmSync, writeFileSync } from "node:fs";
+import { tmpdir } from "node:os";
+import { join } from "node:path";
+import { createServer } from "vite";
+
+const rasterbench = process.argv[2] ?? "../native/build/wasm4_rasterbench";
+
+const OP_FRAME = 0, OP_FRAME_END = 1, OP_HLINE = 2, OP_VLINE = 3, OP_RECT = 4, OP_OVAL = 5,
+    OP_LINE = 6, OP_BLIT = 7, OP_TEXT = 8, OP_TEXT_UTF8 = 9, OP_TEXT_UTF16 = 10;
+
+// xorshift32, so the corpus is the same on every run
+let seed = 0x2545f491;
+function random (n) {
+    seed ^= seed << 13;
+    seed ^= seed >>> 17;
+    seed ^= seed << 5;
+    return (seed >>> 0) % n;
+}
+function randomRange (min, max) {
+    return min + random(max - min + 1);
+}
+
+// Draw colors with each nibble from 0 (transparent) to 4
+function randomDrawColors () {
+    return random(5) | (random(5) << 4) | (random(5) << 8) | (random(5) << 12);
+}
+
+function buildCorpus () {
+    const calls = [];
+
+    // A busy background, so that transparent pixels and partial bytes show
+    for (let ii = 0; ii < 24; ++ii) {
+        calls.push({ op: OP_RECT, drawColors: randomDrawColors(),
+            args: [randomRange(-20, 150), randomRange(-20, 150), randomRange(1, 80), randomRange(1, 80)] });
+    }
+
+    // drawHLineFast: every start alignment against lengths crossing byte and word boundaries
+    for (let x = -5; x <= 20; ++x) {
+        for (let length = 0; length <= 40; length += (length < 20 ? 1 : 3)) {
+            calls.push({ op: OP_HLINE, drawColors: randomRange(1, 4), args: [x, randomRange(0, 159), length] });
+        }
+    }
+    for (let ii = 0; ii < 200; ++ii) {
+        calls.push({ op: OP_HLINE, drawColors: randomDrawColors(),
+            args: [randomRange(-170, 170), randomRange(-2, 161), randomRange(-5, 200)] });
+    }
+
+    for (let ii = 0; ii < 100; ++ii) {
+        calls.push({ op: OP_VLINE, drawColors: randomDrawColors(),
+            args: [randomRange(-2, 161), randomRange(-170, 170), randomRange(-5, 200)] });
+        calls.push({ op: OP_RECT, drawColors: randomDrawColors(),
+            args: [randomRange(-30, 170), randomRange(-30, 170), randomRange(0, 60), randomRange(0, 60)] });
+        calls.push({ op: OP_OVAL, drawColors: randomDrawColors(),
+            args: [randomRange(-30, 170), randomRange(-30, 170), randomRange(0, 60), randomRange(0, 60)] });
+        calls.push({ op: OP_LINE, drawColors: randomDrawColors(),
+            args: [randomRange(-30, 190), randomRange(-30, 190), randomRange(-30, 190), randomRange(-30, 190)] });
+    }
+
+    // blitBytes and the per-pixel loop: every flip/rotate/bpp combination, at byte aligned and
+    // unaligned source offsets and strides, clipped on every side
+    const widths = [1, 3, 4, 7, 8, 9, 16, 17, 24, 33];
+    const heights = [1, 5, 8, 13];
+    for (let flags = 0; flags < 16; ++flags) {
+        for (const width of widths) {
+            for (let ii = 0; ii < 6; ++ii) {
+                const height = heights[random(heights.length)];
+                const srcX = [0, 1, 3, 4, 8, 12][random(6)];
+                const srcY = random(3);
+                const strideAlign = (flags & 1) ? 4 : 8;
+                const minStride = srcX + width;
+                const stride = random(2)
+                    ? Math.ceil(minStride / strideAlign) * strideAlign
+                    : minStride + random(5);
+                const bitsPerPixel = (flags & 1) ? 2 : 1;
+                const sprite = new Uint8Array(Math.ceil((srcY + height) * stride * bitsPerPixel / 8));
+                for (let jj = 0; jj < sprite.length; ++jj) {
+                    sprite[jj] = random(256);
+                }
+                calls.push({ op: OP_BLIT, drawColors: randomDrawColors(),
+                    args: [randomRange(-40, 170), randomRange(-40, 170), width, height, srcX, srcY, stride, flags],
+                    data: sprite });
+            }
+        }
+    }
+
+    // drawGlyph for text entirely on screen at every alignment, and the blit fallback for text
+    // that's partly off screen
+    for (let ii = 0; ii < 150; ++ii) {
+        const length = randomRange(1, 24);
+        const chars = [];
+        for (let jj = 0; jj < length; ++jj) {
+            chars.push(random(12) == 0 ? 10 : randomRange(32, 255));
+        }
+        const x = ii < 100 ? randomRange(0, 152) : randomRange(-12, 165);
+        const y = ii < 100 ? randomRange(0, 152) : randomRange(-12, 165);
+        const drawColors = randomDrawColors();
+        switch (ii % 3) {
+        case 0:
+            calls.push({ op: OP_TEXT, drawColors, args: [x, y], data: Uint8Array.of(...chars, 0) });
+            break;
+        case 1:
+            calls.push({ op: OP_TEXT_UTF8, drawColors, args: [x, y], data: Uint8Array.of(...chars) });
+            break;
+        case 2:
+            calls.push({ op: OP_TEXT_UTF16, drawColors, args: [x, y],
+                data: new Uint8Array(Uint16Array.of(...chars).buffer) });
+            break;
+        }
+    }
+
+    return calls;
+}
+
+function draw (framebuffer, call) {
+    const args = call.args;
+    framebuffer.drawColors[0] = call.drawColors;
+    switch (call.op) {
+    case OP_HLINE: framebuffer.drawHLine(args[0], args[1], args[2]); break;
+    case OP_VLINE: framebuffer.drawVLine(args[0], args[1], args[2]); break;
+    case OP_RECT: framebuffer.drawRect(args[0], args[1], args[2], args[3]); break;
+    case OP_OVAL: framebuffer.drawOval(args[0], args[1], args[2], args[3]); break;
+    case OP_LINE: framebuffer.drawLine(args[0], args[1], args[2], args[3]); break;
+    case OP_BLIT: {
+        const flags = args[7];
+        framebuffer.blit(call.data, args[0], args[1], args[2], args[3], args[4], args[5], args[6],
+            flags & 1, flags & 2, flags & 4, flags & 8);
+        break;
+    }
+    case OP_TEXT:
+    case OP_TEXT_UTF8:
+        framebuffer.drawText(call.data, args[0], args[1]);
+        break;
+    case OP_TEXT_UTF16:
+        framebuffer.drawText(new Uint16Array(call.data.slice().buffer), args[0], args[1]);
+        break;
+    }
+}
+
+// FNV-1a over the framebuffer bytes, as in w4_captureHash()
+function hash (bytes) {
+    let hash = 0x811c9dc5;
+    for (let ii = 0; ii < bytes.length; ++ii) {
+        hash = Math.imul(hash ^ bytes[ii], 0x01000193);
+    }
+    return hash >>> 0;
+}
+
+class CaptureWriter {
+    bytes = [];
+
+    u8 (value) {
+        this.bytes.push(value & 0xff);
+    }
+    u16 (value) {
+        this.u8(value);
+        this.u8(value >>> 8);
+    }
+    u32 (value) {
+        this.u16(value);
+        this.u16(value >>> 16);
+    }
+}
+
+const server = await createServer({
+    configFile: false,
+    logLevel: "silent",
+    appType: "custom",
+    server: { middlewareMode: true },
+});
+const { Framebuffer } = await server.ssrLoadModule("/src/framebuffer.ts");
+await server.close();
+
+const framebuffer = new Framebuffer(new ArrayBuffer(65536));
+const calls = buildCorpus();
+
+const capture = new CaptureWriter();
+capture.bytes.push(..."W4DC".split("").map(c => c.charCodeAt(0)));
+capture.u32(1);
+calls.forEach((call, idx) => {
+    capture.u8(OP_FRAME);
+    capture.u8(idx == 0 ? 1 : 0);
+    if (idx == 0) {
+        framebuffer.clear();
+    }
+    draw(framebuffer, call);
+
+    capture.u8(call.op);
+    capture.u16(call.drawColors);
+    for (const arg of call.args) {
+        capture.u32(arg);
+    }
+    if (call.data != null) {
+        capture.u32(call.data.length);
+        capture.bytes.push(...call.data);
+    }
+
+    capture.u8(OP_FRAME_END);
+    capture.u32(hash(framebuffer.bytes));
+});
+
+const dir = mkdtempSync(join(tmpdir(), "w4-parity-"));
+const capturePath = join(dir, "corpus.w4dc");
+let output;
+try {
+    writeFileSync(capturePath, Uint8Array.from(capture.bytes));
+    output = execFileSync(rasterbench, [capturePath, "1"], { encoding: "utf8" });
+} finally {
+    rmSync(dir, { recursive: true, force: true });
+}
+
+const frames = /Frames:\s+(\d+) \((\d+) differ/.exec(output);
+if (frames == null || Number(frames[1]) != calls.length) {
+    console.error(`Unexpected output from ${rasterbench}:\n${output}`);
+    process.exit(1);
+}
+if (Number(frames[2]) > 0) {
+    const first = Number(/First differing frame:\s+(\d+)/.exec(output)[1]);
+    const call = calls[first];
+    console.error(`${frames[2]} of ${calls.length} calls draw differently than native, starting with:`);
+    console.error(JSON.stringify({ ...call, data: call.data && Array.from(call.data) }));
+    process.exit(1);
+}
+console.log(`${calls.length} calls draw the same as native`);
@@ -1,468 +0,0 @@
-var wasm4=function(t){"use strict";
-/**
-   * @license
-   * Copyright 2019 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */var e,s;const i=globalThis,r=i.ShadowRoot&&(void 0===i.ShadyCSS||i.ShadyCSS.nativeShadow)&&"adoptedStyleSheets"in Document.prototype&&"replace"in CSSStyleSheet.prototype,n=Symbol(),o=new WeakMap;let a=class{constructor(t,e,s){if(this._$cssResult$=!0,s!==n)throw Error("CSSResult is not constructable. Use `unsafeCSS` or `css` instead.");this.cssText=t,this.t=e}get styleSheet(){let t=this.o;const e=this.t;if(r&&void 0===t){const s=void 0!==e&&1===e.length;s&&(t=o.get(e)),void 0===t&&((this.o=t=new CSSStyleSheet).replaceSync(this.cssText),s&&o.set(e,t))}return t}toString(){return this.cssText}};const l=(t,...e)=>{const s=1===t.length?t[0]:e.reduce(((e,s,i)=>e+(t=>{if(!0===t._$cssResult$)return t.cssText;if("number"==typeof t)return t;throw Error("Value passed to 'css' function must be a 'css' function result: "+t+". Use 'unsafeCSS' to pass non-literal values, but take care to ensure page security.")})(s)+t[i+1]),t[0]);return new a(s,t,n)},d=r?t=>t:t=>t instanceof CSSStyleSheet?(t=>{let e="";for(const s of t.cssRules)e+=s.cssText;return(t=>new a("string"==typeof t?t:t+"",void 0,n))(e)})(t):t
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */,{is:c,defineProperty:h,getOwnPropertyDescriptor:p,getOwnPropertyNames:u,getOwnPropertySymbols:m,getPrototypeOf:f}=Object,g=globalThis,y=g.trustedTypes,v=y?y.emptyScript:"",b=g.reactiveElementPolyfillSupport,w=(t,e)=>t,x={toAttribute(t,e){switch(e){case Boolean:t=t?v:null;break;case Object:case Array:t=null==t?t:JSON.stringify(t)}return t},fromAttribute(t,e){let s=t;switch(e){case Boolean:s=null!==t;break;case Number:s=null===t?null:Number(t);break;case Object:case Array:try{s=JSON.parse(t)}catch(i){s=null}}return s}},_=(t,e)=>!c(t,e),$={attribute:!0,type:String,converter:x,reflect:!1,hasChanged:_};Symbol.metadata??(Symbol.metadata=Symbol("metadata")),g.litPropertyMetadata??(g.litPropertyMetadata=new WeakMap);let A=class extends HTMLElement{static addInitializer(t){this._$Ei(),(this.l??(this.l=[])).push(t)}static get observedAttributes(){return this.finalize(),this._$Eh&&[...this._$Eh.keys()]}static createProperty(t,e=$){if(e.state&&(e.attribute=!1),this._$Ei(),this.elementProperties.set(t,e),!e.noAccessor){const s=Symbol(),i=this.getPropertyDescriptor(t,s,e);void 0!==i&&h(this.prototype,t,i)}}static getPropertyDescriptor(t,e,s){const{get:i,set:r}=p(this.prototype,t)??{get(){return this[e]},set(t){this[e]=t}};return{get(){return null==i?void 0:i.call(this)},set(e){const n=null==i?void 0:i.call(this);r.call(this,e),this.requestUpdate(t,n,s)},configurable:!0,enumerable:!0}}static getPropertyOptions(t){return this.elementProperties.get(t)??$}static _$Ei(){if(this.hasOwnProperty(w("elementProperties")))return;const t=f(this);t.finalize(),void 0!==t.l&&(this.l=[...t.l]),this.elementProperties=new Map(t.elementProperties)}static finalize(){if(this.hasOwnProperty(w("finalized")))return;if(this.finalized=!0,this._$Ei(),this.hasOwnProperty(w("properties"))){const t=this.properties,e=[...u(t),...m(t)];for(const s of e)this.createProperty(s,t[s])}const t=this[Symbol.metadata];if(null!==t){const e=litPropertyMetadata.get(t);if(void 0!==e)for(const[t,s]of e)this.elementProperties.set(t,s)}this._$Eh=new Map;for(const[e,s]of this.elementProperties){const t=this._$Eu(e,s);void 0!==t&&this._$Eh.set(t,e)}this.elementStyles=this.finalizeStyles(this.styles)}static finalizeStyles(t){const e=[];if(Array.isArray(t)){const s=new Set(t.flat(1/0).reverse());for(const t of s)e.unshift(d(t))}else void 0!==t&&e.push(d(t));return e}static _$Eu(t,e){const s=e.attribute;return!1===s?void 0:"string"==typeof s?s:"string"==typeof t?t.toLowerCase():void 0}constructor(){super(),this._$Ep=void 0,this.isUpdatePending=!1,this.hasUpdated=!1,this._$Em=null,this._$Ev()}_$Ev(){var t;this._$ES=new Promise((t=>this.enableUpdating=t)),this._$AL=new Map,this._$E_(),this.requestUpdate(),null==(t=this.constructor.l)||t.forEach((t=>t(this)))}addController(t){var e;(this._$EO??(this._$EO=new Set)).add(t),void 0!==this.renderRoot&&this.isConnected&&(null==(e=t.hostConnected)||e.call(t))}removeController(t){var e;null==(e=this._$EO)||e.delete(t)}_$E_(){const t=new Map,e=this.constructor.elementProperties;for(const s of e.keys())this.hasOwnProperty(s)&&(t.set(s,this[s]),delete this[s]);t.size>0&&(this._$Ep=t)}createRenderRoot(){const t=this.shadowRoot??this.attachShadow(this.constructor.shadowRootOptions);return((t,e)=>{if(r)t.adoptedStyleSheets=e.map((t=>t instanceof CSSStyleSheet?t:t.styleSheet));else for(const s of e){const e=document.createElement("style"),r=i.litNonce;void 0!==r&&e.setAttribute("nonce",r),e.textContent=s.cssText,t.appendChild(e)}})(t,this.constructor.elementStyles),t}connectedCallback(){var t;this.renderRoot??(this.renderRoot=this.createRenderRoot()),this.enableUpdating(!0),null==(t=this._$EO)||t.forEach((t=>{var e;return null==(e=t.hostConnected)?void 0:e.call(t)}))}enableUpdating(t){}disconnectedCallback(){var t;null==(t=this._$EO)||t.forEach((t=>{var e;return null==(e=t.hostDisconnected)?void 0:e.call(t)}))}attributeChangedCallback(t,e,s){this._$AK(t,s)}_$EC(t,e){var s;const i=this.constructor.elementProperties.get(t),r=this.constructor._$Eu(t,i);if(void 0!==r&&!0===i.reflect){const n=(void 0!==(null==(s=i.converter)?void 0:s.toAttribute)?i.converter:x).toAttribute(e,i.type);this._$Em=t,null==n?this.removeAttribute(r):this.setAttribute(r,n),this._$Em=null}}_$AK(t,e){var s;const i=this.constructor,r=i._$Eh.get(t);if(void 0!==r&&this._$Em!==r){const t=i.getPropertyOptions(r),n="function"==typeof t.converter?{fromAttribute:t.converter}:void 0!==(null==(s=t.converter)?void 0:s.fromAttribute)?t.converter:x;this._$Em=r,this[r]=n.fromAttribute(e,t.type),this._$Em=null}}requestUpdate(t,e,s){if(void 0!==t){if(s??(s=this.constructor.getPropertyOptions(t)),!(s.hasChanged??_)(this[t],e))return;this.P(t,e,s)}!1===this.isUpdatePending&&(this._$ES=this._$ET())}P(t,e,s){this._$AL.has(t)||this._$AL.set(t,e),!0===s.reflect&&this._$Em!==t&&(this._$Ej??(this._$Ej=new Set)).add(t)}async _$ET(){this.isUpdatePending=!0;try{await this._$ES}catch(e){Promise.reject(e)}const t=this.scheduleUpdate();return null!=t&&await t,!this.isUpdatePending}scheduleUpdate(){return this.performUpdate()}performUpdate(){var t;if(!this.isUpdatePending)return;if(!this.hasUpdated){if(this.renderRoot??(this.renderRoot=this.createRenderRoot()),this._$Ep){for(const[t,e]of this._$Ep)this[t]=e;this._$Ep=void 0}const t=this.constructor.elementProperties;if(t.size>0)for(const[e,s]of t)!0!==s.wrapped||this._$AL.has(e)||void 0===this[e]||this.P(e,this[e],s)}let e=!1;const s=this._$AL;try{e=this.shouldUpdate(s),e?(this.willUpdate(s),null==(t=this._$EO)||t.forEach((t=>{var e;return null==(e=t.hostUpdate)?void 0:e.call(t)})),this.update(s)):this._$EU()}catch(i){throw e=!1,this._$EU(),i}e&&this._$AE(s)}willUpdate(t){}_$AE(t){var e;null==(e=this._$EO)||e.forEach((t=>{var e;return null==(e=t.hostUpdated)?void 0:e.call(t)})),this.hasUpdated||(this.hasUpdated=!0,this.firstUpdated(t)),this.updated(t)}_$EU(){this._$AL=new Map,this.isUpdatePending=!1}get updateComplete(){return this.getUpdateComplete()}getUpdateComplete(){return this._$ES}shouldUpdate(t){return!0}update(t){this._$Ej&&(this._$Ej=this._$Ej.forEach((t=>this._$EC(t,this[t])))),this._$EU()}updated(t){}firstUpdated(t){}};A.elementStyles=[],A.shadowRootOptions={mode:"open"},A[w("elementProperties")]=new Map,A[w("finalized")]=new Map,null==b||b({ReactiveElement:A}),(g.reactiveElementVersions??(g.reactiveElementVersions=[])).push("2.0.4");
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-const E=globalThis,S=E.trustedTypes,k=S?S.createPolicy("lit-html",{createHTML:t=>t}):void 0,P="$lit$",C=`lit$${(Math.random()+"").slice(9)}$`,U="?"+C,T=`<${U}>`,O=document,R=()=>O.createComment(""),M=t=>null===t||"object"!=typeof t&&"function"!=typeof t,I=Array.isArray,L="[ \t\n\f\r]",D=/<(?:(!--|\/[^a-zA-Z])|(\/?[a-zA-Z][^>\s]*)|(\/?$))/g,B=/-->/g,N=/>/g,F=RegExp(`>|${L}(?:([^\\s"'>=/]+)(${L}*=${L}*(?:[^ \t\n\f\r"'\`<>=]|("|')|))|$)`,"g"),z=/'/g,j=/"/g,V=/^(?:script|style|textarea|title)$/i,H=(K=1,(t,...e)=>({_$litType$:K,strings:t,values:e})),G=Symbol.for("lit-noChange"),W=Symbol.for("lit-nothing"),Y=new WeakMap,q=O.createTreeWalker(O,129);var K;function J(t,e){if(!Array.isArray(t)||!t.hasOwnProperty("raw"))throw Error("invalid template strings array");return void 0!==k?k.createHTML(e):e}let X=class t{constructor({strings:e,_$litType$:s},i){let r;this.parts=[];let n=0,o=0;const a=e.length-1,l=this.parts,[d,c]=((t,e)=>{const s=t.length-1,i=[];let r,n=2===e?"<svg>":"",o=D;for(let a=0;a<s;a++){const e=t[a];let s,l,d=-1,c=0;for(;c<e.length&&(o.lastIndex=c,l=o.exec(e),null!==l);)c=o.lastIndex,o===D?"!--"===l[1]?o=B:void 0!==l[1]?o=N:void 0!==l[2]?(V.test(l[2])&&(r=RegExp("</"+l[2],"g")),o=F):void 0!==l[3]&&(o=F):o===F?">"===l[0]?(o=r??D,d=-1):void 0===l[1]?d=-2:(d=o.lastIndex-l[2].length,s=l[1],o=void 0===l[3]?F:'"'===l[3]?j:z):o===j||o===z?o=F:o===B||o===N?o=D:(o=F,r=void 0);const h=o===F&&t[a+1].startsWith("/>")?" ":"";n+=o===D?e+T:d>=0?(i.push(s),e.slice(0,d)+P+e.slice(d)+C+h):e+C+(-2===d?a:h)}return[J(t,n+(t[s]||"<?>")+(2===e?"</svg>":"")),i]})(e,s);if(this.el=t.createElement(d,i),q.currentNode=this.el.content,2===s){const t=this.el.content.firstChild;t.replaceWith(...t.childNodes)}for(;null!==(r=q.nextNode())&&l.length<a;){if(1===r.nodeType){if(r.hasAttributes())for(const t of r.getAttributeNames())if(t.endsWith(P)){const e=c[o++],s=r.getAttribute(t).split(C),i=/([.?@])?(.*)/.exec(e);l.push({type:1,index:n,name:i[2],strings:s,ctor:"."===i[1]?st:"?"===i[1]?it:"@"===i[1]?rt:et}),r.removeAttribute(t)}else t.startsWith(C)&&(l.push({type:6,index:n}),r.removeAttribute(t));if(V.test(r.tagName)){const t=r.textContent.split(C),e=t.length-1;if(e>0){r.textContent=S?S.emptyScript:"";for(let s=0;s<e;s++)r.append(t[s],R()),q.nextNode(),l.push({type:2,index:++n});r.append(t[e],R())}}}else if(8===r.nodeType)if(r.data===U)l.push({type:2,index:n});else{let t=-1;for(;-1!==(t=r.data.indexOf(C,t+1));)l.push({type:7,index:n}),t+=C.length-1}n++}}static createElement(t,e){const s=O.createElement("template");return s.innerHTML=t,s}};function Z(t,e,s=t,i){var r,n;if(e===G)return e;let o=void 0!==i?null==(r=s._$Co)?void 0:r[i]:s._$Cl;const a=M(e)?void 0:e._$litDirective$;return(null==o?void 0:o.constructor)!==a&&(null==(n=null==o?void 0:o._$AO)||n.call(o,!1),void 0===a?o=void 0:(o=new a(t),o._$AT(t,s,i)),void 0!==i?(s._$Co??(s._$Co=[]))[i]=o:s._$Cl=o),void 0!==o&&(e=Z(t,o._$AS(t,e.values),o,i)),e}let Q=class{constructor(t,e){this._$AV=[],this._$AN=void 0,this._$AD=t,this._$AM=e}get parentNode(){return this._$AM.parentNode}get _$AU(){return this._$AM._$AU}u(t){const{el:{content:e},parts:s}=this._$AD,i=((null==t?void 0:t.creationScope)??O).importNode(e,!0);q.currentNode=i;let r=q.nextNode(),n=0,o=0,a=s[0];for(;void 0!==a;){if(n===a.index){let e;2===a.type?e=new tt(r,r.nextSibling,this,t):1===a.type?e=new a.ctor(r,a.name,a.strings,this,t):6===a.type&&(e=new nt(r,this,t)),this._$AV.push(e),a=s[++o]}n!==(null==a?void 0:a.index)&&(r=q.nextNode(),n++)}return q.currentNode=O,i}p(t){let e=0;for(const s of this._$AV)void 0!==s&&(void 0!==s.strings?(s._$AI(t,s,e),e+=s.strings.length-2):s._$AI(t[e])),e++}},tt=class t{get _$AU(){var t;return(null==(t=this._$AM)?void 0:t._$AU)??this._$Cv}constructor(t,e,s,i){this.type=2,this._$AH=W,this._$AN=void 0,this._$AA=t,this._$AB=e,this._$AM=s,this.options=i,this._$Cv=(null==i?void 0:i.isConnected)??!0}get parentNode(){let t=this._$AA.parentNode;const e=this._$AM;return void 0!==e&&11===(null==t?void 0:t.nodeType)&&(t=e.parentNode),t}get startNode(){return this._$AA}get endNode(){return this._$AB}_$AI(t,e=this){t=Z(this,t,e),M(t)?t===W||null==t||""===t?(this._$AH!==W&&this._$AR(),this._$AH=W):t!==this._$AH&&t!==G&&this._(t):void 0!==t._$litType$?this.$(t):void 0!==t.nodeType?this.T(t):(t=>I(t)||"function"==typeof(null==t?void 0:t[Symbol.iterator]))(t)?this.k(t):this._(t)}S(t){return this._$AA.parentNode.insertBefore(t,this._$AB)}T(t){this._$AH!==t&&(this._$AR(),this._$AH=this.S(t))}_(t){this._$AH!==W&&M(this._$AH)?this._$AA.nextSibling.data=t:this.T(O.createTextNode(t)),this._$AH=t}$(t){var e;const{values:s,_$litType$:i}=t,r="number"==typeof i?this._$AC(t):(void 0===i.el&&(i.el=X.createElement(J(i.h,i.h[0]),this.options)),i);if((null==(e=this._$AH)?void 0:e._$AD)===r)this._$AH.p(s);else{const t=new Q(r,this),e=t.u(this.options);t.p(s),this.T(e),this._$AH=t}}_$AC(t){let e=Y.get(t.strings);return void 0===e&&Y.set(t.strings,e=new X(t)),e}k(e){I(this._$AH)||(this._$AH=[],this._$AR());const s=this._$AH;let i,r=0;for(const n of e)r===s.length?s.push(i=new t(this.S(R()),this.S(R()),this,this.options)):i=s[r],i._$AI(n),r++;r<s.length&&(this._$AR(i&&i._$AB.nextSibling,r),s.length=r)}_$AR(t=this._$AA.nextSibling,e){var s;for(null==(s=this._$AP)||s.call(this,!1,!0,e);t&&t!==this._$AB;){const e=t.nextSibling;t.remove(),t=e}}setConnected(t){var e;void 0===this._$AM&&(this._$Cv=t,null==(e=this._$AP)||e.call(this,t))}},et=class{get tagName(){return this.element.tagName}get _$AU(){return this._$AM._$AU}constructor(t,e,s,i,r){this.type=1,this._$AH=W,this._$AN=void 0,this.element=t,this.name=e,this._$AM=i,this.options=r,s.length>2||""!==s[0]||""!==s[1]?(this._$AH=Array(s.length-1).fill(new String),this.strings=s):this._$AH=W}_$AI(t,e=this,s,i){const r=this.strings;let n=!1;if(void 0===r)t=Z(this,t,e,0),n=!M(t)||t!==this._$AH&&t!==G,n&&(this._$AH=t);else{const i=t;let o,a;for(t=r[0],o=0;o<r.length-1;o++)a=Z(this,i[s+o],e,o),a===G&&(a=this._$AH[o]),n||(n=!M(a)||a!==this._$AH[o]),a===W?t=W:t!==W&&(t+=(a??"")+r[o+1]),this._$AH[o]=a}n&&!i&&this.j(t)}j(t){t===W?this.element.removeAttribute(this.name):this.element.setAttribute(this.name,t??"")}},st=class extends et{constructor(){super(...arguments),this.type=3}j(t){this.element[this.name]=t===W?void 0:t}},it=class extends et{constructor(){super(...arguments),this.type=4}j(t){this.element.toggleAttribute(this.name,!!t&&t!==W)}},rt=class extends et{constructor(t,e,s,i,r){super(t,e,s,i,r),this.type=5}_$AI(t,e=this){if((t=Z(this,t,e,0)??W)===G)return;const s=this._$AH,i=t===W&&s!==W||t.capture!==s.capture||t.once!==s.once||t.passive!==s.passive,r=t!==W&&(s===W||i);i&&this.element.removeEventListener(this.name,this,s),r&&this.element.addEventListener(this.name,this,t),this._$AH=t}handleEvent(t){var e;"function"==typeof this._$AH?this._$AH.call((null==(e=this.options)?void 0:e.host)??this.element,t):this._$AH.handleEvent(t)}},nt=class{constructor(t,e,s){this.element=t,this.type=6,this._$AN=void 0,this._$AM=e,this.options=s}get _$AU(){return this._$AM._$AU}_$AI(t){Z(this,t)}};const ot=E.litHtmlPolyfillSupport;null==ot||ot(X,tt),(E.litHtmlVersions??(E.litHtmlVersions=[])).push("3.1.2");
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-let at=class extends A{constructor(){super(...arguments),this.renderOptions={host:this},this._$Do=void 0}createRenderRoot(){var t;const e=super.createRenderRoot();return(t=this.renderOptions).renderBefore??(t.renderBefore=e.firstChild),e}update(t){const e=this.render();this.hasUpdated||(this.renderOptions.isConnected=this.isConnected),super.update(t),this._$Do=((t,e,s)=>{const i=(null==s?void 0:s.renderBefore)??e;let r=i._$litPart$;if(void 0===r){const t=(null==s?void 0:s.renderBefore)??null;i._$litPart$=r=new tt(e.insertBefore(R(),t),t,void 0,s??{})}return r._$AI(t),r})(e,this.renderRoot,this.renderOptions)}connectedCallback(){var t;super.connectedCallback(),null==(t=this._$Do)||t.setConnected(!0)}disconnectedCallback(){var t;super.disconnectedCallback(),null==(t=this._$Do)||t.setConnected(!1)}render(){return G}};at._$litElement$=!0,at.finalized=!0,null==(e=globalThis.litElementHydrateSupport)||e.call(globalThis,{LitElement:at});const lt=globalThis.litElementPolyfillSupport;null==lt||lt({LitElement:at}),(globalThis.litElementVersions??(globalThis.litElementVersions=[])).push("4.0.4");
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-const dt=t=>(e,s)=>{void 0!==s?s.addInitializer((()=>{customElements.define(t,e)})):customElements.define(t,e)}
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */,ct={attribute:!0,type:String,converter:x,reflect:!1,hasChanged:_},ht=(t=ct,e,s)=>{const{kind:i,metadata:r}=s;let n=globalThis.litPropertyMetadata.get(r);if(void 0===n&&globalThis.litPropertyMetadata.set(r,n=new Map),n.set(s.name,t),"accessor"===i){const{name:i}=s;return{set(s){const r=e.get.call(this);e.set.call(this,s),this.requestUpdate(i,r,t)},init(e){return void 0!==e&&this.P(i,void 0,t),e}}}if("setter"===i){const{name:i}=s;return function(s){const r=this[i];e.call(this,s),this.requestUpdate(i,r,t)}}throw Error("Unsupported decorator location: "+i)};
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-function pt(t){return function(t){return(e,s)=>"object"==typeof s?ht(t,e,s):((t,e,s)=>{const i=e.hasOwnProperty(s);return e.constructor.createProperty(s,i?{...t,wrapped:!0}:t),i?Object.getOwnPropertyDescriptor(e,s):void 0})(t,e,s)}({...t,state:!0,attribute:!1})}
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */const ut=(t,e,s)=>(s.configurable=!0,s.enumerable=!0,Reflect.decorate&&"object"!=typeof e&&Object.defineProperty(t,e,s),s)
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */;function mt(t,e){return(s,i,r)=>{const n=e=>{var s;return(null==(s=e.renderRoot)?void 0:s.querySelector(t))??null};if(e){const{get:t,set:e}="object"==typeof i?s:r??(()=>{const t=Symbol();return{get(){return this[t]},set(e){this[t]=e}}})();return ut(s,i,{get(){let s=t.call(this);return void 0===s&&(s=n(this),(null!==s||this.hasUpdated)&&e.call(this,s)),s}})}return ut(s,i,{get(){return n(this)}})}}const ft=160,gt=160,yt=1024,vt=[14743759,8831084,3172432,464929],bt=16,wt=32,xt=64,_t=128,$t=Uint8Array.of(255,255,255,255,255,255,255,255,199,199,199,207,207,255,207,255,147,147,147,255,255,255,255,255,147,1,147,147,147,1,147,255,239,131,47,131,233,3,239,255,157,91,55,239,217,181,115,255,143,39,39,143,37,51,129,255,207,207,207,255,255,255,255,255,243,231,207,207,207,231,243,255,159,207,231,231,231,207,159,255,255,147,199,1,199,147,255,255,255,231,231,129,231,231,255,255,255,255,255,255,255,207,207,159,255,255,255,129,255,255,255,255,255,255,255,255,255,207,207,255,253,251,247,239,223,191,127,255,199,179,57,57,57,155,199,255,231,199,231,231,231,231,129,255,131,57,241,195,135,31,1,255,129,243,231,195,249,57,131,255,227,195,147,51,1,243,243,255,3,63,3,249,249,57,131,255,195,159,63,3,57,57,131,255,1,57,243,231,207,207,207,255,135,59,27,135,97,121,131,255,131,57,57,129,249,243,135,255,255,207,207,255,207,207,255,255,255,207,207,255,207,207,159,255,243,231,207,159,207,231,243,255,255,255,1,255,1,255,255,255,159,207,231,243,231,207,159,255,131,1,57,243,199,255,199,255,131,125,69,85,65,127,131,255,199,147,57,57,1,57,57,255,3,57,57,3,57,57,3,255,195,153,63,63,63,153,195,255,7,51,57,57,57,51,7,255,1,63,63,3,63,63,1,255,1,63,63,3,63,63,63,255,193,159,63,49,57,153,193,255,57,57,57,1,57,57,57,255,129,231,231,231,231,231,129,255,249,249,249,249,249,57,131,255,57,51,39,15,7,35,49,255,159,159,159,159,159,159,129,255,57,17,1,1,41,57,57,255,57,25,9,1,33,49,57,255,131,57,57,57,57,57,131,255,3,57,57,57,3,63,63,255,131,57,57,57,33,51,133,255,3,57,57,49,7,35,49,255,135,51,63,131,249,57,131,255,129,231,231,231,231,231,231,255,57,57,57,57,57,57,131,255,57,57,57,17,131,199,239,255,57,57,41,1,1,17,57,255,57,17,131,199,131,17,57,255,153,153,153,195,231,231,231,255,1,241,227,199,143,31,1,255,195,207,207,207,207,207,195,255,127,191,223,239,247,251,253,255,135,231,231,231,231,231,135,255,199,147,255,255,255,255,255,255,255,255,255,255,255,255,255,1,239,247,255,255,255,255,255,255,255,255,131,249,129,57,129,255,63,63,3,57,57,57,131,255,255,255,129,63,63,63,129,255,249,249,129,57,57,57,129,255,255,255,131,57,1,63,131,255,241,231,129,231,231,231,231,255,255,255,129,57,57,129,249,131,63,63,3,57,57,57,57,255,231,255,199,231,231,231,129,255,243,255,227,243,243,243,243,135,63,63,49,3,7,35,49,255,199,231,231,231,231,231,129,255,255,255,3,73,73,73,73,255,255,255,3,57,57,57,57,255,255,255,131,57,57,57,131,255,255,255,3,57,57,3,63,63,255,255,129,57,57,129,249,249,255,255,145,143,159,159,159,255,255,255,131,63,131,249,3,255,231,231,129,231,231,231,231,255,255,255,57,57,57,57,129,255,255,255,153,153,153,195,231,255,255,255,73,73,73,73,129,255,255,255,57,1,199,1,57,255,255,255,57,57,57,129,249,131,255,255,1,227,199,143,1,255,243,231,231,207,231,231,243,255,231,231,231,231,231,231,231,255,159,207,207,231,207,207,159,255,255,255,143,69,227,255,255,255,255,255,255,255,255,147,147,255,131,41,41,17,41,41,131,255,131,57,9,17,33,57,131,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,131,17,33,125,33,17,131,255,131,17,9,125,9,17,131,255,131,17,57,85,17,17,131,255,131,17,17,85,57,17,131,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,231,255,231,231,199,199,199,255,239,131,41,47,41,131,239,255,195,153,159,3,159,159,1,255,255,165,219,219,219,165,255,255,153,153,195,129,231,129,231,255,231,231,231,255,231,231,231,255,195,153,135,219,225,153,195,255,147,255,255,255,255,255,255,255,195,189,102,94,94,102,189,195,135,195,147,195,255,255,255,255,255,201,147,39,147,201,255,255,255,255,129,249,249,255,255,255,255,255,255,255,255,255,255,255,195,189,70,90,70,90,189,195,131,255,255,255,255,255,255,255,239,215,239,255,255,255,255,255,231,231,129,231,231,255,129,255,199,243,231,195,255,255,255,255,195,231,243,199,255,255,255,255,247,239,255,255,255,255,255,255,255,255,51,51,51,51,9,63,193,149,181,149,193,245,245,255,255,255,255,207,207,255,255,255,255,255,255,255,255,255,247,207,231,199,231,195,255,255,255,255,199,147,147,199,255,255,255,255,255,39,147,201,147,39,255,255,189,59,183,173,217,177,125,255,189,59,183,169,221,187,113,255,29,187,215,45,217,177,125,255,199,255,199,159,57,1,131,255,223,239,199,147,57,1,57,255,247,239,199,147,57,1,57,255,199,147,199,147,57,1,57,255,203,167,199,147,57,1,57,255,147,255,199,147,57,1,57,255,239,215,199,147,57,1,57,255,193,135,39,33,7,39,33,255,195,153,63,63,153,195,247,207,223,239,1,63,3,63,1,255,247,239,1,63,3,63,1,255,199,147,1,63,3,63,1,255,147,255,1,63,3,63,1,255,239,247,129,231,231,231,129,255,247,239,129,231,231,231,129,255,231,195,129,231,231,231,129,255,153,255,129,231,231,231,129,255,135,147,153,9,153,147,135,255,203,167,25,9,1,33,49,255,223,239,131,57,57,57,131,255,247,239,131,57,57,57,131,255,199,147,131,57,57,57,131,255,203,167,131,57,57,57,131,255,147,255,131,57,57,57,131,255,255,187,215,239,215,187,255,255,131,57,49,41,25,57,131,255,223,239,57,57,57,57,131,255,247,239,57,57,57,57,131,255,199,147,255,57,57,57,131,255,147,255,57,57,57,57,131,255,247,239,153,153,195,231,231,255,63,3,57,57,57,3,63,255,195,153,153,147,153,137,147,255,223,239,131,249,129,57,129,255,247,239,131,249,129,57,129,255,199,147,131,249,129,57,129,255,203,167,131,249,129,57,129,255,147,255,131,249,129,57,129,255,239,215,131,249,129,57,129,255,255,255,131,233,129,47,131,255,255,255,129,63,63,129,247,207,223,239,131,57,1,63,131,255,247,239,131,57,1,63,131,255,199,147,131,57,1,63,131,255,147,255,131,57,1,63,131,255,223,239,255,199,231,231,129,255,247,239,255,199,231,231,129,255,199,147,255,199,231,231,129,255,147,255,199,231,231,231,129,255,155,135,103,131,57,57,131,255,203,167,3,57,57,57,57,255,223,239,131,57,57,57,131,255,247,239,131,57,57,57,131,255,199,147,131,57,57,57,131,255,203,167,131,57,57,57,131,255,147,255,131,57,57,57,131,255,255,231,255,129,255,231,255,255,255,255,131,49,41,25,131,255,223,239,57,57,57,57,129,255,247,239,57,57,57,57,129,255,199,147,255,57,57,57,129,255,147,255,57,57,57,57,129,255,247,239,57,57,57,129,249,131,63,63,3,57,57,3,63,63,147,255,57,57,57,129,249,131),At=new WebSocket(("https:"==location.protocol?"wss":"ws")+"://"+location.host);function Et(t){const e=new URL(location.href),s=e.searchParams.get(t);if(null!=s)return s;return new URL(e.hash.substring(1),"https://x").searchParams.get(t)}const St="0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.-:+=^!/*?&<>()[]{}@%$#".split(""),kt=[0,68,0,84,83,82,72,0,75,76,70,65,0,63,62,69,0,1,2,3,4,5,6,7,8,9,64,0,73,66,74,71,81,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,57,58,59,60,61,77,0,78,67,0,0,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,79,0,80,0,0];function Pt(t){const e=t.length,s=e%4,i=s?e+4-s:e;let r="",n=0,o=0;for(;n<i;){const s=n<e?t[n]:0;if(++n,o=256*o+s,n%4==0){let t=52200625;for(;t>=1;){const e=Math.floor(o/t)%85;r+=St[e],t/=85}o=0}}return r}function Ct(t,e){let s=0,i=0,r=0;const n=t.length,o=e.length;if(t.length%5==0)for(;i<n;){const n=t.charCodeAt(i++)-32;if(n<0||n>=kt.length)return s;if(r=85*r+kt[n],i%5==0){let t=16777216;for(;t>=1;){if(s>=o)return s;e[s++]=r/t%256,t/=256}r=0}}return s}class Ut{constructor(){this.memory=new ArrayBuffer(65536),this.globals={},this.diskBuffer=new ArrayBuffer(yt),this.diskSize=0}read(t){new Uint8Array(this.memory).set(new Uint8Array(t.memory.buffer)),this.globals={};for(const e in t.wasm.exports){const s=t.wasm.exports[e];s instanceof WebAssembly.Global&&(this.globals[e]=s.value.toString())}this.diskSize=t.diskSize,new Uint8Array(this.diskBuffer).set(new Uint8Array(t.diskBuffer,0,t.diskSize))}write(t){new Uint8Array(t.memory.buffer).set(new Uint8Array(this.memory));for(const e in t.wasm.exports){const s=t.wasm.exports[e];if(s instanceof WebAssembly.Global&&e in this.globals)try{s.value=this.globals[e]}catch{}}t.diskSize=this.diskSize,new Uint8Array(t.diskBuffer).set(new Uint8Array(this.diskBuffer,0,this.diskSize))}toBytes(){const t=(new TextEncoder).encode(JSON.stringify(this.globals)),e=new Uint8Array(65544+t.byteLength+this.diskSize),s=new DataView(e.buffer,e.byteOffset,e.byteLength);e.set(new Uint8Array(this.memory),0);let i=65536;return s.setUint32(i,t.byteLength),e.set(t,i+4),i+=4+t.byteLength,s.setUint32(i,this.diskSize),e.set(new Uint8Array(this.diskBuffer,0,this.diskSize),i+4),e}fromBytes(t){const e=new DataView(t.buffer,t.byteOffset,t.byteLength);new Uint8Array(this.memory).set(t.subarray(0,65536));let s=65536;const i=e.getUint32(s),r=t.slice(s+4,s+4+i);this.globals=JSON.parse((new TextDecoder).decode(r)),s+=4+i,this.diskSize=e.getUint32(s),new Uint8Array(this.diskBuffer).set(t.subarray(s+4,s+4+this.diskSize))}}const Tt=20;class Ot{constructor(){this.frame=-1,this.state=new Ut,this.inputs=new Array(4),this.predicted=new Array(4);for(let t=0;t<4;++t)this.inputs[t]=0,this.predicted[t]=!0}}class Rt{constructor(){this.futureInputs=new Map}}class Mt{constructor(t,e){this.currentFrame=t,this.runtime=e,this.rollbackIdx=Tt,this.history=new Array(Tt);for(let s=0;s<Tt;++s)this.history[s]=new Ot;this.players=new Array(4);for(let s=0;s<4;++s)this.players[s]=new Rt}addInputs(t,e,s){const i=this.players[t];for(const r of s){if(e>=this.currentFrame)i.futureInputs.has(e)||i.futureInputs.set(e,r);else for(let s=0,i=Tt;s<i;++s){const i=this.history[s];if(i.frame==e){i.predicted[t]&&(i.predicted[t]=!1,i.inputs[t]!=r&&(i.inputs[t]=r,this.rollbackIdx=Math.min(s,this.rollbackIdx)));break}}++e}}update(){if(this.rollbackIdx<Tt){for(let e=this.rollbackIdx+1;e<Tt;++e){const t=this.history[e];for(let s=0;s<4;++s)if(t.predicted[s]){const i=this.history[e-1];t.inputs[s]=i.inputs[s]}}let t=!0;for(;this.rollbackIdx<Tt;){const e=this.history[this.rollbackIdx++];t?(t=!1,e.state.write(this.runtime)):e.state.read(this.runtime);for(let t=0;t<4;++t)this.runtime.setGamepad(t,e.inputs[t]);this.runtime.update()}}const t=this.history[19],e=this.history.shift();this.history.push(e),e.frame=this.currentFrame,e.state.read(this.runtime);for(let s=0;s<4;++s){const i=this.players[s];let r=i.futureInputs.get(this.currentFrame);null!=r?(e.predicted[s]=!1,i.futureInputs.delete(this.currentFrame)):(e.predicted[s]=!0,r=t.inputs[s]),e.inputs[s]=r,this.runtime.setGamepad(s,r)}this.runtime.update(),++this.currentFrame}}class It{constructor(t){this.onMessage=t,this.bufferedOutput=[],this.connect(),this.keepaliveInterval=window.setInterval((()=>{this.send("",{type:"KEEPALIVE"},!1)}),15e3)}async connect(){const t=["wss://webrtc-signal-server.wasm4.org","wss://ywc2h85cv1.execute-api.us-east-1.amazonaws.com/production","wss://webrtc-signal-server.wasm4.jwq.moe","wss://iyuavuru2h.execute-api.eu-central-1.amazonaws.com/production"];for(const s of t)try{this.socket=await new Promise(((t,e)=>{const i=new WebSocket(s);i.addEventListener("open",(()=>{t(i)})),i.addEventListener("error",(()=>{e()}))}));break}catch(e){console.error(e)}if(!this.socket)throw new Error("Unable to connect to signal server");this.socket.addEventListener("message",(t=>{const{source:e,message:s}=JSON.parse(t.data);this.onMessage(e,s)}));for(const s of this.bufferedOutput)this.socket.send(s);this.bufferedOutput.length=0}send(t,e,s=!0){var i;const r=JSON.stringify({target:t,message:e});1==(null==(i=this.socket)?void 0:i.readyState)?this.socket.send(r):s&&this.bufferedOutput.push(r)}close(){var t;null==(t=this.socket)||t.close(),window.clearInterval(this.keepaliveInterval)}}class Lt{constructor(t){let e;this.connections=new Map,this.localPeerId=new Promise((t=>{e=t})),this.signalClient=new It((async(s,i)=>{switch(i.type){case"WHOAMI_REPLY":this.iceServers=i.iceServers,e(i.yourPeerId);break;case"OFFER":if(this.connections.has(s))throw new Error("Received offer for a connection we already initiated");{const e=this.createConnection(s);await e.setRemoteDescription(i.description),await e.setLocalDescription(await e.createAnswer()),t(e,s),this.signalClient.send(s,{type:"ANSWER",description:e.localDescription.toJSON()})}break;case"ANSWER":{const t=this.connections.get(s);t&&await t.setRemoteDescription(i.description)}break;case"CANDIDATE":{const t=this.connections.get(s);t&&await t.addIceCandidate(new RTCIceCandidate(i.candidate))}break;case"ABORT":{const t=this.connections.get(s);t&&t.close()}}})),this.signalClient.send("",{type:"WHOAMI_REQUEST"})}createConnection(t){const e=new RTCPeerConnection({iceServers:this.iceServers});return this.connections.set(t,e),e.addEventListener("negotiationneeded",(async()=>{await e.setLocalDescription(await e.createOffer()),this.signalClient.send(t,{type:"OFFER",description:e.localDescription.toJSON()})})),e.addEventListener("icecandidate",(({candidate:e})=>{e&&this.signalClient.send(t,{type:"CANDIDATE",candidate:e.toJSON()})})),e.addEventListener("connectionstatechange",(()=>{const s=e.connectionState;"connected"!=s&&"failed"!=s||this.connections.delete(t)})),e}connect(t){return this.connections.get(t)||this.createConnection(t)}close(){this.signalClient.close();for(const[t,e]of this.connections)e.close()}}const Dt=16384;class Bt{constructor(t){this.chunks=[],this.size=0,t.addEventListener("message",(t=>{if(t.data instanceof ArrayBuffer){const e=new Uint8Array(t.data);this.size+=e.byteLength,this.chunks.push(e)}}))}read(){const t=new Uint8Array(this.size);let e=0;for(const s of this.chunks)t.set(s,e),e+=s.byteLength;return this.chunks.length=0,this.size=0,t}}class Nt{constructor(t){this.channel=t,this.size=0}write(t){this.buffer||(this.buffer=new Uint8Array(Dt));let e=this.size,s=0;for(;s<t.length;){const i=t.subarray(s,s+Dt-e);this.buffer.set(i,e),s+=i.length,e+=i.length,e>=Dt&&(e-=Dt,this.channel.send(this.buffer))}this.size=e}flush(){this.buffer&&this.size>0&&this.channel.send(this.buffer.subarray(0,this.size)),this.buffer=void 0}}class Ft{constructor(t,e=0){this.buffer=t,this.position=e}readBit(){const t=!!(this.buffer[this.position/8>>>0]&1<<(7&this.position));return++this.position,t}readBits(t){let e=0;for(let s=0;s<t;++s)e|=+this.readBit()<<s;return e}}class zt{constructor(t,e=0){this.buffer=t,this.position=e}write1(){this.buffer[this.position/8>>>0]|=1<<(7&this.position),++this.position}write0(){this.buffer[this.position/8>>>0]&=~(1<<(7&this.position)),++this.position}writeBits(t,e){for(let s=0;s<e;++s)t&1<<s?this.write1():this.write0()}}class jt{constructor(t=.125){this.discount=t,this.average=0,this.firstUpdate=!0}update(t){if(this.firstUpdate)this.firstUpdate=!1,this.average=t;else{const e=this.discount;this.average=(1-e)*this.average+e*t}}}const Vt=8+Math.ceil(82.5),Ht=new ArrayBuffer(Vt);class Gt{constructor(t,e,s,i){this.peerId=t,this.connection=e,this.reliableChannel=s,this.unreliableChannel=i,this.playerIdx=-1,this.frame=0,this.nextNeededFrame=0,this.outboundFrame=0,this.outboundInputs=[],this.ping=new jt,this.drift=new jt,this.chunkReader=new Bt(s),this.chunkWriter=new Nt(s)}addOutboundInput(t,e){if(0==this.outboundFrame&&(this.outboundFrame=t),t<this.outboundFrame){for(let s=this.outboundFrame-t;s>0;--s)this.outboundInputs.unshift(e);this.outboundFrame=t}else{const s=t-this.outboundFrame;if(s>=this.outboundInputs.length){for(let t=this.outboundInputs.length;t<s;++t)this.outboundInputs[t]=t>0?this.outboundInputs[t-1]:0;this.outboundInputs[s]=e}}}sendMessage(t){this.reliableChannel.send(JSON.stringify(t))}sendUnreliableBuffer(t){this.unreliableChannel.send(t)}sendPingRequest(){const t=new DataView(Ht);t.setUint8(0,2),t.setUint32(1,performance.now()>>>0),this.sendUnreliableBuffer(new Uint8Array(Ht,0,5))}sendPingReply(t){const e=new DataView(Ht);e.setUint8(0,3),e.setUint32(1,t),this.sendUnreliableBuffer(new Uint8Array(Ht,0,5))}sendTick(t){const e=new DataView(Ht);e.setUint8(0,1),e.setUint32(1,t),e.setInt8(5,0==this.nextNeededFrame?-127:this.nextNeededFrame-t),e.setInt8(6,this.outboundFrame-t),e.setUint8(7,this.outboundInputs.length);const s=new zt(new Uint8Array(Ht,8));let i=0;for(const n of this.outboundInputs){const t=i^n;i=n;for(let e=0;e<8;++e)t&1<<e&&(s.write1(),s.writeBits(e,3));s.write0()}const r=8+Math.ceil(s.position/8);this.sendUnreliableBuffer(new Uint8Array(Ht,0,r))}close(){this.reliableChannel.close(),this.unreliableChannel.close(),this.connection.close()}}class Wt{constructor(t){this.runtime=t,this.remotePlayers=new Map,this.localPlayerIdx=-1,this.updateCount=0,this.peerMgr=new Lt((async(t,e)=>{const s=Array.from(this.remotePlayers.keys()),i=await this.createRemotePlayer(t,e);i.sendMessage({type:"WELCOME",otherPeers:s}),this.localPlayerIdx>=0&&i.sendMessage({type:"PLAYER_INFO",playerIdx:this.localPlayerIdx})}))}host(){this.runtime.setNetplay(0),this.rollbackMgr=new Mt(1,this.runtime),this.localPlayerIdx=0}join(t){const e=this.peerMgr.connect(t);this.createRemotePlayer(e,t).then((t=>{t.sendMessage({type:"JOIN_REQUEST"})}),(t=>{this.runtime.blueScreen("Failed to connect\nto peer. They may\nbe offline?")}))}async getInviteLink(){const t=await this.peerMgr.localPeerId,e=window.location;if("file:"==e.protocol||"localhost"==e.hostname||"127.0.0.1"==e.hostname||"wasm4.org"==e.hostname)return`https://wasm4.org/netplay/#${t}`;const s=new URL(e.href);return s.searchParams.set("netplay",t),s.href}close(){for(const t of this.remotePlayers.values())t.close();this.peerMgr.close()}async createRemotePlayer(t,e){function s(e){return new Promise(((s,i)=>{const r=t.createDataChannel("WASM-4",e);r.binaryType="arraybuffer",r.onopen=()=>{s(r)},r.onerror=i}))}const[i,r]=await Promise.all([s({negotiated:!0,id:0}),s({negotiated:!0,id:1,ordered:!1,maxRetransmits:0})]),n=new Gt(e,t,i,r);this.remotePlayers.set(e,n);const o=()=>{this.remotePlayers.has(e)&&(this.remotePlayers.delete(e),this.onleave&&n.playerIdx>=0&&this.onleave(n.playerIdx))};return t.addEventListener("connectionstatechange",(()=>{"disconnected"==t.connectionState&&o()})),i.addEventListener("close",o),r.addEventListener("close",o),i.addEventListener("message",(async t=>{if("string"!=typeof t.data)return;const e=JSON.parse(t.data);switch(e.type){case"WELCOME":for(const t of e.otherPeers)if(!this.remotePlayers.has(t)){const e=this.peerMgr.connect(t),s=await this.createRemotePlayer(e,t);this.localPlayerIdx>=0&&s.sendMessage({type:"PLAYER_INFO",playerIdx:this.localPlayerIdx})}break;case"JOIN_REQUEST":{const t=this.nextPlayerIdx();if(t>=4)n.sendMessage({type:"JOIN_REJECT"}),n.close();else{n.playerIdx=t,n.chunkWriter.write(this.runtime.wasmBuffer);const e=new Ut;e.read(this.runtime),n.chunkWriter.write(e.toBytes()),n.chunkWriter.flush(),n.sendMessage({type:"JOIN_REPLY",yourPlayerIdx:n.playerIdx,frame:this.rollbackMgr.currentFrame,stateOffset:this.runtime.wasmBuffer.byteLength}),this.onjoin&&this.onjoin(n.playerIdx)}}break;case"JOIN_REPLY":{this.localPlayerIdx=e.yourPlayerIdx;for(const e of this.remotePlayers.values())e!=n&&e.sendMessage({type:"PLAYER_INFO",playerIdx:this.localPlayerIdx});const t=n.chunkReader.read(),s=t.subarray(0,e.stateOffset),i=t.subarray(e.stateOffset);await this.runtime.load(s,!1);const r=new Ut;r.fromBytes(i),r.write(this.runtime),this.runtime.setNetplay(this.localPlayerIdx),this.rollbackMgr=new Mt(e.frame,this.runtime),this.onstart&&this.onstart(this.localPlayerIdx)}break;case"JOIN_REJECT":this.runtime.blueScreen("Connected, but the\ngame is already\nfull!"),this.close();break;case"PLAYER_INFO":-1==n.playerIdx&&(n.playerIdx=e.playerIdx,this.onjoin&&this.onjoin(n.playerIdx))}})),r.addEventListener("message",(async t=>{const e=t.data,s=new DataView(e);switch(s.getUint8(0)){case 1:if(this.rollbackMgr&&n.playerIdx>=0){const t=s.getUint32(1);if(t>n.frame){const i=s.getInt8(5)+t,r=s.getInt8(6)+t,o=s.getUint8(7),a=new Ft(new Uint8Array(e,8)),l=new Array(o);let d=0;for(let t=0;t<o;++t){for(;a.readBit();){d^=1<<a.readBits(3)}l[t]=d}if(n.frame=t,n.nextNeededFrame=r+l.length,0==n.outboundFrame)n.outboundFrame=i;else if(i>n.outboundFrame){const t=i-n.outboundFrame;n.outboundFrame=i,n.outboundInputs.splice(0,t)}const c=t+.5*n.ping.average*60/1e3,h=this.rollbackMgr.currentFrame-c;n.drift.update(h),this.rollbackMgr.addInputs(n.playerIdx,r,l)}}break;case 2:{const t=s.getUint32(1);n.sendPingReply(t)}break;case 3:{const t=s.getUint32(1),e=(performance.now()>>>0)-t;n.ping.update(e)}}})),n}nextPlayerIdx(){t:for(let t=0;t<4;++t)if(this.localPlayerIdx!=t){for(const e of this.remotePlayers.values())if(e.playerIdx==t)continue t;return t}return-1}update(t){if(!this.rollbackMgr)return!1;const e=0==(7&this.updateCount),s=0==(31&this.updateCount);++this.updateCount;const i=this.rollbackMgr.currentFrame,r=i+2;this.rollbackMgr.addInputs(this.localPlayerIdx,r,[t]);let n=!1;for(const o of this.remotePlayers.values())o.addOutboundInput(r,t),o.sendTick(i),(o.nextNeededFrame<i-Tt||o.outboundInputs.length>=20)&&(n=!0),s&&o.sendPingRequest();if(e){let t=0;for(const e of this.remotePlayers.values())t=Math.max(e.drift.average,t);t>=1&&(n=!0)}return n||this.rollbackMgr.update(),!n}getSummary(){const t=[{playerIdx:this.localPlayerIdx,ping:-1}];for(const e of this.remotePlayers.values())t.push({playerIdx:e.playerIdx,ping:e.ping.average});return t.sort(((t,e)=>t.playerIdx-e.playerIdx)),t}}const Yt='"use strict";(()=>{var M=Math.floor(44.1),b=class{constructor(){this.freq1=0;this.freq2=0;this.startTime=0;this.attackTime=0;this.decayTime=0;this.sustainTime=0;this.releaseTime=0;this.endTick=0;this.sustainVolume=0;this.peakVolume=0;this.phase=0;this.pan=0;this.pulseDutyCycle=0;this.noiseSeed=1;this.noiseLastRandom=0}};function L(m,e,s){return m+s*(e-m)}function V(m,e){if(m<e){let s=m/e;return s+s-s*s}else if(m>1-e){let s=(m-(1-e))/e;return 1-(s+s-s*s)}else return 1}function x(m,e){return Math.pow(2,(m-69+e/256)/12)*440}var y=class extends AudioWorkletProcessor{constructor(){super(),this.time=0,this.ticks=0,this.channels=new Array(4);for(let e=0;e<4;++e)this.channels[e]=new b;this.port!=null&&(this.port.onmessage=e=>{e.data==="tick"?this.tick():this.tone(...e.data)})}ramp(e,s,f,u){if(this.time>=u)return s;let a=(this.time-f)/(u-f);return L(e,s,a)}getCurrentFrequency(e){return e.freq2>0?this.ramp(e.freq1,e.freq2,e.startTime,e.releaseTime):e.freq1}getCurrentVolume(e){let s=this.time;return s>=e.sustainTime&&e.releaseTime-e.sustainTime>M?this.ramp(e.sustainVolume,0,e.sustainTime,e.releaseTime):s>=e.decayTime?e.sustainVolume:s>=e.attackTime?this.ramp(e.peakVolume,e.sustainVolume,e.attackTime,e.decayTime):this.ramp(0,e.peakVolume,e.startTime,e.attackTime)}tick(){this.ticks++}tone(e,s,f,u){let a=e&65535,p=e>>16&65535,A=s&255,h=s>>8&255,o=s>>16&255,i=s>>24&255,E=Math.min(f&255,100),l=Math.min(f>>8&255,100),n=u&3,r=u>>2&3,c=u>>4&3,d=u&64,t=this.channels[n];this.time>t.releaseTime&&this.ticks!=t.endTick&&(t.phase=n==2?.25:0),d?(t.freq1=x(a&255,a>>8),t.freq2=p==0?0:x(p&255,p>>8)):(t.freq1=a,t.freq2=p),t.startTime=this.time,t.attackTime=t.startTime+(44100*i/60>>>0),t.decayTime=t.attackTime+(44100*o/60>>>0),t.sustainTime=t.decayTime+(44100*A/60>>>0),t.releaseTime=t.sustainTime+(44100*h/60>>>0),t.endTick=this.ticks+i+o+A+h,t.pan=c;let T=n==2?.25:.15;if(t.sustainVolume=T*E/100,t.peakVolume=l?T*l/100:T,n==0||n==1)switch(r){case 0:t.pulseDutyCycle=.125;break;case 1:case 3:default:t.pulseDutyCycle=.25;break;case 2:t.pulseDutyCycle=.5;break}else n==2&&h==0&&(t.releaseTime+=M)}process(e,[[s,f]],u){for(let a=0,p=s.length;a<p;++a,++this.time){let A=0,h=0;for(let o=0;o<4;++o){let i=this.channels[o];if(this.time<i.releaseTime||this.ticks==i.endTick){let E=this.getCurrentFrequency(i),l=this.getCurrentVolume(i),n;if(o==3){for(i.phase+=E*E/(1e6/44100*44100);i.phase>0;){i.phase--;let r=i.noiseSeed;r^=r>>7,r^=r<<9,r^=r>>13,i.noiseSeed=r,i.noiseLastRandom=((r&1)<<1)-1}n=l*i.noiseLastRandom}else{let r=E/44100,c=i.phase+r;if(c>=1&&c--,i.phase=c,o==2)n=l*(2*Math.abs(2*i.phase-1)-1);else{let d,t,T,k=i.pulseDutyCycle;c<k?(d=c/k,t=r/k,T=l):(d=(c-k)/(1-k),t=r/(1-k),T=-l),n=T*V(d,t)}}i.pan!=1&&(h+=n),i.pan!=2&&(A+=n)}}s[a]=A,f[a]=h}return!0}};registerProcessor("wasm4-apu",y);})();\n';class qt{constructor(){this.audioCtx=new(window.AudioContext||window.webkitAudioContext)({sampleRate:44100})}async init(){const t=this.audioCtx,e=new Blob([Yt],{type:"application/javascript"}),s=URL.createObjectURL(e);try{await t.audioWorklet.addModule(s);const e=new AudioWorkletNode(t,"wasm4-apu",{outputChannelCount:[2]});this.processorPort=e.port,e.connect(t.destination)}catch(i){let e;console.warn("AudioWorklet loading failed, falling back to slow audio",i);const s=(t,s)=>{e=new s};new Function("registerProcessor","AudioWorkletProcessor",Yt)(s,class{}),this.processor=e;const r=t.createScriptProcessor(1024,0,2);r.onaudioprocess=t=>{const s=t.outputBuffer.getChannelData(0),i=t.outputBuffer.getChannelData(1);e.process(null,[[s,i]],null)},r.connect(t.destination)}}tick(){null!=this.processorPort?this.processorPort.postMessage("tick"):this.processor.tick()}tone(t,e,s,i){null!=this.processorPort?this.processorPort.postMessage([t,e,s,i]):this.processor.tone(t,e,s,i)}unlockAudio(){const t=this.audioCtx;"suspended"==t.state&&t.resume()}pauseAudio(){const t=this.audioCtx;"running"==t.state&&t.suspend()}}class Kt{constructor(t,e){this.view=t,this.baseAddr=e}get game_mode(){return this.view.getUint32(this.baseAddr+0,!0)}set game_mode(t){this.view.setUint32(this.baseAddr+0,t,!0)}get max_frames(){return this.view.getUint32(this.baseAddr+4,!0)}set max_frames(t){this.view.setUint32(this.baseAddr+4,t,!0)}get game_seed(){return this.view.getUint32(this.baseAddr+8,!0)}set game_seed(t){this.view.setUint32(this.baseAddr+8,t,!0)}get frames(){return this.view.getUint32(this.baseAddr+12,!0)}set frames(t){this.view.setUint32(this.baseAddr+12,t,!0)}get score(){return this.view.getUint32(this.baseAddr+16,!0)}set score(t){this.view.setUint32(this.baseAddr+16,t,!0)}get health(){return this.view.getUint32(this.baseAddr+20,!0)}set health(t){this.view.setUint32(this.baseAddr+20,t,!0)}}class Jt{constructor(t){this.bytes=new Uint8Array(t,416,6400),this.drawColors=new Uint16Array(t,20,1)}clear(){this.bytes.fill(0)}drawPoint(t,e,s){const i=ft*s+e>>>2,r=(3&e)<<1,n=3<<r;this.bytes[i]=t<<r|this.bytes[i]&~n}drawPointUnclipped(t,e,s){e>=0&&e<ft&&s>=0&&s<gt&&this.drawPoint(t,e,s)}drawHLineFast(t,e,s,i){const r=i-(3&i),n=Math.min(e+3&-4,r);if(r-n>3){for(let r=e;r<n;r++)this.drawPoint(t,r,s);const i=ft*s+n>>>2,o=ft*s+r>>>2,a=85*t;this.bytes.fill(a,i,o),e=r}for(let o=e;o<i;o++)this.drawPoint(t,o,s)}drawHLineUnclipped(t,e,s,i){s>=0&&s<gt&&(e<0&&(e=0),i>ft&&(i=ft),e<i&&this.drawHLineFast(t,e,s,i))}drawHLine(t,e,s){const i=15&this.drawColors[0];if(0==i)return;const r=i-1&3;this.drawHLineUnclipped(r,t,e,t+s)}drawVLine(t,e,s){if(e+s<=0||t<0||t>=ft)return;const i=15&this.drawColors[0];if(0==i)return;const r=Math.max(0,e),n=Math.min(gt,e+s),o=i-1&3;for(let a=r;a<n;a++)this.drawPoint(o,t,a)}drawRect(t,e,s,i){const r=Math.max(0,t),n=Math.max(0,e),o=t+s,a=e+i,l=Math.max(0,Math.min(o,ft)),d=Math.max(0,Math.min(a,gt)),c=this.drawColors[0],h=15&c,p=c>>>4&15;if(0!==h){const t=h-1&3;for(let e=n;e<d;++e)this.drawHLineFast(t,r,e,l)}if(0!==p){const s=p-1&3;if(t>=0&&t<ft)for(let e=n;e<d;++e)this.drawPoint(s,t,e);if(o>0&&o<=ft)for(let t=n;t<d;++t)this.drawPoint(s,o-1,t);e>=0&&e<gt&&this.drawHLineFast(s,r,e,l),a>0&&a<=gt&&this.drawHLineFast(s,r,a-1,l)}}drawOval(t,e,s,i){const r=this.drawColors[0],n=15&r,o=r>>>4&15;if(15===o)return;const a=o-1&3,l=n-1&3;let d=s-1;const c=i-1;let h=c%2,p=e+Math.floor(i/2),u=t,m=t+s-1,f=p-h;const g=d*d,y=c*c;let v=4*(1-d)*y,b=4*(h+1)*g,w=v+b+h*g;d=8*g,h=8*y;do{this.drawPointUnclipped(a,m,p),this.drawPointUnclipped(a,u,p),this.drawPointUnclipped(a,u,f),this.drawPointUnclipped(a,m,f);const t=u+1;0!==n&&m-t>0&&(this.drawHLineUnclipped(l,t,p,m),this.drawHLineUnclipped(l,t,f,m));const e=2*w;e<=b&&(p+=1,f-=1,b+=d,w+=b),(e>=v||e>b)&&(u+=1,m-=1,v+=h,w+=v)}while(u<=m);for(;p-f<i;)this.drawPointUnclipped(a,u-1,p),this.drawPointUnclipped(a,m+1,p),p+=1,this.drawPointUnclipped(a,u-1,f),this.drawPointUnclipped(a,m+1,f),f-=1}drawLine(t,e,s,i){const r=15&this.drawColors[0];if(0===r)return;const n=r-1&3;if(e>i){let r=t;t=s,s=r,r=e,e=i,i=r}const o=Math.abs(s-t),a=t<s?1:-1,l=i-e;let d,c=(o>l?o:-l)/2;for(;this.drawPointUnclipped(n,t,e),t!==s||e!==i;)d=c,d>-o&&(c-=l,t+=a),d<l&&(c+=o,e++)}drawText(t,e,s){let i=e;for(let r=0,n=t.length;r<n;++r){const n=t[r];if(0===n)return;10===n?(s+=8,i=e):n>=32&&n<=255?(this.blit($t,i,s,8,8,0,n-32<<3,8),i+=8):i+=8}}blit(t,e,s,i,r,n,o,a,l=!1,d=!1,c=!1,h=!1){const p=this.drawColors[0];let u,m,f,g;h?(d=!d,u=Math.max(0,s)-s,m=Math.max(0,e)-e,f=Math.min(i,gt-s),g=Math.min(r,ft-e)):(u=Math.max(0,e)-e,m=Math.max(0,s)-s,f=Math.min(i,ft-e),g=Math.min(r,gt-s));for(let y=m;y<g;y++)for(let m=u;m<f;m++){const u=e+(h?y:m),f=s+(h?m:y);let g;const v=(o+(c?r-y-1:y))*a+(n+(d?i-m-1:m));if(l){g=t[v>>>2]>>>6-((3&v)<<1)&3}else{g=t[v>>>3]>>>7-(7&v)&1}const b=p>>>(g<<2)&15;0!==b&&this.drawPoint(b-1&3,u,f)}}}const Xt=6409,Zt=3553;class Qt{constructor(t){this.gl=t,this.colorBuffer=new Uint32Array(6400),this.paletteBuffer=new Float32Array(12),this.lastPalette=Array(4),this.paletteLocation=null;const e=new Uint32Array(256);for(let i=0;i<256;++i){const t=i>>6&3,s=i>>4&3,r=i>>2&3,n=3&i;e[i]=t<<30|s<<22|r<<14|n<<6}this.table=e;const s=t.canvas;s.addEventListener("webglcontextlost",(t=>{t.preventDefault()})),s.addEventListener("webglcontextrestored",(()=>{this.initGL()})),this.initGL()}initGL(){const t=this.gl;function e(e,s){const i=t.createShader(e);if(t.shaderSource(i,s),t.compileShader(i),!t.getShaderParameter(i,35713))throw new Error(t.getShaderInfoLog(i)+"");return i}this.lastPalette=Array(4);const s=e(35633,"\n            attribute vec2 pos;\n            varying vec2 framebufferCoord;\n\n            void main () {\n                framebufferCoord = pos*vec2(0.5, -0.5) + 0.5;\n                gl_Position = vec4(pos, 0, 1);\n            }\n        "),i=e(35632,`\n            precision mediump float;\n            uniform vec3 palette[4];\n            uniform sampler2D framebuffer;\n            varying vec2 framebufferCoord;\n\n            vec3 lookup(float index) {\n                vec3 p = palette[0];\n                ${Array.from({length:3},((t,e)=>`p = mix(p, palette[${e+1}],  step(${((e+1)/4).toFixed(2)}, index));`)).join("\n")}\n                return p;\n            }\n\n            void main () {\n                gl_FragColor = vec4(lookup(texture2D(framebuffer, framebufferCoord).r), 1.);\n            }\n        `),r=t.createProgram();if(t.attachShader(r,s),t.attachShader(r,i),t.linkProgram(r),!t.getProgramParameter(r,35714))throw new Error(t.getProgramInfoLog(r)+"");t.useProgram(r),this.paletteLocation=t.getUniformLocation(r,"palette"),t.uniform1i(t.getUniformLocation(r,"framebuffer"),0),t.detachShader(r,s),t.deleteShader(s),t.detachShader(r,i),t.deleteShader(i),function(e){const s=t.createTexture();t.activeTexture(e),t.bindTexture(Zt,s),t.texParameteri(Zt,10242,33071),t.texParameteri(Zt,10243,33071),t.texParameteri(Zt,10240,9728),t.texParameteri(Zt,10241,9728)}(33984),t.texImage2D(Zt,0,Xt,ft,gt,0,Xt,5121,null);const n=t.getAttribLocation(r,"pos"),o=t.createBuffer(),a=new Float32Array([-1,-1,-1,1,1,1,1,1,1,-1,-1,-1]);t.bindBuffer(34962,o),t.bufferData(34962,a,35044),t.enableVertexAttribArray(n),t.vertexAttribPointer(n,2,5126,!1,0,0)}composite(t,e){const s=this.gl,i=e.bytes,r=this.colorBuffer,n=this.table,o=this.lastPalette,a=this.paletteBuffer;let l=!1;for(let d=0,c=0;d<4;++d){const e=t[d];l=l||o[d]!==e,a[c++]=(e>>16&255)/255,a[c++]=(e>>8&255)/255,a[c++]=(255&e)/255,o[d]=e}l&&s.uniform3fv(this.paletteLocation,this.paletteBuffer);for(let d=0;d<6400;++d)r[d]=n[i[d]];s.texImage2D(Zt,0,Xt,ft,gt,0,Xt,5121,new Uint8Array(r.buffer)),s.drawArrays(4,0,6)}}function te(t,e){const s=e.reduce(((t,e)=>t+(0===e[0]?e[2]-e[1]:e[1].length)),0),i=new Uint8Array(s);let r=0;for(const n of e)0===n[0]?(i.set(t.slice(n[1],n[2]),r),r+=n[2]-n[1]):(i.set(n[1],r),r+=n[1].length);return i}function ee(t){const e=[];do{const s=127&t;t>>=7,e.push(t?128|s:s)}while(t);return new Uint8Array(e)}function se(t,e=0){let s=0,i=0,r=0;do{s=t[e++],i|=(127&s)<<r,r+=7}while(128&s);return[i,e]}class ie{constructor(t){this.wasmBuffer=null,this.wasm=null,this.warnedFileSize=!1;const e=document.createElement("canvas");e.width=ft,e.height=gt,this.canvas=e;const s=e.getContext("webgl",{alpha:!1,depth:!1,antialias:!1});if(!s)throw new Error("web-runtime: could not create wegl context");let i;this.compositor=new Qt(s),this.apu=new qt,this.diskName=t,this.diskBuffer=new ArrayBuffer(yt);try{i=localStorage.getItem(t)}catch(r){console.error("Error reading disk",r)}this.diskSize=null!=i?Ct(i,new Uint8Array(this.diskBuffer)):0,this.memory=new WebAssembly.Memory({initial:1,maximum:1}),this.data=new DataView(this.memory.buffer),this.persistentData=new Kt(this.data,160),this.framebuffer=new Jt(this.memory.buffer),this.reset(),this.pauseState=0,this.wasmBufferByteLen=0}async init(){await this.apu.init()}setMouse(t,e,s){this.data.setInt16(26,t,!0),this.data.setInt16(28,e,!0),this.data.setUint8(30,s)}setGamepad(t,e){this.data.setUint8(22+t,e)}setNetplay(t){this.data.setUint8(32,4|3&t)}getSystemFlag(t){return this.data.getUint8(31)&t}unlockAudio(){this.apu.unlockAudio()}pauseAudio(){this.apu.pauseAudio()}reset(t){const e=new Uint32Array(this.memory.buffer);t&&e.fill(0),this.pauseState&=-2,e.set(vt,1),this.data.setUint16(20,4611,!0),this.data.setInt16(26,32767,!0),this.data.setInt16(28,32767,!0)}async load(t,e=!0){this.wasmBuffer=t,this.wasmBufferByteLen=t.byteLength,this.wasm=null,t.byteLength>65536&&(this.warnedFileSize||(this.warnedFileSize=!0,this.print("Warning: Cart is larger than 65536 bytes. Ensure the release build of your cart is small enough to be bundled.")));const s={memory:this.memory,rect:this.framebuffer.drawRect.bind(this.framebuffer),oval:this.framebuffer.drawOval.bind(this.framebuffer),line:this.framebuffer.drawLine.bind(this.framebuffer),hline:this.framebuffer.drawHLine.bind(this.framebuffer),vline:this.framebuffer.drawVLine.bind(this.framebuffer),text:this.text.bind(this),textUtf8:this.textUtf8.bind(this),textUtf16:this.textUtf16.bind(this),blit:this.blit.bind(this),blitSub:this.blitSub.bind(this),tone:this.apu.tone.bind(this.apu),diskr:this.diskr.bind(this),diskw:this.diskw.bind(this),trace:this.trace.bind(this),traceUtf8:this.traceUtf8.bind(this),traceUtf16:this.traceUtf16.bind(this),tracef:this.tracef.bind(this)};await this.bluescreenOnError((async()=>{const e=function(t){const e=new DataView(t.buffer),s=e.getUint32(0),i=e.getUint32(4,!0);if(6386541!==s||1!==i)throw new Error("Invalid WASM binary");let r=8;const n=[];let o,a=0,l=0;for(;r<t.byteLength;){const e=t[r],s=r;[o,r]=se(t,r+1);const i=r+o;let d=r;if(r+=o,6===e)a+=se(t,d)[0];else if(7===e){n.push([0,l,s]),l=i;const e=new Set,r=[];let o,c,h;[o,d]=se(t,d);for(let s=0;s<o;s++){const s=d;[c,d]=se(t,d),d+=c;const i=t[d++];[h,d]=se(t,d),3===i&&e.add(h),r.push([0,s,d])}for(let t=0;t<a;t++)if(!e.has(t)){const e=(new TextEncoder).encode(`__global_${t}`),s=ee(e.length),i=ee(t),n=new Uint8Array(e.length+s.length+i.length+1);n.set(s),n.set(e,s.length),n[s.length+e.length]=3,n.set(i,s.length+e.length+1),r.push([1,n])}const p=ee(r.length),u=te(t,r),m=ee(p.length+u.length);n.push([1,new Uint8Array([7])]),n.push([1,m]),n.push([1,p]),n.push([1,u])}}return n.push([0,l,r]),te(t,n)}(t),i=await WebAssembly.instantiate(e,{env:s});this.wasm=i.instance,"function"==typeof this.wasm.exports._start&&this.wasm.exports._start(),"function"==typeof this.wasm.exports._initialize&&this.wasm.exports._initialize()}))}bluescreenOnError(t){try{return t()}catch(e){if(!(e instanceof Error))throw e;return this.printToServer(e.stack??e.message),this.blueScreen(function(t){if(t instanceof WebAssembly.RuntimeError){let e;return t.message.match(/unreachable/)?e="The cartridge has\nreached a code \nsegment marked as\nunreachable.":t.message.match(/out of bounds/)&&(e="The cartridge has\nattempted a memory\naccess that is\nout of bounds."),e+"\n\n\n\n\nHit R to reboot."}if(t instanceof WebAssembly.LinkError)return"The cartridge has\ntried to import\na missing function.\n\n\n\nSee console for\nmore details.";if(t instanceof WebAssembly.CompileError)return"The cartridge is\ncorrupted.\n\n\n\nSee console for\nmore details.";if(t instanceof re)return t.wasm4Message;return"Unknown error.\n\n\n\nSee console for\nmore details."}(e)),0}}text(t,e,s){const i=new Uint8Array(this.memory.buffer,t);this.framebuffer.drawText(i,e,s)}textUtf8(t,e,s,i){const r=new Uint8Array(this.memory.buffer,t,e);this.framebuffer.drawText(r,s,i)}textUtf16(t,e,s,i){const r=new Uint16Array(this.memory.buffer,t,e>>1);this.framebuffer.drawText(r,s,i)}blit(t,e,s,i,r,n){this.blitSub(t,e,s,i,r,0,0,i,n)}blitSub(t,e,s,i,r,n,o,a,l){const d=new Uint8Array(this.memory.buffer,t),c=1&l,h=2&l,p=4&l,u=8&l;this.framebuffer.blit(d,e,s,i,r,n,o,a,c,h,p,u)}diskr(t,e){const s=Math.min(e,this.diskSize),i=new Uint8Array(this.diskBuffer,0,s);return new Uint8Array(this.memory.buffer,t).set(i),s}diskw(t,e){const s=Math.min(e,yt),i=new Uint8Array(this.memory.buffer,t,s),r=new Uint8Array(this.diskBuffer),n=Pt(i);try{localStorage.setItem(this.diskName,n)}catch(o){console.error("Error writing disk",o)}return r.set(i),this.diskSize=s,s}getCString(t){let e="";for(;;){const s=this.data.getUint8(t++);if(0==s)break;e+=String.fromCharCode(s)}return e}print(t){console.log(t),this.printToServer(t)}printToServer(t){null!=At&&1==At.readyState&&At.send(t)}trace(t){this.print(this.getCString(t))}traceUtf8(t,e){const s=new Uint8Array(this.memory.buffer,t,e),i=(new TextDecoder).decode(s);this.print(i)}traceUtf16(t,e){const s=new Uint8Array(this.memory.buffer,t,e),i=new TextDecoder("utf-16").decode(s);this.print(i)}tracef(t,e){let s,i="";for(;s=this.data.getUint8(t++);)if(37==s)switch(s=this.data.getUint8(t++)){case 37:i+="%";break;case 99:i+=String.fromCharCode(this.data.getInt32(e,!0)),e+=4;break;case 100:case 120:i+=this.data.getInt32(e,!0).toString(100==s?10:16),e+=4;break;case 115:i+=this.getCString(this.data.getUint32(e,!0)),e+=4;break;case 102:i+=this.data.getFloat64(e,!0),e+=8;break;default:i+="%"+String.fromCharCode(s)}else i+=String.fromCharCode(s);this.print(i)}start(){let t=this.wasm.exports.start;"function"==typeof t&&this.bluescreenOnError(t)}update(){if(0!=this.pauseState)return!0;this.getSystemFlag(1)||this.framebuffer.clear();const t=this.wasm.exports.update;if("function"==typeof t){const e=this.bluescreenOnError(t);return this.apu.tick(),0!==e}return this.apu.tick(),!0}blueScreen(t){this.pauseState|=1;const e=t=>[...t].map((t=>t.charCodeAt(0))),s=" WASM-4 ",i=s;new Uint32Array(this.memory.buffer).set([1118702,8831084,11184810,16777215],1),this.data.setUint16(20,4611,!0),this.framebuffer.clear(),this.framebuffer.drawHLine(48,19,64),this.data.setUint16(20,4401,!0),this.framebuffer.drawText(e(i),48,20),this.data.setUint16(20,4611,!0),this.framebuffer.drawText(e(t),9,60),this.composite()}composite(){const t=new Uint32Array(this.memory.buffer,4,4);this.compositor.composite(t,this.framebuffer)}}class re extends Error{constructor(t){super(t.replace("\n"," ")),this.name="Wasm4Error",this.wasm4Message=t}}var ne=Object.defineProperty,oe=Object.getOwnPropertyDescriptor,ae=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?oe(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&ne(e,s,n),n};class le{constructor(){this.gamepad=[0,0,0,0],this.mouseX=0,this.mouseY=0,this.mouseButtons=0}}class de{constructor(){this.events=[],this.previousGamepadState=[0,0,0,0],this.currentFrame=0,this.isRecording=!1,this.isPlaying=!1,this.playbackEvents=[],this.playbackFrame=0}startRecording(){this.isRecording=!0,this.events=[],this.currentFrame=0,this.previousGamepadState=[0,0,0,0],console.log("Started gamepad event recording")}stopRecording(){this.isRecording=!1,console.log(`Stopped gamepad event recording. Recorded ${this.events.length} events.`)}get isRecordingActive(){return this.isRecording}get isPlayingActive(){return this.isPlaying}startPlayback(t){this.isPlaying=!0,this.playbackEvents=[...t],this.playbackFrame=0,console.log(`Started playback of ${t.length} events`)}stopPlayback(){this.isPlaying=!1,this.playbackEvents=[],this.playbackFrame=0,console.log("Stopped playback")}getPlaybackGamepadState(){if(!this.isPlaying)return[0,0,0,0];const t=[0,0,0,0];for(const e of this.playbackEvents)e.frame<=this.playbackFrame&&(0===e.eventType?t[e.playerIdx]|=e.button:1===e.eventType&&(t[e.playerIdx]&=~e.button));return this.playbackFrame++,t}loadFromFile(){return new Promise(((t,e)=>{const s=document.createElement("input");s.type="file",s.accept=".bin",s.onchange=s=>{var i;const r=null==(i=s.target.files)?void 0:i[0];if(!r)return void e(new Error("No file selected"));const n=new FileReader;n.onload=()=>{try{const e=new Uint8Array(n.result),s=this.deserializeFromByteStream(e);this.startPlayback(s),console.log(`Loaded ${s.length} events from file`),t()}catch(s){e(s)}},n.onerror=()=>e(new Error("Failed to read file")),n.readAsArrayBuffer(r)},s.oncancel=()=>e(new Error("File selection cancelled")),document.body.appendChild(s),s.click(),document.body.removeChild(s)}))}recordFrame(t){if(this.isRecording){for(let e=0;e<4;e++){const s=this.previousGamepadState[e],i=t[e];for(let t=0;t<8;t++){const r=1<<t,n=0!=(s&r),o=0!=(i&r);!n&&o&&this.events.push({frame:this.currentFrame,playerIdx:e,button:r,eventType:0}),n&&!o&&this.events.push({frame:this.currentFrame,playerIdx:e,button:r,eventType:1})}}this.previousGamepadState=[...t],this.currentFrame++}}getEvents(){return[...this.events]}serializeToByteStream(){const t=4+8*this.events.length,e=new ArrayBuffer(t),s=new DataView(e);s.setUint32(0,this.events.length,!0);let i=4;for(const r of this.events)s.setUint32(i,r.frame,!0),s.setUint8(i+4,r.playerIdx),s.setUint8(i+5,r.button),s.setUint8(i+6,r.eventType),s.setUint8(i+7,0),i+=8;return new Uint8Array(e)}deserializeFromByteStream(t){const e=new DataView(t.buffer,t.byteOffset,t.byteLength),s=e.getUint32(0,!0),i=[];let r=4;for(let n=0;n<s;n++)i.push({frame:e.getUint32(r,!0),playerIdx:e.getUint8(r+4),button:e.getUint8(r+5),eventType:e.getUint8(r+6)}),r+=8;return i}exportToFile(t){const e=Pt(this.serializeToByteStream()),s={persistentData:{game_mode:t.game_mode,max_frames:t.max_frames,game_seed:t.game_seed,frames:t.frames,score:t.score,health:t.health},gamepadEvents:e},i=JSON.stringify(s,null,2),r=new Blob([i],{type:"application/json"}),n=URL.createObjectURL(r),o=document.createElement("a");o.href=n,o.download=`game-recording-${t.game_seed}.json`,document.body.appendChild(o),o.click(),document.body.removeChild(o),URL.revokeObjectURL(n),console.log(`Exported persistent data and ${this.events.length} events to ${o.download}`)}getRecordingSummary(){if(!this.isRecording&&0===this.events.length)return"No recording available";return`${this.isRecording?"Recording":"Stopped"} | Frame: ${this.currentFrame} | Events: ${this.events.length} | Size: ${this.serializeToByteStream().length} bytes`}}
-/**
-   * @license
-   * Copyright 2021 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-function*ce(t,e){if(void 0!==t){let s=0;for(const i of t)yield e(i,s++)}}t.App=class extends at{constructor(t){var e;super(),this.hideGamepadOverlay=!1,this.showMenu=!1,this.requestAnimationFrameId=null,this.inputState=new le,this.gamepadUnavailableWarned=new Set,this.gamepadRecorder=new de,this.onPointerUp=t=>{"touch"==t.pointerType&&function(){if(null==document.fullscreenElement){let t=function(){const t=window.frameElement;t&&(t.style.position="fixed",t.style.top="0",t.style.left="0",t.style.zIndex="99999",t.style.width="100%",t.style.height="100%")};const e=document.body.requestFullscreen&&document.body.requestFullscreen({navigationUI:"hide"});e?e.catch(t):t()}}(),this.runtime.unlockAudio()},this.run=t=>new Promise((async e=>{this.resolveRunPromise=e,await this.init(t)})),(null==t?void 0:t.container)&&t.container.appendChild(this),this.diskPrefix=(null==(e=document.getElementById("wasm4-disk-prefix"))?void 0:e.textContent)??Et("disk-prefix"),this.runtime=new ie(`${this.diskPrefix}-disk`)}async init(t){async function e(){const e=document.getElementById("wasm4-cart-json");if(e){const{WASM4_CART:t,WASM4_CART_SIZE:s}=JSON.parse(e.textContent??""),i=new Uint8Array(s);return Ct(t,i),i}{const e=await fetch(t);if(e.ok)return new Uint8Array(await e.arrayBuffer());throw new Error(`Could not load cart at url: ${t}`)}}this.runtime.persistentData.game_mode=1,this.runtime.persistentData.max_frames=7200,this.runtime.persistentData.game_seed=Date.now();const s=this.runtime;await s.init();const i=s.canvas,r=Et("netplay");r?(this.netplay=this.createNetplay(),this.netplay.join(r)):await s.load(await e());let n={toggleDevtools(){},updateCompleted(...t){}};n=await Promise.resolve().then((()=>Qr)).then((({DevtoolsManager:t})=>new t)),this.netplay||s.start(),s.persistentData.game_mode=1,s.persistentData.max_frames=600,s.persistentData.game_seed=4294967295&Date.now(),this.gamepadRecorder.startRecording(),console.log(`Starting in recording mode with seed: ${s.persistentData.game_seed}`),null==At||At.addEventListener("message",(async t=>{switch(t.data){case"reload":this.resetCart(await e());break;case"hotswap":this.resetCart(await e(),!0)}}));let o=null;const a=t=>{if(document.body.style.cursor="",t.isPrimary){const e=i.getBoundingClientRect(),s=this.inputState;s.mouseX=Math.fround(ft*(t.clientX-e.left)/e.width),s.mouseY=Math.fround(gt*(t.clientY-e.top)/e.height),s.mouseButtons=7&t.buttons}};window.addEventListener("pointerdown",a),window.addEventListener("pointerup",a),window.addEventListener("pointermove",a),i.addEventListener("contextmenu",(t=>{t.preventDefault()}));const l={F1:()=>this.onMenuButtonPressed(),F2:()=>(s.composite(),void i.toBlob((t=>{const e=URL.createObjectURL(t),s=document.createElement("a");s.href=e,s.download="wasm4-screenshot.png",s.click(),URL.revokeObjectURL(e)}))),F3:()=>function(){if(null!=o)return;const t="video/webm",e=i.captureStream();o=new MediaRecorder(e,{mimeType:t,videoBitsPerSecond:25e6});const s=[];o.ondataavailable=t=>{s.push(t.data)},o.onstop=()=>{const e=new Blob(s,{type:t}),i=URL.createObjectURL(e),r=document.createElement("a");r.href=i,r.download="wasm4-animation.webm",r.click(),URL.revokeObjectURL(i)},o.start(),setTimeout((()=>{o&&(o.requestData(),o.stop(),o=null)}),4e3)}(),F5:()=>{this.gamepadRecorder.getEvents().length>0?(this.gamepadRecorder.exportToFile(this.runtime.persistentData),this.notifications.show("Gamepad events exported")):this.notifications.show("No gamepad events to export")},F6:()=>{const t=this.gamepadRecorder.getRecordingSummary();this.notifications.show(t),console.log("Gamepad Recording Status:",t)},F7:()=>{this.gamepadRecorder.isPlayingActive?(this.gamepadRecorder.stopPlayback(),this.notifications.show("Gamepad playback stopped")):this.gamepadRecorder.loadFromFile().then((()=>this.resetCart(void 0,!1))).then((()=>{this.notifications.show("Runtime restarted - Gamepad playback started")})).catch((t=>{console.error("Failed to load gamepad events:",t),this.notifications.show("Failed to load gamepad events")}))},F8:()=>{this.showHotkeyHelp()},F9:()=>this.resetCart(),r:()=>this.resetCart(),R:()=>this.resetCart()},d=t=>{if(t.ctrlKey||t.altKey)return;if(t.srcElement instanceof HTMLElement&&"INPUT"==t.srcElement.tagName)return;const e="keydown"==t.type;if(s.unlockAudio(),document.body.style.cursor="none",e){const e=l[t.key];if(e)return e(),void t.preventDefault()}let i=0,r=0;switch(t.code){case"KeyX":case"KeyV":case"Space":case"Period":r=1;break;case"KeyZ":case"KeyC":case"Comma":r=2;break;case"ArrowUp":r=xt;break;case"ArrowDown":r=_t;break;case"ArrowLeft":r=bt;break;case"ArrowRight":r=wt;break;case"KeyA":case"KeyQ":i=1,r=1;break;case"ShiftLeft":case"Tab":i=1,r=2;break;case"KeyE":i=1,r=xt;break;case"KeyD":i=1,r=_t;break;case"KeyS":i=1,r=bt;break;case"KeyF":i=1,r=wt;break;case"NumpadMultiply":case"NumpadDecimal":i=2,r=1;break;case"NumpadSubtract":case"NumpadEnter":i=2,r=2;break;case"Numpad8":i=2,r=xt;break;case"Numpad5":i=2,r=_t;break;case"Numpad4":i=2,r=bt;break;case"Numpad6":i=2,r=wt}if(0!=r){t.preventDefault();const s=this.inputState.gamepad;e?s[i]|=r:s[i]&=~r}};if(window.addEventListener("keydown",d),window.addEventListener("keyup",d),top&&top!=window)try{top.addEventListener("keydown",d),top.addEventListener("keyup",d)}catch{}const c=()=>{if(navigator.getGamepads)for(const t of navigator.getGamepads()){if(null==t)continue;if("standard"!=t.mapping){this.gamepadUnavailableWarned.has(t.id)||(this.gamepadUnavailableWarned.add(t.id),this.notifications.show("Unsupported gamepad: "+t.id));continue}const e=t.buttons,s=t.axes;let i=0;(e[12].pressed||s[1]<-.5)&&(i|=xt),(e[13].pressed||s[1]>.5)&&(i|=_t),(e[14].pressed||s[0]<-.5)&&(i|=bt),(e[15].pressed||s[0]>.5)&&(i|=wt),(e[0].pressed||e[3].pressed||e[5].pressed||e[7].pressed)&&(i|=1),(e[1].pressed||e[2].pressed||e[4].pressed||e[6].pressed)&&(i|=2),e[9].pressed&&(this.showMenu=!0),this.inputState.gamepad[t.index%4]=i}};let h=performance.now(),p=h;const u=t=>{this.requestAnimationFrameId=requestAnimationFrame(u),c();let e=this.inputState;if(null!=this.menuOverlay){if(this.menuOverlay.applyInput(),!this.netplay)return;e=new le}let i=!1;for(t-h>=200&&(h=t);t>=h;){h+=100;let t=e.gamepad;if(this.gamepadRecorder.isPlayingActive?t=this.gamepadRecorder.getPlaybackGamepadState():this.gamepadRecorder.recordFrame(e.gamepad),this.netplay)this.netplay.update(t[0])&&(i=!0);else{for(let e=0;e<4;++e)s.setGamepad(e,t[e]);s.setMouse(e.mouseX,e.mouseY,e.mouseButtons);if(!s.update()){this.requestAnimationFrameId&&cancelAnimationFrame(this.requestAnimationFrameId);const t=Pt(this.gamepadRecorder.serializeToByteStream()),e={persistentData:this.runtime.persistentData,events_serialized:t};return this.resolveRunPromise&&this.resolveRunPromise(e),this.onExit&&this.onExit(e),void this.notifications.show("Cart exited.")}i=!0}}i&&(this.hideGamepadOverlay=!!s.getSystemFlag(2),s.composite(),n.updateCompleted(s,t-p),p=t)};requestAnimationFrame(u)}onMenuButtonPressed(){this.showMenu?this.inputState.gamepad[0]|=1:this.showMenu=!0}showHotkeyHelp(){const t=["🎮 WASM-4 Hotkeys:","F1 - Open Menu","F2 - Take Screenshot","F3 - Record Video","F4 - Start/Stop Gamepad Recording","F5 - Export Gamepad Events","F6 - Show Recording Status","F7 - Load & Replay Events","F8 - Show This Help","F9/R - Reset Cart"].join(" | ");this.notifications.show(t),console.log("WASM-4 Hotkeys:\n"+["F1 - Open Menu","F2 - Take Screenshot","F3 - Record Video","F4 - Start/Stop Gamepad Recording (restarts runtime)","F5 - Export Gamepad Events to file","F6 - Show Recording Status","F7 - Load & Replay Events from file (restarts runtime)","F8 - Show This Help","F9/R - Reset Cart"].join("\n"))}closeMenu(){if(this.showMenu){this.showMenu=!1;for(let t=0;t<4;++t)this.inputState.gamepad[t]=0}}saveGameState(){let t=this.savedGameState;null==t&&(t=this.savedGameState=new Ut),t.read(this.runtime),this.notifications.show("State saved")}loadGameState(){if(this.netplay)return void this.notifications.show("State loading disabled during netplay");const t=this.savedGameState;null!=t?(t.write(this.runtime),this.notifications.show("State loaded")):this.notifications.show("Need to save a state first")}exportGameDisk(){if(this.runtime.diskSize<=0)return void this.notifications.show("Disk is empty");const t=new Uint8Array(this.runtime.diskBuffer).slice(0,this.runtime.diskSize),e=new Blob([t],{type:"application/octet-stream"}),s=document.createElement("a");s.style.display="none",s.href=URL.createObjectURL(e),s.download=`${this.diskPrefix}.disk`,document.body.appendChild(s),s.click(),document.body.removeChild(s)}importGameDisk(){if(this.netplay)return void this.notifications.show("Disk importing disabled during netplay");const t=this,e=document.createElement("input");e.style.display="none",e.type="file",e.accept=".disk",e.multiple=!1,e.addEventListener("change",(()=>{const s=e.files;let i=new FileReader;i.addEventListener("load",(()=>{let e=new Uint8Array(i.result).slice(0,yt),s=new Uint8Array(yt);s.set(e),t.runtime.diskBuffer=s.buffer,this.runtime.diskSize=e.length;const r=Pt(e);try{localStorage.setItem(this.runtime.diskName,r),t.notifications.show("Disk imported")}catch(n){t.notifications.show("Error importing disk"),console.error("Error importing disk",n)}t.closeMenu()})),i.readAsArrayBuffer(s[0])})),document.body.appendChild(e),e.click(),document.body.removeChild(e)}clearGameDisk(){if(this.netplay)this.notifications.show("Disk clearing disabled during netplay");else{this.runtime.diskBuffer=new ArrayBuffer(yt),this.runtime.diskSize=0;try{localStorage.removeItem(this.runtime.diskName)}catch(t){this.notifications.show("Error clearing disk"),console.error("Error clearing disk",t)}this.notifications.show("Disk cleared")}}async copyNetplayLink(){this.netplay||(this.netplay=this.createNetplay(),this.netplay.host()),async function(t){try{await navigator.clipboard.writeText(t)}catch{let e=document.createElement("dialog");e.title="Netplay URL",e.textContent=t,document.body.append(e);let s=document.createElement("button");s.textContent="Copy",s.style.marginLeft="1em",s.onclick=()=>navigator.clipboard.writeText(t),e.appendChild(s);let i=document.createElement("button");i.textContent="Close",i.style.marginLeft="1em",i.onclick=()=>{document.body.removeChild(e)},e.appendChild(i),e.showModal()}}(await this.netplay.getInviteLink()),this.notifications.show("Netplay link copied to clipboard")}async resetCart(t,e=!1){if(this.netplay)return void this.notifications.show("Reset disabled during netplay");let s;t||(t=this.runtime.wasmBuffer),e&&(s=new Ut,s.read(this.runtime)),this.runtime.reset(!0),this.runtime.pauseState|=2,await this.runtime.load(t),this.runtime.pauseState&=-3,s?s.write(this.runtime):this.runtime.start()}createNetplay(){const t=new Wt(this.runtime);return t.onstart=t=>this.notifications.show(`Joined as player ${t+1}`),t.onjoin=t=>this.notifications.show(`Player ${t+1} joined`),t.onleave=t=>this.notifications.show(`Player ${t+1} left`),t}getNetplaySummary(){return this.netplay?this.netplay.getSummary():[]}connectedCallback(){super.connectedCallback(),window.addEventListener("pointerup",this.onPointerUp)}disconnectedCallback(){window.removeEventListener("pointerup",this.onPointerUp),super.disconnectedCallback()}setOnExit(t){this.onExit=t}render(){return H`<div class="content">${this.showMenu?H`<wasm4-menu-overlay .app="${this}">`:""}<wasm4-notifications></wasm4-notifications>${this.runtime.canvas}</div>${this.hideGamepadOverlay?"":H`<wasm4-virtual-gamepad .app="${this}">`}`}},t.App.styles=l`canvas{display:block;width:100%;height:100%;image-rendering:pixelated;transform:translateZ(0)}:host{animation:none!important;border:none!important;box-shadow:none!important;text-shadow:none!important;padding:0!important;margin:0!important;background:#202020;width:100%;height:100%;display:flex;flex-direction:column;align-items:center;justify-content:center;position:relative;touch-action:none;user-select:none;-webkit-user-select:none;-webkit-tap-highlight-color:transparent}.content{width:100vmin;height:100vmin;overflow:hidden}@media (pointer:coarse) and (max-aspect-ratio:2/3){.content{position:absolute;top:calc((100% - 220px - 100vmin)/ 2)}}.content canvas{width:100%;height:100%;image-rendering:pixelated}`,ae([pt()],t.App.prototype,"hideGamepadOverlay",2),ae([pt()],t.App.prototype,"showMenu",2),ae([mt("wasm4-menu-overlay")],t.App.prototype,"menuOverlay",2),ae([mt("wasm4-notifications")],t.App.prototype,"notifications",2),ae([pt()],t.App.prototype,"onExit",2),t.App=ae([dt("wasm4-app")],t.App),window.Wasm4=t.App;var he=Object.defineProperty,pe=Object.getOwnPropertyDescriptor,ue=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?pe(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&he(e,s,n),n};const me=0,fe=1,ge=[{CONTINUE:0,SAVE_STATE:1,LOAD_STATE:2,DISK_OPTIONS:3,COPY_NETPLAY_LINK:4,RESET_CART:5},{BACK:0,EXPORT_DISK:1,IMPORT_DISK:2,CLEAR_DISK:3}],ye=[["CONTINUE","SAVE STATE","LOAD STATE","DISK OPTIONS","COPY NETPLAY URL","RESET CART"],["BACK","EXPORT DISK","IMPORT DISK","CLEAR DISK"]];t.MenuOverlay=class extends at{constructor(){super(),this.lastGamepad=0,this.selectedIdx=0,this.netplaySummary=[],this.optionContext=0,this.optionContextHistory=[]}get optionIndex(){return ge[this.optionContext]}get options(){return ye[this.optionContext]}previousContext(){if(this.optionContextHistory.length>0){const t=this.optionContextHistory.pop();this.resetInput(),this.optionContext=t.context,this.selectedIdx=t.index}}switchContext(t,e=0){this.optionContextHistory.push({context:this.optionContext,index:this.selectedIdx}),this.resetInput(),this.optionContext=t,this.selectedIdx=e}resetInput(){this.app.inputState.gamepad[0]=0}applyInput(){let t=0;for(const s of this.app.inputState.gamepad)t|=s;const e=t&(t^this.lastGamepad);if(this.lastGamepad=t,3&e)if(this.optionContext===me)switch(this.selectedIdx){case this.optionIndex.CONTINUE:this.app.closeMenu();break;case this.optionIndex.SAVE_STATE:this.app.saveGameState(),this.app.closeMenu();break;case this.optionIndex.LOAD_STATE:this.app.loadGameState(),this.app.closeMenu();break;case this.optionIndex.DISK_OPTIONS:this.switchContext(fe);break;case this.optionIndex.COPY_NETPLAY_LINK:this.app.copyNetplayLink(),this.app.closeMenu();break;case this.optionIndex.RESET_CART:this.app.resetCart(),this.app.closeMenu()}else if(this.optionContext===fe)switch(this.selectedIdx){case this.optionIndex.BACK:this.previousContext();break;case this.optionIndex.EXPORT_DISK:this.app.exportGameDisk(),this.app.closeMenu();break;case this.optionIndex.IMPORT_DISK:this.resetInput(),this.app.importGameDisk();break;case this.optionIndex.CLEAR_DISK:this.app.clearGameDisk(),this.app.closeMenu()}e&_t&&this.selectedIdx++,e&xt&&this.selectedIdx--,this.selectedIdx=(this.selectedIdx+this.options.length)%this.options.length}connectedCallback(){super.connectedCallback();const t=()=>{this.netplaySummary=this.app.getNetplaySummary()};t(),this.netplayPollInterval=window.setInterval(t,1e3)}disconnectedCallback(){window.clearInterval(this.netplayPollInterval),super.disconnectedCallback()}render(){return H`<div class="version">WASM-4 v${"2.7.1"}</div><div class="menu"><ul style="display:${this.optionContext===me?"inherit":"none"}">${ce(ye[me],((t,e)=>H`<li class="${this.selectedIdx==e?"selected":""}" }>${t}</li>`))}</ul><ul style="display:${this.optionContext===fe?"inherit":"none"}">${ce(ye[fe],((t,e)=>H`<li class="${this.selectedIdx==e?"selected":""}" }>${t}</li>`))}</ul></div><div class="netplay-summary">${ce(this.netplaySummary,(t=>{const e=t.ping<100?"good":t.ping<200?"ok":"bad",s=t.ping<0?H`<span class="ping-you">YOU</span>`:H`<span class="ping-${e}">${Math.ceil(t.ping)}ms</span>`;return H`<div>PLAYER ${t.playerIdx>=0?t.playerIdx+1:"?"} ${s}</div>`}))}</div>`}},t.MenuOverlay.styles=l`:host{width:100vmin;height:100vmin;position:absolute;color:#a0a0a0;font:16px wasm4-font;display:flex;align-items:center;justify-content:center;flex-direction:column;background:rgba(0,0,0,.85)}.version{color:#fff;padding-bottom:1em}.menu{border:2px solid #f0f0f0;padding:0 1em 0 1em;line-height:2em}.netplay-summary{margin-top:2em;line-height:1.5em}.ping-you{color:#f0f0f0}.ping-good{color:green}.ping-ok{color:#ff0}.ping-bad{color:red}ul{list-style:none;padding-left:0;padding-right:1em}li::before{content:"\\00a0\\00a0"}li.selected::before{content:"> "}li.selected{color:#fff}`,ue([pt()],t.MenuOverlay.prototype,"selectedIdx",2),ue([pt()],t.MenuOverlay.prototype,"netplaySummary",2),t.MenuOverlay=ue([dt("wasm4-menu-overlay")],t.MenuOverlay);var ve=Object.defineProperty,be=Object.getOwnPropertyDescriptor,we=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?be(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&ve(e,s,n),n};function xe(t,e,s){t&&(s?t.classList.add(e):t.classList.remove(e))}t.VirtualGamepad=class extends at{constructor(){super(...arguments),this.touchEvents=new Map,this.onPointerEvent=t=>{if("touch"!=t.pointerType)return;switch(t.preventDefault(),t.type){case"pointerdown":case"pointermove":this.touchEvents.set(t.pointerId,t);break;default:this.touchEvents.delete(t.pointerId)}let e=0;if(this.touchEvents.size){const t=100,s=10,i=50,r=.6,n=this.dpad.getBoundingClientRect(),o=n.x+n.width/2,a=n.y+n.height/2,l=this.action1.getBoundingClientRect(),d=l.x+l.width/2,c=l.y+l.height/2,h=this.action2.getBoundingClientRect(),p=h.x+h.width/2,u=h.y+h.height/2;let m,f,g,y,v;for(const b of this.touchEvents.values())m=b.clientX-o,f=b.clientY-a,g=Math.sqrt(m*m+f*f),g<t&&g>s&&(y=m/g,v=f/g,-y>r?e|=bt:y>r&&(e|=wt),-v>r?e|=xt:v>r&&(e|=_t)),m=b.clientX-d,f=b.clientY-c,m*m+f*f<i*i&&(e|=1),m=b.clientX-p,f=b.clientY-u,m*m+f*f<i*i&&(e|=2)}xe(this.action1,"pressed",1&e),xe(this.action2,"pressed",2&e),xe(this.dpad,"pressed-left",e&bt),xe(this.dpad,"pressed-right",e&wt),xe(this.dpad,"pressed-up",e&xt),xe(this.dpad,"pressed-down",e&_t),this.app.inputState.gamepad[0]=e}}connectedCallback(){super.connectedCallback(),window.addEventListener("pointercancel",this.onPointerEvent),window.addEventListener("pointerdown",this.onPointerEvent),window.addEventListener("pointermove",this.onPointerEvent),window.addEventListener("pointerup",this.onPointerEvent)}disconnectedCallback(){window.removeEventListener("pointercancel",this.onPointerEvent),window.removeEventListener("pointerdown",this.onPointerEvent),window.removeEventListener("pointermove",this.onPointerEvent),window.removeEventListener("pointerup",this.onPointerEvent),super.disconnectedCallback()}onMenuButtonPressed(t){this.app.onMenuButtonPressed(),t.stopImmediatePropagation()}render(){return H`<div class="menu" @pointerdown="${this.onMenuButtonPressed}"></div><div class="dpad"></div><div class="action1">X</div><div class="action2">Z</div>`}},t.VirtualGamepad.styles=l`:host{display:none}@media (hover:none) or (pointer:coarse){:host{display:inherit}}.dpad{pointer-events:none;position:absolute;width:39px;height:120px;left:69px;bottom:30px;background:#444;border-radius:9px}.dpad:before{position:absolute;width:120px;height:39px;top:39px;left:-39px;background:#444;border-radius:9px;content:""}.dpad:after{position:absolute;height:39px;width:39px;top:39px;border-radius:100%;background:#333;content:""}.dpad.pressed-left:before{border-left:4px solid #a93671;width:116px}.dpad.pressed-right:before{border-right:4px solid #a93671;width:116px}.dpad.pressed-up{border-top:4px solid #a93671}.dpad.pressed-down{border-bottom:4px solid #a93671;height:116px}.action1{right:80px;bottom:30px}.action2{right:30px;bottom:90px}.action1,.action2{pointer-events:none;position:absolute;width:60px;height:60px;border:4px solid #a93671;border-radius:50px;color:#a93671;font:24px wasm4-font;text-align:center;line-height:60px}.action1.pressed,.action2.pressed{background:#a93671}.menu{position:absolute;background:#444;width:60px;height:20px;bottom:200px;right:35px;border-radius:10px}`,we([mt(".dpad")],t.VirtualGamepad.prototype,"dpad",2),we([mt(".action1")],t.VirtualGamepad.prototype,"action1",2),we([mt(".action2")],t.VirtualGamepad.prototype,"action2",2),t.VirtualGamepad=we([dt("wasm4-virtual-gamepad")],t.VirtualGamepad);var _e=Object.defineProperty,$e=Object.getOwnPropertyDescriptor,Ae=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?$e(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&_e(e,s,n),n};t.Notifications=class extends at{constructor(){super(...arguments),this.notifications=[]}show(t){this.notifications=this.notifications.concat([t]),setTimeout((()=>{this.notifications=this.notifications.slice(1)}),5e3)}render(){return this.notifications.map((t=>H`<div class="notification">${t}</div>`))}},t.Notifications.styles=l`:host{width:100vmin;height:100vmin;position:absolute;pointer-events:none;color:#fff;font:24px wasm4-font;display:flex;flex-direction:column}.notification{background:rgba(0,0,0,.85);padding:.5em;animation:appear .5s ease-out}@keyframes appear{from{padding-left:2em;opacity:0}to{opacity:1;padding-left:.5em}}`,Ae([pt()],t.Notifications.prototype,"notifications",2),t.Notifications=Ae([dt("wasm4-notifications")],t.Notifications);
-/**
-   * @license
-   * Copyright 2019 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-const Ee=globalThis,Se=Ee.ShadowRoot&&(void 0===Ee.ShadyCSS||Ee.ShadyCSS.nativeShadow)&&"adoptedStyleSheets"in Document.prototype&&"replace"in CSSStyleSheet.prototype,ke=Symbol(),Pe=new WeakMap;let Ce=class{constructor(t,e,s){if(this._$cssResult$=!0,s!==ke)throw Error("CSSResult is not constructable. Use `unsafeCSS` or `css` instead.");this.cssText=t,this.t=e}get styleSheet(){let t=this.o;const e=this.t;if(Se&&void 0===t){const s=void 0!==e&&1===e.length;s&&(t=Pe.get(e)),void 0===t&&((this.o=t=new CSSStyleSheet).replaceSync(this.cssText),s&&Pe.set(e,t))}return t}toString(){return this.cssText}};const Ue=t=>new Ce("string"==typeof t?t:t+"",void 0,ke),Te=(t,...e)=>{const s=1===t.length?t[0]:e.reduce(((e,s,i)=>e+(t=>{if(!0===t._$cssResult$)return t.cssText;if("number"==typeof t)return t;throw Error("Value passed to 'css' function must be a 'css' function result: "+t+". Use 'unsafeCSS' to pass non-literal values, but take care to ensure page security.")})(s)+t[i+1]),t[0]);return new Ce(s,t,ke)},Oe=Se?t=>t:t=>t instanceof CSSStyleSheet?(t=>{let e="";for(const s of t.cssRules)e+=s.cssText;return Ue(e)})(t):t
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */,{is:Re,defineProperty:Me,getOwnPropertyDescriptor:Ie,getOwnPropertyNames:Le,getOwnPropertySymbols:De,getPrototypeOf:Be}=Object,Ne=globalThis,Fe=Ne.trustedTypes,ze=Fe?Fe.emptyScript:"",je=Ne.reactiveElementPolyfillSupport,Ve=(t,e)=>t,He={toAttribute(t,e){switch(e){case Boolean:t=t?ze:null;break;case Object:case Array:t=null==t?t:JSON.stringify(t)}return t},fromAttribute(t,e){let s=t;switch(e){case Boolean:s=null!==t;break;case Number:s=null===t?null:Number(t);break;case Object:case Array:try{s=JSON.parse(t)}catch(i){s=null}}return s}},Ge=(t,e)=>!Re(t,e),We={attribute:!0,type:String,converter:He,reflect:!1,hasChanged:Ge};Symbol.metadata??(Symbol.metadata=Symbol("metadata")),Ne.litPropertyMetadata??(Ne.litPropertyMetadata=new WeakMap);let Ye=class extends HTMLElement{static addInitializer(t){this._$Ei(),(this.l??(this.l=[])).push(t)}static get observedAttributes(){return this.finalize(),this._$Eh&&[...this._$Eh.keys()]}static createProperty(t,e=We){if(e.state&&(e.attribute=!1),this._$Ei(),this.elementProperties.set(t,e),!e.noAccessor){const s=Symbol(),i=this.getPropertyDescriptor(t,s,e);void 0!==i&&Me(this.prototype,t,i)}}static getPropertyDescriptor(t,e,s){const{get:i,set:r}=Ie(this.prototype,t)??{get(){return this[e]},set(t){this[e]=t}};return{get(){return null==i?void 0:i.call(this)},set(e){const n=null==i?void 0:i.call(this);r.call(this,e),this.requestUpdate(t,n,s)},configurable:!0,enumerable:!0}}static getPropertyOptions(t){return this.elementProperties.get(t)??We}static _$Ei(){if(this.hasOwnProperty(Ve("elementProperties")))return;const t=Be(this);t.finalize(),void 0!==t.l&&(this.l=[...t.l]),this.elementProperties=new Map(t.elementProperties)}static finalize(){if(this.hasOwnProperty(Ve("finalized")))return;if(this.finalized=!0,this._$Ei(),this.hasOwnProperty(Ve("properties"))){const t=this.properties,e=[...Le(t),...De(t)];for(const s of e)this.createProperty(s,t[s])}const t=this[Symbol.metadata];if(null!==t){const e=litPropertyMetadata.get(t);if(void 0!==e)for(const[t,s]of e)this.elementProperties.set(t,s)}this._$Eh=new Map;for(const[e,s]of this.elementProperties){const t=this._$Eu(e,s);void 0!==t&&this._$Eh.set(t,e)}this.elementStyles=this.finalizeStyles(this.styles)}static finalizeStyles(t){const e=[];if(Array.isArray(t)){const s=new Set(t.flat(1/0).reverse());for(const t of s)e.unshift(Oe(t))}else void 0!==t&&e.push(Oe(t));return e}static _$Eu(t,e){const s=e.attribute;return!1===s?void 0:"string"==typeof s?s:"string"==typeof t?t.toLowerCase():void 0}constructor(){super(),this._$Ep=void 0,this.isUpdatePending=!1,this.hasUpdated=!1,this._$Em=null,this._$Ev()}_$Ev(){var t;this._$ES=new Promise((t=>this.enableUpdating=t)),this._$AL=new Map,this._$E_(),this.requestUpdate(),null==(t=this.constructor.l)||t.forEach((t=>t(this)))}addController(t){var e;(this._$EO??(this._$EO=new Set)).add(t),void 0!==this.renderRoot&&this.isConnected&&(null==(e=t.hostConnected)||e.call(t))}removeController(t){var e;null==(e=this._$EO)||e.delete(t)}_$E_(){const t=new Map,e=this.constructor.elementProperties;for(const s of e.keys())this.hasOwnProperty(s)&&(t.set(s,this[s]),delete this[s]);t.size>0&&(this._$Ep=t)}createRenderRoot(){const t=this.shadowRoot??this.attachShadow(this.constructor.shadowRootOptions);return((t,e)=>{if(Se)t.adoptedStyleSheets=e.map((t=>t instanceof CSSStyleSheet?t:t.styleSheet));else for(const s of e){const e=document.createElement("style"),i=Ee.litNonce;void 0!==i&&e.setAttribute("nonce",i),e.textContent=s.cssText,t.appendChild(e)}})(t,this.constructor.elementStyles),t}connectedCallback(){var t;this.renderRoot??(this.renderRoot=this.createRenderRoot()),this.enableUpdating(!0),null==(t=this._$EO)||t.forEach((t=>{var e;return null==(e=t.hostConnected)?void 0:e.call(t)}))}enableUpdating(t){}disconnectedCallback(){var t;null==(t=this._$EO)||t.forEach((t=>{var e;return null==(e=t.hostDisconnected)?void 0:e.call(t)}))}attributeChangedCallback(t,e,s){this._$AK(t,s)}_$EC(t,e){var s;const i=this.constructor.elementProperties.get(t),r=this.constructor._$Eu(t,i);if(void 0!==r&&!0===i.reflect){const n=(void 0!==(null==(s=i.converter)?void 0:s.toAttribute)?i.converter:He).toAttribute(e,i.type);this._$Em=t,null==n?this.removeAttribute(r):this.setAttribute(r,n),this._$Em=null}}_$AK(t,e){var s;const i=this.constructor,r=i._$Eh.get(t);if(void 0!==r&&this._$Em!==r){const t=i.getPropertyOptions(r),n="function"==typeof t.converter?{fromAttribute:t.converter}:void 0!==(null==(s=t.converter)?void 0:s.fromAttribute)?t.converter:He;this._$Em=r,this[r]=n.fromAttribute(e,t.type),this._$Em=null}}requestUpdate(t,e,s){if(void 0!==t){if(s??(s=this.constructor.getPropertyOptions(t)),!(s.hasChanged??Ge)(this[t],e))return;this.P(t,e,s)}!1===this.isUpdatePending&&(this._$ES=this._$ET())}P(t,e,s){this._$AL.has(t)||this._$AL.set(t,e),!0===s.reflect&&this._$Em!==t&&(this._$Ej??(this._$Ej=new Set)).add(t)}async _$ET(){this.isUpdatePending=!0;try{await this._$ES}catch(e){Promise.reject(e)}const t=this.scheduleUpdate();return null!=t&&await t,!this.isUpdatePending}scheduleUpdate(){return this.performUpdate()}performUpdate(){var t;if(!this.isUpdatePending)return;if(!this.hasUpdated){if(this.renderRoot??(this.renderRoot=this.createRenderRoot()),this._$Ep){for(const[t,e]of this._$Ep)this[t]=e;this._$Ep=void 0}const t=this.constructor.elementProperties;if(t.size>0)for(const[e,s]of t)!0!==s.wrapped||this._$AL.has(e)||void 0===this[e]||this.P(e,this[e],s)}let e=!1;const s=this._$AL;try{e=this.shouldUpdate(s),e?(this.willUpdate(s),null==(t=this._$EO)||t.forEach((t=>{var e;return null==(e=t.hostUpdate)?void 0:e.call(t)})),this.update(s)):this._$EU()}catch(i){throw e=!1,this._$EU(),i}e&&this._$AE(s)}willUpdate(t){}_$AE(t){var e;null==(e=this._$EO)||e.forEach((t=>{var e;return null==(e=t.hostUpdated)?void 0:e.call(t)})),this.hasUpdated||(this.hasUpdated=!0,this.firstUpdated(t)),this.updated(t)}_$EU(){this._$AL=new Map,this.isUpdatePending=!1}get updateComplete(){return this.getUpdateComplete()}getUpdateComplete(){return this._$ES}shouldUpdate(t){return!0}update(t){this._$Ej&&(this._$Ej=this._$Ej.forEach((t=>this._$EC(t,this[t])))),this._$EU()}updated(t){}firstUpdated(t){}};Ye.elementStyles=[],Ye.shadowRootOptions={mode:"open"},Ye[Ve("elementProperties")]=new Map,Ye[Ve("finalized")]=new Map,null==je||je({ReactiveElement:Ye}),(Ne.reactiveElementVersions??(Ne.reactiveElementVersions=[])).push("2.0.4");
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-const qe=globalThis,Ke=qe.trustedTypes,Je=Ke?Ke.createPolicy("lit-html",{createHTML:t=>t}):void 0,Xe="$lit$",Ze=`lit$${(Math.random()+"").slice(9)}$`,Qe="?"+Ze,ts=`<${Qe}>`,es=document,ss=()=>es.createComment(""),is=t=>null===t||"object"!=typeof t&&"function"!=typeof t,rs=Array.isArray,ns=t=>rs(t)||"function"==typeof(null==t?void 0:t[Symbol.iterator]),os="[ \t\n\f\r]",as=/<(?:(!--|\/[^a-zA-Z])|(\/?[a-zA-Z][^>\s]*)|(\/?$))/g,ls=/-->/g,ds=/>/g,cs=RegExp(`>|${os}(?:([^\\s"'>=/]+)(${os}*=${os}*(?:[^ \t\n\f\r"'\`<>=]|("|')|))|$)`,"g"),hs=/'/g,ps=/"/g,us=/^(?:script|style|textarea|title)$/i,ms=(t=>(e,...s)=>({_$litType$:t,strings:e,values:s}))(1),fs=Symbol.for("lit-noChange"),gs=Symbol.for("lit-nothing"),ys=new WeakMap,vs=es.createTreeWalker(es,129);function bs(t,e){if(!Array.isArray(t)||!t.hasOwnProperty("raw"))throw Error("invalid template strings array");return void 0!==Je?Je.createHTML(e):e}const ws=(t,e)=>{const s=t.length-1,i=[];let r,n=2===e?"<svg>":"",o=as;for(let a=0;a<s;a++){const e=t[a];let s,l,d=-1,c=0;for(;c<e.length&&(o.lastIndex=c,l=o.exec(e),null!==l);)c=o.lastIndex,o===as?"!--"===l[1]?o=ls:void 0!==l[1]?o=ds:void 0!==l[2]?(us.test(l[2])&&(r=RegExp("</"+l[2],"g")),o=cs):void 0!==l[3]&&(o=cs):o===cs?">"===l[0]?(o=r??as,d=-1):void 0===l[1]?d=-2:(d=o.lastIndex-l[2].length,s=l[1],o=void 0===l[3]?cs:'"'===l[3]?ps:hs):o===ps||o===hs?o=cs:o===ls||o===ds?o=as:(o=cs,r=void 0);const h=o===cs&&t[a+1].startsWith("/>")?" ":"";n+=o===as?e+ts:d>=0?(i.push(s),e.slice(0,d)+Xe+e.slice(d)+Ze+h):e+Ze+(-2===d?a:h)}return[bs(t,n+(t[s]||"<?>")+(2===e?"</svg>":"")),i]};let xs=class t{constructor({strings:e,_$litType$:s},i){let r;this.parts=[];let n=0,o=0;const a=e.length-1,l=this.parts,[d,c]=ws(e,s);if(this.el=t.createElement(d,i),vs.currentNode=this.el.content,2===s){const t=this.el.content.firstChild;t.replaceWith(...t.childNodes)}for(;null!==(r=vs.nextNode())&&l.length<a;){if(1===r.nodeType){if(r.hasAttributes())for(const t of r.getAttributeNames())if(t.endsWith(Xe)){const e=c[o++],s=r.getAttribute(t).split(Ze),i=/([.?@])?(.*)/.exec(e);l.push({type:1,index:n,name:i[2],strings:s,ctor:"."===i[1]?Ss:"?"===i[1]?ks:"@"===i[1]?Ps:Es}),r.removeAttribute(t)}else t.startsWith(Ze)&&(l.push({type:6,index:n}),r.removeAttribute(t));if(us.test(r.tagName)){const t=r.textContent.split(Ze),e=t.length-1;if(e>0){r.textContent=Ke?Ke.emptyScript:"";for(let s=0;s<e;s++)r.append(t[s],ss()),vs.nextNode(),l.push({type:2,index:++n});r.append(t[e],ss())}}}else if(8===r.nodeType)if(r.data===Qe)l.push({type:2,index:n});else{let t=-1;for(;-1!==(t=r.data.indexOf(Ze,t+1));)l.push({type:7,index:n}),t+=Ze.length-1}n++}}static createElement(t,e){const s=es.createElement("template");return s.innerHTML=t,s}};function _s(t,e,s=t,i){var r,n;if(e===fs)return e;let o=void 0!==i?null==(r=s._$Co)?void 0:r[i]:s._$Cl;const a=is(e)?void 0:e._$litDirective$;return(null==o?void 0:o.constructor)!==a&&(null==(n=null==o?void 0:o._$AO)||n.call(o,!1),void 0===a?o=void 0:(o=new a(t),o._$AT(t,s,i)),void 0!==i?(s._$Co??(s._$Co=[]))[i]=o:s._$Cl=o),void 0!==o&&(e=_s(t,o._$AS(t,e.values),o,i)),e}let $s=class{constructor(t,e){this._$AV=[],this._$AN=void 0,this._$AD=t,this._$AM=e}get parentNode(){return this._$AM.parentNode}get _$AU(){return this._$AM._$AU}u(t){const{el:{content:e},parts:s}=this._$AD,i=((null==t?void 0:t.creationScope)??es).importNode(e,!0);vs.currentNode=i;let r=vs.nextNode(),n=0,o=0,a=s[0];for(;void 0!==a;){if(n===a.index){let e;2===a.type?e=new As(r,r.nextSibling,this,t):1===a.type?e=new a.ctor(r,a.name,a.strings,this,t):6===a.type&&(e=new Cs(r,this,t)),this._$AV.push(e),a=s[++o]}n!==(null==a?void 0:a.index)&&(r=vs.nextNode(),n++)}return vs.currentNode=es,i}p(t){let e=0;for(const s of this._$AV)void 0!==s&&(void 0!==s.strings?(s._$AI(t,s,e),e+=s.strings.length-2):s._$AI(t[e])),e++}},As=class t{get _$AU(){var t;return(null==(t=this._$AM)?void 0:t._$AU)??this._$Cv}constructor(t,e,s,i){this.type=2,this._$AH=gs,this._$AN=void 0,this._$AA=t,this._$AB=e,this._$AM=s,this.options=i,this._$Cv=(null==i?void 0:i.isConnected)??!0}get parentNode(){let t=this._$AA.parentNode;const e=this._$AM;return void 0!==e&&11===(null==t?void 0:t.nodeType)&&(t=e.parentNode),t}get startNode(){return this._$AA}get endNode(){return this._$AB}_$AI(t,e=this){t=_s(this,t,e),is(t)?t===gs||null==t||""===t?(this._$AH!==gs&&this._$AR(),this._$AH=gs):t!==this._$AH&&t!==fs&&this._(t):void 0!==t._$litType$?this.$(t):void 0!==t.nodeType?this.T(t):ns(t)?this.k(t):this._(t)}S(t){return this._$AA.parentNode.insertBefore(t,this._$AB)}T(t){this._$AH!==t&&(this._$AR(),this._$AH=this.S(t))}_(t){this._$AH!==gs&&is(this._$AH)?this._$AA.nextSibling.data=t:this.T(es.createTextNode(t)),this._$AH=t}$(t){var e;const{values:s,_$litType$:i}=t,r="number"==typeof i?this._$AC(t):(void 0===i.el&&(i.el=xs.createElement(bs(i.h,i.h[0]),this.options)),i);if((null==(e=this._$AH)?void 0:e._$AD)===r)this._$AH.p(s);else{const t=new $s(r,this),e=t.u(this.options);t.p(s),this.T(e),this._$AH=t}}_$AC(t){let e=ys.get(t.strings);return void 0===e&&ys.set(t.strings,e=new xs(t)),e}k(e){rs(this._$AH)||(this._$AH=[],this._$AR());const s=this._$AH;let i,r=0;for(const n of e)r===s.length?s.push(i=new t(this.S(ss()),this.S(ss()),this,this.options)):i=s[r],i._$AI(n),r++;r<s.length&&(this._$AR(i&&i._$AB.nextSibling,r),s.length=r)}_$AR(t=this._$AA.nextSibling,e){var s;for(null==(s=this._$AP)||s.call(this,!1,!0,e);t&&t!==this._$AB;){const e=t.nextSibling;t.remove(),t=e}}setConnected(t){var e;void 0===this._$AM&&(this._$Cv=t,null==(e=this._$AP)||e.call(this,t))}},Es=class{get tagName(){return this.element.tagName}get _$AU(){return this._$AM._$AU}constructor(t,e,s,i,r){this.type=1,this._$AH=gs,this._$AN=void 0,this.element=t,this.name=e,this._$AM=i,this.options=r,s.length>2||""!==s[0]||""!==s[1]?(this._$AH=Array(s.length-1).fill(new String),this.strings=s):this._$AH=gs}_$AI(t,e=this,s,i){const r=this.strings;let n=!1;if(void 0===r)t=_s(this,t,e,0),n=!is(t)||t!==this._$AH&&t!==fs,n&&(this._$AH=t);else{const i=t;let o,a;for(t=r[0],o=0;o<r.length-1;o++)a=_s(this,i[s+o],e,o),a===fs&&(a=this._$AH[o]),n||(n=!is(a)||a!==this._$AH[o]),a===gs?t=gs:t!==gs&&(t+=(a??"")+r[o+1]),this._$AH[o]=a}n&&!i&&this.j(t)}j(t){t===gs?this.element.removeAttribute(this.name):this.element.setAttribute(this.name,t??"")}},Ss=class extends Es{constructor(){super(...arguments),this.type=3}j(t){this.element[this.name]=t===gs?void 0:t}},ks=class extends Es{constructor(){super(...arguments),this.type=4}j(t){this.element.toggleAttribute(this.name,!!t&&t!==gs)}},Ps=class extends Es{constructor(t,e,s,i,r){super(t,e,s,i,r),this.type=5}_$AI(t,e=this){if((t=_s(this,t,e,0)??gs)===fs)return;const s=this._$AH,i=t===gs&&s!==gs||t.capture!==s.capture||t.once!==s.once||t.passive!==s.passive,r=t!==gs&&(s===gs||i);i&&this.element.removeEventListener(this.name,this,s),r&&this.element.addEventListener(this.name,this,t),this._$AH=t}handleEvent(t){var e;"function"==typeof this._$AH?this._$AH.call((null==(e=this.options)?void 0:e.host)??this.element,t):this._$AH.handleEvent(t)}},Cs=class{constructor(t,e,s){this.element=t,this.type=6,this._$AN=void 0,this._$AM=e,this.options=s}get _$AU(){return this._$AM._$AU}_$AI(t){_s(this,t)}};const Us={P:Xe,A:Ze,C:Qe,M:1,L:ws,R:$s,D:ns,V:_s,I:As,H:Es,N:ks,U:Ps,B:Ss,F:Cs},Ts=qe.litHtmlPolyfillSupport;null==Ts||Ts(xs,As),(qe.litHtmlVersions??(qe.litHtmlVersions=[])).push("3.1.2");
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-let Os=class extends Ye{constructor(){super(...arguments),this.renderOptions={host:this},this._$Do=void 0}createRenderRoot(){var t;const e=super.createRenderRoot();return(t=this.renderOptions).renderBefore??(t.renderBefore=e.firstChild),e}update(t){const e=this.render();this.hasUpdated||(this.renderOptions.isConnected=this.isConnected),super.update(t),this._$Do=((t,e,s)=>{const i=(null==s?void 0:s.renderBefore)??e;let r=i._$litPart$;if(void 0===r){const t=(null==s?void 0:s.renderBefore)??null;i._$litPart$=r=new As(e.insertBefore(ss(),t),t,void 0,s??{})}return r._$AI(t),r})(e,this.renderRoot,this.renderOptions)}connectedCallback(){var t;super.connectedCallback(),null==(t=this._$Do)||t.setConnected(!0)}disconnectedCallback(){var t;super.disconnectedCallback(),null==(t=this._$Do)||t.setConnected(!1)}render(){return fs}};Os._$litElement$=!0,Os.finalized=!0,null==(s=globalThis.litElementHydrateSupport)||s.call(globalThis,{LitElement:Os});const Rs=globalThis.litElementPolyfillSupport;null==Rs||Rs({LitElement:Os}),(globalThis.litElementVersions??(globalThis.litElementVersions=[])).push("4.0.4");
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */
-const Ms=t=>(e,s)=>{void 0!==s?s.addInitializer((()=>{customElements.define(t,e)})):customElements.define(t,e)}
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */,Is={attribute:!0,type:String,converter:He,reflect:!1,hasChanged:Ge},Ls=(t=Is,e,s)=>{const{kind:i,metadata:r}=s;let n=globalThis.litPropertyMetadata.get(r);if(void 0===n&&globalThis.litPropertyMetadata.set(r,n=new Map),n.set(s.name,t),"accessor"===i){const{name:i}=s;return{set(s){const r=e.get.call(this);e.set.call(this,s),this.requestUpdate(i,r,t)},init(e){return void 0!==e&&this.P(i,void 0,t),e}}}if("setter"===i){const{name:i}=s;return function(s){const r=this[i];e.call(this,s),this.requestUpdate(i,r,t)}}throw Error("Unsupported decorator location: "+i)};function Ds(t){return(e,s)=>"object"==typeof s?Ls(t,e,s):((t,e,s)=>{const i=e.hasOwnProperty(s);return e.constructor.createProperty(s,i?{...t,wrapped:!0}:t),i?Object.getOwnPropertyDescriptor(e,s):void 0})(t,e,s)}
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */function Bs(t){return Ds({...t,state:!0,attribute:!1})}
-/**
-   * @license
-   * Copyright 2017 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */const Ns=1,Fs=2,zs=t=>(...e)=>({_$litDirective$:t,values:e});class js{constructor(t){}get _$AU(){return this._$AM._$AU}_$AT(t,e,s){this._$Ct=t,this._$AM=e,this._$Ci=s}_$AS(t,e){return this.update(t,e)}update(t,e){return this.render(...e)}}
-/**
-   * @license
-   * Copyright 2018 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */const Vs=zs(class extends js{constructor(t){var e;if(super(t),t.type!==Ns||"class"!==t.name||(null==(e=t.strings)?void 0:e.length)>2)throw Error("`classMap()` can only be used in the `class` attribute and must be the only part in the attribute.")}render(t){return" "+Object.keys(t).filter((e=>t[e])).join(" ")+" "}update(t,[e]){var s,i;if(void 0===this.st){this.st=new Set,void 0!==t.strings&&(this.nt=new Set(t.strings.join(" ").split(/\s/).filter((t=>""!==t))));for(const t in e)e[t]&&!(null==(s=this.nt)?void 0:s.has(t))&&this.st.add(t);return this.render(e)}const r=t.element.classList;for(const n of this.st)n in e||(r.remove(n),this.st.delete(n));for(const n in e){const t=!!e[n];t===this.st.has(n)||(null==(i=this.nt)?void 0:i.has(n))||(t?(r.add(n),this.st.add(n)):(r.remove(n),this.st.delete(n)))}return fs}}),{I:Hs}=Us,Gs=()=>document.createComment(""),Ws=(t,e,s)=>{var i;const r=t._$AA.parentNode,n=void 0===e?t._$AB:e._$AA;if(void 0===s){const e=r.insertBefore(Gs(),n),i=r.insertBefore(Gs(),n);s=new Hs(e,i,t,t.options)}else{const e=s._$AB.nextSibling,o=s._$AM,a=o!==t;if(a){let e;null==(i=s._$AQ)||i.call(s,t),s._$AM=t,void 0!==s._$AP&&(e=t._$AU)!==o._$AU&&s._$AP(e)}if(e!==n||a){let t=s._$AA;for(;t!==e;){const e=t.nextSibling;r.insertBefore(t,n),t=e}}}return s},Ys=(t,e,s=t)=>(t._$AI(e,s),t),qs={},Ks=t=>{var e;null==(e=t._$AP)||e.call(t,!1,!0);let s=t._$AA;const i=t._$AB.nextSibling;for(;s!==i;){const t=s.nextSibling;s.remove(),s=t}},Js=(t,e,s)=>{const i=new Map;for(let r=e;r<=s;r++)i.set(t[r],r);return i},Xs=zs(class extends js{constructor(t){if(super(t),t.type!==Fs)throw Error("repeat() can only be used in text expressions")}dt(t,e,s){let i;void 0===s?s=e:void 0!==e&&(i=e);const r=[],n=[];let o=0;for(const a of t)r[o]=i?i(a,o):o,n[o]=s(a,o),o++;return{values:n,keys:r}}render(t,e,s){return this.dt(t,e,s).values}update(t,[e,s,i]){const r=t._$AH,{values:n,keys:o}=this.dt(e,s,i);if(!Array.isArray(r))return this.ut=o,n;const a=this.ut??(this.ut=[]),l=[];let d,c,h=0,p=r.length-1,u=0,m=n.length-1;for(;h<=p&&u<=m;)if(null===r[h])h++;else if(null===r[p])p--;else if(a[h]===o[u])l[u]=Ys(r[h],n[u]),h++,u++;else if(a[p]===o[m])l[m]=Ys(r[p],n[m]),p--,m--;else if(a[h]===o[m])l[m]=Ys(r[h],n[m]),Ws(t,l[m+1],r[h]),h++,m--;else if(a[p]===o[u])l[u]=Ys(r[p],n[u]),Ws(t,r[h],r[p]),p--,u++;else if(void 0===d&&(d=Js(o,u,m),c=Js(a,h,p)),d.has(a[h]))if(d.has(a[p])){const e=c.get(o[u]),s=void 0!==e?r[e]:null;if(null===s){const e=Ws(t,r[h]);Ys(e,n[u]),l[u]=e}else l[u]=Ys(s,n[u]),Ws(t,r[h],s),r[e]=null;u++}else Ks(r[p]),p--;else Ks(r[h]),h++;for(;u<=m;){const e=Ws(t,l[m+1]);Ys(e,n[u]),l[u++]=e}for(;h<=p;){const t=r[h++];null!==t&&Ks(t)}return this.ut=o,((t,e=qs)=>{t._$AH=e})(t,l),fs}}),Zs=(t,e)=>{var s;const i=t._$AN;if(void 0===i)return!1;for(const r of i)null==(s=r._$AO)||s.call(r,e,!1),Zs(r,e);return!0},Qs=t=>{let e,s;do{if(void 0===(e=t._$AM))break;s=e._$AN,s.delete(t),t=e}while(0===(null==s?void 0:s.size))},ti=t=>{for(let e;e=t._$AM;t=e){let s=e._$AN;if(void 0===s)e._$AN=s=new Set;else if(s.has(t))break;s.add(t),ii(e)}};
-/**
-   * @license
-   * Copyright 2020 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */function ei(t){void 0!==this._$AN?(Qs(this),this._$AM=t,ti(this)):this._$AM=t}function si(t,e=!1,s=0){const i=this._$AH,r=this._$AN;if(void 0!==r&&0!==r.size)if(e)if(Array.isArray(i))for(let n=s;n<i.length;n++)Zs(i[n],!1),Qs(i[n]);else null!=i&&(Zs(i,!1),Qs(i));else Zs(this,t)}const ii=t=>{t.type==Fs&&(t._$AP??(t._$AP=si),t._$AQ??(t._$AQ=ei))};class ri extends js{constructor(){super(...arguments),this._$AN=void 0}_$AT(t,e,s){super._$AT(t,e,s),ti(this),this.isConnected=t._$AU}_$AO(t,e=!0){var s,i;t!==this.isConnected&&(this.isConnected=t,t?null==(s=this.reconnected)||s.call(this):null==(i=this.disconnected)||i.call(this)),e&&(Zs(this,t),Qs(this))}setValue(t){if(void 0===this._$Ct.strings)this._$Ct._$AI(t,this);else{const e=[...this._$Ct._$AH];e[this._$Ci]=t,this._$Ct._$AI(e,this,0)}}disconnected(){}reconnected(){}}
-/**
-   * @license
-   * Copyright 2020 Google LLC
-   * SPDX-License-Identifier: BSD-3-Clause
-   */class ni{}const oi=new WeakMap,ai=zs(class extends ri{render(t){return gs}update(t,[e]){var s;const i=e!==this.Y;return i&&void 0!==this.Y&&this.rt(void 0),(i||this.lt!==this.ct)&&(this.Y=e,this.ht=null==(s=t.options)?void 0:s.host,this.rt(this.ct=t.element)),gs}rt(t){if("function"==typeof this.Y){const e=this.ht??globalThis;let s=oi.get(e);void 0===s&&(s=new WeakMap,oi.set(e,s)),void 0!==s.get(this.Y)&&this.Y.call(this.ht,void 0),s.set(this.Y,t),void 0!==t&&this.Y.call(this.ht,t)}else this.Y.value=t}get lt(){var t,e;return"function"==typeof this.Y?null==(t=oi.get(this.ht??globalThis))?void 0:t.get(this.Y):null==(e=this.Y)?void 0:e.value}disconnected(){this.lt===this.ct&&this.rt(void 0)}reconnected(){this.rt(this.ct)}});var li="object"==typeof global&&global&&global.Object===Object&&global,di="object"==typeof self&&self&&self.Object===Object&&self,ci=li||di||Function("return this")(),hi=ci.Symbol,pi=Object.prototype,ui=pi.hasOwnProperty,mi=pi.toString,fi=hi?hi.toStringTag:void 0;var gi=Object.prototype.toString;var yi="[object Null]",vi="[object Undefined]",bi=hi?hi.toStringTag:void 0;function wi(t){return null==t?void 0===t?vi:yi:bi&&bi in Object(t)?function(t){var e=ui.call(t,fi),s=t[fi];try{t[fi]=void 0;var i=!0}catch(n){}var r=mi.call(t);return i&&(e?t[fi]=s:delete t[fi]),r}(t):function(t){return gi.call(t)}(t)}var xi="[object Symbol]";var _i=/\s/;var $i=/^\s+/;function Ai(t){return t?t.slice(0,function(t){for(var e=t.length;e--&&_i.test(t.charAt(e)););return e}(t)+1).replace($i,""):t}function Ei(t){var e=typeof t;return null!=t&&("object"==e||"function"==e)}var Si=NaN,ki=/^[-+]0x[0-9a-f]+$/i,Pi=/^0b[01]+$/i,Ci=/^0o[0-7]+$/i,Ui=parseInt;function Ti(t){if("number"==typeof t)return t;if(function(t){return"symbol"==typeof t||function(t){return null!=t&&"object"==typeof t}(t)&&wi(t)==xi}(t))return Si;if(Ei(t)){var e="function"==typeof t.valueOf?t.valueOf():t;t=Ei(e)?e+"":e}if("string"!=typeof t)return 0===t?t:+t;t=Ai(t);var s=Pi.test(t);return s||Ci.test(t)?Ui(t.slice(2),s?2:8):ki.test(t)?Si:+t}var Oi=function(){return ci.Date.now()},Ri="Expected a function",Mi=Math.max,Ii=Math.min;function Li(t,e,s){var i,r,n,o,a,l,d=0,c=!1,h=!1,p=!0;if("function"!=typeof t)throw new TypeError(Ri);function u(e){var s=i,n=r;return i=r=void 0,d=e,o=t.apply(n,s)}function m(t){var s=t-l;return void 0===l||s>=e||s<0||h&&t-d>=n}function f(){var t=Oi();if(m(t))return g(t);a=setTimeout(f,function(t){var s=e-(t-l);return h?Ii(s,n-(t-d)):s}(t))}function g(t){return a=void 0,p&&i?u(t):(i=r=void 0,o)}function y(){var t=Oi(),s=m(t);if(i=arguments,r=this,l=t,s){if(void 0===a)return function(t){return d=t,a=setTimeout(f,e),c?u(t):o}(l);if(h)return clearTimeout(a),a=setTimeout(f,e),u(l)}return void 0===a&&(a=setTimeout(f,e)),o}return e=Ti(e)||0,Ei(s)&&(c=!!s.leading,n=(h="maxWait"in s)?Mi(Ti(s.maxWait)||0,e):n,p="trailing"in s?!!s.trailing:p),y.cancel=function(){void 0!==a&&clearTimeout(a),d=0,i=l=r=a=void 0},y.flush=function(){return void 0===a?o:g(Oi())},y}const Di=160,Bi=65536,Ni={PALETTE:{offset:4,len:16},DRAW_COLORS:{offset:20,len:2},GAMEPAD1:{offset:22,len:1},GAMEPAD2:{offset:23,len:1},GAMEPAD3:{offset:24,len:1},GAMEPAD4:{offset:25,len:1},MOUSE_X:{offset:26,len:2},MOUSE_Y:{offset:28,len:2},MOUSE_BUTTONS:{offset:30,len:1},SYSTEM_FLAGS:{offset:31,len:1},RESERVED:{offset:32,len:128},PERSISTENT:{offset:Di,len:256},FRAMEBUFFER:{offset:416,len:6400},PROGRAM_MEMORY:{offset:6816,len:58720}},Fi=Object.freeze(Object.defineProperty({__proto__:null,ADDR_DRAW_COLORS:20,ADDR_FRAMEBUFFER:416,ADDR_GAMEPAD1:22,ADDR_GAMEPAD2:23,ADDR_GAMEPAD3:24,ADDR_GAMEPAD4:25,ADDR_MOUSE_BUTTONS:30,ADDR_MOUSE_X:26,ADDR_MOUSE_Y:28,ADDR_PALETTE:4,ADDR_PERSISTENT:Di,ADDR_SYSTEM_FLAGS:31,BUTTON_DOWN:128,BUTTON_LEFT:16,BUTTON_RIGHT:32,BUTTON_UP:64,BUTTON_X:1,BUTTON_Z:2,COLORS:[14743759,8831084,3172432,464929],HEIGHT:160,MAX_CART_SIZE:Bi,MOUSE_LEFT:1,MOUSE_MIDDLE:4,MOUSE_RIGHT:2,STORAGE_SIZE:1024,SYSTEM_HIDE_GAMEPAD_OVERLAY:2,SYSTEM_PRESERVE_FRAMEBUFFER:1,WIDTH:160,memoryMap:Ni},Symbol.toStringTag,{value:"Module"}));class zi{constructor(t,e){const s=t.getInt16(26,!0),i=t.getInt16(28,!0);this.pointerPos={x:s,y:i},this.drawColors=t.getUint16(20,!0),this.palette=function(t){const e=[0,0,0,0];for(let s=0;s<4;s++)e[s]=t.getUint32(4+4*s,!0);return e}(t),this.gamepads=function(t,e){return[t.getUint8(22)|e.gamepads[0],t.getUint8(23)|e.gamepads[1],t.getUint8(24)|e.gamepads[2],t.getUint8(25)|e.gamepads[3]]}(t,e),this.systemFlags=t.getUint8(31),this.mouseBtnByte=t.getUint8(30)|e.mouseButtons,this.getUint8=e=>t.getUint8(e),this.byteLen=t.byteLength}}const ji="wasm4-update-completed";function Vi(){try{return window.localStorage.getItem("disk")}catch(K){return console.error(K),null}}function Hi({dataView:t,fps:e,bufferedData:s,wasmBufferByteLen:i},r={bubbles:!0}){return new CustomEvent(ji,{...r,detail:{memory:new zi(t,s),fps:e,wasmBufferByteLen:i,storedValue:Vi()}})}class Gi{constructor(t){this.state=null,this.handleUpdateEvt=({detail:t})=>{if(null!=t&&t.memory){const e={memoryView:t.memory,storedValue:t.storedValue??null,fps:t.fps,wasmBufferByteLen:t.wasmBufferByteLen};this.state=e,this.host.requestUpdate()}},(this.host=t).addController(this)}hostConnected(){window.addEventListener(ji,this.handleUpdateEvt)}hostDisconnected(){window.removeEventListener(ji,this.handleUpdateEvt)}}const Wi="wasm4-close-devtools-request";function Yi(){return new CustomEvent(Wi,{bubbles:!0,composed:!0})}const qi=Te`:host{color:var(--wasm4-devtools-text-primary, #fff);background-color:var(--wasm4-devtools-bg-primary, #202020)}.text-primary{color:var(--wasm4-devtools-text-primary, #fff)!important}.text-secondary{color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7))!important}.bg-primary{background-color:var(--wasm4-devtools-bg-primary, #202020)!important}.bg-secondary{background-color:var(--wasm4-devtools-bg-secondary, #444)!important}:host{font-size:var(--wasm4-devtools-text-size, 16px);font-family:monospace;text-rendering:optimizeLegibility;-webkit-font-smoothing:antialiased}.text-align-left{text-align:left!important}.text-align-right{text-align:right!important}.text-align-center{text-align:center!important}.active{color:var(--wasm4-devtools-text-primary, #fff)}.dim{opacity:.4}.display-block{display:block!important}.info-box{text-align:center;padding:.2em .4em;color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7));background:var(--wasm4-devtools-bg-secondary, #444);border-radius:4px;min-width:60px;display:inline-block;font-size:.875em}.table{text-align:left;overflow:hidden;border-collapse:collapse;margin-bottom:0;border-style:solid;border-color:currentColor;border-width:1px;max-width:100%;font-size:var(--wasm4-devtools-text-size, 16px)}.table tbody,.table thead,.table tfoot,.table tr,.table td,.table th{overflow-wrap:break-word;text-align:inherit;font-size:inherit}.table td,.table th{border-width:0;border-style:none;border-color:inherit;font-size:.875em;padding:.3em .4em;min-width:50px;border-bottom:1px solid currentColor}a,a:visited{color:var(--wasm4-devtools-text-primary, #fff);outline:none;font-size:.875em}a:focus{color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7))}.list{padding-left:1.2em}.list li{list-style:disc}.fixed-wrapper{position:fixed;background:transparent;top:0;right:0;padding:4px;height:100vh;z-index:var(--wasm4-devtools-window-z-index, 11);pointer-events:none}.fixed-wrapper.pos-right .toggle-pos-btn{transform:rotateY(-180deg)}.fixed-wrapper.pos-left{right:auto;left:0}.fixed-wrapper.pos-left .toggle-pos-btn{transform:rotateY(0)}.devtools-wrapper{display:block;border:solid 1px gray;border-radius:4px;overflow:hidden;width:320px;position:relative;max-height:100%;pointer-events:auto}.devtools-wrapper:before{content:"";height:2.923em;width:100%}.devtools-wrapper .devtools-top-static-placeholder{height:2.923em;width:100%;padding:0}.devtools-wrapper .devtools-top{display:grid;grid-template-columns:1r auto;justify-content:space-between;grid-template-areas:". win-btn";align-items:center;overflow:hidden;padding:0 8px;position:absolute;background:theme;z-index:5;left:0;top:0;width:100%;height:2.923em}.devtools-wrapper .devtools-top-btn{grid-area:win-btn;height:inherit;-webkit-user-select:none;user-select:none;display:flex;justify-content:flex-end;align-items:center;grid-gap:4px}.devtools-wrapper .top-btn{border-radius:4px;background:transparent;border:none;box-shadow:none;color:inherit;display:flex;justify-content:center;align-items:center;width:2.2em;height:2.2em;cursor:pointer}.devtools-wrapper .devtools-body{max-height:calc(100vh - 2.923em - 8px);padding:0 8px 8px;overflow-x:hidden;overflow-y:auto}.devtools-wrapper .devtools-body::-webkit-scrollbar{-webkit-appearance:none;width:7px}.devtools-wrapper .devtools-body::-webkit-scrollbar-thumb{border-radius:4px;background-color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7));box-shadow:0 0 1px #ffffff80}.mouse-pos-list{display:grid;grid-template-columns:repeat(2,50px);grid-gap:16px}.mouse-pos{white-space:nowrap}.inline-section{display:flex;flex-flow:row nowrap;grid-gap:16px;align-items:center}.inline-section>*{margin:0}.cart-size-wrapper{display:grid;grid-auto-flow:row;justify-content:flex-start;align-items:flex-start;grid-gap:.25em}.cart-size-wrapper .size-box{display:flex;justify-content:space-between}.flags-wrapper{display:grid;grid-template-rows:1fr 1fr;grid-gap:16px}.flags-wrapper .flag-label{font-size:.875em}.tabs{display:flex;flex-flow:row nowrap;grid-gap:4px;cursor:pointer;font-weight:900;-webkit-user-select:none;user-select:none}.tabs .tab-item{pointer-events:auto;padding:4px}.tabs .tab-item[data-active="1"]{border-bottom:1px solid currentColor}`,Ki=[Te`*,*:before,*:after{box-sizing:border-box}section{padding:.4em 0}article{padding:.4em 0}ul{list-style:none;margin:0;padding:.2em 0}h1,h2,h3,h4,h5,h6{margin:.4em 0;font-size:1em}p{padding:0;margin:0}[hidden]{display:none!important}`,Te`:host{color:var(--wasm4-devtools-text-primary, #fff);background-color:var(--wasm4-devtools-bg-primary, #202020)}.text-primary{color:var(--wasm4-devtools-text-primary, #fff)!important}.text-secondary{color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7))!important}.bg-primary{background-color:var(--wasm4-devtools-bg-primary, #202020)!important}.bg-secondary{background-color:var(--wasm4-devtools-bg-secondary, #444)!important}:host{font-size:var(--wasm4-devtools-text-size, 16px);font-family:monospace;text-rendering:optimizeLegibility;-webkit-font-smoothing:antialiased}.text-align-left{text-align:left!important}.text-align-right{text-align:right!important}.text-align-center{text-align:center!important}.active{color:var(--wasm4-devtools-text-primary, #fff)}.dim{opacity:.4}.display-block{display:block!important}.info-box{text-align:center;padding:.2em .4em;color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7));background:var(--wasm4-devtools-bg-secondary, #444);border-radius:4px;min-width:60px;display:inline-block;font-size:.875em}.table{text-align:left;overflow:hidden;border-collapse:collapse;margin-bottom:0;border-style:solid;border-color:currentColor;border-width:1px;max-width:100%;font-size:var(--wasm4-devtools-text-size, 16px)}.table tbody,.table thead,.table tfoot,.table tr,.table td,.table th{overflow-wrap:break-word;text-align:inherit;font-size:inherit}.table td,.table th{border-width:0;border-style:none;border-color:inherit;font-size:.875em;padding:.3em .4em;min-width:50px;border-bottom:1px solid currentColor}a,a:visited{color:var(--wasm4-devtools-text-primary, #fff);outline:none;font-size:.875em}a:focus{color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7))}.list{padding-left:1.2em}.list li{list-style:disc}`].map((t=>Ue(t)));function Ji(...t){return Ki.concat(t.map((t=>"string"==typeof t?Ue(t):t)))}function Xi(t,e=2){return t.toString(16).padStart(e,"0").toUpperCase()}function Zi(t){return t}function Qi(t,e=0){return(1<<t)-1^(1<<e)-1}function tr(t,e,s=1){if(!Number.isFinite(t)||!Number.isFinite(e)||!Number.isFinite(s)||t>e||0===s)throw new TypeError(`invalid range input: from ${t}, to ${e}, step ${s}`);const i=(e-t)/s>>0;let r=[];for(let n=0;n<i;n++)r[n]=s*n+t;return r}var er=Object.defineProperty,sr=Object.getOwnPropertyDescriptor,ir=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?sr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&er(e,s,n),n};const rr="wasm4-devtools",nr=["general","controls","mem","persistent","info"],or=[Qi(3),Qi(7,3),Qi(11,7),Qi(15,11)];let ar=class extends Os{constructor(){super(...arguments),this.updateController=new Gi(this),this._expanded=!0,this._activeTab=nr[0],this._fixedPosition="right",this._handleCloseButtonClick=()=>{this.dispatchEvent(Yi())},this._handleTabClick=t=>{var e;const s=null==(e=t.composedPath()[0])?void 0:e.dataset.tabValue;nr.includes(s)&&(this._activeTab=s)},this._toggleExapanded=()=>{this._expanded=!this._expanded},this._changeFixedPosition=()=>{this._fixedPosition="left"===this._fixedPosition?"right":"left"},this._renderGeneralView=({memoryView:t,fps:e,wasmBufferByteLen:s})=>{const i=t.drawColors??0;return ms`<article>
-      <wasm4-palette
-        palette-heading="palette"
-        .palette=${t.palette}
-      ></wasm4-palette>
-      <section>
-        <h4>draw colors</h4>
-        <table class="table text-align-right">
-          <thead>
-            <tr>
-              <th>color</th>
-              <th>value</th>
-            </tr>
-          </thead>
-          <tbody>
-            ${Xs(or,Zi,((t,e)=>ms`<tr>
-                <td class="text-align-center">${e+1}</td>
-                <td>${i&t}</td>
-              </tr>`))}
-          </tbody>
-          <tfoot>
-            <tr>
-              <td class="text-align-center">sum</td>
-              <td>${i}</td>
-            </tr>
-          </tfoot>
-        </table>
-      </section>
-      <section class="inline-section">
-        <h4>fps</h4>
-        <span class="info-box text-primary">${e}</span>
-      </section>
-      <section class="cart-size-wrapper">
-        <h4>cartridge size ${s>Bi?"⚠️":""}</h4>
-        <div class="size-box">
-          current
-          <span class="info-box text-primary">${s}B</span>
-        </div>
-        <div class="size-box">
-          limit <span class="info-box text-primary">${Bi}B</span>
-        </div>
-      </section>
-      <section class="flags-section">
-        <h4>system flags</h4>
-        <div class="flags-wrapper">
-          <div>
-            <span class="flag-label">preserve framebuffer</span>
-            <span class="info-box text-primary"
-              >${1&t.systemFlags}</span
-            >
-          </div>
-          <div>
-            <span class="flag-label">hide gamepad overlay</span>
-            <span class="info-box text-primary"
-              >${2&t.systemFlags}</span
-            >
-          </div>
-        </div>
-      </section>
-    </article>`},this._renderInfo=()=>ms` <wasm4-info-view></wasm4-info-view> `,this._renderControls=({memoryView:t})=>ms`<wasm4-controls-view
-      .mouseButtons=${t.mouseBtnByte}
-      .mouseX=${t.pointerPos.x}
-      .mouseY=${t.pointerPos.y}
-      .gamepads=${t.gamepads}
-    ></wasm4-controls-view>`,this._renderMemory=({memoryView:t})=>ms`<wasm4-memory-view
-      .memoryView=${t}
-    ></wasm4-memory-view>`,this._renderPersistentView=({memoryView:t})=>ms`<wasm4-persistent-view
-      .memoryView=${t}
-    ></wasm4-persistent-view>`,this._renderTab=t=>{let e;switch(this._activeTab){case"controls":e=this._renderControls;break;case"info":e=this._renderInfo;break;case"mem":e=this._renderMemory;break;case"persistent":e=this._renderPersistentView;break;default:e=this._renderGeneralView}return e.call(this,t)}}render(){if(!this.updateController.state)return null;const t="move "+("left"===this._fixedPosition?"right":"left");return ms`<div
-      class=${Vs({"fixed-wrapper":1,[`pos-${this._fixedPosition}`]:1})}
-    >
-      <div class="devtools-wrapper bg-primary">
-        <div class="devtools-top-static-placeholder"></div>
-        <div class="devtools-top bg-primary">
-          <h2>devtools</h2>
-          <div class="devtools-top-btn">
-            <button
-              type="button"
-              aria-label="collapse"
-              class="top-btn"
-              title="collapse"
-              @click=${this._toggleExapanded}
-            >
-              <svg
-                xmlns="http://www.w3.org/2000/svg"
-                viewBox="0 0 24 24"
-                height="24px"
-                width="24px"
-                fill="currentColor"
-              >
-                <path d="M0 0h24v24H0V0z" fill="none" />
-                <path d="M6 19h12v2H6v-2z" />
-              </svg>
-            </button>
-            <button
-              type="button"
-              aria-label=${t}
-              class="top-btn toggle-pos-btn"
-              title=${t}
-              @click=${this._changeFixedPosition}
-            >
-              <svg
-                xmlns="http://www.w3.org/2000/svg"
-                viewBox="0 0 24 24"
-                height="24px"
-                width="24px"
-                fill="currentColor"
-              >
-                <path d="M0 0h24v24H0V0z" fill="none" />
-                <path d="M10 6L8.59 7.41 13.17 12l-4.58 4.59L10 18l6-6z" />
-              </svg>
-            </button>
-            <button
-              type="button"
-              aria-label="close"
-              class="top-btn"
-              title="close"
-              @click=${this._handleCloseButtonClick}
-            >
-              <svg
-                xmlns="http://www.w3.org/2000/svg"
-                viewBox="0 0 24 24"
-                height="24px"
-                width="24px"
-                fill="currentColor"
-              >
-                <path d="M0 0h24v24H0V0z" fill="none" />
-                <path
-                  d="M19 6.41L17.59 5 12 10.59 6.41 5 5 6.41 10.59 12 5 17.59 6.41 19 12 13.41 17.59 19 19 17.59 13.41 12 19 6.41z"
-                />
-              </svg>
-            </button>
-          </div>
-        </div>
-        <div class="devtools-body" ?hidden=${!this._expanded}>
-          <ul class="tabs" @click=${this._handleTabClick}>
-            ${Xs(nr,Zi,(t=>ms`<li
-                  data-tab-value=${t}
-                  data-active=${+(t===this._activeTab)}
-                  class="tab-item"
-                >
-                  ${t}
-                </li>`))}
-          </ul>
-          ${this._renderTab(this.updateController.state)}
-        </div>
-      </div>
-    </div>`}};ar.styles=Ji(qi),ir([Bs()],ar.prototype,"_expanded",2),ir([Bs()],ar.prototype,"_activeTab",2),ir([Bs()],ar.prototype,"_fixedPosition",2),ar=ir([Ms(rr)],ar);const lr=Te`.palette-grid{display:grid;grid-template-columns:repeat(4,1fr);height:50px;border-radius:4px;overflow:hidden;font-weight:800;font-size:.875em}.palette-grid .color-box{display:flex;align-items:center;justify-content:center}.palette-article h3{margin-bottom:.2em}`;var dr=Object.defineProperty,cr=Object.getOwnPropertyDescriptor,hr=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?cr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&dr(e,s,n),n};const pr="wasm4-palette";let ur=class extends Os{constructor(){super(...arguments),this.palette=[0,0,0,0],this.heading=""}render(){return ms`<section class="palette-article">
-      ${this.heading&&ms`<h4>${this.heading}</h4>`}
-      <div class="palette-grid">
-        ${this.palette.slice(0,4).map((t=>{const e=function(t){return`#${t.toString(16).toLowerCase().padStart(6,"0")}`}(16777215&t);return ms`<div
-            class="color-box"
-            data-color="${e}"
-            style="background: ${e}"
-          >
-            <div style=${((255&t)+(t>>8&255)+(t>>16))/3>128?"filter: invert(1)":""}>${e}</div>
-          </div>`}))}
-      </div>
-    </section>`}};ur.styles=Ji(lr),hr([Ds({type:Array})],ur.prototype,"palette",2),hr([Ds({type:String,attribute:"palette-heading"})],ur.prototype,"heading",2),ur=hr([Ms(pr)],ur);const mr=Te`.gamepad{pointer-events:none;position:relative;display:grid;grid-template-columns:1fr 1fr;justify-content:space-between;overflow:hidden}.gamepad-dpad{position:relative;width:39px;height:120px;background:#444;border-radius:9px;left:40px}.gamepad-dpad:before{position:absolute;width:120px;height:39px;top:39px;left:-39px;background:#444;border-radius:9px;content:""}.gamepad-dpad:after{position:absolute;height:39px;width:39px;top:39px;border-radius:100%;background:#333;content:""}.gamepad-dpad.pressed-left:before{border-left:4px solid #a93671;width:116px}.gamepad-dpad.pressed-right:before{border-right:4px solid #a93671;width:116px}.gamepad-dpad.pressed-up{border-top:4px solid #a93671}.gamepad-dpad.pressed-down{border-bottom:4px solid #a93671;height:116px}.gamepad-action1,.gamepad-action2{width:60px;height:60px;border:4px solid #a93671;border-radius:50px;flex:0 0 auto}.gamepad-action1{position:relative;right:60px}.gamepad-action1.pressed,.gamepad-action2.pressed{background:#a93671}.gamepad-actions{display:flex;flex-flow:column-reverse nowrap;align-items:flex-end;position:relative}`;var fr=Object.defineProperty,gr=Object.getOwnPropertyDescriptor,yr=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?gr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&fr(e,s,n),n};const vr="wasm4-gamepad";let br=class extends Os{constructor(){super(...arguments),this.action1=!1,this.action2=!1,this.up=!1,this.down=!1,this.left=!1,this.right=!1,this.rawValue=0}render(){const t=this.up||!!(64&this.rawValue),e=this.down||!!(128&this.rawValue),s=this.left||!!(16&this.rawValue),i=this.right||!!(32&this.rawValue),r=this.action1||!!(1&this.rawValue),n=this.action2||!!(2&this.rawValue);return ms`<div class="gamepad">
-      <div
-        class="${Vs({"gamepad-dpad":1,"pressed-right":i,"pressed-down":e,"pressed-left":s,"pressed-up":t})}"
-      ></div>
-      <div class="gamepad-actions">
-        <div
-          class="${Vs({"gamepad-action1":1,pressed:r})}"
-        ></div>
-        <div
-          class="${Vs({"gamepad-action2":1,pressed:n})}"
-        ></div>
-      </div>
-    </div>`}};br.styles=Ji(mr),yr([Ds({type:Boolean,reflect:!0,attribute:"action-1"})],br.prototype,"action1",2),yr([Ds({type:Boolean,reflect:!0,attribute:"action-2"})],br.prototype,"action2",2),yr([Ds({type:Boolean,reflect:!0})],br.prototype,"up",2),yr([Ds({type:Boolean,reflect:!0})],br.prototype,"down",2),yr([Ds({type:Boolean,reflect:!0})],br.prototype,"left",2),yr([Ds({type:Boolean,reflect:!0})],br.prototype,"right",2),yr([Ds({type:Number,reflect:!0,attribute:"raw-value"})],br.prototype,"rawValue",2),br=yr([Ms(vr)],br);var wr=Object.defineProperty,xr=Object.getOwnPropertyDescriptor,_r=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?xr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&wr(e,s,n),n};const $r="wasm4-controls-view";let Ar=class extends Os{constructor(){super(...arguments),this.mouseButtons=0,this.gamepads=[0,0,0,0],this.mouseX=0,this.mouseY=0,this.heading=""}render(){return ms`<article class="bg-primary" part="root-view">
-      ${this.heading&&ms`<h3 class="heading">${this.heading}</h3>`}
-      <section class="mouse-section">
-        <h4 class="heading">mouse position</h4>
-        <ul class="mouse-pos-list">
-          <li class="info-box mouse-pos">
-            <span class="text-primary">x: ${this.mouseX}</span>
-          </li>
-          <li class="info-box mouse-pos">
-            <span class="text-primary">y: ${this.mouseY}</span>
-          </li>
-        </ul>
-      </section>
-      <wasm4-mouse-buttons
-        heading="mouse buttons"
-        raw-value=${this.mouseButtons}
-      ></wasm4-mouse-buttons>
-      ${this.gamepads.map(((t,e)=>ms`<section>
-            <h4>gamepad ${e+1}</h4>
-            <wasm4-gamepad raw-value=${t}></wasm4-gamepad>
-          </section>`))}
-    </article>`}};Ar.styles=Ji(),_r([Ds({type:Number})],Ar.prototype,"mouseButtons",2),_r([Ds({type:Array})],Ar.prototype,"gamepads",2),_r([Ds({type:Number})],Ar.prototype,"mouseX",2),_r([Ds({type:Number})],Ar.prototype,"mouseY",2),_r([Ds({type:String,reflect:!0})],Ar.prototype,"heading",2),Ar=_r([Ms($r)],Ar);const Er=Te`.mouse-buttons{display:grid;grid-template-columns:repeat(3,1fr);grid-gap:8px}`;var Sr=Object.defineProperty,kr=Object.getOwnPropertyDescriptor,Pr=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?kr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&Sr(e,s,n),n};const Cr="wasm4-mouse-buttons";let Ur=class extends Os{constructor(){super(...arguments),this.middle=!1,this.right=!1,this.left=!1,this.rawValue=0,this.heading=""}render(){const t={left:this.left||!!(1&this.rawValue),middle:this.middle||!!(4&this.rawValue),right:this.right||!!(2&this.rawValue)};return ms`<section>
-      ${this.heading&&ms`<h4 class="heading">${this.heading}</h4>`}
-      <ul class="mouse-buttons">
-        ${Object.entries(t).map((([t,e])=>ms`<li
-              class=${Vs({"info-box":1,dim:!e,"text-primary":e})}
-            >
-              ${t}
-            </li>`))}
-      </ul>
-    </section> `}};Ur.styles=Ji(Er),Pr([Ds({type:Boolean,reflect:!0})],Ur.prototype,"middle",2),Pr([Ds({type:Boolean,reflect:!0})],Ur.prototype,"right",2),Pr([Ds({type:Boolean,reflect:!0})],Ur.prototype,"left",2),Pr([Ds({type:Number,reflect:!0,attribute:"raw-value"})],Ur.prototype,"rawValue",2),Pr([Ds({type:String,reflect:!0})],Ur.prototype,"heading",2),Ur=Pr([Ms(Cr)],Ur);const Tr=Te`:host{color:var(--wasm4-devtools-text-primary, #fff);background-color:var(--wasm4-devtools-bg-primary, #202020)}.text-primary{color:var(--wasm4-devtools-text-primary, #fff)!important}.text-secondary{color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7))!important}.bg-primary{background-color:var(--wasm4-devtools-bg-primary, #202020)!important}.bg-secondary{background-color:var(--wasm4-devtools-bg-secondary, #444)!important}:host{font-size:var(--wasm4-devtools-text-size, 16px);font-family:monospace;text-rendering:optimizeLegibility;-webkit-font-smoothing:antialiased}.text-align-left{text-align:left!important}.text-align-right{text-align:right!important}.text-align-center{text-align:center!important}.active{color:var(--wasm4-devtools-text-primary, #fff)}.dim{opacity:.4}.display-block{display:block!important}.info-box{text-align:center;padding:.2em .4em;color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7));background:var(--wasm4-devtools-bg-secondary, #444);border-radius:4px;min-width:60px;display:inline-block;font-size:.875em}.table{text-align:left;overflow:hidden;border-collapse:collapse;margin-bottom:0;border-style:solid;border-color:currentColor;border-width:1px;max-width:100%;font-size:var(--wasm4-devtools-text-size, 16px)}.table tbody,.table thead,.table tfoot,.table tr,.table td,.table th{overflow-wrap:break-word;text-align:inherit;font-size:inherit}.table td,.table th{border-width:0;border-style:none;border-color:inherit;font-size:.875em;padding:.3em .4em;min-width:50px;border-bottom:1px solid currentColor}a,a:visited{color:var(--wasm4-devtools-text-primary, #fff);outline:none;font-size:.875em}a:focus{color:var(--wasm4-devtools-text-secondary, rgba(255, 255, 255, .7))}.list{padding-left:1.2em}.list li{list-style:disc}.memory-map{image-rendering:pixelated;border:2px solid gray;border-radius:4px;flex:0 0 auto;align-self:center}.color-formula{font-size:.65em;padding:.1em;max-width:280px}.memory-map-wrapper{display:block;margin:0 auto}.hex-view{padding:.2em 0;min-height:80px;font-size:.61em;width:max-content;white-space:nowrap;overflow-x:hidden;text-transform:uppercase}.hex-view .hex-header{border-bottom:1px solid var(--wasm4-devtools-text-primary, #fff);margin-bottom:.5em;padding:.5em 0}.hex-form{font-size:.875em}.hex-form input[type=number]{width:75px;border:none;margin:0;padding:.2em;line-height:1.15;border-radius:4px}.hex-form .form-group{display:flex;justify-content:flex-start;align-items:center;grid-gap:4px}`;var Or=Object.defineProperty,Rr=Object.getOwnPropertyDescriptor,Mr=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?Rr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&Or(e,s,n),n};const Ir="wasm4-memory-view",Lr=256,Dr=65520;let Br=class extends Os{constructor(){super(...arguments),this.heading="",this.memoryView=null,this.hexEditor={values:{firstRow:0}},this._hexViewFirstRow=tr(0,16).map((t=>Xi(t))).join(" "),this.memoryCanvasRef=new ni,this.imageData=new ImageData(Lr,Lr),this._animationFrameRequestId=0,this._paintMemoryCanvas=()=>{var t;const e=null==(t=this.memoryCanvasRef.value)?void 0:t.getContext("2d"),s=this.memoryView;if(s&&e){e.clearRect(0,0,Lr,Lr);for(let t=0,e=this.imageData.data.byteLength;t<e;t+=4){const e=s.getUint8(t/4),i=240&e,r=(15&e)<<4;this.imageData.data[t]=0,this.imageData.data[t+1]=i,this.imageData.data[t+2]=r,this.imageData.data[t+3]=255}e.putImageData(this.imageData,0,0)}}}_handleHexEditorChange(t){const e=t.composedPath()[0];if("firstRow"===e.name){const t=Number(e.value);Number.isFinite(t)&&t%16==0&&t>=0&&t<=Dr&&t!==this.hexEditor.values.firstRow&&(this.hexEditor={...this.hexEditor,values:{...this.hexEditor.values,firstRow:t}})}}_renderHexView(t){if(!t)return;const{firstRow:e}=this.hexEditor.values,s=tr(0,8).map((t=>e+16*t)).filter((t=>t<=Dr)).map((e=>function(t,e){const s=Math.max(0,Math.min(e,t.byteLen-1));let i=[];for(let r=s,n=s+16;r<n;r++)i[r]=Xi(t.getUint8(r),2);return i.join(" ")}(t,e))),i=`${Xi(e,4)} - ${Xi(e+16*s.length-1,4)}`;return ms`
-      <section>
-        <h4>hex view</h4>
-        <form @input=${this._handleHexEditorChange} class="hex-form">
-          <div class="form-group">
-            <input
-              id="hex-view-first-row"
-              name="firstRow"
-              type="number"
-              min="0"
-              max=${Dr}
-              step="16"
-            /><label for="hex-view-first-row">range: ${i}</label>
-          </div>
-        </form>
-        <div class="hex-view">
-          <div class="hex-header">${this._hexViewFirstRow}</div>
-          ${s.map((t=>ms`<div>${t}</div>`))}
-        </div>
-      </section>
-    `}firstUpdated(){this._animationFrameRequestId=window.requestAnimationFrame(this._paintMemoryCanvas)}updated(t){t.has("memoryView")&&(this._animationFrameRequestId=window.requestAnimationFrame(this._paintMemoryCanvas))}disconnectedCallback(){this._animationFrameRequestId&&(window.cancelAnimationFrame(this._animationFrameRequestId),this._animationFrameRequestId=0)}render(){return ms`<article class="bg-primary" part="root-view">
-      <section class="memory-map-wrapper">
-        <h4>wasm memory (64KiB)</h4>
-        <canvas
-          width=${Lr}
-          height=${Lr}
-          class="memory-map"
-          ${ai(this.memoryCanvasRef)}
-        ></canvas>
-        <div class="color-formula">${"b = (byte & 0xf) << 4; g = (byte & 0xf0)"}</div>
-      </section>
-      ${this._renderHexView(this.memoryView)}
-    </article>`}};Br.styles=Ji(Tr),Mr([Ds({type:String,reflect:!0})],Br.prototype,"heading",2),Mr([Ds({type:Object,reflect:!1})],Br.prototype,"memoryView",2),Mr([Bs()],Br.prototype,"hexEditor",2),Br=Mr([Ms(Ir)],Br);const Nr=Te`:host{display:block;width:100%;height:100%}article{padding:1rem;height:100%;display:flex;flex-direction:column}header{margin-bottom:1rem}header h3{margin:0 0 .5rem;color:var(--color-text-primary)}header p{margin:0;color:var(--color-text-secondary);font-size:.9rem}.content{display:flex;gap:1rem;flex:1;min-height:0}.hex-section{flex:1;min-width:0}.sidebar{width:250px;display:flex;flex-direction:column;gap:1rem}.hex-grid{font-family:Courier New,monospace;font-size:.8rem;border:1px solid var(--color-border);border-radius:4px;overflow:hidden}.hex-header{display:flex;background:var(--color-bg-secondary);border-bottom:1px solid var(--color-border)}.hex-header .row-label,.hex-header .col-label{width:2rem;padding:.25rem;text-align:center;font-weight:700;color:var(--color-text-secondary)}.hex-row{display:flex}.hex-row:nth-child(2n){background:var(--color-bg-tertiary)}.hex-row .row-label{width:2rem;padding:.25rem;text-align:center;background:var(--color-bg-secondary);border-right:1px solid var(--color-border);font-weight:700;color:var(--color-text-secondary)}.hex-cell{width:2rem;padding:.25rem;text-align:center;cursor:pointer;transition:background-color .2s}.hex-cell:hover{background:var(--color-bg-hover)}.hex-cell.selected{background:var(--color-primary);color:var(--color-text-on-primary)}.details{border:1px solid var(--color-border);border-radius:4px;padding:1rem}.details h4{margin:0 0 .75rem;color:var(--color-text-primary)}.detail-row{display:flex;justify-content:space-between;align-items:center;margin-bottom:.5rem}.detail-row label{font-weight:700;color:var(--color-text-secondary)}.detail-row span{color:var(--color-text-primary)}.value-display{display:flex;align-items:center;gap:.5rem}.edit-controls{display:flex;align-items:center;gap:.25rem}.hex-input{width:3rem;padding:.25rem;border:1px solid var(--color-border);border-radius:2px;background:var(--color-bg-primary);color:var(--color-text-primary);font-family:Courier New,monospace;text-align:center;text-transform:uppercase}.edit-btn,.save-btn,.cancel-btn{padding:.25rem .5rem;border:1px solid var(--color-border);border-radius:2px;background:var(--color-bg-secondary);color:var(--color-text-primary);cursor:pointer;font-size:.75rem}.edit-btn:hover,.save-btn:hover,.cancel-btn:hover{background:var(--color-bg-hover)}.save-btn{background:var(--color-success);color:#fff;border-color:var(--color-success)}.save-btn:hover{background:var(--color-success-dark)}.cancel-btn{background:var(--color-danger);color:#fff;border-color:var(--color-danger)}.cancel-btn:hover{background:var(--color-danger-dark)}.utilities{border:1px solid var(--color-border);border-radius:4px;padding:1rem}.utilities h4{margin:0 0 .75rem;color:var(--color-text-primary)}.utility-buttons{display:flex;flex-direction:column;gap:.5rem}.clear-btn,.export-btn{padding:.5rem;border:1px solid var(--color-border);border-radius:4px;background:var(--color-bg-secondary);color:var(--color-text-primary);cursor:pointer}.clear-btn:hover,.export-btn:hover{background:var(--color-bg-hover)}.clear-btn{background:var(--color-warning);color:#fff;border-color:var(--color-warning)}.clear-btn:hover{background:var(--color-warning-dark)}.export-btn{background:var(--color-info);color:#fff;border-color:var(--color-info)}.export-btn:hover{background:var(--color-info-dark)}.no-data{padding:2rem;text-align:center;color:var(--color-text-secondary);font-style:italic}`;var Fr=Object.defineProperty,zr=Object.getOwnPropertyDescriptor,jr=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?zr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&Fr(e,s,n),n};const Vr="wasm4-persistent-view";let Hr=class extends Os{constructor(){super(...arguments),this.memoryView=null,this.selectedOffset=0}_handleOffsetClick(t){this.selectedOffset=t}_renderHexGrid(){if(!this.memoryView)return ms`<div class="no-data">No memory data available</div>`;const t=[];for(let e=0;e<16;e++){const s=[];for(let t=0;t<16;t++){const i=16*e+t,r=this.memoryView.getUint8(Di+i),n=i===this.selectedOffset;s.push(ms`
-          <div 
-            class="hex-cell ${n?"selected":""}"
-            @click=${()=>this._handleOffsetClick(i)}
-            title="Offset: ${Xi(i,2)}, Value: ${Xi(r,2)}"
-          >
-            ${Xi(r,2)}
-          </div>
-        `)}t.push(ms`
-        <div class="hex-row">
-          <div class="row-label">${Xi(16*e,2)}</div>
-          ${s}
-        </div>
-      `)}return ms`
-      <div class="hex-grid">
-        <div class="hex-header">
-          <div class="row-label"></div>
-          ${Array.from({length:16},((t,e)=>ms`<div class="col-label">${Xi(e,1)}</div>`))}
-        </div>
-        ${t}
-      </div>
-    `}_renderDetails(){if(!this.memoryView)return ms``;const t=this.memoryView.getUint8(Di+this.selectedOffset),e=Di+this.selectedOffset;return ms`
-      <div class="details">
-        <h4>Selected Byte</h4>
-        <div class="detail-row">
-          <label>Offset:</label>
-          <span>${Xi(this.selectedOffset,2)} (${this.selectedOffset})</span>
-        </div>
-        <div class="detail-row">
-          <label>Address:</label>
-          <span>${Xi(e,4)}</span>
-        </div>
-        <div class="detail-row">
-          <label>Value:</label>
-          <span class="value-display">
-            ${Xi(t,2)} (${t})
-          </span>
-        </div>
-        <div class="detail-row">
-          <label>Binary:</label>
-          <span>${t.toString(2).padStart(8,"0")}</span>
-        </div>
-        <div class="detail-row">
-          <label>ASCII:</label>
-          <span>${t>=32&&t<=126?String.fromCharCode(t):"·"}</span>
-        </div>
-      </div>
-    `}_renderUtilities(){return this.memoryView?ms`
-      <div class="utilities">
-        <h4>Utilities</h4>
-        <div class="utility-buttons">
-          <button @click=${()=>{const t=new Uint8Array(256);for(let r=0;r<256;r++)t[r]=this.memoryView.getUint8(Di+r);const e=new Blob([t],{type:"application/octet-stream"}),s=URL.createObjectURL(e),i=document.createElement("a");i.href=s,i.download="persistent-data.bin",i.click(),URL.revokeObjectURL(s)}} class="export-btn">Export Data</button>
-        </div>
-      </div>
-    `:ms``}render(){return ms`
-      <article class="bg-primary" part="root-view">
-        <header>
-          <h3>Persistent Memory Area (256 bytes)</h3>
-          <p>Cart data storage for scores, settings, and other persistent information</p>
-        </header>
-        
-        <div class="content">
-          <div class="hex-section">
-            ${this._renderHexGrid()}
-          </div>
-          
-          <div class="sidebar">
-            ${this._renderDetails()}
-            ${this._renderUtilities()}
-          </div>
-        </div>
-      </article>
-    `}};Hr.styles=Ji(Nr),jr([Ds({type:Object,reflect:!1})],Hr.prototype,"memoryView",2),jr([Bs()],Hr.prototype,"selectedOffset",2),Hr=jr([Ms(Vr)],Hr);var Gr=Object.defineProperty,Wr=Object.getOwnPropertyDescriptor,Yr=(t,e,s,i)=>{for(var r,n=i>1?void 0:i?Wr(e,s):e,o=t.length-1;o>=0;o--)(r=t[o])&&(n=(i?r(e,s,n):r(n))||n);return i&&n&&Gr(e,s,n),n};const qr="wasm4-info-view",Kr=[{key:"2",description:"Save state"},{key:"4",description:"Load state"},{key:"R",description:"Reboot cartridge"},{key:"F8",description:"Open devtools"},{key:"F9",description:"Take screenshot"},{key:"F10",description:"Record 4 second video"},{key:"F11",description:"Fullscreen"}],Jr=[{label:"website",href:"https://wasm4.org/"},{label:"docs",href:"https://wasm4.org/docs"},{label:"github",href:"https://github.com/aduros/wasm4"}];let Xr=class extends Os{constructor(){super(...arguments),this.heading=""}render(){return ms`
-      <article class="bg-primary" part="root-view">
-        ${this.heading&&ms`<h3 class="heading">${this.heading}</h3>`}
-        <section>
-          <h4>links</h4>
-          <ul class="list">
-            ${Xs(Jr,(({href:t})=>t),(({href:t,label:e})=>ms`<li>
-                  <a target="_blank" rel="noopener" href=${t}>${e}</a>
-                </li>`))}
-          </ul>
-        </section>
-        <section>
-          <h4>keybindings</h4>
-          <table class="table">
-            <thead>
-              <tr>
-                <th>key</th>
-                <th>description</th>
-              </tr>
-            </thead>
-            <tbody>
-              ${Xs(Kr,(({key:t})=>t),(({key:t,description:e})=>ms`<tr>
-                    <td>${t}</td>
-                    <td>${e}</td>
-                  </tr>`))}
-            </tbody>
-          </table>
-        </section>
-        <section>
-          <h4>memory map</h4>
-          <table class="table">
-            <thead>
-              <tr>
-                <th>address</th>
-                <th>size (bytes)</th>
-                <th>description</th>
-              </tr>
-            </thead>
-            <tbody>
-              ${Xs(Object.entries(Ni),(([t,{offset:e}])=>e),(([t,{offset:e,len:s}])=>ms`<tr>
-                    <td>0x${Xi(e)}</td>
-                    <td>${s}</td>
-                    <td>${t}</td>
-                  </tr>`))}
-            </tbody>
-          </table>
-        </section>
-      </article>
-    `}};Xr.styles=Ji(),Yr([Ds({type:String,reflect:!0})],Xr.prototype,"heading",2),Xr=Yr([Ms(qr)],Xr);class Zr{constructor(){this.mouseButtons=0,this.gamepads=[0,0,0,0],this.update=t=>{this.mouseButtons=this.mouseButtons|t.getUint8(30);for(let e=0,s=this.gamepads.length;e<s;e++)this.gamepads[e]=t.getUint8(Fi[`ADDR_GAMEPAD${e+1}`])|this.gamepads[e]},this.flush=()=>{const t={mouseButtons:this.mouseButtons,gamepads:this.gamepads.slice()};return this.mouseButtons=0,this.gamepads.fill(0),t}}}const Qr=Object.freeze(Object.defineProperty({__proto__:null,DevtoolsManager:class{constructor(){this._enabled=!1,this._bufferedData=new Zr,this._interFrameTimeBuffer=new Array(30).fill(1e3/60),this._fpsBufferIdx=0,this._calcAvgFPS=()=>{let t=this._interFrameTimeBuffer[0];for(let e=1;e<30;e++)t+=this._interFrameTimeBuffer[e];return Math.round(3e4/t)},this._nextFPSBufferIdx=()=>(this._fpsBufferIdx++,30==this._fpsBufferIdx&&(this._fpsBufferIdx=0),this._fpsBufferIdx),this.updateCompleted=(t,e)=>{this._enabled&&(this._interFrameTimeBuffer[this._nextFPSBufferIdx()]=e,this._bufferedData.update(t.data),this._notifyUpdateCompleted(t.data,t.wasmBufferByteLen,this._calcAvgFPS()))},this.removeDevTools=()=>{this._enabled&&this.toggleDevtools()},this.toggleDevtools=()=>{this._enabled=!this._enabled,this._enabled?(window.addEventListener(Wi,this.removeDevTools),document.body.appendChild(document.createElement(rr))):(window.removeEventListener(Wi,this.removeDevTools),Array.from(document.body.querySelectorAll(rr)).forEach((t=>{var e;null==(e=null==t?void 0:t.parentElement)||e.removeChild(t)})))},this._notifyUpdateCompleted=function(t,e,s){var i=!0,r=!0;if("function"!=typeof t)throw new TypeError("Expected a function");return Ei(s)&&(i="leading"in s?!!s.leading:i,r="trailing"in s?!!s.trailing:r),Li(t,e,{leading:i,maxWait:e,trailing:r})}(((t,e,s)=>{window.dispatchEvent(Hi({dataView:t,wasmBufferByteLen:e,fps:s,bufferedData:this._bufferedData.flush()}))}),200)}},get Wasm4ControlsView(){return Ar},get Wasm4Devtools(){return ar},get Wasm4Gamepad(){return br},get Wasm4InfoView(){return Xr},get Wasm4MemoryView(){return Br},get Wasm4MouseButtons(){return Ur},get Wasm4Palette(){return ur},get Wasm4PersistentView(){return Hr},closeDevtoolsEventType:Wi,createCloseDevtoolsEvent:Yi,createUpdateCompletedEvent:Hi,updateCompletedEventType:ji,wasm4ControlsViewTagName:$r,wasm4DevtoolsTagName:rr,wasm4GamepadTagName:vr,wasm4InfoTagName:qr,wasm4MemoryViewTagName:Ir,wasm4MouseTagName:Cr,wasm4PaletteTagName:pr,wasm4PersistentViewTagName:Vr},Symbol.toStringTag,{value:"Module"}));return Object.defineProperty(t,Symbol.toStringTag,{value:"Module"}),t}({});
-//# sourceMappingURL=wasm4.js.map
@@ -23,6 +23,14 @@ const leaderboardControls = document.getElementById('leaderboard-controls')!;
 const shortenAddress = (address: string) => `${address.substring(0, 6)}...${address.substring(address.length - 4)}`;
 const walletStatusDiv = document.getElementById('wallet-status') as HTMLDivElement;
 
+// public/wasm4.js is built from ../runtimes/web by `npm run sync-runtime`, which dev and build run
+// first. Runs are replayed with it before they're submitted, so a bundle without verifyReplay()
+// can't start a game.
+const runtimeCanVerify = typeof (window as any).Wasm4?.prototype?.verifyReplay === 'function';
+if (!runtimeCanVerify) {
+    console.error('This wasm4.js has no verifyReplay(), run `npm run sync-runtime` to rebuild it.');
+}
+
 // Web3-Onboard Initialization
 const injected = injectedModule();
 const onboard = Onboard({
@@ -106,9 +114,12 @@ async function updateUI(wallet: any | null) {
         // The main goal is to prevent the timeout from crashing the UI.
 
         walletStatusDiv.textContent = `Connected: ${name} - ${shortenAddress(address)}`;
+        if (!runtimeCanVerify) {
+            walletStatusDiv.textContent += ' (game unavailable: runtime is out of date)';
+        }
         connectButton.style.display = 'none';
         disconnectButton.style.display = 'block';
-        startButton.style.display = 'block';
+        startButton.style.display = runtimeCanVerify ? 'block' : 'none';
         leaderboardContainer.style.display = 'block'; // Hide on connect
 
     } else {
@@ -164,6 +175,15 @@ async function startGame() {
         const gameData = await wasm4.run('/cart.wasm');
         console.log('Game exited, received data:', gameData);
 
+        // Replay the run locally before spending a backend slot and a proof on it
+        const replay = await wasm4.verifyReplay(gameData);
+        if (!replay.ok) {
+            console.error('Replay verification failed:', replay);
+            alert('This run could not be reproduced from its recorded inputs, so it was not submitted.');
+            title.style.display = 'block';
+            return;
+        }
+
         // TODO: Hide game container, show results/leaderboard
 
         // Now, submit the data to the backend
@@ -175,7 +195,7 @@ async function startGame() {
     title.style.display = 'block';
 }
 
-async function submitGameData(gameData: { persistentData: any, events_serialized: string }) {
+async function submitGameData(gameData: { persistentData: any, initialPersistentData?: any, events_serialized: string, framebuffer_hashes: string }) {
     if (!jwtToken) {
         console.error('No JWT token, cannot submit game data.');
         return;
@@ -188,9 +208,11 @@ async function submitGameData(gameData: { persistentData: any, events_serialized
         const score = gameData.persistentData.score;
         const frames = gameData.persistentData.frames;
         const health = gameData.persistentData.health;
-        const seed = gameData.persistentData.game_seed;
-        const max_frames = gameData.persistentData.max_frames;
-        const game_mode = gameData.persistentData.game_mode;
+        // The run is replayed from what it started with, which older bundles don't report
+        const initial = gameData.initialPersistentData ?? gameData.persistentData;
+        const seed = initial.game_seed;
+        const max_frames = initial.max_frames;
+        const game_mode = initial.game_mode;
 
         console.info(`Submitting game data to backend... score: ${score}, frames: ${frames}, health: ${health}, seed: ${seed}, max_frames: ${max_frames}, game_mode: ${game_mode}`);
 
@@ -202,6 +224,7 @@ async function submitGameData(gameData: { persistentData: any, events_serialized
             max_frames,
             game_mode,
             serialized_events: gameData.events_serialized,
+            framebuffer_hashes: gameData.framebuffer_hashes,
         };
 
 